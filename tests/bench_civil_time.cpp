@@ -0,0 +1,80 @@
+// Conversions per second on the host: the calendar functions against
+// glibc's timegm/gmtime_r, and TimeZone::offsetAt against localtime_r for
+// the same rules, both for a clock ticking in order (the cached interval
+// holds) and for random times between 1970 and 2100 (recomputed each time).
+
+#include <chrono>
+#include <random>
+#include <time.h>
+#include <vector>
+#include "civil_time.h"
+#include "timezone.h"
+
+static const char* const TZ = "CET-1CEST,M3.5.0,M10.5.0/3";
+static const uint32_t COUNT = 2000000;
+
+static volatile int64_t sink;
+
+template <typename Convert>
+static void run(const char* name, const std::vector<int64_t>& inputs, Convert convert) {
+    int64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t input : inputs) {
+        sum += convert(input);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sink = sum;
+    printf("%-32s %7.1f M/s %7.1f ns each\n", name, inputs.size() / seconds / 1e6, seconds * 1e9 / inputs.size());
+}
+
+int main() {
+    const int64_t end = static_cast<int64_t>(daysFromCivil(2101, 1, 1)) * SECONDS_PER_DAY;
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int64_t> anyTime(0, end - 1);
+    std::vector<int64_t> randomTimes(COUNT);
+    std::vector<int64_t> ticking(COUNT);
+    for (uint32_t i = 0; i < COUNT; i++) {
+        randomTimes[i] = anyTime(random);
+        ticking[i] = 1700000000 + i;
+    }
+
+    run("civilFromDays", randomTimes, [](int64_t t) {
+        CivilDate date = civilFromDays(daysFromSeconds(t));
+        return date.year + date.month + date.day;
+    });
+    run("gmtime_r", randomTimes, [](int64_t t) {
+        time_t tt = static_cast<time_t>(t);
+        struct tm tm;
+        gmtime_r(&tt, &tm);
+        return tm.tm_year + tm.tm_mon + tm.tm_mday;
+    });
+    run("daysFromCivil", randomTimes, [](int64_t t) {
+        return daysFromCivil(1970 + static_cast<int32_t>(t % 131), 1 + t % 12, 1 + t % 28);
+    });
+    run("timegm", randomTimes, [](int64_t t) {
+        struct tm tm = {};
+        tm.tm_year = 70 + static_cast<int>(t % 131);
+        tm.tm_mon = static_cast<int>(t % 12);
+        tm.tm_mday = 1 + static_cast<int>(t % 28);
+        return static_cast<int64_t>(timegm(&tm));
+    });
+
+    setenv("TZ", TZ, 1);
+    tzset();
+    TimeZone::set(TZ);
+    run("TimeZone::offsetAt, ticking", ticking, [](int64_t t) { return TimeZone::offsetAt(t); });
+    run("TimeZone::offsetAt, random", randomTimes, [](int64_t t) { return TimeZone::offsetAt(t); });
+    run("localtime_r, ticking", ticking, [](int64_t t) {
+        time_t tt = static_cast<time_t>(t);
+        struct tm tm;
+        localtime_r(&tt, &tm);
+        return tm.tm_gmtoff;
+    });
+    run("localtime_r, random", randomTimes, [](int64_t t) {
+        time_t tt = static_cast<time_t>(t);
+        struct tm tm;
+        localtime_r(&tt, &tm);
+        return tm.tm_gmtoff;
+    });
+    return 0;
+}
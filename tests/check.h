@@ -0,0 +1,24 @@
+// Minimal assertions for the host tests: a failed CHECK prints where and
+// carries on, and the test exits with checkResult().
+#pragma once
+
+#include <stdio.h>
+
+inline int hostCheckFailures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            hostCheckFailures++;                                                \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+        }                                                                       \
+    } while (0)
+
+inline int checkResult(const char* name) {
+    if (hostCheckFailures) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, hostCheckFailures);
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
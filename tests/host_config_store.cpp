@@ -0,0 +1,41 @@
+// ConfigStore kept in memory instead of data flash, for code under test that
+// loads or saves settings
+
+#include <map>
+#include <vector>
+#include "config_store.h"
+#include "host_config_store.h"
+
+static std::map<uint8_t, std::vector<uint8_t>> hostConfig;
+
+void hostConfigClear() {
+    hostConfig.clear();
+}
+
+bool ConfigStore::get(ConfigKey key, void* value, size_t size) {
+    auto it = hostConfig.find(static_cast<uint8_t>(key));
+    if (it == hostConfig.end() || it->second.size() != size) {
+        return false;
+    }
+    memcpy(value, it->second.data(), size);
+    return true;
+}
+
+bool ConfigStore::set(ConfigKey key, const void* value, size_t size) {
+    if (size > MAX_VALUE_SIZE) {
+        return false;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    hostConfig[static_cast<uint8_t>(key)].assign(bytes, bytes + size);
+    return true;
+}
+
+bool ConfigStore::getString(ConfigKey key, char* value, size_t capacity) {
+    auto it = hostConfig.find(static_cast<uint8_t>(key));
+    if (it == hostConfig.end() || it->second.size() >= capacity) {
+        return false;
+    }
+    memcpy(value, it->second.data(), it->second.size());
+    value[it->second.size()] = '\0';
+    return true;
+}
@@ -0,0 +1,5 @@
+// ConfigStore in memory (host_config_store.cpp), empty at start
+#pragma once
+
+// Forget every stored setting
+void hostConfigClear();
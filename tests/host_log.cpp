@@ -0,0 +1,24 @@
+#include "host_log.h"
+
+std::vector<LogRecord> hostLog;
+
+bool Log::writeRecord(LogMsg id, uint8_t argCount, int32_t a, int32_t b, int32_t c) {
+    LogRecord record;
+    record.timestamp = millis();
+    record.id = static_cast<uint16_t>(id);
+    record.argCount = argCount;
+    record.args[0] = a;
+    record.args[1] = b;
+    record.args[2] = c;
+    hostLog.push_back(record);
+    return true;
+}
+
+const LogRecord* hostLastLog(LogMsg id) {
+    for (auto it = hostLog.rbegin(); it != hostLog.rend(); ++it) {
+        if (it->id == static_cast<uint16_t>(id)) {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
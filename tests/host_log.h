@@ -0,0 +1,12 @@
+// LOG() records made by the code under test, kept in order instead of going
+// to the drain task. %s arguments are pointers truncated to 32 bits, so only
+// the message IDs and numeric arguments are meant to be checked.
+#pragma once
+
+#include <vector>
+#include "log.h"
+
+extern std::vector<LogRecord> hostLog;
+
+// The last record with this ID, or nullptr
+const LogRecord* hostLastLog(LogMsg id);
@@ -0,0 +1,161 @@
+// Replays recorded sensor traces through ActivityDetector, with the missed-
+// wake decision Alarm::updateWakeWatch() makes on it: awake once the score
+// crosses the threshold, missed if the window runs out first. Use it to tune
+// the detector against real mornings.
+//
+//   replay_activity [options] trace...
+//     -m N   motionWeight            -s N   soundWeight
+//     -f N   soundThresholdFactor    -d N   decayShift
+//     -t N   awakeThreshold          -w N   window in seconds (900)
+//     -v     print the confidence every second
+//
+// A trace starts when the alarm is stopped. One event per line, times in ms:
+//
+//   <ms> motion                      a PIR rising edge
+//   <ms> sound <meanSquare> [n]      n (default 1) sound blocks 25 ms apart,
+//                                    as SoundMeter::BlockResult::meanSquare
+//   # expect awake|missed            checked; the exit status is 1 on a miss
+//
+// Other lines starting with # are comments.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "activity_detector.h"
+
+struct Event {
+    unsigned long time;
+    bool motion;
+    uint32_t meanSquare;
+};
+
+struct Trace {
+    std::vector<Event> events;
+    std::string expect;
+};
+
+static const unsigned long TASK_PERIOD = 10;     // ms, the alarm task
+
+static bool load(const char* path, Trace& trace) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    char line[160];
+    int number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        number++;
+        char word[16];
+        char expect[16];
+        unsigned long time;
+        unsigned long meanSquare;
+        unsigned long count = 1;
+        if (sscanf(line, " # expect %15s", expect) == 1) {
+            trace.expect = expect;
+        } else if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') {
+            continue;
+        } else if (sscanf(line, "%lu %15s", &time, word) == 2 && strcmp(word, "motion") == 0) {
+            trace.events.push_back({time, true, 0});
+        } else if (sscanf(line, "%lu %15s %lu %lu", &time, word, &meanSquare, &count) >= 3 && strcmp(word, "sound") == 0) {
+            for (unsigned long i = 0; i < count; i++) {
+                trace.events.push_back({time + i * 25, false, static_cast<uint32_t>(meanSquare)});
+            }
+        } else {
+            fprintf(stderr, "%s:%d: cannot parse: %s", path, number, line);
+            fclose(file);
+            return false;
+        }
+    }
+    fclose(file);
+    std::stable_sort(trace.events.begin(), trace.events.end(),
+                     [](const Event& a, const Event& b) { return a.time < b.time; });
+    return true;
+}
+
+// Returns "awake" or "missed", and when it was decided
+static const char* replay(const Trace& trace, const ActivityDetector::Tuning& tuning, unsigned long window,
+                          bool verbose, unsigned long& decidedAt, uint16_t& peak) {
+    ActivityDetector detector(tuning);
+    detector.reset(0);
+    peak = 0;
+    size_t next = 0;
+
+    for (unsigned long now = 0;; now += TASK_PERIOD) {
+        for (; next < trace.events.size() && trace.events[next].time <= now; next++) {
+            const Event& event = trace.events[next];
+            if (event.motion) {
+                detector.onMotion(event.time);
+            } else {
+                detector.onSoundBlock(event.meanSquare, event.time);
+            }
+        }
+
+        detector.update(now);
+        peak = std::max(peak, detector.confidence());
+        if (verbose && now % 1000 == 0) {
+            printf("%lu,%u\n", now / 1000, detector.confidence());
+        }
+
+        if (detector.hasSeenAwake()) {
+            decidedAt = now;
+            return "awake";
+        }
+        if (now >= window) {
+            decidedAt = now;
+            return "missed";
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    ActivityDetector::Tuning tuning = ActivityDetector::DEFAULT_TUNING;
+    unsigned long window = 15UL * 60 * 1000;
+    bool verbose = false;
+    std::vector<const char*> paths;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "-v") == 0) {
+            verbose = true;
+            continue;
+        }
+        if (arg[0] == '-' && i + 1 < argc) {
+            long value = atol(argv[++i]);
+            switch (arg[1]) {
+                case 'm': tuning.motionWeight = static_cast<uint16_t>(value); continue;
+                case 's': tuning.soundWeight = static_cast<uint16_t>(value); continue;
+                case 'f': tuning.soundThresholdFactor = static_cast<uint8_t>(value); continue;
+                case 'd': tuning.decayShift = static_cast<uint8_t>(value); continue;
+                case 't': tuning.awakeThreshold = static_cast<uint16_t>(value); continue;
+                case 'w': window = static_cast<unsigned long>(value) * 1000; continue;
+            }
+        }
+        if (arg[0] == '-') {
+            fprintf(stderr, "usage: %s [-m N] [-s N] [-f N] [-d N] [-t N] [-w s] [-v] trace...\n", argv[0]);
+            return 2;
+        }
+        paths.push_back(arg);
+    }
+
+    int mismatches = 0;
+    for (const char* path : paths) {
+        Trace trace;
+        if (!load(path, trace)) {
+            return 2;
+        }
+        unsigned long decidedAt;
+        uint16_t peak;
+        if (verbose) {
+            printf("# %s\nsecond,confidence\n", path);
+        }
+        const char* outcome = replay(trace, tuning, window, verbose, decidedAt, peak);
+        bool matches = trace.expect.empty() || trace.expect == outcome;
+        printf("%-28s %-6s at %4lu s, peak confidence %4u%s%s%s\n", path, outcome, decidedAt / 1000, peak,
+               matches ? "" : " (expected ", matches ? "" : trace.expect.c_str(), matches ? "" : ")");
+        if (!matches) {
+            mismatches++;
+        }
+    }
+    return mismatches ? 1 : 0;
+}
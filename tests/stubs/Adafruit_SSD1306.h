@@ -0,0 +1,20 @@
+// Host stand-in for the OLED driver: draws nothing
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define SSD1306_SWITCHCAPVCC 2
+#define SSD1306_WHITE 1
+
+class Adafruit_SSD1306 : public Print {
+public:
+    Adafruit_SSD1306(int, int, TwoWire*, int) {}
+    bool begin(int, int) { return true; }
+    void clearDisplay() {}
+    void display() {}
+    void setTextSize(int) {}
+    void setTextColor(int) {}
+    void setCursor(int, int) {}
+    size_t write(uint8_t) override { return 1; }
+};
@@ -0,0 +1,220 @@
+// Host stand-in for the Arduino core, with just what the tested parts of the
+// sketch use. Time is simulated: a test moves it on with hostAdvance().
+#pragma once
+
+#include <ctype.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "host_cmsis.h"
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define RISING 2
+#define FALLING 3
+#define DEC 10
+#define HEX 16
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define DAC A0
+#define F(x) x
+#define PROGMEM
+
+// Simulated time
+inline uint64_t hostMicros = 0;
+
+inline void hostAdvance(uint64_t micros) {
+    hostMicros += micros;
+    DWT->CYCCNT = static_cast<uint32_t>(hostMicros * (SystemCoreClock / 1000000UL));
+}
+
+inline unsigned long millis() { return static_cast<unsigned long>(hostMicros / 1000); }
+inline unsigned long micros() { return static_cast<unsigned long>(hostMicros); }
+inline void delay(unsigned long ms) { hostAdvance(ms * 1000ULL); }
+inline void delayMicroseconds(unsigned int us) { hostAdvance(us); }
+
+// Pins. tone() and digitalWrite() report to optional hooks so a test can
+// trace them.
+inline void (*hostToneHook)(unsigned int pin, unsigned int frequency) = nullptr;
+inline void (*hostPinHook)(int pin, int level) = nullptr;
+
+inline void pinMode(int, int) {}
+inline int digitalRead(int) { return LOW; }
+inline void digitalWrite(int pin, int level) { if (hostPinHook) hostPinHook(pin, level); }
+inline int analogRead(int) { return 2048; }
+inline void analogWrite(int, int) {}
+inline void analogReadResolution(int) {}
+inline void analogWriteResolution(int) {}
+inline void tone(unsigned int pin, unsigned int frequency, unsigned long = 0) { if (hostToneHook) hostToneHook(pin, frequency); }
+inline void noTone(unsigned int pin) { if (hostToneHook) hostToneHook(pin, 0); }
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void attachInterrupt(int, void (*)(), int) {}
+inline void detachInterrupt(int) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// The bounds take x's type, as they do in the core's macro once assigned
+template <class T, class L, class H>
+T constrain(T x, L low, H high) {
+    T lo = low, hi = high;
+    return x < lo ? lo : (x > hi ? hi : x);
+}
+template <class A, class B>
+auto min(A a, B b) { return a < b ? a : b; }
+template <class A, class B>
+auto max(A a, B b) { return a > b ? a : b; }
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+class String {
+public:
+    String(const char* s = "") : s(s ? s : "") {}
+    String(int v) : s(std::to_string(v)) {}
+    String(unsigned int v) : s(std::to_string(v)) {}
+    String(long v) : s(std::to_string(v)) {}
+    String(unsigned long v) : s(std::to_string(v)) {}
+    String(float v) : s(std::to_string(v)) {}
+
+    String operator+(const String& o) const { String r; r.s = s + o.s; return r; }
+    friend String operator+(const char* a, const String& b) { return String(a) + b; }
+    String& operator+=(const String& o) { s += o.s; return *this; }
+    String& operator+=(char c) { s += c; return *this; }
+    bool operator==(const char* o) const { return s == o; }
+    char operator[](unsigned int i) const { return s[i]; }
+    unsigned int length() const { return s.size(); }
+    const char* c_str() const { return s.c_str(); }
+    bool reserve(unsigned int n) { s.reserve(n); return true; }
+    int toInt() const { return atoi(s.c_str()); }
+    bool startsWith(const char* prefix) const { return s.compare(0, strlen(prefix), prefix) == 0; }
+    int indexOf(char c) const { size_t i = s.find(c); return i == std::string::npos ? -1 : static_cast<int>(i); }
+    String substring(unsigned int from, unsigned int to = ~0u) const {
+        return String(s.substr(from, to == ~0u ? std::string::npos : to - from).c_str());
+    }
+    void trim() {
+        s.erase(0, s.find_first_not_of(" \t\r\n"));
+        s.erase(s.find_last_not_of(" \t\r\n") + 1);
+    }
+    void toLowerCase() { for (char& c : s) c = tolower(c); }
+
+private:
+    std::string s;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buffer++);
+        return n;
+    }
+    size_t write(const char* s) { return s ? write(reinterpret_cast<const uint8_t*>(s), strlen(s)) : 0; }
+    size_t write(const char* buffer, size_t size) { return write(reinterpret_cast<const uint8_t*>(buffer), size); }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+    size_t print(unsigned char v, int base = DEC) { return print(static_cast<unsigned long>(v), base); }
+    size_t print(int v, int base = DEC) { return print(static_cast<long>(v), base); }
+    size_t print(unsigned int v, int base = DEC) { return print(static_cast<unsigned long>(v), base); }
+    size_t print(long v, int base = DEC) { return v < 0 && base == DEC ? print('-') + print(static_cast<unsigned long>(-v), base) : print(static_cast<unsigned long>(v), base); }
+    size_t print(unsigned long v, int base = DEC) { return printNumber(v, base); }
+    size_t print(long long v, int base = DEC) { return v < 0 && base == DEC ? print('-') + printNumber(static_cast<unsigned long long>(-v), base) : printNumber(static_cast<unsigned long long>(v), base); }
+    size_t print(unsigned long long v, int base = DEC) { return printNumber(v, base); }
+    size_t print(double v, int digits = 2) {
+        char text[40];
+        snprintf(text, sizeof(text), "%.*f", digits, v);
+        return write(text);
+    }
+
+    size_t println() { return write("\r\n"); }
+    template <class T>
+    size_t println(const T& v) { return print(v) + println(); }
+    template <class T>
+    size_t println(const T& v, int format) { return print(v, format) + println(); }
+
+private:
+    size_t printNumber(unsigned long long v, int base) {
+        char text[72];
+        char* p = &text[sizeof(text) - 1];
+        *p = '\0';
+        do {
+            int digit = static_cast<int>(v % base);
+            *--p = static_cast<char>(digit < 10 ? '0' + digit : 'A' + digit - 10);
+            v /= base;
+        } while (v);
+        return write(p);
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() { return -1; }
+    void setTimeout(unsigned long) {}
+};
+
+// Serial output goes to stdout, or to hostSerialCapture while a test sets it
+inline std::string* hostSerialCapture = nullptr;
+
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    operator bool() { return true; }
+    size_t write(uint8_t c) override {
+        if (hostSerialCapture) {
+            *hostSerialCapture += static_cast<char>(c);
+            return 1;
+        }
+        return fputc(c, stdout) == EOF ? 0 : 1;
+    }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int availableForWrite() { return 64; }
+};
+
+inline HardwareSerial Serial;
+
+class IPAddress {
+public:
+    IPAddress() : address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : address(a | (b << 8) | (c << 16) | (static_cast<uint32_t>(d) << 24)) {}
+    IPAddress(uint32_t value) : address(value) {}
+    operator uint32_t() const { return address; }
+    uint8_t operator[](int i) const { return static_cast<uint8_t>(address >> (8 * i)); }
+    bool operator==(const IPAddress& other) const { return address == other.address; }
+
+    // A dotted quad, or false and unchanged
+    bool fromString(const char* text) {
+        unsigned a, b, c, d;
+        char end;
+        if (sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+            return false;
+        }
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+
+private:
+    uint32_t address;
+};
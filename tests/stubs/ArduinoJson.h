@@ -0,0 +1,3 @@
+// ArduinoJson is only used inside server_client.cpp, which the host tests do
+// not build; the headers that include it need nothing from it.
+#pragma once
@@ -0,0 +1,30 @@
+// Host stand-in for the FreeRTOS types the sketch's headers use. No
+// scheduler: code under test that would block on the kernel is not built
+// for the host.
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t StackType_t;
+typedef uint32_t EventBits_t;
+typedef void* TaskHandle_t;
+typedef void* SemaphoreHandle_t;
+typedef void* QueueHandle_t;
+typedef void* EventGroupHandle_t;
+
+struct StaticTask_t { uint32_t data[30]; };
+struct StaticQueue_t { uint32_t data[20]; };
+typedef StaticQueue_t StaticSemaphore_t;
+struct StaticEventGroup_t { uint32_t data[8]; };
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+#define portMAX_DELAY 0xffffffffu
+#define tskIDLE_PRIORITY 0
+#define configMINIMAL_STACK_SIZE 128
+#define configMAX_PRIORITIES 24
@@ -0,0 +1,25 @@
+// Host stand-in for the UNO R4 WiFi LED matrix: draws nothing
+#pragma once
+
+#include <Arduino.h>
+
+#define Font_4x6 0
+#define Font_5x7 1
+#define SCROLL_LEFT 1
+
+class ArduinoLEDMatrix {
+public:
+    void begin() {}
+    void clear() {}
+    void beginDraw() {}
+    void endDraw() {}
+    void stroke(uint32_t) {}
+    void textFont(int) {}
+    void textScrollSpeed(unsigned long) {}
+    void beginText(int, int, uint32_t) {}
+    template <class T>
+    void print(const T&) {}
+    template <class T>
+    void println(const T&) {}
+    void endText(int = 0) {}
+};
@@ -0,0 +1,77 @@
+// Host stand-in for the core's FspTimer. Nothing runs by itself: a test
+// finds a timer with hostTimer() and calls fire() where the hardware would
+// interrupt.
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+typedef enum { TIMER_MODE_PERIODIC, TIMER_MODE_ONE_SHOT, TIMER_MODE_PWM } timer_mode_t;
+
+#define GPT_TIMER 0
+#define AGT_TIMER 1
+
+typedef struct {
+    uint32_t event;
+    void const* p_context;
+    uint32_t capture;
+} timer_callback_args_t;
+
+typedef void (*GPTimerCbk_f)(timer_callback_args_t*);
+
+class FspTimer {
+public:
+    // Timers get_available_timer() still hands out; -1 for no limit
+    static inline int hostFreeTimers = -1;
+    static inline std::vector<FspTimer*> hostTimers;
+
+    uint8_t type = 0;
+    int8_t channel = -1;
+    float frequency = 0.0f;
+    bool running = false;
+    uint32_t starts = 0;
+
+    static int8_t get_available_timer(uint8_t&, bool = false) {
+        if (hostFreeTimers == 0) {
+            return -1;
+        }
+        if (hostFreeTimers > 0) {
+            hostFreeTimers--;
+        }
+        return static_cast<int8_t>(hostTimers.size());
+    }
+
+    bool begin(timer_mode_t, uint8_t timerType, uint8_t timerChannel, float hz, float, GPTimerCbk_f cb = nullptr, void* context = nullptr) {
+        type = timerType;
+        channel = timerChannel;
+        frequency = hz;
+        callback = cb;
+        args.p_context = context;
+        hostTimers.push_back(this);
+        return true;
+    }
+    bool setup_overflow_irq(uint8_t = 12, void* = nullptr) { return true; }
+    bool open() { return true; }
+    bool start() { running = true; starts++; return true; }
+    bool stop() { running = false; return true; }
+    bool reset() { return true; }
+    bool close() { return true; }
+    void end() {}
+    bool set_frequency(float hz) { frequency = hz; return true; }
+
+    // The overflow interrupt
+    void fire() {
+        if (running && callback) {
+            callback(&args);
+        }
+    }
+
+private:
+    GPTimerCbk_f callback = nullptr;
+    timer_callback_args_t args = {0, nullptr, 0};
+};
+
+// Timers in the order begin() was called on them
+inline FspTimer* hostTimer(size_t index) {
+    return index < FspTimer::hostTimers.size() ? FspTimer::hostTimers[index] : nullptr;
+}
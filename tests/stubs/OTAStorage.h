@@ -0,0 +1,16 @@
+// Host stand-in for ArduinoOTA's staging area interface
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class OTAStorage {
+public:
+    virtual ~OTAStorage() {}
+    virtual int open(int length) = 0;
+    virtual size_t write(uint8_t value) = 0;
+    virtual void close() = 0;
+    virtual void clear() = 0;
+    virtual void apply() = 0;
+    virtual long maxSize() = 0;
+};
@@ -0,0 +1,44 @@
+// Host stand-in for the R4 core's RTC: a calendar that holds what was set
+#pragma once
+
+#include <Arduino.h>
+
+enum class Month { JANUARY = 0, FEBRUARY, MARCH, APRIL, MAY, JUNE, JULY, AUGUST, SEPTEMBER, OCTOBER, NOVEMBER, DECEMBER };
+enum class DayOfWeek { SUNDAY = 0, MONDAY, TUESDAY, WEDNESDAY, THURSDAY, FRIDAY, SATURDAY };
+enum class SaveLight { SAVING_TIME_INACTIVE, SAVING_TIME_ACTIVE };
+
+inline int Month2int(Month month) { return static_cast<int>(month) + 1; }
+
+class RTCTime {
+public:
+    RTCTime() {}
+    RTCTime(int day, Month month, int year, int hour, int minute, int second, DayOfWeek, SaveLight)
+        : day(day), month(month), year(year), hour(hour), minute(minute), second(second) {}
+    int getDayOfMonth() { return day; }
+    Month getMonth() { return month; }
+    int getYear() { return year; }
+    int getHour() { return hour; }
+    int getMinutes() { return minute; }
+    int getSeconds() { return second; }
+
+private:
+    int day = 1;
+    Month month = Month::JANUARY;
+    int year = 2000;
+    int hour = 0;
+    int minute = 0;
+    int second = 0;
+};
+
+class RTClock {
+public:
+    bool begin() { return true; }
+    bool isRunning() { return running; }
+    bool setTime(RTCTime& time) { now = time; running = true; return true; }
+    bool getTime(RTCTime& time) { time = now; return true; }
+
+    bool running = false;
+    RTCTime now;
+};
+
+inline RTClock RTC;
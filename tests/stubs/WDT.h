@@ -0,0 +1,14 @@
+// Host stand-in for the R4 core's watchdog: counts refreshes, never fires
+#pragma once
+
+#include <Arduino.h>
+
+class WDTimer {
+public:
+    int begin(uint32_t timeout) { return 1; }
+    void refresh() { refreshes++; }
+
+    uint32_t refreshes = 0;
+};
+
+inline WDTimer WDT;
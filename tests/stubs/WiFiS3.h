@@ -0,0 +1,175 @@
+// Host stand-in for WiFiS3 with a simulated TCP layer. Every connection is a
+// HostSocket shared by the device's WiFiClient and the test, which plays the
+// peer: it puts what the peer sends in toDevice and finds what the device
+// wrote in fromDevice.
+//
+//   - hostConnect(port) opens a connection to a listening WiFiServer, for
+//     the device to accept
+//   - a WiFiClient::connect() by the device adds a socket to hostSockets
+//     for the test to answer, unless hostRefuseConnects is set
+//   - writeLimit caps what one write() takes, like a socket whose send
+//     buffer is full, and writeMicros is the simulated time one takes
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define WL_IDLE_STATUS 0
+#define WL_CONNECTED 3
+#define WL_CONNECT_FAILED 4
+#define WL_CONNECTION_LOST 5
+#define WL_DISCONNECTED 6
+
+struct HostSocket {
+    std::string host;               // Connect by name, or empty
+    uint16_t port = 0;
+    std::string toDevice;           // Sent by the peer, not read yet
+    std::string fromDevice;         // Written by the device
+    bool peerOpen = true;           // The peer has not closed its side
+    bool deviceOpen = true;         // The device has not called stop()
+    bool accepted = false;          // Handed out by WiFiServer::available()
+    size_t writeLimit = SIZE_MAX;   // Bytes one write() takes
+    uint32_t writeMicros = 0;       // Time one write() takes
+    uint32_t writeCalls = 0;
+};
+
+inline std::vector<std::shared_ptr<HostSocket>> hostSockets;    // In the order they were opened
+inline bool hostRefuseConnects = false;
+
+// A peer connecting to the device
+inline std::shared_ptr<HostSocket> hostConnect(uint16_t port) {
+    auto socket = std::make_shared<HostSocket>();
+    socket->port = port;
+    hostSockets.push_back(socket);
+    return socket;
+}
+
+class Client : public Stream {
+public:
+    virtual int connect(IPAddress, uint16_t port) { return open("", port); }
+    virtual int connect(const char* host, uint16_t port) { return open(host, port); }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        if (!socket || !socket->peerOpen) {
+            return 0;
+        }
+        socket->writeCalls++;
+        hostAdvance(socket->writeMicros);
+        size_t taken = size < socket->writeLimit ? size : socket->writeLimit;
+        socket->fromDevice.append(reinterpret_cast<const char*>(buffer), taken);
+        return taken;
+    }
+    using Print::write;
+
+    int available() override { return socket ? static_cast<int>(socket->toDevice.size()) : 0; }
+    int read() override {
+        if (!available()) {
+            return -1;
+        }
+        uint8_t c = static_cast<uint8_t>(socket->toDevice[0]);
+        socket->toDevice.erase(0, 1);
+        return c;
+    }
+    int read(uint8_t* buffer, size_t size) {
+        size_t n = socket ? (size < socket->toDevice.size() ? size : socket->toDevice.size()) : 0;
+        if (n) {
+            memcpy(buffer, socket->toDevice.data(), n);
+            socket->toDevice.erase(0, n);
+        }
+        return static_cast<int>(n);
+    }
+    int peek() override { return available() ? static_cast<uint8_t>(socket->toDevice[0]) : -1; }
+
+    // Open while either side is, as long as there is something left to read
+    virtual uint8_t connected() { return socket && (socket->peerOpen || !socket->toDevice.empty()); }
+    virtual void stop() {
+        if (socket) {
+            socket->deviceOpen = false;
+        }
+        socket.reset();
+    }
+    operator bool() const { return socket != nullptr; }
+
+    void setConnectionTimeout(int) {}
+
+    std::shared_ptr<HostSocket> socket;
+
+private:
+    int open(const char* host, uint16_t port) {
+        stop();
+        if (hostRefuseConnects) {
+            return 0;
+        }
+        socket = hostConnect(port);
+        socket->host = host;
+        socket->accepted = true;
+        return 1;
+    }
+};
+
+class WiFiClient : public Client {};
+
+class WiFiSSLClient : public WiFiClient {
+public:
+    void setCACert(const char*) {}
+};
+
+class WiFiServer {
+public:
+    explicit WiFiServer(uint16_t port) : port(port) {}
+    void begin() { listening = true; }
+
+    // The oldest connection to this port not accepted yet
+    WiFiClient available() {
+        WiFiClient client;
+        for (auto& socket : hostSockets) {
+            if (listening && !socket->accepted && socket->port == port) {
+                socket->accepted = true;
+                client.socket = socket;
+                break;
+            }
+        }
+        return client;
+    }
+
+private:
+    uint16_t port;
+    bool listening = false;
+};
+
+// No datagrams on the host: nothing is ever received
+class WiFiUDP {
+public:
+    uint8_t begin(uint16_t) { return 1; }
+    void stop() {}
+    int beginPacket(IPAddress, uint16_t) { return 1; }
+    int beginPacket(const char*, uint16_t) { return 1; }
+    int endPacket() { return 1; }
+    size_t write(const uint8_t*, size_t size) { return size; }
+    int parsePacket() { return 0; }
+    int read(uint8_t*, size_t) { return 0; }
+    IPAddress remoteIP() { return IPAddress(); }
+};
+
+class CWifi {
+public:
+    int begin(const char*, const char*) { return hostStatus = WL_CONNECTED; }
+    int status() { return hostStatus; }
+    IPAddress localIP() { return IPAddress(192, 168, 1, 50); }
+    void disconnect() { hostStatus = WL_DISCONNECTED; }
+    void end() { hostStatus = WL_IDLE_STATUS; }
+    int hostByName(const char*, IPAddress& address) {
+        address = IPAddress(192, 168, 1, 2);
+        return 1;
+    }
+    void lowPowerMode() {}
+    void noLowPowerMode() {}
+    int32_t RSSI() { return -50; }
+
+    int hostStatus = WL_CONNECTED;
+};
+
+inline CWifi WiFi;
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+    void begin() {}
+    void beginTransmission(int) {}
+    int endTransmission() { return 0; }
+};
+
+inline TwoWire Wire;
@@ -0,0 +1,86 @@
+// Host stand-ins for the CMSIS and RA4M1 register definitions the sketch
+// uses. The DSP intrinsics follow the Armv7E-M definitions exactly, so the
+// dual 16-bit kernels give the device's results on the host.
+#pragma once
+
+#include <stdint.h>
+
+// The cycle counter moves with the simulated clock (hostAdvance). A test can
+// also make each read cost cycles, to stand in for the work between two reads.
+struct HostCycleCount {
+    uint32_t value;
+    uint32_t cyclesPerRead;
+
+    operator uint32_t() {
+        uint32_t now = value;
+        value += cyclesPerRead;
+        return now;
+    }
+    HostCycleCount& operator=(uint32_t v) {
+        value = v;
+        return *this;
+    }
+};
+
+struct HostDwt { uint32_t CTRL; HostCycleCount CYCCNT; };
+struct HostCoreDebug { volatile uint32_t DEMCR; };
+inline HostDwt hostDwt;
+inline HostCoreDebug hostCoreDebug;
+#define DWT (&hostDwt)
+#define CoreDebug (&hostCoreDebug)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk 1UL
+
+inline uint32_t SystemCoreClock = 48000000UL;
+
+struct HostDac { volatile uint16_t DADR[2]; };
+inline HostDac hostDac;
+#define R_DAC (&hostDac)
+
+inline void __DMB() {}
+inline void __DSB() {}
+
+// Dual 16-bit multiply, accumulate into 32 bits
+inline uint32_t __SMLAD(uint32_t x, uint32_t y, uint32_t sum) {
+    int32_t p = static_cast<int16_t>(x) * static_cast<int16_t>(y)
+              + static_cast<int16_t>(x >> 16) * static_cast<int16_t>(y >> 16);
+    return static_cast<uint32_t>(static_cast<int32_t>(sum) + p);
+}
+
+// Dual 16-bit multiply, accumulate into 64 bits
+inline uint64_t __SMLALD(uint32_t x, uint32_t y, uint64_t sum) {
+    int64_t p = static_cast<int64_t>(static_cast<int16_t>(x) * static_cast<int16_t>(y))
+              + static_cast<int16_t>(x >> 16) * static_cast<int16_t>(y >> 16);
+    return static_cast<uint64_t>(static_cast<int64_t>(sum) + p);
+}
+
+// ADC and ELC, as far as SoundMeter programs them. A conversion is done as
+// soon as it is triggered: a test puts the result in ADDR before it fires
+// the sample timer.
+struct HostAdc {
+    struct { uint16_t ADST; uint16_t ADCS; uint16_t TRGE; } ADCSR_b;
+    uint16_t ADANSA[2];
+    struct { uint8_t TRSA; } ADSTRGR_b;
+    volatile uint16_t ADDR[29];
+};
+struct HostElc {
+    struct { uint16_t HA; } ELSR[19];
+    struct { uint8_t ELCON; } ELCR_b;
+};
+inline HostAdc hostAdc;
+inline HostElc hostElc;
+#define R_ADC0 (&hostAdc)
+#define R_ELC (&hostElc)
+
+typedef enum {
+    ELC_EVENT_GPT0_COUNTER_OVERFLOW,
+    ELC_EVENT_GPT1_COUNTER_OVERFLOW,
+    ELC_EVENT_GPT2_COUNTER_OVERFLOW,
+    ELC_EVENT_GPT3_COUNTER_OVERFLOW,
+    ELC_EVENT_GPT4_COUNTER_OVERFLOW,
+    ELC_EVENT_GPT5_COUNTER_OVERFLOW,
+    ELC_EVENT_GPT6_COUNTER_OVERFLOW,
+    ELC_EVENT_GPT7_COUNTER_OVERFLOW,
+} elc_event_t;
+#define ELC_PERIPHERAL_ADC0 8
+#define R_BSP_MODULE_START(ip, channel) ((void)0)
@@ -0,0 +1,203 @@
+// Calendar and time zone conversions over every day and every hour from 1970
+// to 2100:
+//
+//   - daysFromCivil, civilFromDays and weekdayFromDays against a day-by-day
+//     walk of the calendar and against glibc's timegm/gmtime_r
+//   - TimeZone against glibc's localtime_r for the same POSIX TZ string:
+//     the offset and DST flag each hour (in order, so mostly from the cache,
+//     and at random times, so mostly recomputed), every transition to the
+//     second, and offsetForLocal around each transition
+//
+// glibc applies a POSIX TZ string to every year when there is no zone file
+// of that name, so the two implementations are independent.
+
+#include <random>
+#include <time.h>
+#include <vector>
+#include "check.h"
+#include "civil_time.h"
+#include "config_store.h"
+#include "host_config_store.h"
+#include "timezone.h"
+
+static const int64_t START = 0;                                                     // 1970-01-01
+static const int64_t END = static_cast<int64_t>(daysFromCivil(2101, 1, 1)) * SECONDS_PER_DAY;
+static const int64_t HOUR = 3600;
+
+static const char* const ZONES[] = {
+    "CET-1CEST,M3.5.0,M10.5.0/3",           // Europe
+    "EST5EDT,M3.2.0,M11.1.0",               // North America
+    "AEST-10AEDT,M10.1.0,M4.1.0/3",         // Southern hemisphere: DST over New Year
+    "NZST-12NZDT,M9.5.0,M4.1.0/3",
+    "IST-1GMT0,M10.5.0,M3.5.0/1",           // Ireland: "DST" is the winter offset
+    "<-03>3<-02>,M3.5.0/-2,M10.5.0/-1",     // Negative rule times
+    "AAA3BBB,J60/0,J300/23:30",             // Julian days, 29 February not counted
+    "CCC-2DDD,59,300",                      // Zero-based days, 29 February counted
+    "<+0530>-5:30",                         // Fixed, no DST
+};
+
+struct GlibcZone {
+    int32_t stdOffset;
+    int32_t dstOffset;
+};
+
+static void checkCalendar() {
+    static const uint8_t DAYS_IN_MONTH[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int32_t year = 1970;
+    uint8_t month = 1;
+    uint8_t day = 1;
+    uint8_t weekday = 4;        // 1970-01-01 was a Thursday
+    uint32_t days = 0;
+
+    for (int32_t n = 0; static_cast<int64_t>(n) * SECONDS_PER_DAY < END; n++, days++) {
+        CHECK(daysFromCivil(year, month, day) == n);
+        CivilDate date = civilFromDays(n);
+        CHECK(date.year == year && date.month == month && date.day == day);
+        CHECK(weekdayFromDays(n) == weekday);
+
+        time_t t = static_cast<time_t>(n) * SECONDS_PER_DAY + 12 * HOUR;
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        CHECK(tm.tm_year + 1900 == year && tm.tm_mon + 1 == month && tm.tm_mday == day && tm.tm_wday == weekday);
+        CHECK(daysFromSeconds(t) == n && daysFromSeconds(t - 12 * HOUR - 1) == n - 1);
+
+        uint8_t length = DAYS_IN_MONTH[month - 1] + (month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0));
+        CHECK(isLeapYear(year) == (year % 4 == 0 && year != 2100));
+        weekday = (weekday + 1) % 7;
+        if (++day > length) {
+            day = 1;
+            if (++month > 12) {
+                month = 1;
+                year++;
+            }
+        }
+    }
+    CHECK(year == 2101 && month == 1 && day == 1);
+
+    // Before 1970 too, where the divisions have to round down
+    for (int32_t n = -800000; n < 0; n += 97) {
+        CivilDate date = civilFromDays(n);
+        CHECK(daysFromCivil(date.year, date.month, date.day) == n);
+        CHECK(weekdayFromDays(n) == ((n % 7 + 7 + 4) % 7));
+    }
+    printf("calendar: %u days from 1970-01-01 to 2100-12-31\n", days);
+}
+
+static struct tm glibcLocal(int64_t utc) {
+    time_t t = static_cast<time_t>(utc);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    return tm;
+}
+
+// The zone's standard and DST offsets as glibc sees them
+static GlibcZone glibcZone() {
+    GlibcZone zone = {static_cast<int32_t>(-timezone), static_cast<int32_t>(-timezone)};
+    for (int64_t t = START; t < START + 366 * 24 * HOUR; t += HOUR) {
+        struct tm tm = glibcLocal(t);
+        if (tm.tm_isdst) {
+            zone.dstOffset = static_cast<int32_t>(tm.tm_gmtoff);
+            break;
+        }
+    }
+    return zone;
+}
+
+static bool matches(int64_t utc) {
+    struct tm tm = glibcLocal(utc);
+    return TimeZone::offsetAt(utc) == tm.tm_gmtoff && TimeZone::isDst(utc) == (tm.tm_isdst > 0);
+}
+
+// A local time the zone maps back to under this offset
+static bool glibcValid(int64_t local, int32_t offset) {
+    return glibcLocal(local - offset).tm_gmtoff == offset;
+}
+
+// Standard time wherever it is valid, so in the repeated hour as well
+static void checkLocal(int64_t local, const GlibcZone& zone, uint32_t& failures) {
+    int32_t offset = TimeZone::offsetForLocal(local);
+    if (glibcValid(local, zone.stdOffset)) {
+        failures += offset != zone.stdOffset;
+    } else if (glibcValid(local, zone.dstOffset)) {
+        failures += offset != zone.dstOffset;
+    }
+    // Otherwise the time is skipped at the start of DST and any answer will do
+}
+
+static void checkZone(const char* tz, std::mt19937& random) {
+    setenv("TZ", tz, 1);
+    tzset();
+    GlibcZone zone = glibcZone();
+
+    hostConfigClear();
+    CHECK(TimeZone::set(tz));
+
+    // Every hour in order
+    uint32_t hourly = 0;
+    uint32_t failures = 0;
+    for (int64_t t = START; t < END; t += HOUR) {
+        failures += !matches(t);
+        hourly++;
+    }
+
+    // At random, so the cached interval rarely holds
+    std::uniform_int_distribution<int64_t> anyTime(START, END - 1);
+    for (int i = 0; i < 200000; i++) {
+        failures += !matches(anyTime(random));
+    }
+
+    // Each transition to the second, and local times around it
+    uint32_t transitions = 0;
+    for (int64_t t = TimeZone::nextTransition(START); t < END; t = TimeZone::nextTransition(t)) {
+        transitions++;
+        failures += !matches(t - 1) + !matches(t);
+        failures += glibcLocal(t - 1).tm_gmtoff == glibcLocal(t).tm_gmtoff;
+        int32_t before = TimeZone::offsetAt(t - 1);
+        for (int64_t local = t + before - 2 * HOUR; local <= t + before + 2 * HOUR; local += 15 * 60) {
+            checkLocal(local, zone, failures);
+        }
+    }
+    for (int64_t t = START; t < END; t += 7 * HOUR) {
+        checkLocal(t + TimeZone::offsetAt(t), zone, failures);
+    }
+
+    printf("%-34s %u hours, %3u transitions, offsets %+d/%+d s: %u mismatches\n", tz, hourly, transitions,
+           zone.stdOffset, zone.dstOffset, failures);
+    CHECK(failures == 0);
+    CHECK((zone.stdOffset == zone.dstOffset) == (transitions == 0));
+    if (transitions == 0) {
+        CHECK(TimeZone::nextTransition(START) == INT64_MAX);
+    } else {
+        CHECK(transitions == 2 * 131);
+    }
+}
+
+// Rules survive a restart through the config store; bad strings change nothing
+static void checkStore() {
+    hostConfigClear();
+    int32_t fixed = -7 * 3600;
+    CHECK(ConfigStore::set(ConfigKey::UTC_OFFSET, fixed));
+    TimeZone::begin();
+    CHECK(TimeZone::offsetAt(1700000000) == fixed);
+
+    CHECK(TimeZone::set("CET-1CEST,M3.5.0,M10.5.0/3"));
+    for (const char* bad : {"", "CET", "CE-1", "CET-1CEST,M3.5.0", "CET-1CEST,M13.5.0,M10.5.0", "CET-1CEST,M3.6.0,M10.5.0",
+                            "CET-1CEST,J0,J100", "CET-1CEST,M3.5.0,M10.5.0/3x", "<+05-5",
+                            "AVERYLONGZONENAME-1ANOTHERVERYLONGNAME,M3.5.0,M10.5.0/3"}) {
+        CHECK(!TimeZone::set(bad));
+    }
+    TimeZone::begin();
+    CHECK(TimeZone::offsetAt(daysFromCivil(2024, 7, 1) * static_cast<int64_t>(SECONDS_PER_DAY)) == 7200);
+    CHECK(TimeZone::offsetAt(daysFromCivil(2024, 1, 1) * static_cast<int64_t>(SECONDS_PER_DAY)) == 3600);
+}
+
+int main() {
+    checkCalendar();
+
+    std::mt19937 random(42);
+    for (const char* tz : ZONES) {
+        checkZone(tz, random);
+    }
+    checkStore();
+    return checkResult("test_civil_time");
+}
@@ -0,0 +1,482 @@
+// LocalApi scraped through the simulated TCP layer in stubs/WiFiS3.h:
+//
+//   - /metrics in the Prometheus text format: every family with its HELP and
+//     TYPE lines, each sample with the value the snapshot held
+//   - /state as one JSON object
+//   - 404 and 405, and a request line longer than the part kept
+//   - a request line split at every byte across polls
+//   - a client that sends nothing, closes early, is slow to take the
+//     response or whose socket takes only part of a write
+//   - the send slice: a slow socket gets a few writes per poll, not the
+//     whole response at once
+//
+// The renderers only read the snapshot, so the real Alarm and TaskStats are
+// linked in; the CO2 sensor, the clock, the memory monitor and the server
+// connection counters are replaced below with fixed values.
+
+#include <map>
+#include <string>
+#include <vector>
+#include "alarm.h"
+#include "check.h"
+#include "clock_sync.h"
+#include "co2_sensor.h"
+#include "config_store.h"
+#include "host_config_store.h"
+#include "local_api.h"
+
+static const int64_t NOW_MILLIS = 1760870000000LL;
+static const int32_t CO2_READING = 812;
+static const int16_t CO2_OFFSET = -12;
+
+// Link seams
+
+CO2Sensor::CO2Sensor(int pin) : pwmPin(pin), lastReadTime(0), co2Level(CO2_READING), readingStarted(false) {}
+
+int CO2Sensor::readPWM() {
+    return co2Level;
+}
+
+int64_t ClockSync::nowMillis() {
+    return NOW_MILLIS;
+}
+
+std::atomic<bool> ClockSync::synced(true);
+
+static MemoryStats memoryStats;
+
+void MemoryMonitor::sample() {
+    memoryStats = {};
+    memoryStats.stacks[0] = {"Alarm", 256, 80};
+    memoryStats.stacks[1] = {"Network", 512, 120};
+    memoryStats.stacks[2] = {"Display", 256, 90};
+    memoryStats.taskCount = 3;
+    memoryStats.heapFree = 4000;
+    memoryStats.heapMinFree = 3000;
+    memoryStats.heapFragmentationPercent = 5;
+    memoryStats.valid = true;
+}
+
+MemoryStats MemoryMonitor::getLastStats() {
+    return memoryStats;
+}
+
+NetUpkeep ServerClient::upkeep = {3, 100, 0, 42, 20, 6, 5, 7000, 9000, 0, 0, 0, 1};
+
+// One exchange as the peer sees it
+struct Exchange {
+    std::string response;
+    uint32_t polls = 0;
+    uint32_t writes = 0;
+    uint32_t maxWritesPerPoll = 0;
+    bool closed = false;        // The device called stop()
+};
+
+struct Peer {
+    size_t split = SIZE_MAX;            // Bytes of the request sent before the first poll
+    size_t writeLimit = SIZE_MAX;
+    uint32_t writeMicros = 0;
+    uint32_t pollInterval = 1000;       // us between polls
+    bool closeAfterSplit = false;       // Close instead of sending the rest
+};
+
+// Connect, send the request (part of it before the first poll, the rest
+// after) and poll until the device closes the connection
+static Exchange exchange(const std::string& request, Alarm* alarm, CO2Sensor* co2, const Peer& peer = Peer()) {
+    auto socket = hostConnect(WAKU_LOCAL_API_PORT);
+    socket->writeLimit = peer.writeLimit;
+    socket->writeMicros = peer.writeMicros;
+    size_t split = peer.split < request.size() ? peer.split : request.size();
+    socket->toDevice = request.substr(0, split);
+
+    Exchange result;
+    for (; result.polls < 100000 && socket->deviceOpen; result.polls++) {
+        uint32_t before = socket->writeCalls;
+        LocalApi::poll(alarm, co2);
+        if (socket->writeCalls - before > result.maxWritesPerPoll) {
+            result.maxWritesPerPoll = socket->writeCalls - before;
+        }
+        if (result.polls == 0) {
+            if (peer.closeAfterSplit) {
+                socket->peerOpen = false;
+            } else {
+                socket->toDevice += request.substr(split);
+            }
+        }
+        hostAdvance(peer.pollInterval);
+    }
+    result.response = socket->fromDevice;
+    result.writes = socket->writeCalls;
+    result.closed = !socket->deviceOpen;
+    return result;
+}
+
+static std::string header(const char* status, const char* type) {
+    return std::string("HTTP/1.1 ") + status + "\r\nContent-Type: " + type + "\r\nConnection: close\r\n\r\n";
+}
+
+static std::string body(const std::string& response) {
+    size_t end = response.find("\r\n\r\n");
+    return end == std::string::npos ? std::string() : response.substr(end + 4);
+}
+
+static bool startsWith(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Text exposition format: each family opens with its HELP and TYPE lines and
+// has at least one sample of that name; values are integers. The samples by
+// name and labels, and the families in order.
+static bool parsePrometheus(const std::string& text, std::map<std::string, unsigned long>& samples,
+                            std::vector<std::string>& families) {
+    std::string family;
+    bool typed = false;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) {
+            return false;
+        }
+        std::string line = text.substr(start, end - start);
+        start = end + 1;
+
+        if (startsWith(line, "# HELP ")) {
+            if (!family.empty() && !typed) {
+                return false;
+            }
+            family = line.substr(7, line.find(' ', 7) - 7);
+            if (samples.count(family) || line.size() <= 8 + family.size()) {
+                return false;
+            }
+            typed = false;
+            families.push_back(family);
+        } else if (startsWith(line, "# TYPE ")) {
+            if (line != "# TYPE " + family + " gauge" && line != "# TYPE " + family + " counter") {
+                return false;
+            }
+            typed = true;
+        } else {
+            size_t space = line.rfind(' ');
+            std::string key = line.substr(0, space);
+            std::string value = line.substr(space + 1);
+            std::string name = key.substr(0, key.find('{'));
+            bool labelled = name.size() < key.size();
+            if (space == std::string::npos || !typed || name != family || value.empty() ||
+                value.find_first_not_of("0123456789") != std::string::npos || samples.count(key) ||
+                (labelled && (key.back() != '}' || key.find("=\"") == std::string::npos || key[key.size() - 2] != '"'))) {
+                return false;
+            }
+            samples[key] = strtoul(value.c_str(), nullptr, 10);
+        }
+    }
+    return typed;
+}
+
+// Just enough JSON: objects, arrays, strings without escapes, integers,
+// true, false, null
+static bool parseJsonValue(const std::string& s, size_t& i);
+
+static bool parseJsonString(const std::string& s, size_t& i) {
+    if (s[i] != '"') {
+        return false;
+    }
+    size_t end = s.find('"', i + 1);
+    if (end == std::string::npos || s.find('\\', i) < end) {
+        return false;
+    }
+    i = end + 1;
+    return true;
+}
+
+static bool parseJsonValue(const std::string& s, size_t& i) {
+    if (i >= s.size()) {
+        return false;
+    }
+    if (s[i] == '{' || s[i] == '[') {
+        char close = s[i] == '{' ? '}' : ']';
+        i++;
+        if (s[i] == close) {
+            i++;
+            return true;
+        }
+        for (;;) {
+            if (close == '}' && (!parseJsonString(s, i) || s[i++] != ':')) {
+                return false;
+            }
+            if (!parseJsonValue(s, i)) {
+                return false;
+            }
+            if (s[i] == close) {
+                i++;
+                return true;
+            }
+            if (s[i++] != ',') {
+                return false;
+            }
+        }
+    }
+    if (s[i] == '"') {
+        return parseJsonString(s, i);
+    }
+    for (const char* word : {"true", "false", "null"}) {
+        if (s.compare(i, strlen(word), word) == 0) {
+            i += strlen(word);
+            return true;
+        }
+    }
+    size_t digits = i + (s[i] == '-');
+    size_t end = s.find_first_not_of("0123456789", digits);
+    if (end == digits) {
+        return false;
+    }
+    i = end;
+    return true;
+}
+
+static bool isJsonObject(const std::string& text) {
+    size_t i = 0;
+    return !text.empty() && text[0] == '{' && parseJsonValue(text, i) && text.substr(i) == "\n";
+}
+
+static void checkMetrics(Alarm& alarm, CO2Sensor& co2) {
+    Exchange e = exchange("GET /metrics HTTP/1.1\r\nHost: waku\r\nAccept: */*\r\n\r\n", &alarm, &co2);
+    CHECK(e.closed);
+    CHECK(startsWith(e.response, header("200 OK", "text/plain; version=0.0.4")));
+
+    std::map<std::string, unsigned long> samples;
+    std::vector<std::string> families;
+    CHECK(parsePrometheus(body(e.response), samples, families));
+    CHECK(families.size() == 20);
+    CHECK(families.front() == "waku_co2_ppm" && families.back() == "waku_api_requests_total");
+    CHECK(samples["waku_co2_ppm"] == CO2_READING + CO2_OFFSET);
+    CHECK(samples["waku_alarm_phase{phase=\"idle\"}"] == 1);
+    CHECK(samples["waku_alarm_phase{phase=\"off\"}"] == 0);
+    CHECK(samples["waku_alarm_phase{phase=\"waking\"}"] == 0);
+    CHECK(samples["waku_alarm_phase{phase=\"stopped\"}"] == 0);
+    CHECK(samples["waku_alarm_wake_minutes"] == 7 * 60);
+    CHECK(samples["waku_clock_synced"] == 1);
+    CHECK(samples["waku_task_jitter_mean_microseconds{task=\"alarm\"}"] == 150);
+    CHECK(samples["waku_task_jitter_max_microseconds{task=\"alarm\"}"] == 200);
+    CHECK(samples.count("waku_task_busy_permille{task=\"network\"}"));
+    CHECK(samples["waku_stack_free_words{task=\"Network\"}"] == 120);
+    CHECK(samples["waku_heap_free_bytes"] == 4000);
+    CHECK(samples["waku_heap_fragmentation_percent"] == 5);
+    CHECK(samples["waku_net_connects_total"] == 3);
+    CHECK(samples["waku_net_requests_total"] == 42);
+    CHECK(samples["waku_net_config_pushes_total"] == 5);
+    CHECK(samples["waku_net_not_modified_total"] == 1);
+    CHECK(samples["waku_net_received_bytes_total"] == 9000);
+    unsigned long served = samples["waku_api_requests_total"];
+
+    // Many items, one buffer: written out in pieces, all in one poll here
+    CHECK(e.writes > 5);
+    CHECK(e.maxWritesPerPoll == e.writes);
+    printf("/metrics: %zu bytes in %u writes, %zu families, %zu samples\n", e.response.size(), e.writes,
+           families.size(), samples.size());
+
+    // The counter moves on with each response sent in full
+    e = exchange("GET /metrics HTTP/1.1\r\n\r\n", &alarm, &co2);
+    samples.clear();
+    families.clear();
+    CHECK(parsePrometheus(body(e.response), samples, families));
+    CHECK(samples["waku_api_requests_total"] == served + 1);
+
+    // Without a CO2 reading the family is left out
+    e = exchange("GET /metrics HTTP/1.1\r\n\r\n", &alarm, nullptr);
+    samples.clear();
+    families.clear();
+    CHECK(parsePrometheus(body(e.response), samples, families));
+    CHECK(families.size() == 19 && !samples.count("waku_co2_ppm"));
+}
+
+static void checkState(Alarm& alarm, CO2Sensor& co2) {
+    Exchange e = exchange("GET /state?pretty=1 HTTP/1.1\r\n\r\n", &alarm, &co2);
+    CHECK(e.closed);
+    CHECK(startsWith(e.response, header("200 OK", "application/json")));
+    std::string json = body(e.response);
+    CHECK(isJsonObject(json));
+    CHECK(json.find("\"time\":1760870000,\"synced\":true,") != std::string::npos);
+    CHECK(json.find("\"co2\":800,") != std::string::npos);
+    CHECK(json.find("\"alarm\":{\"wake\":\"07:00\",\"armed\":true,\"phase\":\"idle\",\"triggered\":false}") != std::string::npos);
+    CHECK(json.find("\"alarm\":[150,200,") != std::string::npos);
+    CHECK(json.find("\"stacks\":{\"Alarm\":80,\"Network\":120,\"Display\":90}") != std::string::npos);
+    CHECK(json.find("\"net\":{\"connects\":3,\"requests\":42,\"updates\":20,\"pushes\":5,\"not_modified\":1,"
+                    "\"tx\":7000,\"rx\":9000}}\n") != std::string::npos);
+    printf("/state: %zu bytes in %u writes\n", e.response.size(), e.writes);
+
+    e = exchange("GET /state HTTP/1.1\r\n\r\n", &alarm, nullptr);
+    json = body(e.response);
+    CHECK(isJsonObject(json) && json.find("\"co2\":null,") != std::string::npos);
+}
+
+// The phase follows the alarm: armed and outside the window, in the window,
+// stopped today, disarmed
+static void checkPhases(Alarm& alarm, CO2Sensor& co2) {
+    struct Case {
+        int hour;
+        int minute;
+        bool stop;
+        bool armed;
+        const char* phase;
+    };
+    static const Case CASES[] = {
+        {3, 0, false, true, "idle"},
+        {6, 59, false, true, "waking"},
+        {3, 0, false, false, "off"},
+        {6, 59, true, true, "stopped"},
+    };
+    for (const Case& c : CASES) {
+        RTCTime time(19, Month::OCTOBER, 2026, c.hour, c.minute, 0, DayOfWeek::MONDAY, SaveLight::SAVING_TIME_INACTIVE);
+        RTC.setTime(time);
+        alarm.updateTime(7, 0, c.armed);
+        if (c.stop) {
+            alarm.stopAlarm();
+        }
+        Exchange e = exchange("GET /metrics HTTP/1.1\r\n\r\n", &alarm, &co2);
+        std::map<std::string, unsigned long> samples;
+        std::vector<std::string> families;
+        CHECK(parsePrometheus(body(e.response), samples, families));
+        for (const char* phase : {"off", "idle", "waking", "stopped"}) {
+            CHECK(samples["waku_alarm_phase{phase=\"" + std::string(phase) + "\"}"] == (strcmp(phase, c.phase) == 0));
+        }
+        CHECK(isJsonObject(body(exchange("GET /state HTTP/1.1\r\n\r\n", &alarm, &co2).response)));
+    }
+}
+
+static void checkErrors(Alarm& alarm, CO2Sensor& co2) {
+    Exchange e = exchange("GET /nope HTTP/1.1\r\n\r\n", &alarm, &co2);
+    CHECK(e.response == header("404 Not Found", "text/plain; charset=utf-8") + "Not found\n");
+    e = exchange("GET /metricsx HTTP/1.1\r\n\r\n", &alarm, &co2);
+    CHECK(startsWith(e.response, "HTTP/1.1 404 "));
+    e = exchange("POST /state HTTP/1.1\r\nContent-Length: 2\r\n\r\n{}", &alarm, &co2);
+    CHECK(e.response == header("405 Method Not Allowed", "text/plain; charset=utf-8") + "Only GET\n");
+
+    // Only the start of a long request line is kept, which is enough to route it
+    e = exchange("GET /state?" + std::string(200, 'x') + " HTTP/1.1\r\n\r\n", &alarm, &co2);
+    CHECK(startsWith(e.response, header("200 OK", "application/json")));
+    CHECK(isJsonObject(body(e.response)));
+}
+
+// However the request line is split, the same response (the 404 has no
+// values that move with time)
+static void checkSplits(Alarm& alarm, CO2Sensor& co2) {
+    const std::string request = "GET /nope HTTP/1.1\r\nHost: waku\r\n\r\n";
+    const std::string expected = header("404 Not Found", "text/plain; charset=utf-8") + "Not found\n";
+    uint32_t failures = 0;
+    for (size_t split = 0; split <= request.size(); split++) {
+        Peer peer;
+        peer.split = split;
+        failures += exchange(request, &alarm, &co2, peer).response != expected;
+    }
+    CHECK(failures == 0);
+
+    for (size_t split = 0; split <= 24; split++) {
+        Peer peer;
+        peer.split = split;
+        CHECK(isJsonObject(body(exchange("GET /state HTTP/1.1\r\n\r\n", &alarm, &co2, peer).response)));
+    }
+}
+
+// Clients that never complete: each is dropped, nothing is counted as served
+static void checkDropped(Alarm& alarm, CO2Sensor& co2) {
+    // Never finishes the request line: given up after REQUEST_TIMEOUT
+    Peer silent;
+    silent.split = 8;
+    silent.closeAfterSplit = true;
+    auto socket = hostConnect(WAKU_LOCAL_API_PORT);
+    socket->toDevice = "GET /met";
+    uint64_t start = hostMicros;
+    while (socket->deviceOpen && hostMicros - start < 10000000) {
+        LocalApi::poll(&alarm, &co2);
+        hostAdvance(10000);
+    }
+    CHECK(!socket->deviceOpen && socket->fromDevice.empty());
+    CHECK(hostMicros - start >= 2000000 && hostMicros - start < 2100000);
+
+    // Closes before the request line is in
+    Exchange e = exchange("GET /metrics HTTP/1.1\r\n\r\n", &alarm, &co2, silent);
+    CHECK(e.closed && e.response.empty() && e.polls <= 2);
+
+    // Its socket takes only part of a write
+    Peer full;
+    full.writeLimit = 100;
+    e = exchange("GET /metrics HTTP/1.1\r\n\r\n", &alarm, &co2, full);
+    CHECK(e.closed && e.writes == 1 && e.response.size() == 100);
+
+    // Takes the response so slowly it runs past RESPONSE_TIMEOUT
+    Peer slow;
+    slow.writeMicros = 10000;
+    slow.pollInterval = 5000000;
+    e = exchange("GET /metrics HTTP/1.1\r\n\r\n", &alarm, &co2, slow);
+    CHECK(e.closed && e.polls <= 6 && body(e.response).find("waku_api_requests_total") == std::string::npos);
+
+    // A new WiFi join while a response is going out
+    socket = hostConnect(WAKU_LOCAL_API_PORT);
+    socket->toDevice = "GET /metrics HTTP/1.1\r\n\r\n";
+    socket->writeMicros = 30000;
+    LocalApi::poll(&alarm, &co2);
+    CHECK(socket->deviceOpen && socket->writeCalls > 0);
+    LocalApi::begin();
+    CHECK(!socket->deviceOpen);
+}
+
+// A slow socket: each poll sends for about SEND_SLICE and returns, so the
+// response goes out over several polls, and clients queued behind it are
+// served in turn
+static void checkSlices(Alarm& alarm, CO2Sensor& co2) {
+    Peer slow;
+    slow.writeMicros = 20000;
+    auto waiting = hostConnect(WAKU_LOCAL_API_PORT);
+    waiting->toDevice = "GET /nope HTTP/1.1\r\n\r\n";
+    Exchange e = exchange("GET /metrics HTTP/1.1\r\n\r\n", &alarm, &co2, slow);
+
+    // The queued client was accepted first and answered within the first polls
+    CHECK(!waiting->deviceOpen && startsWith(waiting->fromDevice, "HTTP/1.1 404 "));
+    std::map<std::string, unsigned long> samples;
+    std::vector<std::string> families;
+    CHECK(parsePrometheus(body(e.response), samples, families));
+    CHECK(families.size() == 20);
+    CHECK(e.maxWritesPerPoll == 3);
+    CHECK(e.polls > e.writes / 3);
+    printf("slow socket: %u writes over %u polls, at most %u per poll\n", e.writes, e.polls, e.maxWritesPerPoll);
+}
+
+int main() {
+    hostConfigClear();
+    SensorCalibration calibration = {CO2_OFFSET, 0};
+    CHECK(ConfigStore::set(ConfigKey::CALIBRATION, calibration));
+    RTCTime time(19, Month::OCTOBER, 2026, 3, 0, 0, DayOfWeek::MONDAY, SaveLight::SAVING_TIME_INACTIVE);
+    RTC.setTime(time);
+    for (uint32_t late : {100, 200}) {
+        TaskStats::recordWake(TaskId::ALARM, late);
+    }
+
+    static const int LED_PINS[] = {9, 10, 11};
+    Alarm alarm(7, 0, 30, LED_PINS, 3, 5, 6);
+    CO2Sensor co2(2);
+    hostAdvance(1000000);
+
+    // Nothing is accepted before begin()
+    auto early = hostConnect(WAKU_LOCAL_API_PORT);
+    early->toDevice = "GET /state HTTP/1.1\r\n\r\n";
+    LocalApi::poll(&alarm, &co2);
+    CHECK(!early->accepted);
+    LocalApi::begin();
+    LocalApi::poll(&alarm, &co2);
+    CHECK(early->accepted);
+    while (early->deviceOpen) {
+        LocalApi::poll(&alarm, &co2);
+    }
+    LocalApi::poll(&alarm, &co2);
+
+    checkMetrics(alarm, co2);
+    checkState(alarm, co2);
+    checkErrors(alarm, co2);
+    checkSplits(alarm, co2);
+    checkDropped(alarm, co2);
+    checkSlices(alarm, co2);
+    checkPhases(alarm, co2);
+
+    LocalApi::printReport("");
+    return checkResult("test_local_api");
+}
@@ -0,0 +1,187 @@
+// Note-onset trace of MelodySequencer on both of its paths:
+//
+//   timer   the 100 Hz note timer switches notes from its interrupt; the
+//           interrupt is taken a few microseconds late, as on the device
+//   polled  no timer is free, and the 10 ms alarm task calls service(),
+//           sometimes held off by higher-priority work
+//
+// Each onset is timestamped on the simulated clock and compared with the
+// nominal length of the note before it. The result must agree with the
+// jitter the sequencer measures itself on the cycle counter, which is what
+// the device reports when playback stops.
+//
+//   test_melody [-v]    -v prints every onset
+
+#include <random>
+#include <vector>
+#include "check.h"
+#include "cycle_counter.h"
+#include "host_log.h"
+#include "melody.h"
+
+static const int BUZZER_PIN = 7;
+static const char* TRACK = "midi:67/600,0/200,69/600,72/400,74/100,0/30,76/1000,72/20,69/600";
+
+struct Onset {
+    uint64_t micros;
+    uint16_t frequency;
+};
+
+static std::vector<Onset> onsets;
+static bool verbose = false;
+
+struct TraceStats {
+    uint32_t onsets;
+    uint32_t maxMicros;
+    uint32_t meanMicros;
+};
+
+static void recordTone(unsigned int, unsigned int frequency) {
+    onsets.push_back({hostMicros, static_cast<uint16_t>(frequency)});
+}
+
+// Onset error against the nominal length of the note before, as the
+// sequencer counts it
+static TraceStats analyze(const char* name, const MelodyTrack* track, uint16_t firstNote) {
+    TraceStats stats = {0, 0, 0};
+    uint64_t total = 0;
+    for (size_t i = 1; i < onsets.size(); i++) {
+        PackedNote previous = track->notes[(firstNote + i - 1) % track->length];
+        int64_t nominal = Melody::durationMs(previous) * 1000LL;
+        int64_t actual = static_cast<int64_t>(onsets[i].micros - onsets[i - 1].micros);
+        uint32_t error = static_cast<uint32_t>(actual > nominal ? actual - nominal : nominal - actual);
+        stats.onsets++;
+        total += error;
+        if (error > stats.maxMicros) {
+            stats.maxMicros = error;
+        }
+        if (verbose) {
+            printf("%s,%zu,%u,%lld,%lld\n", name, i, onsets[i - 1].frequency,
+                   static_cast<long long>(nominal), static_cast<long long>(actual));
+        }
+    }
+    stats.meanMicros = stats.onsets ? static_cast<uint32_t>(total / stats.onsets) : 0;
+    printf("%-7s trace:  %3u onsets, max %6u us, mean %6u us\n", name, stats.onsets, stats.maxMicros, stats.meanMicros);
+    return stats;
+}
+
+static void report(const char* name, const MelodySequencer::JitterStats& device) {
+    printf("%-7s device: %3u onsets, max %6u us, mean %6u us\n", name, device.onsets, device.maxMicros,
+           device.onsets ? device.totalMicros / device.onsets : 0);
+}
+
+// Timer path. An onset is a note timer interrupt that moved to the next
+// note; the tone timer's setting at that point is the note's pitch.
+static void traceTimerPath() {
+    std::mt19937 random(1);
+    std::uniform_int_distribution<uint32_t> latency(0, 4);     // us of interrupt entry
+
+    FspTimer::hostTimers.clear();
+    FspTimer::hostFreeTimers = -1;
+    MelodySequencer sequencer(BUZZER_PIN);
+    CHECK(sequencer.begin());
+    FspTimer* noteTimer = hostTimer(0);
+    FspTimer* toneTimer = hostTimer(1);
+    CHECK(noteTimer && toneTimer && noteTimer->frequency == 100.0f);
+
+    const MelodyTrack* track = MelodyStore::current();
+    uint32_t notes = 3 * track->length;
+
+    for (int play = 0; play < 2; play++) {
+        onsets.clear();
+        hostAdvance(12345);
+        uint64_t tick = hostMicros;
+        sequencer.start(millis());
+        onsets.push_back({hostMicros, static_cast<uint16_t>(toneTimer->running ? toneTimer->frequency / 2 : 0)});
+
+        while (onsets.size() <= notes) {
+            tick += 10000;
+            uint32_t lateBy = latency(random);
+            hostAdvance(tick + lateBy - hostMicros);
+            uint32_t before = sequencer.getJitterStats().onsets;
+            noteTimer->fire();
+            if (sequencer.getJitterStats().onsets != before) {
+                onsets.push_back({hostMicros, static_cast<uint16_t>(toneTimer->running ? toneTimer->frequency / 2 : 0)});
+            }
+        }
+        MelodySequencer::JitterStats device = sequencer.getJitterStats();
+        sequencer.stop();
+
+        TraceStats trace = analyze("timer", track, 0);
+        report("timer", device);
+
+        // Per play, not accumulated over plays
+        CHECK(device.onsets == notes);
+        CHECK(trace.onsets == device.onsets);
+        CHECK(trace.maxMicros <= 4);
+        CHECK(device.maxMicros <= trace.maxMicros);
+
+        const LogRecord* logged = hostLastLog(LogMsg::MELODY_JITTER);
+        CHECK(logged && static_cast<uint32_t>(logged->args[2]) == device.onsets);
+        CHECK(logged && static_cast<uint32_t>(logged->args[0]) == device.maxMicros);
+    }
+    CHECK(!sequencer.isRunning() && !noteTimer->running && !toneTimer->running);
+}
+
+// Polled path. The alarm task runs every 10 ms, and one run in eight is
+// held off by up to 25 ms more.
+static void tracePolledPath() {
+    std::mt19937 random(2);
+    std::uniform_int_distribution<uint32_t> starve(0, 25000);
+
+    FspTimer::hostTimers.clear();
+    FspTimer::hostFreeTimers = 0;
+    MelodySequencer sequencer(BUZZER_PIN);
+    CHECK(!sequencer.begin());
+
+    const MelodyTrack* track = MelodyStore::current();
+    uint32_t notes = 3 * track->length;
+
+    onsets.clear();
+    hostToneHook = recordTone;
+    hostAdvance(1000 - hostMicros % 1000);
+    uint64_t wake = hostMicros;
+    sequencer.start(millis());
+    while (onsets.size() <= notes) {
+        wake += 10000;
+        uint64_t runAt = wake + (random() % 8 == 0 ? starve(random) : 0);
+        hostAdvance(runAt - hostMicros);
+        sequencer.service(millis());
+    }
+    hostToneHook = nullptr;
+    MelodySequencer::JitterStats device = sequencer.getJitterStats();
+    sequencer.stop();
+
+    TraceStats trace = analyze("polled", track, 0);
+    report("polled", device);
+
+    // Same measurement on both sides, to the cycle counter's microsecond
+    CHECK(device.onsets == notes);
+    CHECK(trace.onsets == device.onsets);
+    CHECK(device.maxMicros + 1 >= trace.maxMicros && device.maxMicros <= trace.maxMicros + 1);
+    CHECK(trace.maxMicros > 10000);
+}
+
+int main(int argc, char** argv) {
+    verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    if (verbose) {
+        printf("path,onset,previous_hz,nominal_us,actual_us\n");
+    }
+
+    CycleCounter::begin();
+    CHECK(MelodyStore::load(TRACK) == MelodyStore::LoadResult::LOADED);
+    CHECK(MelodyStore::load(TRACK) == MelodyStore::LoadResult::UNCHANGED);
+    // A melody that does not parse leaves the track alone, once
+    const MelodyTrack* loaded = MelodyStore::current();
+    CHECK(MelodyStore::load("midi:") == MelodyStore::LoadResult::INVALID);
+    CHECK(MelodyStore::load("midi:") == MelodyStore::LoadResult::STILL_INVALID);
+    CHECK(MelodyStore::current() == loaded);
+    traceTimerPath();
+    tracePolledPath();
+
+    MelodyStore::reset();
+    CHECK(MelodyStore::current() == &Melody::VELVET_HORIZON);
+    traceTimerPath();
+
+    return checkResult("test_melody");
+}
@@ -0,0 +1,466 @@
+// Firmware pull from the home server through the simulated TCP layer in
+// stubs/WiFiS3.h, into a staging area kept in memory:
+//
+//   - CRC-32 against the check value and a bitwise reference, and the heatshrink decoder
+//     against the stand-in server's encoder (ported below) on code-like,
+//     repetitive and random data, fed one byte at a time
+//   - a download staged byte for byte, then applied outside the wake window
+//     with the version saved first
+//   - an image that does not compress: a body larger than the image
+//   - 304, the refused version, bad and oversized responses, a CRC
+//     mismatch, a truncated body, a stalled server, the run-up to the wake
+//     window, and a staging area too slow to copy under the watchdog
+//
+// Scenarios that end with an image staged run in a child process, since a
+// staged image stays staged until the device resets.
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <random>
+#include <string>
+#include <vector>
+#include <WDT.h>
+#include "alarm.h"
+#include "check.h"
+#include "config_store.h"
+#include "crc32.h"
+#include "heatshrink_decoder.h"
+#include "host_config_store.h"
+#include "host_log.h"
+#include "ota_updater.h"
+#include "radio_manager.h"
+#include "supervisor.h"
+
+static const uint32_t OFFERED = WAKU_FIRMWARE_VERSION + 1;
+static const uint32_t REFUSED = 99;
+static const uint64_t SECOND = 1000000;
+
+// Link seams
+bool RadioManager::held = false;
+std::atomic<bool> Supervisor::paused(false);
+std::atomic<uint32_t> Supervisor::pausedAt(0);
+
+// Staging area in RAM; writeMicros is the simulated flash time per byte
+struct MemoryStorage : OTAStorage {
+    std::vector<uint8_t> data;
+    uint32_t writeMicros = 0;
+    int opens = 0;
+    int clears = 0;
+    int applies = 0;
+    bool isOpen = false;
+
+    int open(int length) override {
+        data.clear();
+        isOpen = true;
+        opens++;
+        return 1;
+    }
+    size_t write(uint8_t value) override {
+        if (!isOpen) {
+            return 0;
+        }
+        hostAdvance(writeMicros);
+        data.push_back(value);
+        return 1;
+    }
+    void close() override { isOpen = false; }
+    void clear() override {
+        data.clear();
+        clears++;
+    }
+    void apply() override { applies++; }
+    long maxSize() override { return 128 * 1024; }
+};
+
+static MemoryStorage storage;
+static int pushPolls = 0;
+
+static void pushPoll() {
+    pushPolls++;
+}
+
+// tools/server_standin.py's encoder: greedy longest match within the window,
+// any match of two bytes or more, MSB-first fields, zero padded
+static std::vector<uint8_t> compress(const std::vector<uint8_t>& data) {
+    const size_t window = 1 << HeatshrinkDecoder::WINDOW_BITS;
+    const size_t maxLength = 1 << HeatshrinkDecoder::LOOKAHEAD_BITS;
+    std::vector<uint8_t> out;
+    uint32_t acc = 0;
+    uint8_t accBits = 0;
+    auto put = [&](uint32_t value, uint8_t bits) {
+        acc = (acc << bits) | value;
+        accBits += bits;
+        while (accBits >= 8) {
+            accBits -= 8;
+            out.push_back(static_cast<uint8_t>(acc >> accBits));
+        }
+        acc &= (1u << accBits) - 1;
+    };
+
+    for (size_t i = 0; i < data.size();) {
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+        for (size_t distance = 1; distance <= window && distance <= i; distance++) {
+            size_t length = 0;
+            while (length < maxLength && i + length < data.size() && data[i - distance + length] == data[i + length]) {
+                length++;
+            }
+            if (length > bestLength) {
+                bestLength = length;
+                bestDistance = distance;
+            }
+        }
+        if (bestLength >= 2) {
+            put(0, 1);
+            put(static_cast<uint32_t>(bestDistance - 1), HeatshrinkDecoder::WINDOW_BITS);
+            put(static_cast<uint32_t>(bestLength - 1), HeatshrinkDecoder::LOOKAHEAD_BITS);
+            i += bestLength;
+        } else {
+            put(1, 1);
+            put(data[i], 8);
+            i++;
+        }
+    }
+    if (accBits) {
+        put(0, 8 - accBits);
+    }
+    return out;
+}
+
+// Thumb-like code: a few instruction patterns with varying operands, and
+// literal pools of random words
+static std::vector<uint8_t> codeImage(size_t size, std::mt19937& random) {
+    static const uint16_t PATTERNS[] = {0x4770, 0xB510, 0xBD10, 0x2000, 0x6800, 0x4618, 0xF000, 0xE7FE};
+    std::vector<uint8_t> image;
+    while (image.size() < size) {
+        if (random() % 16 == 0) {
+            for (int i = 0; i < 8; i++) {
+                image.push_back(static_cast<uint8_t>(random()));
+            }
+        } else {
+            uint16_t op = PATTERNS[random() % 8] | (random() % 4 == 0 ? random() % 8 : 0);
+            image.push_back(static_cast<uint8_t>(op));
+            image.push_back(static_cast<uint8_t>(op >> 8));
+        }
+    }
+    image.resize(size);
+    return image;
+}
+
+static std::vector<uint8_t> randomImage(size_t size, std::mt19937& random) {
+    std::vector<uint8_t> image(size);
+    for (uint8_t& byte : image) {
+        byte = static_cast<uint8_t>(random());
+    }
+    return image;
+}
+
+static uint32_t crcOf(const std::vector<uint8_t>& data) {
+    return crc32Update(0, data.data(), data.size());
+}
+
+// One bit at a time, straight from the polynomial
+static uint32_t referenceCrc(const std::vector<uint8_t>& data) {
+    uint32_t crc = 0xFFFFFFFFUL;
+    for (uint8_t byte : data) {
+        crc ^= byte;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+static void checkCrc(std::mt19937& random) {
+    CHECK(crc32Update(0, "123456789", 9) == 0xCBF43926UL);
+    CHECK(crc32Update(0, "", 0) == 0);
+    // Chained over uneven pieces, as the download feeds it
+    std::vector<uint8_t> data = randomImage(100000, random);
+    uint32_t crc = 0;
+    for (size_t i = 0; i < data.size(); i += 1 + i % 17) {
+        crc = crc32Update(crc, &data[i], std::min<size_t>(1 + i % 17, data.size() - i));
+    }
+    CHECK(crc == referenceCrc(data));
+    CHECK(crc == crcOf(data));
+}
+
+// Decoded one input byte at a time and cut at the known size, as the
+// download does
+static std::vector<uint8_t> decompress(const std::vector<uint8_t>& body, size_t size) {
+    HeatshrinkDecoder decoder;
+    decoder.reset();
+    std::vector<uint8_t> out;
+    uint8_t produced[HeatshrinkDecoder::MAX_OUTPUT];
+    for (uint8_t byte : body) {
+        uint8_t n = decoder.feed(byte, produced);
+        out.insert(out.end(), produced, produced + n);
+    }
+    if (out.size() > size) {
+        out.resize(size);
+    }
+    return out;
+}
+
+static void checkDecoder(std::mt19937& random) {
+    struct Case {
+        const char* name;
+        std::vector<uint8_t> data;
+    };
+    std::vector<Case> cases = {
+        {"code", codeImage(50000, random)},
+        {"zeros", std::vector<uint8_t>(5000, 0)},
+        {"random", randomImage(5000, random)},
+        {"one byte", {0x42}},
+        {"empty", {}},
+    };
+    std::string text;
+    while (text.size() < 20000) {
+        text += "The window is the last 256 bytes of output; " + std::to_string(text.size() % 977) + "\n";
+    }
+    cases.push_back({"text", std::vector<uint8_t>(text.begin(), text.end())});
+
+    for (const Case& c : cases) {
+        std::vector<uint8_t> body = compress(c.data);
+        CHECK(decompress(body, c.data.size()) == c.data);
+        printf("heatshrink %-8s %6zu -> %6zu bytes\n", c.name, c.data.size(), body.size());
+    }
+}
+
+// One check as the server sees it
+struct Server {
+    std::string response;
+    size_t chunk = 3000;            // Bytes sent per poll
+    size_t stopAfter = SIZE_MAX;    // Send no more than this
+    bool closeAtStop = true;        // Close the connection there, or go quiet
+    Alarm* alarm = nullptr;
+};
+
+static std::string response200(const std::vector<uint8_t>& image, const std::vector<uint8_t>& body, uint32_t version,
+                               uint32_t crc) {
+    char header[256];
+    snprintf(header, sizeof(header),
+             "HTTP/1.0 200 OK\r\nServer: stand-in\r\nETag: \"%u\"\r\nContent-Type: application/x-heatshrink\r\n"
+             "Content-Length: %zu\r\nX-Firmware-Size: %zu\r\nX-Firmware-CRC32: %08x\r\nConnection: close\r\n\r\n",
+             version, body.size(), image.size(), crc);
+    return header + std::string(body.begin(), body.end());
+}
+
+// Wait for the next check, answer it and poll until the device hangs up.
+// The socket, or nullptr if no check was started.
+static std::shared_ptr<HostSocket> serve(const Server& server) {
+    hostAdvance(3600 * SECOND);
+    size_t sockets = hostSockets.size();
+    OtaUpdater::cycle(server.alarm);
+    if (hostSockets.size() == sockets) {
+        return nullptr;
+    }
+    auto socket = hostSockets.back();
+    CHECK(socket->fromDevice.find("GET /api/device/firmware HTTP/1.1\r\n") == 0);
+    CHECK(socket->fromDevice.find("If-None-Match: \"" + std::to_string(WAKU_FIRMWARE_VERSION) + "\"\r\n") !=
+          std::string::npos);
+    CHECK(RadioManager::isHeld());
+
+    size_t end = std::min(server.stopAfter, server.response.size());
+    size_t sent = 0;
+    for (int polls = 0; polls < 100000 && socket->deviceOpen; polls++) {
+        size_t n = std::min(server.chunk, end - sent);
+        socket->toDevice += server.response.substr(sent, n);
+        sent += n;
+        if (sent == end && (end == server.response.size() || server.closeAtStop)) {
+            socket->peerOpen = false;
+        }
+        OtaUpdater::poll(server.alarm);
+        hostAdvance(250000);
+    }
+    CHECK(!socket->deviceOpen);
+    CHECK(!RadioManager::isHeld());
+    return socket;
+}
+
+// What the "ota" console command prints
+static std::string report() {
+    std::string text;
+    hostSerialCapture = &text;
+    OtaUpdater::printReport("");
+    hostSerialCapture = nullptr;
+    return text;
+}
+
+static void setTime(int hour, int minute) {
+    RTCTime time(19, Month::OCTOBER, 2026, hour, minute, 0, DayOfWeek::MONDAY, SaveLight::SAVING_TIME_INACTIVE);
+    RTC.setTime(time);
+}
+
+// Downloads that must not leave anything staged
+static void checkRejected(std::mt19937& random, Alarm& alarm) {
+    std::vector<uint8_t> image = codeImage(30000, random);
+    std::vector<uint8_t> body = compress(image);
+    Server server;
+
+    // Up to date
+    server.response = "HTTP/1.1 304 Not Modified\r\nETag: \"1\"\r\n\r\n";
+    CHECK(serve(server) != nullptr);
+    CHECK(storage.opens == 0);
+    // Pushes are taken once nothing uses the staging area
+    int pushesBefore = pushPolls;
+    OtaUpdater::poll(&alarm);
+    CHECK(pushPolls == pushesBefore + 1);
+
+    // The version that came up as another one before
+    server.response = response200(image, body, REFUSED, crcOf(image));
+    CHECK(serve(server) != nullptr);
+    CHECK(storage.opens == 0);
+
+    struct Case {
+        const char* name;
+        std::string response;
+        size_t stopAfter;
+        bool closeAtStop;
+        bool opened;
+    };
+    std::string full = response200(image, body, OFFERED, crcOf(image));
+    const Case CASES[] = {
+        {"bad response", "HTTP/1.1 200 OK\r\nETag: \"2\"\r\nContent-Length: 10\r\n\r\n0123456789", SIZE_MAX, true, false},
+        {"bad response", "HTTP/1.1 500 Internal Server Error\r\n\r\n", SIZE_MAX, true, false},
+        {"too large", response200(std::vector<uint8_t>(200000), body, OFFERED, 0), SIZE_MAX, true, false},
+        {"CRC mismatch", response200(image, body, OFFERED, crcOf(image) ^ 1), SIZE_MAX, true, true},
+        {"truncated", full, full.size() - 100, true, true},
+        {"closed", full, 40, true, false},
+        {"timeout", full, full.size() / 2, false, true},
+    };
+    for (const Case& c : CASES) {
+        int opens = storage.opens;
+        int clears = storage.clears;
+        size_t logs = hostLog.size();
+        server.response = c.response;
+        server.stopAfter = c.stopAfter;
+        server.closeAtStop = c.closeAtStop;
+        CHECK(serve(server) != nullptr);
+        const LogRecord* failed = hostLastLog(LogMsg::OTA_FAILED);
+        CHECK(failed && hostLog.size() > logs && failed == &hostLog.back());
+        CHECK((storage.opens > opens) == c.opened);
+        CHECK((storage.clears > clears) == c.opened);
+        CHECK(!hostLastLog(LogMsg::OTA_STAGED));
+        CHECK(report().find(std::string(" failed, last: ") + c.name + "\r\n") != std::string::npos);
+    }
+    server.stopAfter = SIZE_MAX;
+
+    // The run-up to the wake window (07:00, from 06:00 with the margin)
+    // drops a download in progress and starts none
+    setTime(5, 59);
+    server.response = full;
+    server.chunk = 500;
+    server.alarm = &alarm;
+    int clears = storage.clears;
+    hostAdvance(3600 * SECOND);
+    OtaUpdater::cycle(&alarm);
+    auto socket = hostSockets.back();
+    socket->toDevice = full.substr(0, 2000);
+    OtaUpdater::poll(&alarm);
+    CHECK(socket->deviceOpen && storage.data.size() > 0);
+    setTime(6, 0);
+    OtaUpdater::poll(&alarm);
+    CHECK(!socket->deviceOpen && storage.clears == clears + 1 && !RadioManager::isHeld());
+    CHECK(report().find("last: wake window\r\n") != std::string::npos);
+    CHECK(serve(server) == nullptr);
+    setTime(3, 0);
+    server.chunk = 3000;
+    server.alarm = nullptr;
+}
+
+// Staged and applied: the bytes, the CRC, the log, the swap. Run in a child.
+static void checkStaged(const std::vector<uint8_t>& image, Alarm& alarm) {
+    std::vector<uint8_t> body = compress(image);
+    Server server;
+    server.response = response200(image, body, OFFERED, crcOf(image));
+    // No push upload into the staging area under the download or over the image
+    int pushesBefore = pushPolls;
+    CHECK(serve(server) != nullptr);
+    OtaUpdater::poll(&alarm);
+    CHECK(pushPolls == pushesBefore);
+
+    CHECK(storage.data == image);
+    const LogRecord* staged = hostLastLog(LogMsg::OTA_STAGED);
+    CHECK(staged && staged->args[0] == static_cast<int32_t>(OFFERED));
+    CHECK(staged && staged->args[2] == static_cast<int32_t>(image.size()) - static_cast<int32_t>(body.size()));
+    printf("staged %zu bytes from a %zu byte body, %d bytes saved\n", image.size(), body.size(),
+           staged ? staged->args[2] : 0);
+
+    // Not applied in the run-up to the wake window, then outside it
+    setTime(6, 30);
+    hostAdvance(15 * SECOND);
+    OtaUpdater::cycle(&alarm);
+    CHECK(storage.applies == 0);
+    setTime(8, 0);
+    uint32_t refreshes = WDT.refreshes;
+    OtaUpdater::cycle(&alarm);
+    CHECK(storage.applies == 1 && WDT.refreshes == refreshes + 1);
+    uint32_t applied = 0;
+    CHECK(ConfigStore::get(ConfigKey::FIRMWARE_APPLIED, applied) && applied == OFFERED);
+    OtaUpdater::printReport("");
+}
+
+// A staging area that takes longer than the copy may: dropped, and the
+// version is not fetched again
+static void checkSlowStorage(std::mt19937& random) {
+    std::vector<uint8_t> image = codeImage(40000, random);
+    Server server;
+    server.response = response200(image, compress(image), OFFERED, crcOf(image));
+    storage.writeMicros = 100;      // 4 s of flash time for the image
+    size_t logs = hostLog.size();
+    int clears = storage.clears;
+    CHECK(serve(server) != nullptr);
+    storage.writeMicros = 0;
+    const LogRecord* slow = hostLastLog(LogMsg::OTA_COPY_TOO_SLOW);
+    CHECK(slow && slow == &hostLog.back() && hostLog.size() > logs);
+    CHECK(slow && slow->args[0] == static_cast<int32_t>(OFFERED) && slow->args[1] >= 4000 && slow->args[1] < 4500);
+    CHECK(storage.clears == clears + 1 && !hostLastLog(LogMsg::OTA_STAGED));
+
+    int opens = storage.opens;
+    CHECK(serve(server) != nullptr);
+    CHECK(storage.opens == opens);
+    OtaUpdater::printReport("");
+}
+
+// Run a scenario in a child process, which has a copy of the state so far
+template <typename Scenario>
+static void inChild(Scenario scenario) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        scenario();
+        fflush(stdout);
+        _exit(hostCheckFailures ? 1 : 0);
+    }
+    int status = 0;
+    CHECK(pid > 0 && waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main() {
+    std::mt19937 random(7);
+    checkCrc(random);
+    checkDecoder(random);
+
+    // The last image applied came up as another version
+    hostConfigClear();
+    CHECK(ConfigStore::set(ConfigKey::FIRMWARE_APPLIED, REFUSED));
+    OtaUpdater::begin("server.local", 8080, nullptr, storage, pushPoll);
+    const LogRecord* refused = hostLastLog(LogMsg::OTA_REFUSED);
+    CHECK(refused && refused->args[0] == static_cast<int32_t>(REFUSED));
+
+    static const int LED_PINS[] = {9, 10, 11};
+    Alarm alarm(7, 0, 30, LED_PINS, 3, 5, 6);
+    setTime(3, 0);
+
+    checkRejected(random, alarm);
+
+    std::vector<uint8_t> code = codeImage(60000, random);
+    inChild([&] { checkStaged(code, alarm); });
+    // Random bytes grow by an eighth in heatshrink's format
+    std::vector<uint8_t> noise = randomImage(20000, random);
+    inChild([&] { checkStaged(noise, alarm); });
+
+    checkSlowStorage(random);
+    return checkResult("test_ota_updater");
+}
@@ -0,0 +1,141 @@
+// SeqLock under contention on real threads: one writer publishing as fast as
+// it can, several readers copying at the same time. Every published value
+// is internally consistent, so a torn copy (fields from two different writes)
+// shows up as a value that was never written.
+//
+//   - AlarmSchedule, the type the alarm publishes: the minute is derived
+//     from the hour and the armed flag
+//   - a 64-byte value. Every fourth copy a reader makes yields to the other
+//     threads halfway through, so writes land in the middle of copies even
+//     on a single core: every word must be equal
+//
+// The versions a reader sees must never go backwards.
+//
+//   test_seqlock [writes]     default 500000, a tenth of that for the wide value
+
+#include <thread>
+#include <vector>
+#include "alarm_config.h"
+#include "check.h"
+
+static const int READERS = 3;
+
+static thread_local bool isReader = false;
+static thread_local uint32_t copies = 0;
+
+struct Wide {
+    uint32_t words[16];
+
+    Wide() = default;
+    Wide(const Wide& other) = default;
+    Wide& operator=(const Wide& other) {
+        for (int i = 0; i < 16; i++) {
+            if (i == 8 && isReader && ++copies % 4 == 0) {
+                std::this_thread::yield();
+            }
+            words[i] = other.words[i];
+        }
+        return *this;
+    }
+};
+
+struct ReaderStats {
+    uint64_t reads = 0;
+    uint64_t torn = 0;
+    uint64_t backwards = 0;
+};
+
+static AlarmSchedule scheduleFor(uint32_t n) {
+    uint8_t hour = static_cast<uint8_t>(n % 24);
+    bool armed = (n / 24) % 2;
+    return AlarmSchedule{hour, static_cast<uint8_t>((hour * 7 + armed * 13) % 60), armed};
+}
+
+static bool consistent(const AlarmSchedule& s) {
+    return s.wakeHour < 24 && s.wakeMinute == (s.wakeHour * 7 + s.armed * 13) % 60;
+}
+
+static Wide wideFor(uint32_t n) {
+    Wide w;
+    for (uint32_t& word : w.words) {
+        word = n;
+    }
+    return w;
+}
+
+static bool consistent(const Wide& w) {
+    for (uint32_t word : w.words) {
+        if (word != w.words[0]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Cooperative: the readers yield inside their copies, and the writer lets
+// them back in every few writes; otherwise they all just spin.
+template <typename T, bool Cooperative, typename Make>
+static void stress(const char* name, uint32_t writes, Make make) {
+    SeqLock<T> lock(make(0));
+    std::atomic<bool> done(false);
+    std::vector<ReaderStats> stats(READERS);
+    std::vector<std::thread> readers;
+
+    for (int r = 0; r < READERS; r++) {
+        readers.emplace_back([&, r] {
+            ReaderStats& mine = stats[r];
+            isReader = true;
+            uint32_t lastVersion = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                uint32_t version = lock.version();
+                T copy = lock.read();
+                mine.reads++;
+                if (!consistent(copy)) {
+                    mine.torn++;
+                }
+                if (version < lastVersion) {
+                    mine.backwards++;
+                }
+                lastVersion = version;
+            }
+        });
+    }
+
+    std::thread writer([&] {
+        for (uint32_t n = 1; n <= writes; n++) {
+            lock.write(make(n));
+            if (Cooperative && n % 16 == 0) {
+                std::this_thread::yield();
+            }
+        }
+        done.store(true, std::memory_order_relaxed);
+    });
+    writer.join();
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    ReaderStats total;
+    for (const ReaderStats& s : stats) {
+        total.reads += s.reads;
+        total.torn += s.torn;
+        total.backwards += s.backwards;
+        CHECK(s.reads > 0);
+    }
+    printf("%-13s %u writes, %d readers: %llu reads, %llu torn, %llu version steps back\n", name, writes,
+           READERS, static_cast<unsigned long long>(total.reads), static_cast<unsigned long long>(total.torn),
+           static_cast<unsigned long long>(total.backwards));
+
+    CHECK(total.torn == 0);
+    CHECK(total.backwards == 0);
+    CHECK(lock.version() == writes);
+    CHECK(consistent(lock.read()));
+}
+
+int main(int argc, char** argv) {
+    uint32_t writes = argc > 1 ? static_cast<uint32_t>(atol(argv[1])) : 500000;
+
+    stress<AlarmSchedule, false>("AlarmSchedule", writes, scheduleFor);
+    stress<Wide, true>("64-byte value", writes / 10, wideFor);
+    return checkResult("test_seqlock");
+}
@@ -0,0 +1,114 @@
+// SoundMeter on the host:
+//
+//   - the dual 16-bit MAC kernel gives exactly the scalar reference's result
+//     on random and extreme blocks (the intrinsics are emulated bit for bit)
+//   - begin() links the sample timer's overflow to the ADC through the ELC
+//     and arms a hardware-triggered single scan of the microphone channel
+//   - tones fed through the ADC result register come out at the expected
+//     RMS, peak and weighted level after one second of blocks
+
+#include <random>
+#include "check.h"
+#include "sound_meter.h"
+
+static bool sameResult(const SoundMeter::BlockResult& a, const SoundMeter::BlockResult& b) {
+    return a.meanSquare == b.meanSquare && a.weightedSquare == b.weightedSquare && a.peak == b.peak;
+}
+
+static void checkKernel() {
+    std::mt19937 random(29);
+    std::uniform_int_distribution<int> adc(-2048, 2047);
+    std::uniform_int_distribution<int> full(-32768, 32767);
+    alignas(4) int16_t block[SoundMeter::BLOCK_SIZE];
+
+    uint32_t blocks = 0;
+    for (int round = 0; round < 2000; round++) {
+        uint16_t count = 2 * (1 + round % (SoundMeter::BLOCK_SIZE / 2));
+        for (uint16_t i = 0; i < count; i++) {
+            block[i] = static_cast<int16_t>(round % 2 ? adc(random) : full(random) / 8);
+        }
+        CHECK(sameResult(SoundMeter::analyzeBlock(block, count), SoundMeter::analyzeBlockScalar(block, count)));
+        blocks++;
+    }
+
+    const int16_t extremes[] = {2047, -2048, 0, 1, -1};
+    for (int16_t a : extremes) {
+        for (int16_t b : extremes) {
+            for (uint16_t i = 0; i < SoundMeter::BLOCK_SIZE; i++) {
+                block[i] = i % 2 ? a : b;
+            }
+            CHECK(sameResult(SoundMeter::analyzeBlock(block, SoundMeter::BLOCK_SIZE),
+                             SoundMeter::analyzeBlockScalar(block, SoundMeter::BLOCK_SIZE)));
+            blocks++;
+        }
+    }
+    printf("kernel matches the scalar reference on %u blocks\n", blocks);
+}
+
+// One second of a tone through the sample interrupt and process()
+static SoundLevelStats measureTone(SoundMeter& meter, FspTimer* timer, uint8_t channel, double hz, double amplitude) {
+    for (uint32_t n = 0; n < SoundMeter::SAMPLE_RATE; n++) {
+        double x = amplitude * sin(2 * M_PI * hz * n / SoundMeter::SAMPLE_RATE);
+        R_ADC0->ADDR[channel] = static_cast<uint16_t>(lround(2048 + x));
+        timer->fire();
+        if ((n + 1) % SoundMeter::BLOCK_SIZE == 0) {
+            meter.process();
+        }
+    }
+    return meter.getLastSecond();
+}
+
+static bool near(float value, double expected, double tolerance) {
+    return fabs(value - expected) <= tolerance;
+}
+
+static void checkPipeline() {
+    FspTimer::hostTimers.clear();
+    FspTimer::hostFreeTimers = -1;
+
+    SoundMeter notAnalog(7);
+    CHECK(!notAnalog.begin());
+
+    SoundMeter meter(A0);
+    CHECK(meter.begin());
+    FspTimer* timer = hostTimer(0);
+    CHECK(timer && timer->running && timer->frequency == SoundMeter::SAMPLE_RATE);
+
+    // A0 is AN09; overflow of the claimed GPT channel starts its scan
+    const uint8_t channel = 9;
+    CHECK(R_ADC0->ADANSA[0] == (1U << channel) && R_ADC0->ADANSA[1] == 0);
+    CHECK(R_ADC0->ADSTRGR_b.TRSA == 0x09 && R_ADC0->ADCSR_b.TRGE == 1 && R_ADC0->ADCSR_b.ADCS == 0);
+    CHECK(R_ELC->ELSR[ELC_PERIPHERAL_ADC0].HA == ELC_EVENT_GPT0_COUNTER_OVERFLOW + timer->channel);
+    CHECK(R_ELC->ELCR_b.ELCON == 1);
+
+    // Half scale: -6 dBFS peak, -9 dBFS RMS. The first difference weights
+    // 1 kHz by 2 sin(pi f / fs), -2.3 dB, and 100 Hz by -22 dB.
+    SoundLevelStats tone = measureTone(meter, timer, channel, 1000, 1024);
+    printf("1 kHz, half scale:  rms %.2f, peak %.2f, weighted %.2f dBFS, cpu %u permille\n",
+           tone.rmsDbfs, tone.peakDbfs, tone.weightedDbfs, tone.cpuLoadPermille);
+    CHECK(tone.valid);
+    CHECK(near(tone.rmsDbfs, -9.03, 0.05));
+    CHECK(near(tone.peakDbfs, -6.02, 0.05));
+    CHECK(near(tone.weightedDbfs, -9.03 - 2.33, 0.1));
+
+    SoundLevelStats hum = measureTone(meter, timer, channel, 100, 1024);
+    printf("100 Hz, half scale: rms %.2f, peak %.2f, weighted %.2f dBFS\n", hum.rmsDbfs, hum.peakDbfs, hum.weightedDbfs);
+    CHECK(near(hum.rmsDbfs, -9.03, 0.2));      // 2.5 periods per block: the DC removal takes a little
+    CHECK(near(hum.weightedDbfs, -9.03 - 22.1, 0.3));
+
+    SoundLevelStats quiet = measureTone(meter, timer, channel, 1000, 16);
+    CHECK(near(quiet.rmsDbfs, -45.15, 0.2));
+    CHECK(meter.getOverruns() == 0);
+
+    // Blocks left unprocessed are counted, not silently overwritten
+    for (uint32_t n = 0; n < 3 * SoundMeter::BLOCK_SIZE; n++) {
+        timer->fire();
+    }
+    CHECK(meter.getOverruns() == 2);
+}
+
+int main() {
+    checkKernel();
+    checkPipeline();
+    return checkResult("test_sound_meter");
+}
@@ -0,0 +1,217 @@
+// WavetableSynth on the host:
+//
+//   - renders the wake-up theme through the device path (sequencer note
+//     timer, render interrupt, sample interrupt writing DAC codes) with the
+//     volume ramp the dawn applies, and writes the DAC output to a WAV file
+//   - sheds voices when blocks go over the CPU budget and gives them back
+//     once blocks fit again
+//   - times renderBlock() with all voices sounding
+//
+//   test_synth [out.wav [seconds]]     default synth.wav, 40 s
+
+#include <chrono>
+#include <vector>
+#include "check.h"
+#include "cycle_counter.h"
+#include "host_log.h"
+#include "melody.h"
+#include "wavetable_synth.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static const int BUZZER_PIN = 7;
+
+static void writeWav(const char* path, const std::vector<int16_t>& samples) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        perror(path);
+        return;
+    }
+    auto put32 = [file](uint32_t v) { fwrite(&v, 4, 1, file); };
+    auto put16 = [file](uint16_t v) { fwrite(&v, 2, 1, file); };
+    uint32_t dataBytes = samples.size() * 2;
+    fwrite("RIFF", 1, 4, file);
+    put32(36 + dataBytes);
+    fwrite("WAVEfmt ", 1, 8, file);
+    put32(16);
+    put16(1);                                   // PCM
+    put16(1);                                   // Mono
+    put32(WavetableSynth::SAMPLE_RATE);
+    put32(WavetableSynth::SAMPLE_RATE * 2);
+    put16(2);
+    put16(16);
+    fwrite("data", 1, 4, file);
+    put32(dataBytes);
+    fwrite(samples.data(), 2, samples.size(), file);
+    fclose(file);
+}
+
+static double rms(const std::vector<int16_t>& samples, size_t from, size_t count) {
+    double sum = 0;
+    for (size_t i = from; i < from + count; i++) {
+        sum += static_cast<double>(samples[i]) * samples[i];
+    }
+    return sqrt(sum / count);
+}
+
+// The alarm's sound phase from its start, in seconds, with the volume
+// following progress squared as ProgressiveAlarm does
+static void renderTheme(const char* path, uint32_t seconds) {
+    FspTimer::hostTimers.clear();
+    FspTimer::hostFreeTimers = -1;
+    WavetableSynth synth;
+    MelodySequencer melody(BUZZER_PIN);
+    CHECK(synth.begin());
+    CHECK(melody.begin());
+    FspTimer* sampleTimer = hostTimer(0);
+    FspTimer* renderTimer = hostTimer(1);
+    FspTimer* noteTimer = hostTimer(2);
+    melody.setSynth(&synth);
+
+    const uint32_t rate = WavetableSynth::SAMPLE_RATE;
+    const uint32_t samplesPerRender = static_cast<uint32_t>(rate / renderTimer->frequency);
+    const uint32_t samplesPerTick = rate / 100;
+    const uint64_t startMicros = hostMicros;
+
+    synth.setVolume(0.0f);
+    synth.start();
+    melody.start(millis());
+
+    std::vector<int16_t> wav;
+    wav.reserve(seconds * rate);
+    int32_t largestStep = 0;
+    uint16_t previous = R_DAC->DADR[0];
+    for (uint32_t n = 0; n < seconds * rate; n++) {
+        hostAdvance(startMicros + static_cast<uint64_t>(n) * 1000000 / rate - hostMicros);
+        if (n % rate == 0) {
+            float progress = static_cast<float>(n / rate) / seconds;
+            synth.setVolume(progress * progress);
+        }
+        if (n % samplesPerTick == 0) {
+            noteTimer->fire();
+        }
+        sampleTimer->fire();
+        if (n % samplesPerRender == 0) {
+            renderTimer->fire();
+        }
+
+        uint16_t code = R_DAC->DADR[0];
+        CHECK(code < 4096);
+        int32_t step = abs(static_cast<int32_t>(code) - previous);
+        largestStep = step > largestStep ? step : largestStep;
+        previous = code;
+        wav.push_back(static_cast<int16_t>((static_cast<int32_t>(code) - 2048) * 16));
+    }
+    melody.stop();
+    synth.stop();
+    CHECK(R_DAC->DADR[0] == 2048);
+
+    writeWav(path, wav);
+    double quiet = rms(wav, 2 * rate, rate);
+    double loud = rms(wav, wav.size() - rate, rate);
+    printf("rendered %u s to %s: rms %.0f after 2 s, %.0f in the last second, largest step %d codes\n",
+           seconds, path, quiet, loud, largestStep);
+
+    // Audible, getting louder with the dawn, and no wrap-around in the mix
+    CHECK(loud > 2000);
+    CHECK(loud > 4 * quiet);
+    CHECK(largestStep < 1024);
+}
+
+// Rendering cost is taken on the cycle counter around each block; here
+// every read of it costs the given cycles, so a block "takes" that many
+static void checkBudget() {
+    FspTimer::hostTimers.clear();
+    WavetableSynth synth;
+    CHECK(synth.begin());
+    FspTimer* renderTimer = hostTimer(1);
+    FspTimer* sampleTimer = hostTimer(0);
+    synth.setVolume(1.0f);
+    synth.start();
+
+    const uint32_t budget = (SystemCoreClock / WavetableSynth::SAMPLE_RATE) * WavetableSynth::BLOCK_SIZE *
+                            WavetableSynth::CPU_BUDGET_PERCENT / 100;
+    auto playBlocks = [&](uint32_t blocks, uint32_t cyclesPerBlock) {
+        DWT->CYCCNT.cyclesPerRead = cyclesPerBlock;
+        for (uint32_t b = 0; b < blocks; b++) {
+            for (uint16_t i = 0; i < WavetableSynth::BLOCK_SIZE; i++) {
+                sampleTimer->fire();
+            }
+            renderTimer->fire();
+        }
+        DWT->CYCCNT.cyclesPerRead = 0;
+    };
+
+    CHECK(synth.getLoadStats().voiceLimit == WavetableSynth::NUM_VOICES);
+    playBlocks(1, budget + 1);
+    CHECK(synth.getLoadStats().voiceLimit == WavetableSynth::NUM_VOICES - 1);
+    playBlocks(5, budget + 1);
+    CHECK(synth.getLoadStats().voiceLimit == 1);
+
+    // Just over what one more voice would cost: stays at one
+    playBlocks(3 * WavetableSynth::RESTORE_BLOCKS, budget / 2 + 1);
+    CHECK(synth.getLoadStats().voiceLimit == 1);
+
+    // Cheap again: a voice back per second of fitting blocks
+    playBlocks(WavetableSynth::RESTORE_BLOCKS - 1, budget / 4);
+    CHECK(synth.getLoadStats().voiceLimit == 1);
+    playBlocks(1, budget / 4);
+    CHECK(synth.getLoadStats().voiceLimit == 2);
+    playBlocks(WavetableSynth::RESTORE_BLOCKS, budget / 4);
+    CHECK(synth.getLoadStats().voiceLimit == 3);
+    playBlocks(10 * WavetableSynth::RESTORE_BLOCKS, budget / 4);
+    CHECK(synth.getLoadStats().voiceLimit == WavetableSynth::NUM_VOICES);
+
+    WavetableSynth::LoadStats stats = synth.getLoadStats();
+    printf("budget %u cycles per block: shed to 1 voice and restored to %u over %u blocks\n",
+           budget, stats.voiceLimit, stats.blocks);
+    synth.stop();
+}
+
+// Host time and, on x86, host cycles per sample with every voice sounding.
+// Only the ratio between changes means much; the device reports its own
+// cycles per sample through getLoadStats().
+static void timeRender() {
+    WavetableSynth synth;
+    synth.setVolume(1.0f);
+    for (int i = 0; i < 64; i++) {
+        int16_t warm[WavetableSynth::BLOCK_SIZE];
+        synth.renderBlock(warm, WavetableSynth::BLOCK_SIZE);
+    }
+
+    const uint32_t blocks = 20000;
+    int16_t out[WavetableSynth::BLOCK_SIZE];
+    int64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t startCycles = __rdtsc();
+#endif
+    for (uint32_t b = 0; b < blocks; b++) {
+        if (b % 50 == 0) {
+            synth.noteOn(440 + b % 300, 60000);
+        }
+        synth.renderBlock(out, WavetableSynth::BLOCK_SIZE);
+        checksum += out[b % WavetableSynth::BLOCK_SIZE];
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    double cycles = static_cast<double>(__rdtsc() - startCycles) / (blocks * WavetableSynth::BLOCK_SIZE);
+#else
+    double cycles = 0;
+#endif
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                (blocks * WavetableSynth::BLOCK_SIZE);
+    printf("renderBlock, %u voices: %.1f ns/sample, %.1f host cycles/sample (checksum %lld)\n",
+           WavetableSynth::NUM_VOICES, ns, cycles, static_cast<long long>(checksum));
+}
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "synth.wav";
+    uint32_t seconds = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : 40;
+
+    CycleCounter::begin();
+    renderTheme(path, seconds < 4 ? 4 : seconds);
+    checkBudget();
+    timeRender();
+    return checkResult("test_synth");
+}
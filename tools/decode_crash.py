@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""Decode Waku crash records against the firmware ELF.
+
+Takes the hex records printed by the "crash" console command (lines of the
+form "CRASH <slot> <state> <hex>") or uploaded as the "crash" field of a
+device update, from a file, the command line or stdin:
+
+    python3 tools/decode_crash.py --elf build/waku.ino.elf serial.txt
+    python3 tools/decode_crash.py --elf waku.ino.elf 48535243...
+
+Addresses are resolved with arm-none-eabi-addr2line, so the ELF has to be
+the exact build that crashed. Without --elf only the raw values are shown.
+The last log records are decoded with the tables decode_log.py uses, and
+their %s arguments are read from the same ELF.
+
+Record layout (little-endian, see CrashRecord in waku/crash_journal.h):
+    magic u32 | type u8 | log count u8 | reserved u16 | uptime ms u32 |
+    task name char[12] | r0 r1 r2 r3 r12 lr pc xpsr | exc_return | sp |
+    cfsr | hfsr | mmfar | bfar | stack u32 x 16 |
+    log record x 4 (timestamp u32, id u16, arg count u8, pad, args i32 x 3) |
+    crc32
+"""
+
+import argparse
+import os
+import re
+import struct
+import subprocess
+import sys
+import zlib
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import decode_log  # noqa: E402
+
+MAGIC = 0x43525348
+STACK_WORDS = 16
+LOG_RECORDS = 4
+HEADER = struct.Struct("<IBBHI12s")
+REGISTERS = struct.Struct("<8I6I")
+STACK = struct.Struct("<%dI" % STACK_WORDS)
+LOG_RECORD = struct.Struct("<IHBx3i")
+RECORD_SIZE = HEADER.size + REGISTERS.size + STACK.size + LOG_RECORDS * LOG_RECORD.size + 4
+
+CRASH_TYPES = {1: "HARD_FAULT", 2: "STACK_OVERFLOW", 3: "SUPERVISOR_RESET"}
+FRAME_NAMES = ["r0", "r1", "r2", "r3", "r12", "lr", "pc", "xpsr"]
+
+# RA4M1 code flash; Thumb return addresses in it have bit 0 set
+CODE_START = 0x00000000
+CODE_END = 0x00040000
+
+CFSR_BITS = [
+    (0, "IACCVIOL: instruction access violation"),
+    (1, "DACCVIOL: data access violation"),
+    (3, "MUNSTKERR: MemManage fault on exception return"),
+    (4, "MSTKERR: MemManage fault on exception entry"),
+    (5, "MLSPERR: MemManage fault during FP lazy state preservation"),
+    (7, "MMARVALID: MMFAR holds the faulting address"),
+    (8, "IBUSERR: instruction bus error"),
+    (9, "PRECISERR: precise data bus error"),
+    (10, "IMPRECISERR: imprecise data bus error"),
+    (11, "UNSTKERR: bus fault on exception return"),
+    (12, "STKERR: bus fault on exception entry (stack overflow?)"),
+    (13, "LSPERR: bus fault during FP lazy state preservation"),
+    (15, "BFARVALID: BFAR holds the faulting address"),
+    (16, "UNDEFINSTR: undefined instruction"),
+    (17, "INVSTATE: invalid EPSR state (Thumb bit clear?)"),
+    (18, "INVPC: invalid EXC_RETURN"),
+    (19, "NOCP: coprocessor access (FPU disabled?)"),
+    (24, "UNALIGNED: unaligned access"),
+    (25, "DIVBYZERO: divide by zero"),
+]
+
+HEX_RECORD = re.compile(r"\b([0-9a-fA-F]{%d})\b" % (2 * RECORD_SIZE))
+
+
+class Symbolizer:
+    def __init__(self, elf, addr2line):
+        self.elf = elf
+        self.addr2line = addr2line
+        self.cache = {}
+
+    def __call__(self, address):
+        if not self.elf:
+            return ""
+        if address not in self.cache:
+            try:
+                out = subprocess.run(
+                    [self.addr2line, "-f", "-C", "-p", "-e", self.elf, "0x%08x" % address],
+                    capture_output=True, text=True, check=True).stdout.strip()
+            except (OSError, subprocess.CalledProcessError) as e:
+                out = "(addr2line failed: %s)" % e
+            self.cache[address] = out
+        return self.cache[address]
+
+
+def is_code_address(value):
+    return CODE_START <= value < CODE_END and value & 1
+
+
+def parse(data):
+    magic, crash_type, log_count, _, uptime, task = HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        raise ValueError("bad magic 0x%08x" % magic)
+    if zlib.crc32(data[:-4]) != struct.unpack_from("<I", data, len(data) - 4)[0]:
+        raise ValueError("CRC mismatch")
+
+    offset = HEADER.size
+    registers = REGISTERS.unpack_from(data, offset)
+    offset += REGISTERS.size
+    stack = STACK.unpack_from(data, offset)
+    offset += STACK.size
+    logs = []
+    for i in range(min(log_count, LOG_RECORDS)):
+        timestamp, msg_id, arg_count, *args = LOG_RECORD.unpack_from(data, offset + i * LOG_RECORD.size)
+        logs.append((timestamp, msg_id, args[:min(arg_count, 3)]))
+
+    return {
+        "type": CRASH_TYPES.get(crash_type, "UNKNOWN(%d)" % crash_type),
+        "uptime": uptime,
+        "task": task.split(b"\0")[0].decode(errors="replace"),
+        "frame": dict(zip(FRAME_NAMES, registers[:8])),
+        "exc_return": registers[8],
+        "sp": registers[9],
+        "cfsr": registers[10],
+        "hfsr": registers[11],
+        "mmfar": registers[12],
+        "bfar": registers[13],
+        "stack": stack,
+        "logs": logs,
+    }
+
+
+def report(record, symbolize, messages, error_names, strings):
+    lines = ["%s in task '%s' after %.1f s" % (record["type"], record["task"], record["uptime"] / 1000.0)]
+
+    if record["type"] == "HARD_FAULT":
+        frame = record["frame"]
+        for name in ("pc", "lr"):
+            lines.append("  %-4s 0x%08x %s" % (name, frame[name], symbolize(frame[name] & ~1)))
+        lines.append("  " + "  ".join("%s=0x%08x" % (n, frame[n]) for n in FRAME_NAMES if n not in ("pc", "lr")))
+        lines.append("  sp=0x%08x exc_return=0x%08x" % (record["sp"], record["exc_return"]))
+        lines.append("  cfsr=0x%08x hfsr=0x%08x" % (record["cfsr"], record["hfsr"]))
+        for bit, text in CFSR_BITS:
+            if record["cfsr"] & (1 << bit):
+                lines.append("    " + text)
+        if record["hfsr"] & (1 << 30):
+            lines.append("    FORCED: escalated from a configurable fault")
+        if record["cfsr"] & (1 << 7):
+            lines.append("  mmfar=0x%08x" % record["mmfar"])
+        if record["cfsr"] & (1 << 15):
+            lines.append("  bfar=0x%08x" % record["bfar"])
+
+        # Return addresses among the stacked words give a rough backtrace
+        lines.append("  stack:")
+        for i, word in enumerate(record["stack"]):
+            note = symbolize(word & ~1) if is_code_address(word) else ""
+            lines.append("    [%2d] 0x%08x %s" % (i, word, note))
+    elif record["type"] == "STACK_OVERFLOW":
+        lines.append("  psp=0x%08x" % record["sp"])
+
+    if record["logs"]:
+        lines.append("  last log records (oldest first):")
+        for timestamp, msg_id, args in reversed(record["logs"]):
+            if msg_id < len(messages):
+                _, level, fmt = messages[msg_id]
+                text = decode_log.format_message(fmt, args, error_names, strings)
+                lines.append("    [%d] %s %s" % (timestamp, decode_log.LEVEL_LETTERS.get(level, "?"), text))
+            else:
+                lines.append("    [%d] ? Unknown log message %d %s" % (timestamp, msg_id, list(args)))
+
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", nargs="*", help="files or hex records (default: stdin)")
+    parser.add_argument("--elf", help="firmware ELF of the build that crashed")
+    parser.add_argument("--addr2line", default="arm-none-eabi-addr2line")
+    parser.add_argument("--messages", default=os.path.join(decode_log.ROOT, "log_messages.h"))
+    parser.add_argument("--errors", default=os.path.join(decode_log.ROOT, "error_codes.h"))
+    args = parser.parse_args()
+
+    text = []
+    for item in args.input:
+        if os.path.exists(item):
+            with open(item, errors="replace") as f:
+                text.append(f.read())
+        else:
+            text.append(item)
+    if not args.input:
+        text.append(sys.stdin.read())
+
+    messages = decode_log.load_messages(args.messages)
+    error_names = decode_log.load_error_names(args.errors)
+    symbolize = Symbolizer(args.elf, args.addr2line)
+    try:
+        strings = decode_log.ElfStrings(args.elf)
+    except (OSError, ValueError) as e:
+        parser.error(str(e))
+
+    found = 0
+    for match in HEX_RECORD.finditer("\n".join(text)):
+        found += 1
+        try:
+            record = parse(bytes.fromhex(match.group(1)))
+        except ValueError as e:
+            print("Skipping record %d: %s" % (found, e))
+            continue
+        print(report(record, symbolize, messages, error_names, strings))
+        print()
+
+    if not found:
+        print("No crash records found (expected %d hex characters each)" % (2 * RECORD_SIZE))
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""Decode Waku binary log frames (built with WAKU_LOG_BINARY=1).
+
+Reads raw bytes captured from the serial port, from a file or stdin, and
+prints one line per record. Message formats and levels are taken from
+waku/log_messages.h and error names from waku/error_codes.h, so the decoder
+always matches the firmware source it sits next to.
+
+    python3 tools/decode_log.py --elf build/waku.ino.elf capture.bin
+    cat /dev/ttyACM0 | python3 tools/decode_log.py --elf waku.ino.elf
+
+A %s argument is the address of a string in flash. With --elf it is read
+from the firmware image, which has to be the exact build that logged it;
+without, only the address is shown.
+
+Plain-text output on the same port (boot messages, console replies) is
+skipped by searching for the sync bytes.
+
+Frame layout (little-endian):
+    A5 5A | timestamp u32 (ms) | id u16 | arg count u8 | args i32 x count
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+SYNC = b"\xa5\x5a"
+HEADER = struct.Struct("<IHB")
+MAX_ARGS = 3
+LEVEL_LETTERS = {"ERROR": "E", "WARN": "W", "INFO": "I", "DEBUG": "D"}
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "waku")
+
+
+def load_messages(path):
+    pattern = re.compile(r'^LOG_MESSAGE\((\w+),\s*(\w+),\s*"((?:[^"\\]|\\.)*)"\)')
+    messages = []
+    with open(path) as f:
+        for line in f:
+            match = pattern.match(line.strip())
+            if match:
+                messages.append((match.group(1), match.group(2), match.group(3)))
+    return messages
+
+
+def load_error_names(path):
+    pattern = re.compile(r"^\s*(\w+)\s*=\s*(\d+)")
+    names = {}
+    in_enum = False
+    with open(path) as f:
+        for line in f:
+            if "enum class ErrorCode" in line:
+                in_enum = True
+            elif in_enum and "};" in line:
+                break
+            elif in_enum:
+                match = pattern.match(line)
+                if match:
+                    names[int(match.group(2))] = match.group(1)
+    return names
+
+
+class ElfStrings:
+    """NUL-terminated strings read from the loadable segments of an ELF32."""
+
+    MAX_LENGTH = 128
+
+    def __init__(self, path):
+        self.segments = []
+        if not path:
+            return
+        with open(path, "rb") as f:
+            image = f.read()
+        if image[:4] != b"\x7fELF" or image[4] != 1 or image[5] != 1:
+            raise ValueError("%s is not a little-endian 32-bit ELF" % path)
+        phoff, = struct.unpack_from("<I", image, 28)
+        phentsize, phnum = struct.unpack_from("<HH", image, 42)
+        for i in range(phnum):
+            p_type, p_offset, p_vaddr, _, p_filesz = struct.unpack_from("<5I", image, phoff + i * phentsize)
+            if p_type == 1 and p_filesz:     # PT_LOAD
+                self.segments.append((p_vaddr, image[p_offset:p_offset + p_filesz]))
+
+    def __call__(self, address):
+        for start, data in self.segments:
+            if start <= address < start + len(data):
+                offset = address - start
+                end = data.find(b"\0", offset, offset + self.MAX_LENGTH)
+                if end < 0:
+                    return None
+                return data[offset:end].decode("utf-8", errors="replace")
+        return None
+
+
+def format_message(fmt, args, error_names, strings=None):
+    out = []
+    arg = 0
+    i = 0
+    while i < len(fmt):
+        c = fmt[i]
+        if c != "%" or i + 1 == len(fmt):
+            out.append(c)
+            i += 1
+            continue
+        conversion = fmt[i + 1]
+        i += 2
+        if conversion == "%":
+            out.append("%")
+            continue
+        value = args[arg] if arg < len(args) else 0
+        arg += 1
+        if conversion == "d":
+            out.append(str(value))
+        elif conversion == "u":
+            out.append(str(value & 0xFFFFFFFF))
+        elif conversion == "s":
+            text = strings(value & 0xFFFFFFFF) if strings else None
+            out.append(text if text is not None else "<str@0x%08x>" % (value & 0xFFFFFFFF))
+        elif conversion == "E":
+            out.append(error_names.get(value, "UNKNOWN_ERROR(%d)" % value))
+        else:
+            out.append("?")
+    return "".join(out)
+
+
+def decode(data, messages, error_names, strings=None):
+    pos = 0
+    while True:
+        start = data.find(SYNC, pos)
+        if start < 0 or start + len(SYNC) + HEADER.size > len(data):
+            return
+        timestamp, msg_id, arg_count = HEADER.unpack_from(data, start + len(SYNC))
+        body = start + len(SYNC) + HEADER.size
+        if arg_count > MAX_ARGS:
+            pos = start + 1     # False sync inside text or noise
+            continue
+        if body + 4 * arg_count > len(data):
+            return
+        args = struct.unpack_from("<%di" % arg_count, data, body)
+        pos = body + 4 * arg_count
+
+        if msg_id < len(messages):
+            name, level, fmt = messages[msg_id]
+            text = format_message(fmt, args, error_names, strings)
+            yield "[%d] %s %s" % (timestamp, LEVEL_LETTERS.get(level, "?"), text)
+        else:
+            yield "[%d] ? Unknown log message %d %s" % (timestamp, msg_id, list(args))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", nargs="?", help="capture file (default: stdin)")
+    parser.add_argument("--elf", help="firmware ELF of the build that logged, for %s arguments")
+    parser.add_argument("--messages", default=os.path.join(ROOT, "log_messages.h"))
+    parser.add_argument("--errors", default=os.path.join(ROOT, "error_codes.h"))
+    args = parser.parse_args()
+
+    messages = load_messages(args.messages)
+    error_names = load_error_names(args.errors)
+    try:
+        strings = ElfStrings(args.elf)
+    except (OSError, ValueError) as e:
+        parser.error(str(e))
+
+    if args.input:
+        with open(args.input, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    for line in decode(data, messages, error_names, strings):
+        print(line)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,290 @@
+#!/usr/bin/env python3
+"""Minimal Waku home server for testing the device's server protocol.
+
+Answers device updates (POST /api/device/update) and config long-polls
+(GET /api/device/config?wait=N) the way the home server does, so the
+conditional fetch and config push can be watched without the real one.
+Point SERVER_HOST / SERVER_PORT in arduino_secrets.h at this machine.
+
+    python3 tools/server_standin.py --port 8080 --time 06:30
+
+The configuration carries a version, sent as the ETag. A request whose
+If-None-Match names the current version gets a bodyless 304; a long-poll
+is held until the version changes or its wait runs out. Type a new wake
+time (HH:MM, or "off" / "on" to disarm and arm) on stdin to bump the
+version and watch the device pick it up. --no-etag answers every update
+in full, like a server from before versioning, for comparison.
+
+Each request is printed with its status, and each device update with the
+device's own counters from its "net" field, so the parse work the 304s
+save shows up per hour.
+
+--tls serves HTTPS with the given certificate and key, for a device built
+with WAKU_USE_TLS and that certificate as SERVER_CA_CERT. Connections are
+kept open when the device asks for it; each request line shows how many
+connections (TLS handshakes) there have been so far.
+
+    openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:prime256v1 -nodes -days 3650 \\
+        -subj /CN=waku-home -addext subjectAltName=IP:192.168.1.10 -keyout key.pem -out cert.pem
+    python3 tools/server_standin.py --port 8443 --tls cert.pem key.pem
+
+--firmware offers a sketch binary (Sketch > Export Compiled Binary) for the
+device to pull as version --firmware-version (GET /api/device/firmware). It
+is sent compressed in heatshrink's format with an 8-bit window and 4-bit
+lookahead, which is what the device decodes, with the image size and CRC-32
+in X-Firmware-Size and X-Firmware-CRC32. A device already running that
+version (If-None-Match) gets a 304.
+
+    python3 tools/server_standin.py --firmware waku.ino.bin --firmware-version 2
+"""
+
+import argparse
+import json
+import ssl
+import sys
+import threading
+import time
+import zlib
+from collections import defaultdict, deque
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+
+def heatshrink_compress(data, window_bits=8, lookahead_bits=4):
+    """heatshrink's LZSS bitstream: 1 + byte for a literal, 0 + (distance - 1)
+    in window_bits + (length - 1) in lookahead_bits for a back-reference.
+    Greedy longest match; MSB-first, zero padded."""
+    window = 1 << window_bits
+    max_length = 1 << lookahead_bits
+    out = bytearray()
+    acc = 0
+    acc_bits = 0
+
+    def put(value, bits):
+        nonlocal acc, acc_bits
+        acc = (acc << bits) | value
+        acc_bits += bits
+        while acc_bits >= 8:
+            acc_bits -= 8
+            out.append((acc >> acc_bits) & 0xFF)
+        acc &= (1 << acc_bits) - 1
+
+    # Positions of each two-byte prefix still inside the window
+    seen = defaultdict(deque)
+    i = 0
+    while i < len(data):
+        best_length, best_distance = 0, 0
+        candidates = seen.get(data[i:i + 2])
+        if candidates:
+            while candidates and i - candidates[0] > window:
+                candidates.popleft()
+            for start in reversed(candidates):
+                length = 2
+                while length < max_length and i + length < len(data) and data[start + length] == data[i + length]:
+                    length += 1
+                if length > best_length:
+                    best_length, best_distance = length, i - start
+                    if length == max_length:
+                        break
+        # 13 bits against 9 per literal: any match of two or more pays
+        if best_length >= 2:
+            put(0, 1)
+            put(best_distance - 1, window_bits)
+            put(best_length - 1, lookahead_bits)
+            step = best_length
+        else:
+            put(1, 1)
+            put(data[i], 8)
+            step = 1
+        for j in range(i, min(i + step, len(data) - 1)):
+            seen[data[j:j + 2]].append(j)
+        i += step
+    if acc_bits:
+        out.append((acc << (8 - acc_bits)) & 0xFF)
+    return bytes(out)
+
+
+class Firmware:
+    def __init__(self, path, version):
+        with open(path, "rb") as image:
+            self.image = image.read()
+        self.version = version
+        self.crc = zlib.crc32(self.image)
+        self.body = heatshrink_compress(self.image)
+
+
+class Config:
+    def __init__(self, wake_time, etag, firmware=None):
+        self.changed = threading.Condition()
+        self.firmware = firmware
+        self.wake_time = wake_time
+        self.armed = True
+        self.version = 1
+        self.etag = etag
+        self.counts = {200: 0, 304: 0}
+        self.connections = 0
+        self.start = time.time()
+
+    def update(self, line):
+        with self.changed:
+            if line == "off":
+                self.armed = False
+            elif line == "on":
+                self.armed = True
+            else:
+                hour, minute = (int(part) for part in line.split(":"))
+                self.wake_time = "%02d:%02d" % (hour, minute)
+            self.version += 1
+            self.changed.notify_all()
+
+    def body(self):
+        document = {"time": self.wake_time, "armed": self.armed, "current_time": int(time.time())}
+        if self.etag:
+            document["version"] = self.version
+        return json.dumps(document).encode()
+
+    def not_modified(self, if_none_match):
+        return self.etag and if_none_match == '"%d"' % self.version
+
+    def per_hour(self, count):
+        hours = max((time.time() - self.start) / 3600, 1 / 60)
+        return count / hours
+
+
+def make_handler(config):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+        # Idle kept connections are dropped after this (s); the device stops
+        # reusing them sooner
+        timeout = 75
+
+        def log_message(self, format, *args):
+            pass
+
+        def setup(self):
+            super().setup()
+            with config.changed:
+                config.connections += 1
+
+        def reply(self, status):
+            body = b"" if status == 304 else config.body()
+            # send_response adds the Date header the device takes the time from on a 304
+            self.send_response(status)
+            if config.etag:
+                self.send_header("ETag", '"%d"' % config.version)
+            if body:
+                self.send_header("Content-Type", "application/json")
+                self.send_header("Content-Length", str(len(body)))
+            if self.headers.get("Connection", "").lower() != "keep-alive":
+                self.send_header("Connection", "close")
+            self.end_headers()
+            self.wfile.write(body)
+            config.counts[status] = config.counts.get(status, 0) + 1
+            return len(body)
+
+        def do_POST(self):
+            if urlparse(self.path).path != "/api/device/update":
+                self.send_error(404)
+                return
+            update = json.loads(self.rfile.read(int(self.headers.get("Content-Length", 0))) or b"{}")
+            with config.changed:
+                status = 304 if config.not_modified(self.headers.get("If-None-Match")) else 200
+                size = self.reply(status)
+            net = update.get("net", [])
+            device = ""
+            if len(net) >= 6:
+                device = "  device: %d parsed, %d not modified" % (net[4], net[5])
+            print("%s update %d (%d bytes)  %.0f full / %.0f 304 per hour, %d connections%s" % (
+                time.strftime("%H:%M:%S"), status, size, config.per_hour(config.counts[200]),
+                config.per_hour(config.counts[304]), config.connections, device), flush=True)
+
+        def send_firmware(self):
+            firmware = config.firmware
+            if self.headers.get("If-None-Match") == '"%d"' % firmware.version:
+                self.send_response(304)
+                self.send_header("ETag", '"%d"' % firmware.version)
+                self.send_header("Connection", "close")
+                self.end_headers()
+                print("%s firmware check 304" % time.strftime("%H:%M:%S"), flush=True)
+                return
+            self.send_response(200)
+            self.send_header("ETag", '"%d"' % firmware.version)
+            self.send_header("Content-Type", "application/x-heatshrink")
+            self.send_header("Content-Length", str(len(firmware.body)))
+            self.send_header("X-Firmware-Size", str(len(firmware.image)))
+            self.send_header("X-Firmware-CRC32", "%08x" % firmware.crc)
+            self.send_header("Connection", "close")
+            self.end_headers()
+            start = time.time()
+            try:
+                self.wfile.write(firmware.body)
+                self.wfile.flush()
+            except OSError as error:
+                print("%s firmware %d aborted: %s" % (time.strftime("%H:%M:%S"), firmware.version, error), flush=True)
+                return
+            print("%s firmware %d sent: %d bytes for %d (%.0f s)" % (
+                time.strftime("%H:%M:%S"), firmware.version, len(firmware.body), len(firmware.image),
+                time.time() - start), flush=True)
+
+        def do_GET(self):
+            url = urlparse(self.path)
+            if url.path == "/api/device/firmware" and config.firmware:
+                self.send_firmware()
+                return
+            if url.path != "/api/device/config" or not config.etag:
+                self.send_error(404)
+                return
+            wait = int(parse_qs(url.query).get("wait", ["60"])[0])
+            if_none_match = self.headers.get("If-None-Match")
+            with config.changed:
+                config.changed.wait_for(lambda: not config.not_modified(if_none_match), timeout=wait)
+                status = 304 if config.not_modified(if_none_match) else 200
+                self.reply(status)
+            print("%s config poll %d, %d connections" % (time.strftime("%H:%M:%S"), status, config.connections),
+                  flush=True)
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--bind", default="0.0.0.0")
+    parser.add_argument("--time", default="07:00", help="initial wake time, HH:MM")
+    parser.add_argument("--no-etag", action="store_true", help="no versions: every update answered in full")
+    parser.add_argument("--tls", nargs=2, metavar=("CERT", "KEY"), help="serve HTTPS with this certificate and key")
+    parser.add_argument("--firmware", metavar="BIN", help="sketch binary offered to the device")
+    parser.add_argument("--firmware-version", type=int, default=2, help="WAKU_FIRMWARE_VERSION the binary was built with")
+    args = parser.parse_args()
+
+    firmware = None
+    if args.firmware:
+        firmware = Firmware(args.firmware, args.firmware_version)
+        print("Firmware %d: %d bytes, %d compressed (%.0f %% saved), CRC-32 %08x" % (
+            firmware.version, len(firmware.image), len(firmware.body),
+            100.0 * (1 - len(firmware.body) / max(len(firmware.image), 1)), firmware.crc), file=sys.stderr)
+    config = Config(args.time, not args.no_etag, firmware)
+    server = ThreadingHTTPServer((args.bind, args.port), make_handler(config))
+    server.daemon_threads = True
+    if args.tls:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(*args.tls)
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    print("Serving on %s:%d, wake time %s" % (args.bind, args.port, args.time), file=sys.stderr)
+
+    for line in sys.stdin:
+        line = line.strip()
+        if not line:
+            continue
+        try:
+            config.update(line)
+            print("Config version %d: %s%s" % (config.version, config.wake_time, "" if config.armed else " (off)"))
+        except ValueError:
+            print("Expected HH:MM, on or off", file=sys.stderr)
+    # stdin closed (running in the background): keep serving
+    threading.Event().wait()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Minimal SNTP server for testing Waku's clock discipline.
+
+Answers SNTP (RFC 4330) client requests with the host clock, so the device
+can be pointed at a machine without an NTP daemon (the home server by
+default, see sntp_host in waku/global_variables.cpp). Port 123 needs root;
+use --port and a matching sntp_port for a quick test without it.
+
+    sudo python3 tools/sntp_standin.py
+    python3 tools/sntp_standin.py --port 12300 --offset 2.5 --jitter 0.02
+
+--offset shifts the time served (seconds, may be negative) to watch the
+device step or slew, --jitter adds a random delay before each reply to
+exercise the congestion filter, and --drift makes the served clock run
+fast or slow (ppm) to check that the frequency estimate follows it.
+Every exchange is printed with the client's transmit time, which is the
+device's own clock, so its error can be read straight off the log.
+"""
+
+import argparse
+import random
+import socket
+import struct
+import sys
+import time
+
+NTP_UNIX_OFFSET = 2208988800
+PACKET = struct.Struct("!BBbbII4s8s8s8s8s")
+
+
+def to_ntp(seconds):
+    whole = int(seconds)
+    return struct.pack("!II", whole + NTP_UNIX_OFFSET, int((seconds - whole) * 2**32) & 0xFFFFFFFF)
+
+
+def from_ntp(raw):
+    whole, fraction = struct.unpack("!II", raw)
+    if whole == 0:
+        return None
+    return whole - NTP_UNIX_OFFSET + fraction / 2**32
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=123)
+    parser.add_argument("--bind", default="0.0.0.0")
+    parser.add_argument("--offset", type=float, default=0.0, help="seconds added to the served time")
+    parser.add_argument("--jitter", type=float, default=0.0, help="max random reply delay, seconds")
+    parser.add_argument("--drift", type=float, default=0.0, help="served clock rate error, ppm")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.bind, args.port))
+    start = time.time()
+    print("Serving SNTP on %s:%d" % (args.bind, args.port), file=sys.stderr)
+
+    def served():
+        now = time.time()
+        return now + args.offset + (now - start) * args.drift * 1e-6
+
+    while True:
+        data, client = sock.recvfrom(512)
+        received = served()
+        if len(data) < PACKET.size or data[0] & 0x07 != 3:
+            continue
+        version = (data[0] >> 3) & 0x07
+        client_transmit = data[40:48]
+
+        if args.jitter > 0:
+            time.sleep(random.uniform(0, args.jitter))
+
+        # LI 0, the client's version, mode 4 (server); stratum 1 with a
+        # made-up reference so clients accept it
+        reply = PACKET.pack(
+            (version << 3) | 4, 1, 6, -20, 0, 0, b"LOCL",
+            to_ntp(received), client_transmit, to_ntp(received), to_ntp(served()))
+        sock.sendto(reply, client)
+
+        device = from_ntp(client_transmit)
+        error = "" if device is None else "  device clock %+.3f s" % (device - received)
+        print("%s %s%s" % (time.strftime("%H:%M:%S"), client[0], error), flush=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,94 @@
+#include "activity_detector.h"
+
+// A PIR edge alone gets half way to "awake"; about four seconds of sound
+// over the floor gets there, where a passing car (three) does not. The score
+// halves in ~22 s. tests/replay_activity checks this against tests/traces.
+const ActivityDetector::Tuning ActivityDetector::DEFAULT_TUNING = {
+    300,    // motionWeight
+    4,      // soundWeight
+    4,      // soundThresholdFactor (+6 dB over the floor)
+    5,      // decayShift
+    600     // awakeThreshold
+};
+
+volatile uint16_t ActivityDetector::pendingMotionEdges = 0;
+
+void ActivityDetector::pirISR() {
+    if (pendingMotionEdges < 0xFFFF) {
+        pendingMotionEdges++;
+    }
+}
+
+ActivityDetector::ActivityDetector(const Tuning& config)
+    : tuning(config), score(0), noiseFloor(0), lastDecay(0), awakeSeen(false) {
+}
+
+void ActivityDetector::begin(int pirPin) {
+    pinMode(pirPin, INPUT);
+    attachInterrupt(digitalPinToInterrupt(pirPin), pirISR, RISING);
+}
+
+void ActivityDetector::addScore(uint16_t amount) {
+    uint32_t total = static_cast<uint32_t>(score) + amount;
+    score = total > MAX_CONFIDENCE ? MAX_CONFIDENCE : total;
+    if (score >= tuning.awakeThreshold) {
+        awakeSeen = true;
+    }
+}
+
+void ActivityDetector::onMotion(unsigned long now) {
+    update(now);
+    addScore(tuning.motionWeight);
+}
+
+void ActivityDetector::onSoundBlock(uint32_t meanSquare, unsigned long now) {
+    if (noiseFloor == 0) {
+        noiseFloor = meanSquare > 0 ? meanSquare : 1;
+    }
+
+    if (meanSquare > noiseFloor * tuning.soundThresholdFactor) {
+        update(now);
+        addScore(tuning.soundWeight);
+    }
+
+    // Follow quiet periods down immediately and noise up slowly, so an
+    // ongoing alarm or conversation does not become the new floor
+    if (meanSquare < noiseFloor) {
+        noiseFloor = meanSquare > 0 ? meanSquare : 1;
+    } else {
+        noiseFloor += (meanSquare - noiseFloor) >> 10;
+    }
+}
+
+void ActivityDetector::update(unsigned long now) {
+    noInterrupts();
+    uint16_t edges = pendingMotionEdges;
+    pendingMotionEdges = 0;
+    interrupts();
+
+    while (now - lastDecay >= 1000 && score > 0) {
+        score -= (score >> tuning.decayShift) > 0 ? (score >> tuning.decayShift) : 1;
+        lastDecay += 1000;
+    }
+    if (score == 0) {
+        lastDecay = now;
+    }
+
+    if (edges > 0) {
+        addScore(edges > 3 ? 3 * tuning.motionWeight : edges * tuning.motionWeight);
+    }
+}
+
+void ActivityDetector::reset(unsigned long now) {
+    noInterrupts();
+    pendingMotionEdges = 0;
+    interrupts();
+
+    score = 0;
+    lastDecay = now;
+    awakeSeen = false;
+}
+
+void ActivityDetector::soundBlockListener(const SoundMeter::BlockResult& block, void* context) {
+    static_cast<ActivityDetector*>(context)->onSoundBlock(block.meanSquare, millis());
+}
@@ -0,0 +1,58 @@
+#ifndef ACTIVITY_DETECTOR_H
+#define ACTIVITY_DETECTOR_H
+
+#include <Arduino.h>
+#include "sound_meter.h"
+
+// Fuses PIR edges and microphone block energy into an "awake" confidence
+// score (0-1000) with constant-size state. Every input carries its own
+// timestamp, so a recorded sensor trace can be fed back through the same
+// methods to tune the thresholds.
+class ActivityDetector {
+public:
+    struct Tuning {
+        uint16_t motionWeight;          // Score added per PIR edge
+        uint16_t soundWeight;           // Score added per loud 25 ms block
+        uint8_t soundThresholdFactor;   // Loud = block energy above floor * factor
+        uint8_t decayShift;             // Score loses score >> decayShift every second
+        uint16_t awakeThreshold;
+    };
+
+    static const uint16_t MAX_CONFIDENCE = 1000;
+    static const Tuning DEFAULT_TUNING;
+
+private:
+    static volatile uint16_t pendingMotionEdges;
+    static void pirISR();
+
+    Tuning tuning;
+    uint16_t score;
+    uint32_t noiseFloor;        // Slow-tracking quiet-room block energy
+    unsigned long lastDecay;
+    bool awakeSeen;             // Score crossed the threshold since reset()
+
+    void addScore(uint16_t amount);
+
+public:
+    explicit ActivityDetector(const Tuning& config = DEFAULT_TUNING);
+
+    // Attach the PIR sensor interrupt
+    void begin(int pirPin);
+
+    // Feed a sound block; matches SoundMeter::BlockListener via soundBlockListener
+    void onSoundBlock(uint32_t meanSquare, unsigned long now);
+    void onMotion(unsigned long now);
+
+    // Consume PIR edges from the interrupt and apply decay
+    void update(unsigned long now);
+
+    // Start a fresh observation window
+    void reset(unsigned long now);
+
+    uint16_t confidence() const { return score; }
+    bool hasSeenAwake() const { return awakeSeen; }
+
+    static void soundBlockListener(const SoundMeter::BlockResult& block, void* context);
+};
+
+#endif
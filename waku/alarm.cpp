@@ -3,23 +3,32 @@
 Alarm::Alarm(int wakeHour, int wakeMinute, int wakeDuration,
              const int* ledPins, int ledPinCount,
              int buzzerPin, int buzzerOverdrivePin)
-    : WAKE_HOUR(wakeHour)
-    , WAKE_MINUTE(wakeMinute)
+    : schedule(AlarmSchedule{static_cast<uint8_t>(wakeHour), static_cast<uint8_t>(wakeMinute), true})
     , WAKE_DURATION(wakeDuration)
     , alarmTriggeredToday(false)
     , progressiveAlarm(ledPins[1], ledPins[2], ledPins[0], buzzerPin, buzzerOverdrivePin)  // Red=10, Green=11, Blue=9
+    , activity(nullptr)
+    , watchingForWake(false)
+    , watchStartMillis(0)
+    , rewakeActive(false)
+    , rewakeStartMillis(0)
+    , rewakeCount(0)
 {
     // Constructor body is empty as initialization is done in initializer list
 }
 
 bool Alarm::isWakeUpTime() {
-    if (alarmTriggeredToday) {
+    return isWakeUpTime(schedule.read());
+}
+
+bool Alarm::isWakeUpTime(const AlarmSchedule& config) const {
+    if (alarmTriggeredToday || !config.armed) {
         return false;
     }
     
     int currentMinutes = getCurrentTimeMinutes();
-    int wakeUpStart = getWakeUpStartMinutes();
-    int wakeUpEnd = getWakeUpEndMinutes();
+    int wakeUpStart = getWakeUpStartMinutes(config);
+    int wakeUpEnd = getWakeUpEndMinutes(config);
     
     // Handle case when wake-up time spans across midnight
     if (wakeUpEnd >= 24 * 60) {
@@ -39,33 +48,120 @@ void Alarm::checkAndResetAtMidnight() {
     if (currentTime.getHour() == 0 && currentTime.getMinutes() == 0) {
         if (alarmTriggeredToday) {
             alarmTriggeredToday = false;
-            Serial.println("Midnight reached - Reset alarm trigger status for new day");
+            rewakeCount = 0;
+            LOG(ALARM_MIDNIGHT_RESET);
         }
     }
 }
 
 void Alarm::stopAlarm() {
     alarmTriggeredToday = true;
+    rewakeActive = false;
     progressiveAlarm.stop();
-    Serial.println("ALARM STOPPED!");
+    LOG(ALARM_STOPPED);
+    startWakeWatch();
+}
+
+bool Alarm::isRinging() {
+    return rewakeActive || isWakeUpTime();
+}
+
+bool Alarm::isNearWakeWindow(int marginMinutes) const {
+    if (rewakeActive) {
+        return true;
+    }
+    AlarmSchedule config = schedule.read();
+    if (!config.armed) {
+        return false;
+    }
+
+    int start = getWakeUpStartMinutes(config) - marginMinutes;
+    int length = getWakeUpEndMinutes(config) + marginMinutes - start;
+    // Minutes since the start, across midnight
+    int sinceStart = ((getCurrentTimeMinutes() - start) % (24 * 60) + 24 * 60) % (24 * 60);
+    return sinceStart < length;
 }
 
 void Alarm::update() {
-    if (isWakeUpTime() && !alarmTriggeredToday) {
-        float progress = calculateProgress();
+    // One snapshot per cycle, so the window check and the progress agree
+    AlarmSchedule config = schedule.read();
+
+    if (isWakeUpTime(config)) {
+        float progress = calculateProgress(config);
         progressiveAlarm.update(progress);
+    } else if (rewakeActive) {
+        unsigned long elapsed = millis() - rewakeStartMillis;
+        if (elapsed >= REWAKE_DURATION) {
+            rewakeActive = false;
+            progressiveAlarm.stop();
+            startWakeWatch();
+        } else {
+            // Start just above the pre-wake phase so the light goes straight to dawn colours
+            float progress = 0.01 + float(elapsed) / float(REWAKE_RAMP_TIME);
+            progressiveAlarm.update(progress > 1.0 ? 1.0 : progress);
+        }
     } else {
         progressiveAlarm.stop();
     }
+
+    updateWakeWatch();
+}
+
+void Alarm::startWakeWatch() {
+    if (!activity || rewakeCount >= MAX_REWAKES) {
+        watchingForWake = false;
+        return;
+    }
+    watchStartMillis = millis();
+    activity->reset(watchStartMillis);
+    watchingForWake = true;
 }
 
-bool Alarm::updateTime(int newHour, int newMinute) {
+void Alarm::updateWakeWatch() {
+    if (!watchingForWake) {
+        return;
+    }
+
+    unsigned long now = millis();
+    activity->update(now);
+
+    if (activity->hasSeenAwake()) {
+        watchingForWake = false;
+        LOG(WAKE_CONFIRMED);
+    } else if (now - watchStartMillis >= MISSED_WAKE_WINDOW) {
+        watchingForWake = false;
+        rewakeActive = true;
+        rewakeStartMillis = now;
+        rewakeCount++;
+        LOG(WAKE_MISSED);
+    }
+}
+
+bool Alarm::updateTime(int newHour, int newMinute, bool armed) {
     
     if (newHour < 0 || newHour >= 24 || newMinute < 0 || newMinute >= 60) {
         return false;
     }
     
-    WAKE_HOUR = newHour;
-    WAKE_MINUTE = newMinute;
+    AlarmSchedule current = schedule.read();
+    if (current.wakeHour == newHour && current.wakeMinute == newMinute && current.armed == armed) {
+        return true;
+    }
+    
+    schedule.write(AlarmSchedule{static_cast<uint8_t>(newHour), static_cast<uint8_t>(newMinute), armed});
     return true;
-} 
\ No newline at end of file
+} 
+
+void Alarm::restoreState(const AlarmSchedule& saved, bool triggeredToday) {
+    if (saved.wakeHour >= 24 || saved.wakeMinute >= 60) {
+        return;
+    }
+    schedule.write(saved);
+    alarmTriggeredToday = triggeredToday;
+}
+
+uint32_t Alarm::currentDate() {
+    RTCTime currentTime;
+    RTC.getTime(currentTime);
+    return currentTime.getYear() * 10000UL + Month2int(currentTime.getMonth()) * 100UL + currentTime.getDayOfMonth();
+}
@@ -4,16 +4,40 @@
 #include <Arduino.h>
 #include <RTC.h>
 #include "progressive_alarm.h"
+#include "activity_detector.h"
+#include "alarm_config.h"
+#include "log.h"
 
 class Alarm {
 private:
-    int WAKE_HOUR;
-    int WAKE_MINUTE;
+    // Configuration is written by the network task and read by the alarm and
+    // button code; every reader works on one consistent snapshot
+    SeqLock<AlarmSchedule> schedule;
     const int WAKE_DURATION;
-    bool alarmTriggeredToday;
+
+    // Runtime state, owned by the alarm task. The flag is read from other
+    // tasks for display and status, so it is atomic.
+    std::atomic<bool> alarmTriggeredToday;
     
     // Progressive alarm handler
     ProgressiveAlarm progressiveAlarm;
+
+    // Missed-wake detection: after the alarm is stopped, watch for activity
+    // and re-trigger a shortened escalation if the user does not get up
+    ActivityDetector* activity;
+    bool watchingForWake;
+    unsigned long watchStartMillis;
+    bool rewakeActive;
+    unsigned long rewakeStartMillis;
+    uint8_t rewakeCount;
+
+    static const unsigned long MISSED_WAKE_WINDOW = 15UL * 60 * 1000;  // Activity expected within 15 min
+    static const unsigned long REWAKE_RAMP_TIME = 2UL * 60 * 1000;     // Light ramp squeezed into 2 min
+    static const unsigned long REWAKE_DURATION = 10UL * 60 * 1000;     // Then full alarm until 10 min
+    static const uint8_t MAX_REWAKES = 2;
+
+    void startWakeWatch();
+    void updateWakeWatch();
     
     // Wake-up protocol timing (in minutes)
     static const int PRE_WAKE_TIME = 40;    // Start red light 40 min before
@@ -25,12 +49,12 @@ private:
         return hours * 60 + minutes;
     }
     
-    int getWakeUpStartMinutes() const {
-        return timeToMinutes(WAKE_HOUR, WAKE_MINUTE) - PRE_WAKE_TIME;
+    int getWakeUpStartMinutes(const AlarmSchedule& config) const {
+        return config.wakeMinutes() - PRE_WAKE_TIME;
     }
     
-    int getWakeUpEndMinutes() const {
-        return timeToMinutes(WAKE_HOUR, WAKE_MINUTE) + FULL_ALARM_TIME;
+    int getWakeUpEndMinutes(const AlarmSchedule& config) const {
+        return config.wakeMinutes() + FULL_ALARM_TIME;
     }
     
     int getCurrentTimeMinutes() const {
@@ -39,16 +63,11 @@ private:
         return timeToMinutes(currentTime.getHour(), currentTime.getMinutes());
     }
     
-    float calculateProgress() const {
+    bool isWakeUpTime(const AlarmSchedule& config) const;
+    
+    float calculateProgress(const AlarmSchedule& config) const {
         int currentMinutes = getCurrentTimeMinutes();
-        int wakeUpStart = getWakeUpStartMinutes();
-        int wakeUpTime = timeToMinutes(WAKE_HOUR, WAKE_MINUTE);
-        int minutesElapsed = currentMinutes - wakeUpStart;
-        
-        // Handle case when we're after midnight
-        if (currentMinutes < wakeUpStart) {
-            minutesElapsed = (24 * 60 - wakeUpStart) + currentMinutes;
-        }
+        int wakeUpTime = config.wakeMinutes();
         
         // Calculate progress based on wake-up protocol phases
         if (currentMinutes < (wakeUpTime - DAWN_START_TIME)) {
@@ -74,11 +93,28 @@ public:
     void checkAndResetAtMidnight();
     void stopAlarm();
     void update();
-    bool isTriggered() const { return alarmTriggeredToday; }
+    bool isTriggered() const { return alarmTriggeredToday.load(); }
+
+    // True while the wake-up protocol or a missed-wake escalation is running
+    bool isRinging();
+
+    // True from marginMinutes before the wake-up protocol until it ends, and
+    // during a missed-wake escalation: the time a clock step would be seen.
+    // Alarm task.
+    bool isNearWakeWindow(int marginMinutes) const;
+
+    void setActivityDetector(ActivityDetector* detector) { activity = detector; }
     
-    bool updateTime(int newHour, int newMinute);
-    int getWakeHour() const { return WAKE_HOUR; }
-    int getWakeMinute() const { return WAKE_MINUTE; }
+    // Publish a new schedule; safe to call from another task
+    bool updateTime(int newHour, int newMinute, bool armed = true);
+    AlarmSchedule getSchedule() const { return schedule.read(); }
+
+    // Put back the state saved before a reset (see Supervisor)
+    void restoreState(const AlarmSchedule& saved, bool triggeredToday);
+
+    // Today's date from the RTC as yyyymmdd, to tell a stop from today
+    // apart from one on an earlier day (see ConfigKey::TRIGGERED_DAY)
+    static uint32_t currentDate();
 };
 
 #endif 
\ No newline at end of file
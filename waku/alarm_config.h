@@ -0,0 +1,58 @@
+#ifndef ALARM_CONFIG_H
+#define ALARM_CONFIG_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Wake-up schedule as configured by the home server. Readers always work on
+// a copy, so all fields of one snapshot belong to the same update.
+struct AlarmSchedule {
+    uint8_t wakeHour;
+    uint8_t wakeMinute;
+    bool armed;
+
+    int wakeMinutes() const { return wakeHour * 60 + wakeMinute; }
+};
+
+// Single-writer sequence lock. The writer makes the sequence odd while it
+// copies the value in and even again when done; a reader retries until it
+// sees the same even sequence before and after its copy. Readers never block
+// the writer and never observe a half-written value.
+//
+// Only one task may write at a time (the network task at runtime); any
+// number of tasks may read.
+template <typename T>
+class SeqLock {
+private:
+    std::atomic<uint32_t> sequence;
+    T value;
+
+public:
+    explicit SeqLock(const T& initial) : sequence(0), value(initial) {}
+
+    void write(const T& newValue) {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        value = newValue;
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    T read() const {
+        T copy;
+        uint32_t before;
+        uint32_t after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            copy = value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return copy;
+    }
+
+    // Number of completed writes
+    uint32_t version() const { return sequence.load(std::memory_order_acquire) >> 1; }
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include "boot_events.h"
+#include "build_config.h"
+#include "log.h"
+
+#if WAKU_STATIC_ALLOCATION
+static StaticEventGroup_t groupStorage;
+#endif
+
+static const char* const EVENT_NAMES[] = {"clock", "alarm", "frame", "wifi", "server"};
+
+static_assert(sizeof(EVENT_NAMES) / sizeof(EVENT_NAMES[0]) == static_cast<uint8_t>(BootEvent::COUNT), "Name every boot event");
+
+EventGroupHandle_t BootEvents::group = NULL;
+uint32_t BootEvents::reachedAt[static_cast<uint8_t>(BootEvent::COUNT)];
+
+bool BootEvents::begin() {
+#if WAKU_STATIC_ALLOCATION
+    group = xEventGroupCreateStatic(&groupStorage);
+#else
+    group = xEventGroupCreate();
+#endif
+    if (!group) {
+        Serial.println("ERROR: Failed to create boot event group");
+        return false;
+    }
+    return true;
+}
+
+void BootEvents::publish(BootEvent event) {
+    if (!group || isSet(event)) {
+        return;
+    }
+    // Each event has a single publisher, so the time is written once
+    uint32_t now = millis();
+    reachedAt[static_cast<uint8_t>(event)] = now ? now : 1;
+    xEventGroupSetBits(group, bit(event));
+    LOG(BOOT_EVENT, LOG_STR(name(event)), now);
+}
+
+bool BootEvents::isSet(BootEvent event) {
+    return group && (xEventGroupGetBits(group) & bit(event));
+}
+
+bool BootEvents::wait(BootEvent event, TickType_t timeout) {
+    if (!group) {
+        return false;
+    }
+    return xEventGroupWaitBits(group, bit(event), pdFALSE, pdTRUE, timeout) & bit(event);
+}
+
+uint32_t BootEvents::millisAt(BootEvent event) {
+    return reachedAt[static_cast<uint8_t>(event)];
+}
+
+const char* BootEvents::name(BootEvent event) {
+    return EVENT_NAMES[static_cast<uint8_t>(event)];
+}
+
+void BootEvents::printReport(const char* args) {
+    Serial.println("Boot milestone  ms since reset");
+    for (uint8_t i = 0; i < static_cast<uint8_t>(BootEvent::COUNT); i++) {
+        BootEvent event = static_cast<BootEvent>(i);
+        char row[40];
+        if (isSet(event)) {
+            snprintf(row, sizeof(row), "%-14s  %lu", name(event), static_cast<unsigned long>(millisAt(event)));
+        } else {
+            snprintf(row, sizeof(row), "%-14s  pending", name(event));
+        }
+        Serial.println(row);
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef BOOT_EVENTS_H
+#define BOOT_EVENTS_H
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+
+// Milestones of the staged boot. setup() only brings up what the alarm and
+// display need; WiFi, OTA and the first server sync follow in the network
+// task. Each event is set once and stays set.
+enum class BootEvent : uint8_t {
+    CLOCK_VALID,        // RTC kept running across the reset, or was set from the network
+    ALARM_READY,        // First alarm cycle with a valid clock
+    FIRST_FRAME,        // First display update
+    WIFI_CONNECTED,
+    SERVER_SYNCED,      // First device update the server accepted
+    COUNT
+};
+
+// Readiness flags in a FreeRTOS event group, plus the uptime at which each
+// one was first set (the boot metrics)
+class BootEvents {
+public:
+    // Call in setup() before anything publishes
+    static bool begin();
+
+    static void publish(BootEvent event);
+    static bool isSet(BootEvent event);
+
+    // Block until the event is set; false on timeout
+    static bool wait(BootEvent event, TickType_t timeout);
+
+    // ms since reset when the event was first set, 0 while it is not
+    static uint32_t millisAt(BootEvent event);
+    static const char* name(BootEvent event);
+
+    // Console handler: time to each milestone
+    static void printReport(const char* args);
+
+private:
+    static EventGroupHandle_t group;
+    static uint32_t reachedAt[static_cast<uint8_t>(BootEvent::COUNT)];
+
+    static EventBits_t bit(BootEvent event) { return 1UL << static_cast<uint8_t>(event); }
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef BUILD_CONFIG_H
+#define BUILD_CONFIG_H
+
+// Compile-time feature switches. Edit here or pass -D flags to the build.
+
+// Play the wake-up melody through the wavetable synthesizer on the A0 DAC
+// instead of the buzzer. A0 is also the MAX9814 input, so the microphone
+// has to move to A1 when this is enabled (see MAX9814_PIN).
+#ifndef WAKU_SYNTH_ENABLED
+#define WAKU_SYNTH_ENABLED 0
+#endif
+
+// Run the alarm and display loops as stackless coroutines on a single
+// FreeRTOS task instead of two tasks with their own stacks. Saves about 1 KB
+// of stack; the "sched" console command shows the latency cost. The network
+// loop keeps its own task, since the WiFiS3 driver blocks for seconds.
+#ifndef WAKU_COOPERATIVE_TASKS
+#define WAKU_COOPERATIVE_TASKS 0
+#endif
+
+// Place tasks, kernel objects and the application objects in static storage
+// (xTaskCreateStatic and friends, placement-constructed objects) so nothing
+// is allocated from a heap at boot. Needs configSUPPORT_STATIC_ALLOCATION.
+#ifndef WAKU_STATIC_ALLOCATION
+#define WAKU_STATIC_ALLOCATION 0
+#endif
+
+// DWT cycle-count probes on hot paths (see profiler.h), reported by the
+// "prof" console command and in telemetry. Compiled out when 0.
+#ifndef WAKU_PROFILING
+#define WAKU_PROFILING 0
+#endif
+
+// Hold a long-poll request open between network cycles, so the server can
+// push a new schedule within a second, and send telemetry every 5 minutes
+// instead of every 15 s. 0 goes back to plain polling; the "net" console
+// command counts what either costs.
+#ifndef WAKU_CONFIG_PUSH
+#define WAKU_CONFIG_PUSH 1
+#endif
+
+// HTTPS to the home server through WiFiSSLClient, trusting only the
+// certificate in SERVER_CA_CERT (arduino_secrets.h). The handshake runs on
+// the WiFi module and takes a second or more, so keep-alive comes with it.
+#ifndef WAKU_USE_TLS
+#define WAKU_USE_TLS 0
+#endif
+
+// Keep the server connection open between requests instead of one
+// connection (and with TLS one handshake) per request
+#ifndef WAKU_HTTP_KEEP_ALIVE
+#define WAKU_HTTP_KEEP_ALIVE WAKU_USE_TLS
+#endif
+
+// Serve /metrics (Prometheus text) and /state (JSON) on the home network
+// from the network task, between its cycles; see LocalApi. Reachable while
+// the radio is up, so with WAKU_RADIO_DUTY_CYCLE only in the wake window's
+// run-up.
+#ifndef WAKU_LOCAL_API
+#define WAKU_LOCAL_API 1
+#endif
+
+#ifndef WAKU_LOCAL_API_PORT
+#define WAKU_LOCAL_API_PORT 80
+#endif
+
+// Switch the WiFi radio off between network batches (every 10 minutes, or
+// right away when the alarm is stopped) outside the run-up to the wake
+// window, instead of keeping it associated in modem power save. See
+// RadioManager. Everything that needs the link between batches then stops
+// working outside the run-up: the config long-poll (a new schedule waits
+// for the next batch instead of arriving within a second), the local API
+// and uploads from the IDE (ArduinoOTA). So it is only on by default in
+// builds without push and the local API; set it to 1 to take that trade.
+#ifndef WAKU_RADIO_DUTY_CYCLE
+#define WAKU_RADIO_DUTY_CYCLE (!WAKU_CONFIG_PUSH && !WAKU_LOCAL_API)
+#endif
+
+// Version of this build, sent when asking the home server for firmware.
+// Bump it for every image the server hands out: a device that comes up
+// from an image still reporting the old number will not fetch it again.
+#ifndef WAKU_FIRMWARE_VERSION
+#define WAKU_FIRMWARE_VERSION 1
+#endif
+
+// Pull compressed firmware images from the home server once an hour and
+// apply them outside the wake window; see OtaUpdater. Pushed uploads from
+// the IDE (ArduinoOTA) work either way.
+#ifndef WAKU_OTA_PULL
+#define WAKU_OTA_PULL 1
+#endif
+
+// Deferred log (log.h): messages above this level are compiled out.
+// 1 = error, 2 = warn, 3 = info, 4 = debug.
+#ifndef WAKU_LOG_LEVEL
+#define WAKU_LOG_LEVEL 3
+#endif
+
+// Drain the log as binary frames for tools/decode_log.py instead of text
+#ifndef WAKU_LOG_BINARY
+#define WAKU_LOG_BINARY 0
+#endif
+
+#endif
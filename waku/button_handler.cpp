@@ -1,4 +1,6 @@
 #include "button_handler.h"
+#include "profiler.h"
+#include "log.h"
 
 // Static member initialization
 volatile unsigned long ButtonHandler::pressStartTime = 0;
@@ -12,6 +14,7 @@ volatile unsigned long ButtonHandler::lastPressDuration = 0;
 
 void ButtonHandler::buttonISR() {
     if (!instance) return; // Prevent null pointer dereference
+    PROFILE_SCOPE(ProbeId::BUTTON_ISR);
     
     unsigned long interruptTime = millis();
     bool currentState = digitalRead(instance->buttonPin);
@@ -42,39 +45,40 @@ void ButtonHandler::begin() {
     
     // Attach interrupt for both RISING and FALLING edges
     attachInterrupt(digitalPinToInterrupt(buttonPin), buttonISR, CHANGE);
-    Serial.println("Button handler initialized on pin " + String(buttonPin) + " with debouncing");
+    LOG(BUTTON_INIT, buttonPin);
 }
 
 void ButtonHandler::handleShortPress() {
-    Serial.println("\nShort press.");
+    LOG(BUTTON_SHORT_PRESS);
 
     // If alarm is active, stop it
-    if (alarm->isWakeUpTime() && !alarm->isTriggered()) {
+    if (alarm->isRinging()) {
         alarm->stopAlarm();
         // TODO: display->displayMessage("STOP");
         return;
     } else {
-        display->displayAlarmTime(alarm->getWakeHour(), alarm->getWakeMinute());
-        Serial.println("Displaying alarm time " + String(alarm->getWakeHour()) + ":" + String(alarm->getWakeMinute()));
+        AlarmSchedule config = alarm->getSchedule();
+        display->displayAlarmTime(config.wakeHour, config.wakeMinute);
+        LOG(ALARM_TIME_SHOWN, config.wakeHour, config.wakeMinute);
     }
 }
 
 void ButtonHandler::handleLongPress() {
-    Serial.println("\nLong press - not implemented yet");
+    LOG(BUTTON_LONG_PRESS);
 }
 
 void ButtonHandler::update() {
     // Move Serial and processing logic outside of interrupt
     if (stateChanged) {
         if (lastState) { // Button was released
-            Serial.println("Button released (RISING edge), duration: " + String(lastPressDuration) + "ms");
+            LOG(BUTTON_RELEASED, lastPressDuration);
             if (lastPressDuration >= LONG_PRESS_TIME) {
                 handleLongPress();
             } else if (lastPressDuration > DEBOUNCE_TIME) {
                 handleShortPress();
             }
         } else { // Button was pressed
-            Serial.println("Button pressed (FALLING edge)");
+            LOG(BUTTON_PRESSED);
         }
         stateChanged = false;
     }
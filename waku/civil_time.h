@@ -0,0 +1,56 @@
+#ifndef CIVIL_TIME_H
+#define CIVIL_TIME_H
+
+#include <stdint.h>
+
+// Proleptic Gregorian calendar <-> days since 1970-01-01, after Howard
+// Hinnant's days_from_civil / civil_from_days. Constant time: the year is
+// split into 400-year eras and the year is taken to start on 1 March, so
+// leap days fall at its end and months need no lookup table.
+
+struct CivilDate {
+    int32_t year;
+    uint8_t month;      // 1-12
+    uint8_t day;        // 1-31
+};
+
+constexpr int32_t SECONDS_PER_DAY = 86400;
+
+constexpr int32_t daysFromCivil(int32_t year, uint8_t month, uint8_t day) {
+    year -= month <= 2;
+    int32_t era = (year >= 0 ? year : year - 399) / 400;
+    uint32_t yearOfEra = static_cast<uint32_t>(year - era * 400);                       // [0, 399]
+    uint32_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;  // [0, 365], from 1 March
+    uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;   // [0, 146096]
+    return era * 146097 + static_cast<int32_t>(dayOfEra) - 719468;
+}
+
+inline CivilDate civilFromDays(int32_t days) {
+    days += 719468;
+    int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+    uint32_t dayOfEra = static_cast<uint32_t>(days - era * 146097);                          // [0, 146096]
+    uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;  // [0, 399]
+    uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);       // [0, 365], from 1 March
+    uint32_t monthIndex = (5 * dayOfYear + 2) / 153;                                            // [0, 11], 0 = March
+    CivilDate date;
+    date.day = static_cast<uint8_t>(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    date.month = static_cast<uint8_t>(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+    date.year = static_cast<int32_t>(yearOfEra) + era * 400 + (date.month <= 2);
+    return date;
+}
+
+// 0 = Sunday, as in POSIX TZ rules and struct tm
+constexpr uint8_t weekdayFromDays(int32_t days) {
+    return static_cast<uint8_t>(days >= -4 ? (days + 4) % 7 : (days + 5) % 7 + 6);
+}
+
+constexpr bool isLeapYear(int32_t year) {
+    return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+// Floor division of seconds into days, right for times before 1970 too
+constexpr int32_t daysFromSeconds(int64_t seconds) {
+    return static_cast<int32_t>(seconds >= 0 ? seconds / SECONDS_PER_DAY : (seconds - SECONDS_PER_DAY + 1) / SECONDS_PER_DAY);
+}
+
+#endif
@@ -0,0 +1,353 @@
+#include "clock_sync.h"
+#include "alarm.h"
+#include "boot_events.h"
+#include "civil_time.h"
+#include "config_store.h"
+#include "log.h"
+#include "timezone.h"
+
+ClockSync::Anchor ClockSync::anchor = {0, 0, 0};
+std::atomic<bool> ClockSync::clockSet(false);
+std::atomic<bool> ClockSync::synced(false);
+
+bool ClockSync::driftKnown = false;
+int32_t ClockSync::savedPpb = 0;
+uint32_t ClockSync::correctedAt = 0;
+uint32_t ClockSync::pollInterval = ClockSync::MIN_POLL_INTERVAL;
+uint32_t ClockSync::nextPollIn = 0;
+uint32_t ClockSync::lastPoll = 0;
+uint32_t ClockSync::sntpReplies = 0;
+uint16_t ClockSync::sntpFailures = 0;
+int32_t ClockSync::lastOffset = 0;
+uint32_t ClockSync::lastDelay = 0;
+uint32_t ClockSync::delays[DELAY_HISTORY];
+uint32_t ClockSync::delayCount = 0;
+
+std::atomic<int32_t> ClockSync::targetOffset(0);
+std::atomic<bool> ClockSync::targetDst(false);
+
+int32_t ClockSync::rtcOffset = 0;
+int64_t ClockSync::rtcSecond = 0;
+bool ClockSync::rtcErrorKnown = false;
+int32_t ClockSync::rtcErrorMillis = 0;
+uint32_t ClockSync::lastSlew = 0;
+
+RTCTime unixTimeToRTCTime(int64_t localTime, bool dst) {
+    int32_t days = daysFromSeconds(localTime);
+    int32_t secondOfDay = static_cast<int32_t>(localTime - static_cast<int64_t>(days) * SECONDS_PER_DAY);
+    CivilDate date = civilFromDays(days);
+
+    // Month counts from JANUARY = 0; DayOfWeek has SUNDAY = 0 like weekdayFromDays
+    return RTCTime(
+        date.day, static_cast<Month>(date.month - 1), date.year,
+        secondOfDay / 3600, secondOfDay / 60 % 60, secondOfDay % 60,
+        static_cast<DayOfWeek>(weekdayFromDays(days)),
+        dst ? SaveLight::SAVING_TIME_ACTIVE : SaveLight::SAVING_TIME_INACTIVE
+    );
+}
+
+int64_t rtcTimeToUnix(RTCTime& time) {
+    int32_t days = daysFromCivil(time.getYear(), Month2int(time.getMonth()), time.getDayOfMonth());
+    return static_cast<int64_t>(days) * SECONDS_PER_DAY
+         + time.getHour() * 3600 + time.getMinutes() * 60 + time.getSeconds();
+}
+
+static int64_t floorSeconds(int64_t millis) {
+    return millis >= 0 ? millis / 1000 : (millis - 999) / 1000;
+}
+
+// For reports and log arguments; a first sample after a power cut is
+// decades off
+static int32_t saturate(int64_t millis) {
+    return millis > INT32_MAX ? INT32_MAX : millis < -INT32_MAX ? -INT32_MAX : static_cast<int32_t>(millis);
+}
+
+bool ClockSync::begin() {
+    if (!RTC.begin()) {
+        return false;
+    }
+
+    int32_t ppb;
+    if (ConfigStore::get(ConfigKey::CLOCK_DRIFT, ppb) && ppb >= -MAX_PPB && ppb <= MAX_PPB) {
+        anchor.ppb = ppb;
+        savedPpb = ppb;
+        driftKnown = true;
+    }
+
+    if (RTC.isRunning()) {
+        RTCTime now;
+        RTC.getTime(now);
+        int64_t local = rtcTimeToUnix(now);
+        rtcOffset = TimeZone::offsetForLocal(local);
+        targetOffset = rtcOffset;
+        targetDst = TimeZone::isDst(local - rtcOffset);
+        // The RTC does not tell how far into the second it is: take the middle
+        step((local - rtcOffset) * 1000 + 500 - nowMillis(), anchor.ppb);
+        clockSet = true;
+        BootEvents::publish(BootEvent::CLOCK_VALID);
+    }
+    return true;
+}
+
+int64_t ClockSync::nowMillis() {
+    noInterrupts();
+    Anchor current = anchor;
+    uint32_t elapsed = millis() - current.anchorMillis;
+    interrupts();
+    return current.anchorUtcMillis + elapsed + static_cast<int64_t>(elapsed) * current.ppb / 1000000000;
+}
+
+// Move the clock by offsetMillis from now on and continue at the given rate
+void ClockSync::step(int64_t offsetMillis, int32_t ppb) {
+    noInterrupts();
+    uint32_t now = millis();
+    uint32_t elapsed = now - anchor.anchorMillis;
+    anchor.anchorUtcMillis += elapsed + static_cast<int64_t>(elapsed) * anchor.ppb / 1000000000 + offsetMillis;
+    anchor.anchorMillis = now;
+    anchor.ppb = ppb;
+    interrupts();
+}
+
+// Same time, fresh anchor, so the elapsed millis() never wrap
+void ClockSync::rebase() {
+    noInterrupts();
+    int32_t ppb = anchor.ppb;
+    interrupts();
+    step(0, ppb);
+}
+
+// First time of a boot when the RTC had none: write it straight away, the
+// alarm is waiting on it. tick() takes over from here.
+bool ClockSync::setRtcNow() {
+    int64_t utc = floorSeconds(nowMillis());
+    int32_t offset = TimeZone::offsetAt(utc);
+    bool dst = TimeZone::isDst(utc);
+    RTCTime time = unixTimeToRTCTime(utc + offset, dst);
+    if (!RTC.setTime(time)) {
+        return false;
+    }
+    targetDst = dst;
+    targetOffset = offset;
+    rtcOffset = offset;
+    return true;
+}
+
+// Apply one sample: the clock is offsetMillis behind, give or take
+// errorMillis. A fresh sample is the first of a better source and is taken
+// as it is, without reading a rate into the error of the previous one.
+bool ClockSync::correct(int64_t offsetMillis, uint32_t errorMillis, bool fresh) {
+    uint32_t now = millis();
+    int32_t ppb = anchor.ppb;
+
+    if (synced && !fresh) {
+        uint32_t interval = now - correctedAt;
+        int64_t threshold = 2 * static_cast<int64_t>(errorMillis);
+        if (threshold < STEP_THRESHOLD) {
+            threshold = STEP_THRESHOLD;
+        }
+        bool significant = offsetMillis > threshold || offsetMillis < -threshold;
+        // A rate needs a long enough interval; a small error over a short one
+        // is left to build up until it means something
+        bool learn = interval >= MIN_FREQUENCY_INTERVAL &&
+                     (significant || interval / INTERVAL_PER_ERROR >= errorMillis) &&
+                     offsetMillis <= interval / 50 && offsetMillis >= -static_cast<int64_t>(interval / 50);
+        if (!learn && !significant) {
+            return true;
+        }
+        if (learn) {
+            // The error built up over the interval; the first measurement is
+            // taken whole, later ones are averaged in against jitter
+            int64_t measured = offsetMillis * 1000000000 / interval;
+            int64_t next = ppb + (driftKnown ? measured / 2 : measured);
+            ppb = next > MAX_PPB ? MAX_PPB : next < -MAX_PPB ? -MAX_PPB : static_cast<int32_t>(next);
+            driftKnown = true;
+        }
+    }
+
+    step(offsetMillis, ppb);
+    correctedAt = now;
+    lastOffset = saturate(offsetMillis);
+
+    if (!clockSet) {
+        if (!setRtcNow()) {
+            return false;
+        }
+        clockSet = true;
+        BootEvents::publish(BootEvent::CLOCK_VALID);
+    }
+    synced = true;
+    return true;
+}
+
+bool ClockSync::syncDue() {
+    return millis() - lastPoll >= nextPollIn * 1000;
+}
+
+void ClockSync::recordSntp(bool ok, const SntpClient::Sample& sample) {
+    lastPoll = millis();
+    if (!ok) {
+        // Back off: no SNTP server at all costs a packet every few hours
+        sntpFailures++;
+        nextPollIn = sntpFailures == 1 ? RETRY_INTERVAL : nextPollIn * 2;
+        if (nextPollIn > MAX_POLL_INTERVAL) {
+            nextPollIn = MAX_POLL_INTERVAL;
+        }
+        LOG(SNTP_FAILED, sntpFailures);
+        return;
+    }
+    sntpFailures = 0;
+
+    // A round trip well above the recent minimum sat in a queue on one of
+    // the two legs, which skews its offset by up to half the difference
+    delays[delayCount++ % DELAY_HISTORY] = sample.delayMillis;
+    uint32_t minDelay = sample.delayMillis;
+    for (uint32_t i = 0; i < DELAY_HISTORY && i < delayCount; i++) {
+        if (delays[i] < minDelay) {
+            minDelay = delays[i];
+        }
+    }
+    uint32_t margin = minDelay / 2 > 10 ? minDelay / 2 : 10;
+    if (sample.delayMillis > minDelay + margin) {
+        nextPollIn = MIN_POLL_INTERVAL;
+        return;
+    }
+
+    bool fresh = sntpReplies++ == 0;
+    lastDelay = sample.delayMillis;
+    correct(sample.offsetMillis, sample.delayMillis / 2 + 1, fresh);
+
+    int32_t magnitude = abs(saturate(sample.offsetMillis));
+    if (magnitude <= GOOD_OFFSET && pollInterval < MAX_POLL_INTERVAL) {
+        pollInterval *= 2;
+    } else if (magnitude > STEP_THRESHOLD && pollInterval > MIN_POLL_INTERVAL) {
+        pollInterval /= 2;
+    }
+    nextPollIn = pollInterval;
+
+    int32_t ppb = anchor.ppb;
+    LOG(CLOCK_SYNCED, saturate(sample.offsetMillis), sample.delayMillis, ppb);
+    if (driftKnown && abs(ppb - savedPpb) >= SAVE_PPB_CHANGE && ConfigStore::set(ConfigKey::CLOCK_DRIFT, ppb)) {
+        savedPpb = ppb;
+    }
+}
+
+bool ClockSync::setFromServer(uint32_t utc) {
+    // SNTP's millisecond timestamps beat these once it has answered
+    if (sntpReplies > 0) {
+        return true;
+    }
+    // The server truncates to the second: take the middle
+    int64_t offset = static_cast<int64_t>(utc) * 1000 + 500 - nowMillis();
+    return correct(offset, SERVER_ERROR, false);
+}
+
+void ClockSync::followTimeZone() {
+    if (!clockSet) {
+        return;
+    }
+    int64_t utc = floorSeconds(nowMillis());
+    // DST first: tick() reads the offset first, so it never pairs a new
+    // offset with the old flag
+    targetDst = TimeZone::isDst(utc);
+    targetOffset = TimeZone::offsetAt(utc);
+}
+
+void ClockSync::tick(Alarm* alarm) {
+    if (!clockSet) {
+        return;
+    }
+    if (millis() - anchor.anchorMillis > REBASE_AFTER) {
+        rebase();
+    }
+
+    int64_t utcMillis = nowMillis();
+    RTCTime time;
+    RTC.getTime(time);
+    int64_t local = rtcTimeToUnix(time);
+    if (local != rtcSecond) {
+        // Only a rollover into the next second marks where a second starts
+        rtcErrorKnown = local == rtcSecond + 1;
+        if (rtcErrorKnown) {
+            int64_t error = (local - rtcOffset) * 1000 - utcMillis;
+            rtcErrorMillis = error > INT32_MAX ? INT32_MAX : error < INT32_MIN ? INT32_MIN : static_cast<int32_t>(error);
+        }
+        rtcSecond = local;
+    }
+
+    // Until the network has set the clock the RTC is the better reference;
+    // only zone changes are applied to it
+    int32_t offset = targetOffset;
+    bool zoneChange = offset != rtcOffset;
+    bool drifted = synced && rtcErrorKnown && abs(rtcErrorMillis) > RTC_TOLERANCE;
+    if (!zoneChange && !drifted) {
+        return;
+    }
+
+    // Write at the start of a software second, so the RTC rolls over with it
+    int64_t utcSecond = floorSeconds(utcMillis);
+    if (utcMillis - utcSecond * 1000 >= RTC_WRITE_WINDOW) {
+        return;
+    }
+
+    int32_t keepSeconds = 0;
+    if (!zoneChange && abs(rtcErrorMillis) > 1000 && abs(rtcErrorMillis) <= MAX_SLEW &&
+        alarm && alarm->isNearWakeWindow(WAKE_MARGIN)) {
+        // Slew: at most a second per SLEW_INTERVAL, keep the rest for later
+        if (millis() - lastSlew < SLEW_INTERVAL) {
+            return;
+        }
+        lastSlew = millis();
+        int32_t rest = rtcErrorMillis > 0 ? rtcErrorMillis - 1000 : rtcErrorMillis + 1000;
+        keepSeconds = (rest + (rest > 0 ? 500 : -500)) / 1000;
+    }
+    writeRtc(utcSecond, offset, keepSeconds);
+}
+
+void ClockSync::writeRtc(int64_t utcSecond, int32_t offset, int32_t keepSeconds) {
+    int64_t local = utcSecond + offset + keepSeconds;
+    RTCTime time = unixTimeToRTCTime(local, targetDst);
+    if (!RTC.setTime(time)) {
+        return;
+    }
+    if (offset != rtcOffset) {
+        LOG(CLOCK_OFFSET_CHANGED, rtcOffset, offset);
+    } else {
+        LOG(RTC_CORRECTED, rtcErrorMillis, keepSeconds);
+    }
+    rtcOffset = offset;
+    rtcSecond = local;
+    rtcErrorMillis = keepSeconds * 1000;
+    rtcErrorKnown = keepSeconds != 0;
+}
+
+void ClockSync::printReport(const char* args) {
+    RTCTime now;
+    RTC.getTime(now);
+    int64_t local = rtcTimeToUnix(now);
+    CivilDate date = civilFromDays(daysFromSeconds(local));
+
+    char line[64];
+    snprintf(line, sizeof(line), "Local: %04ld-%02u-%02u %02d:%02d:%02d",
+             static_cast<long>(date.year), date.month, date.day,
+             now.getHour(), now.getMinutes(), now.getSeconds());
+    Serial.println(line);
+    Serial.print("RTC offset: ");
+    Serial.print(rtcOffset);
+    Serial.println(BootEvents::isSet(BootEvent::CLOCK_VALID) ? " s" : " s (clock not set yet)");
+
+    Serial.print("Sync: ");
+    Serial.print(synced ? (sntpReplies > 0 ? "SNTP" : "server") : "none yet");
+    Serial.print(", ");
+    Serial.print(sntpReplies);
+    Serial.print(" SNTP replies, next in ");
+    Serial.print(syncDue() ? 0 : nextPollIn - (millis() - lastPoll) / 1000);
+    Serial.println(" s");
+    snprintf(line, sizeof(line), "Last offset: %ld ms, delay %lu ms",
+             static_cast<long>(lastOffset), static_cast<unsigned long>(lastDelay));
+    Serial.println(line);
+    snprintf(line, sizeof(line), "Drift: %ld ppb%s, RTC error: %ld ms",
+             static_cast<long>(anchor.ppb), driftKnown ? "" : " (not measured)",
+             static_cast<long>(rtcErrorMillis));
+    Serial.println(line);
+    TimeZone::printReport();
+}
@@ -0,0 +1,139 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <Arduino.h>
+#include <RTC.h>
+#include <atomic>
+#include "sntp_client.h"
+
+class Alarm;
+
+// Local time <-> RTC fields. The RTC keeps local time (the alarm compares
+// hours and minutes with it directly), so the UTC offset it was set with is
+// tracked here.
+RTCTime unixTimeToRTCTime(int64_t localTime, bool dst);
+int64_t rtcTimeToUnix(RTCTime& time);
+
+// Disciplined clock. UTC in milliseconds is kept in software on millis(),
+// corrected by a frequency estimate (ppb) learned from occasional SNTP
+// exchanges; the server's whole-second timestamps stand in while no SNTP
+// server has answered. The estimate is kept in the config store, so a
+// reboot without network still runs at the learned rate.
+//
+// Each sample is the clock's error over the time since the last correction.
+// The error is stepped out only if it is larger than the sample could be
+// wrong by, or once enough time has passed for it to tell the frequency
+// error apart from network jitter; then the frequency is adjusted too. The
+// poll interval doubles while samples stay small (64 s up to 4.5 h, a
+// handful of exchanges a day) and halves when they grow.
+//
+// The RTC (sub-clock, no hardware trim on this board) only holds whole
+// seconds, so it is steered from the alarm task: the RTC's second rollover
+// is compared with the software clock, and when it is off by more than
+// RTC_TOLERANCE it is rewritten right at the start of a software second.
+// Near the wake window a large error is slewed out a second at a time, so
+// the light ramp does not jump; DST changes always step.
+class ClockSync {
+public:
+    // Start the RTC and load the frequency estimate; if the RTC kept running
+    // across the reset its time is good and BootEvent::CLOCK_VALID is
+    // published right away. Call after TimeZone::begin().
+    static bool begin();
+
+    // UTC in ms; counts from 1970 at reset until the clock is set. Any task.
+    static int64_t nowMillis();
+
+    // Set from the network (server or SNTP) since boot
+    static bool isSynced() { return synced; }
+
+    // Network task: is an SNTP exchange due?
+    static bool syncDue();
+
+    // Network task: make the next exchange due now, keeping the poll
+    // interval (before the wake window, say)
+    static void requestSync() { lastPoll = millis() - nextPollIn * 1000; }
+
+    // Network task: result of an SNTP exchange (ok false on timeout or a
+    // bad reply, which backs off the next attempt)
+    static void recordSntp(bool ok, const SntpClient::Sample& sample);
+
+    // Network task: UTC from the server. Sets an unset clock (publishing
+    // BootEvent::CLOCK_VALID) and corrects large errors while SNTP is not
+    // available; false only if the RTC could not be set.
+    static bool setFromServer(uint32_t utc);
+
+    // Network task: pick up a DST transition or a new zone. Between
+    // transitions it is a compare; the RTC follows on the next tick().
+    static void followTimeZone();
+
+    // Alarm task, every cycle: keep the RTC on the software clock
+    static void tick(Alarm* alarm);
+
+    // Console handler: local time, sync state, zone and next transition
+    static void printReport(const char* args);
+
+private:
+    // Software clock: UTC ms at millis() == anchorMillis, plus the elapsed
+    // time corrected by ppb. Read and written with interrupts off.
+    struct Anchor {
+        uint32_t anchorMillis;
+        int64_t anchorUtcMillis;
+        int32_t ppb;            // Correction added to millis(); + if it runs slow
+    };
+
+    static const uint32_t MIN_POLL_INTERVAL = 64;       // s
+    static const uint32_t MAX_POLL_INTERVAL = 16384;    // s
+    static const uint32_t RETRY_INTERVAL = 60;          // s, after a failed exchange
+    static const int32_t STEP_THRESHOLD = 128;          // ms; smaller errors wait for a frequency update
+    static const int32_t GOOD_OFFSET = 32;              // ms; below this the poll interval grows
+    static const uint32_t MIN_FREQUENCY_INTERVAL = 60000;   // ms between frequency updates
+    static const uint32_t INTERVAL_PER_ERROR = 20000;   // Interval / sample error: at most 50 ppm
+    static const uint32_t SERVER_ERROR = 1000;          // ms; whole seconds plus HTTP latency
+    static const int32_t MAX_PPB = 20000000;            // 2 %, beyond any oscillator that works
+    static const int32_t SAVE_PPB_CHANGE = 1000;        // Store the estimate when it moves by 1 ppm
+    static const uint8_t DELAY_HISTORY = 8;             // SNTP round trips for the congestion filter
+
+    static const int32_t RTC_TOLERANCE = 250;           // ms
+    static const uint16_t RTC_WRITE_WINDOW = 20;        // ms after a software second starts
+    static const uint32_t SLEW_INTERVAL = 10000;        // ms between 1 s slew steps
+    static const int32_t MAX_SLEW = 60000;              // ms; a clock off by more is just wrong
+    static const int WAKE_MARGIN = 10;                  // min before the wake window that slew starts
+    static const uint32_t REBASE_AFTER = 1UL << 30;     // ms, well before millis() wraps
+
+    static Anchor anchor;
+    static std::atomic<bool> clockSet;      // anchor holds a time (from the RTC or the network)
+    static std::atomic<bool> synced;        // Set from the network this boot; RTC steering on
+
+    // Sync state, network task
+    static bool driftKnown;                 // ppb measured, now or before the reboot
+    static int32_t savedPpb;
+    static uint32_t correctedAt;            // millis() of the last correction
+    static uint32_t pollInterval;           // s
+    static uint32_t nextPollIn;             // s from lastPoll
+    static uint32_t lastPoll;               // millis()
+    static uint32_t sntpReplies;
+    static uint16_t sntpFailures;           // In a row
+    static int32_t lastOffset;              // ms, last accepted sample
+    static uint32_t lastDelay;              // ms
+    static uint32_t delays[DELAY_HISTORY];
+    static uint32_t delayCount;             // Replies so far
+
+    // Zone for the RTC, written by the network task
+    static std::atomic<int32_t> targetOffset;
+    static std::atomic<bool> targetDst;
+
+    // RTC steering, alarm task
+    static int32_t rtcOffset;               // UTC offset the RTC's local time is in
+    static int64_t rtcSecond;               // Last RTC reading, local seconds
+    static bool rtcErrorKnown;
+    static int32_t rtcErrorMillis;          // RTC ahead of the software clock
+    static uint32_t lastSlew;               // millis()
+
+    static void step(int64_t offsetMillis, int32_t ppb);
+    static void rebase();
+    static bool setRtcNow();
+    static bool correct(int64_t offsetMillis, uint32_t errorMillis, bool fresh);
+    static void writeRtc(int64_t utcSecond, int32_t offset, int32_t keepSeconds);
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "co2_sensor.h"
 #include "Arduino_FreeRTOS.h"
+#include "profiler.h"
 
 // Static member initialization
 volatile unsigned long CO2Sensor::pulseStartTime = 0;
@@ -16,6 +17,7 @@ static volatile unsigned long lastPPM = 0;
 
 void CO2Sensor::pulseISR() {
     if (!instance) return; // Prevent null pointer dereference
+    PROFILE_SCOPE(ProbeId::PULSE_ISR);
     
     interruptCount++;
     if (digitalRead(instance->pwmPin) == HIGH) {
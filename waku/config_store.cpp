@@ -0,0 +1,263 @@
+#include "config_store.h"
+#include "crc32.h"
+#include "data_flash.h"
+#include "log.h"
+
+static const uint32_t BLOCK_MAGIC = 0x57434647;     // "WCFG"
+static const uint8_t BLOCK_COUNT = DataFlash::CONFIG_STORE_BLOCKS;
+
+static const char* const KEY_NAMES[] = {"?", "wake_schedule", "triggered_day", "utc_offset", "calibration", "timezone", "clock_drift", "firmware_applied"};
+
+static_assert(sizeof(KEY_NAMES) / sizeof(KEY_NAMES[0]) == static_cast<uint8_t>(ConfigKey::COUNT), "Name every config key");
+static_assert(ConfigStore::MAX_VALUE_SIZE % DataFlash::WRITE_UNIT == 0, "Entries must fill whole flash write units");
+
+bool ConfigStore::ready = false;
+uint8_t ConfigStore::activeBlock = 0;
+uint32_t ConfigStore::generation = 0;
+uint16_t ConfigStore::writeOffset = 0;
+bool ConfigStore::needsCompaction = false;
+uint16_t ConfigStore::entries[static_cast<uint8_t>(ConfigKey::COUNT)];
+
+uint32_t ConfigStore::blockOffset(uint8_t block) {
+    return DataFlash::CONFIG_STORE_OFFSET + block * DataFlash::BLOCK_SIZE;
+}
+
+size_t ConfigStore::entrySize(uint8_t length) {
+    size_t padded = (length + DataFlash::WRITE_UNIT - 1) & ~(DataFlash::WRITE_UNIT - 1);
+    return sizeof(EntryHeader) + padded + sizeof(uint32_t);
+}
+
+bool ConfigStore::readHeader(uint8_t block, BlockHeader& header) {
+    // The magic is written after the generation, so a blank magic covers a
+    // header that was cut short as well as an erased block
+    if (DataFlash::isBlank(blockOffset(block), sizeof(header.magic))) {
+        return false;
+    }
+    return DataFlash::read(blockOffset(block), &header, sizeof(header)) && header.magic == BLOCK_MAGIC;
+}
+
+// Whole entry into header and value (value needs MAX_VALUE_SIZE bytes);
+// false unless the CRC matches
+bool ConfigStore::readEntry(uint8_t block, uint16_t offset, EntryHeader& header, uint8_t* value) {
+    uint32_t address = blockOffset(block) + offset;
+    if (!DataFlash::read(address, &header, sizeof(header)) ||
+        header.check != static_cast<uint16_t>(~(header.key | header.length << 8)) ||
+        header.length > MAX_VALUE_SIZE) {
+        return false;
+    }
+
+    size_t padded = entrySize(header.length) - sizeof(header) - sizeof(uint32_t);
+    uint32_t storedCrc;
+    if (!DataFlash::read(address + sizeof(header), value, padded) ||
+        !DataFlash::read(address + sizeof(header) + padded, &storedCrc, sizeof(storedCrc))) {
+        return false;
+    }
+    uint32_t crc = crc32Update(crc32Update(0, &header, sizeof(header)), value, padded);
+    return crc == storedCrc;
+}
+
+void ConfigStore::scanBlock() {
+    memset(entries, 0, sizeof(entries));
+    needsCompaction = false;
+
+    uint8_t value[MAX_VALUE_SIZE];
+    uint16_t offset = sizeof(BlockHeader);
+    while (offset < DataFlash::BLOCK_SIZE && !DataFlash::isBlank(blockOffset(activeBlock) + offset, DataFlash::WRITE_UNIT)) {
+        EntryHeader header;
+        if (!DataFlash::read(blockOffset(activeBlock) + offset, &header, sizeof(header)) ||
+            header.check != static_cast<uint16_t>(~(header.key | header.length << 8)) ||
+            header.length > MAX_VALUE_SIZE ||
+            offset + entrySize(header.length) > DataFlash::BLOCK_SIZE) {
+            // Without a length there is no telling where the next entry
+            // starts; move the live ones to a fresh block before appending
+            needsCompaction = true;
+            break;
+        }
+        // A torn write fails its CRC and leaves the older entry in charge
+        if (readEntry(activeBlock, offset, header, value) && header.key != 0 &&
+            header.key < static_cast<uint8_t>(ConfigKey::COUNT)) {
+            entries[header.key] = offset;
+        }
+        offset += entrySize(header.length);
+    }
+    writeOffset = offset;
+}
+
+bool ConfigStore::begin() {
+    if (!DataFlash::begin()) {
+        return false;
+    }
+
+    bool found = false;
+    BlockHeader header;
+    for (uint8_t block = 0; block < BLOCK_COUNT; block++) {
+        if (readHeader(block, header) && (!found || header.generation > generation)) {
+            found = true;
+            activeBlock = block;
+            generation = header.generation;
+        }
+    }
+
+    if (!found) {
+        // First boot, or the partition was never written: start empty
+        uint32_t first = 1;
+        if (!DataFlash::erase(blockOffset(0), 1) ||
+            !DataFlash::write(blockOffset(0) + offsetof(BlockHeader, generation), &first, sizeof(first)) ||
+            !DataFlash::write(blockOffset(0), &BLOCK_MAGIC, sizeof(BLOCK_MAGIC))) {
+            Serial.println("ERROR: Failed to format the config store");
+            return false;
+        }
+        activeBlock = 0;
+        generation = first;
+    }
+
+    scanBlock();
+    ready = true;
+    return true;
+}
+
+bool ConfigStore::get(ConfigKey key, void* value, size_t size) {
+    uint8_t index = static_cast<uint8_t>(key);
+    if (!ready || index == 0 || index >= static_cast<uint8_t>(ConfigKey::COUNT) || entries[index] == NO_ENTRY) {
+        return false;
+    }
+
+    uint32_t address = blockOffset(activeBlock) + entries[index];
+    EntryHeader header;
+    if (!DataFlash::read(address, &header, sizeof(header)) || header.length != size) {
+        return false;
+    }
+    return DataFlash::read(address + sizeof(header), value, size);
+}
+
+bool ConfigStore::getString(ConfigKey key, char* value, size_t capacity) {
+    uint8_t index = static_cast<uint8_t>(key);
+    if (!ready || index == 0 || index >= static_cast<uint8_t>(ConfigKey::COUNT) || entries[index] == NO_ENTRY) {
+        return false;
+    }
+
+    uint32_t address = blockOffset(activeBlock) + entries[index];
+    EntryHeader header;
+    if (!DataFlash::read(address, &header, sizeof(header)) || header.length >= capacity ||
+        !DataFlash::read(address + sizeof(header), value, header.length)) {
+        return false;
+    }
+    value[header.length] = '\0';
+    return true;
+}
+
+bool ConfigStore::appendEntry(uint8_t block, uint16_t offset, uint8_t key, const void* value, uint8_t length) {
+    uint8_t entry[sizeof(EntryHeader) + MAX_VALUE_SIZE + sizeof(uint32_t)] = {};
+    EntryHeader header = {key, length, static_cast<uint16_t>(~(key | length << 8))};
+    size_t size = entrySize(length);
+    size_t crcOffset = size - sizeof(uint32_t);
+
+    memcpy(entry, &header, sizeof(header));
+    memcpy(entry + sizeof(header), value, length);
+    uint32_t crc = crc32Update(0, entry, crcOffset);
+    memcpy(entry + crcOffset, &crc, sizeof(crc));
+
+    return DataFlash::write(blockOffset(block) + offset, entry, size);
+}
+
+bool ConfigStore::compact() {
+    uint8_t next = (activeBlock + 1) % BLOCK_COUNT;
+    if (!DataFlash::erase(blockOffset(next), 1)) {
+        return false;
+    }
+
+    uint16_t moved[static_cast<uint8_t>(ConfigKey::COUNT)] = {};
+    uint16_t offset = sizeof(BlockHeader);
+    uint8_t value[MAX_VALUE_SIZE];
+    for (uint8_t key = 1; key < static_cast<uint8_t>(ConfigKey::COUNT); key++) {
+        EntryHeader header;
+        if (entries[key] == NO_ENTRY || !readEntry(activeBlock, entries[key], header, value)) {
+            continue;
+        }
+        if (!appendEntry(next, offset, key, value, header.length)) {
+            return false;
+        }
+        moved[key] = offset;
+        offset += entrySize(header.length);
+    }
+
+    // Commit: the new block takes over once its magic is in place
+    uint32_t nextGeneration = generation + 1;
+    if (!DataFlash::write(blockOffset(next) + offsetof(BlockHeader, generation), &nextGeneration, sizeof(nextGeneration)) ||
+        !DataFlash::write(blockOffset(next), &BLOCK_MAGIC, sizeof(BLOCK_MAGIC))) {
+        return false;
+    }
+
+    activeBlock = next;
+    generation = nextGeneration;
+    memcpy(entries, moved, sizeof(entries));
+    writeOffset = offset;
+    needsCompaction = false;
+    LOG(CONFIG_COMPACTED, activeBlock, generation);
+    return true;
+}
+
+bool ConfigStore::set(ConfigKey key, const void* value, size_t size) {
+    uint8_t index = static_cast<uint8_t>(key);
+    if (!ready || index == 0 || index >= static_cast<uint8_t>(ConfigKey::COUNT) || size > MAX_VALUE_SIZE) {
+        return false;
+    }
+
+    // Unchanged values cost no flash wear
+    uint8_t stored[MAX_VALUE_SIZE];
+    if (get(key, stored, size) && memcmp(stored, value, size) == 0) {
+        return true;
+    }
+
+    size_t needed = entrySize(size);
+    if (needsCompaction || writeOffset + needed > DataFlash::BLOCK_SIZE) {
+        if (!compact() || writeOffset + needed > DataFlash::BLOCK_SIZE) {
+            LOG(CONFIG_WRITE_FAILED, index);
+            return false;
+        }
+    }
+
+    if (!appendEntry(activeBlock, writeOffset, index, value, size)) {
+        // Partly programmed cells cannot be written again
+        needsCompaction = true;
+        LOG(CONFIG_WRITE_FAILED, index);
+        return false;
+    }
+    entries[index] = writeOffset;
+    writeOffset += needed;
+    return true;
+}
+
+void ConfigStore::printReport(const char* args) {
+    if (!ready) {
+        Serial.println("Config store not available");
+        return;
+    }
+
+    Serial.print("Block ");
+    Serial.print(activeBlock);
+    Serial.print(", generation ");
+    Serial.print(generation);
+    Serial.print(", ");
+    Serial.print(writeOffset);
+    Serial.print(" / ");
+    Serial.print(DataFlash::BLOCK_SIZE);
+    Serial.println(needsCompaction ? " bytes used, compaction pending" : " bytes used");
+
+    uint8_t value[MAX_VALUE_SIZE];
+    for (uint8_t key = 1; key < static_cast<uint8_t>(ConfigKey::COUNT); key++) {
+        EntryHeader header;
+        if (entries[key] == NO_ENTRY || !readEntry(activeBlock, entries[key], header, value)) {
+            continue;
+        }
+        Serial.print(KEY_NAMES[key]);
+        Serial.print(": ");
+        for (uint8_t i = 0; i < header.length; i++) {
+            if (value[i] < 0x10) {
+                Serial.print('0');
+            }
+            Serial.print(value[i], HEX);
+        }
+        Serial.println();
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+
+// Keys of the persistent settings. The numbers are stored in data flash:
+// never renumber, only append.
+enum class ConfigKey : uint8_t {
+    WAKE_SCHEDULE = 1,      // AlarmSchedule last received from the server
+    TRIGGERED_DAY = 2,      // uint32_t yyyymmdd the alarm was last stopped on
+    UTC_OFFSET = 3,         // int32_t seconds added to the server's UTC time
+    CALIBRATION = 4,        // SensorCalibration
+    TIMEZONE = 5,           // POSIX TZ string, without the terminating NUL
+    CLOCK_DRIFT = 6,        // int32_t ppb added to millis() (see ClockSync)
+    FIRMWARE_APPLIED = 7,   // uint32_t version of the last image applied by OtaUpdater
+    COUNT
+};
+
+// Corrections the server can push for this particular unit
+struct SensorCalibration {
+    int16_t co2OffsetPpm;
+    int16_t soundOffsetCentiDb;     // Added to the dBFS levels, 1/100 dB
+};
+
+// Small key/value store in data flash, so the device boots with the settings
+// it last had instead of compile-time defaults, with or without a network.
+//
+// Log-structured: every set() appends an entry [key, length, value, CRC-32]
+// to the active block, and the newest valid entry of a key wins. When the
+// block fills up, the live entries are copied to the next block in the
+// rotation, which spreads the erases over all blocks of the partition. A
+// block only becomes active once its header (written last) is in place, so a
+// power cut mid-compaction leaves the previous block in charge; a torn entry
+// fails its CRC and the previous value stands.
+//
+// Values are read straight from flash; RAM holds one offset per key. Call
+// set() from one task at a time (the network task once the scheduler runs).
+class ConfigStore {
+public:
+    static const uint8_t MAX_VALUE_SIZE = 48;
+
+    // Find the active block and index its entries. Call once in setup(),
+    // after DataFlash::begin(); takes a few milliseconds.
+    static bool begin();
+
+    // Copy the stored value; false if the key was never set or was stored
+    // with a different size (the value is left untouched then)
+    static bool get(ConfigKey key, void* value, size_t size);
+
+    // Store a value; no flash write if it equals the stored one
+    static bool set(ConfigKey key, const void* value, size_t size);
+
+    // Variable-length text; false if missing or longer than capacity - 1
+    static bool getString(ConfigKey key, char* value, size_t capacity);
+    static bool setString(ConfigKey key, const char* value) { return set(key, value, strlen(value)); }
+
+    template <typename T>
+    static bool get(ConfigKey key, T& value) { return get(key, &value, sizeof(T)); }
+
+    template <typename T>
+    static bool set(ConfigKey key, const T& value) { return set(key, &value, sizeof(T)); }
+
+    // Console handler: active block, fill level and stored keys
+    static void printReport(const char* args);
+
+private:
+    struct BlockHeader {
+        uint32_t magic;
+        uint32_t generation;    // Highest valid one is the active block
+    };
+
+    struct EntryHeader {
+        uint8_t key;
+        uint8_t length;
+        uint16_t check;         // ~(key | length << 8); rejects garbage cheaply
+    };
+
+    static const uint16_t NO_ENTRY = 0;
+
+    static bool ready;
+    static uint8_t activeBlock;
+    static uint32_t generation;
+    static uint16_t writeOffset;        // Within the active block
+    static bool needsCompaction;        // Unreadable entry at writeOffset
+    static uint16_t entries[static_cast<uint8_t>(ConfigKey::COUNT)];   // Newest entry per key
+
+    static uint32_t blockOffset(uint8_t block);
+    static size_t entrySize(uint8_t length);
+    static bool readEntry(uint8_t block, uint16_t offset, EntryHeader& header, uint8_t* value);
+    static bool readHeader(uint8_t block, BlockHeader& header);
+    static void scanBlock();
+    static bool appendEntry(uint8_t block, uint16_t offset, uint8_t key, const void* value, uint8_t length);
+    static bool compact();
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include <Arduino.h>
+#include "task_stats.h"
+
+// Stackless coroutines in the protothread style: a coroutine is a plain
+// function that is called repeatedly and resumes at the line where it last
+// returned. All it keeps between calls is this small struct, so many of them
+// can share one task stack.
+//
+// Locals do not survive a wait; anything needed after CO_SLEEP_UNTIL or
+// CO_WAIT_UNTIL has to live in the coroutine's own state. A coroutine body
+// may not use switch statements around a wait.
+
+struct Coroutine {
+    uint16_t resumeLine;    // 0 = start of the body
+    uint32_t wakeAt;        // micros() deadline of the current wait
+    LatencyStats* latency;  // Lateness of CO_SLEEP_UNTIL wake-ups, if set
+
+    // True once the deadline has passed (wrap-safe)
+    bool due(uint32_t now) const { return static_cast<int32_t>(now - wakeAt) >= 0; }
+};
+
+// How often a coroutine blocked on a condition is polled
+#define CO_POLL_INTERVAL_US 1000UL
+
+#define CO_BEGIN(co) switch ((co).resumeLine) { case 0:
+
+#define CO_END(co) } (co).resumeLine = 0
+
+// Return to the scheduler until micros() reaches deadline
+#define CO_SLEEP_UNTIL(co, deadline)                                \
+    do {                                                            \
+        (co).wakeAt = (deadline);                                   \
+        (co).resumeLine = __LINE__;                                 \
+        case __LINE__:                                              \
+        if (!(co).due(micros())) {                                  \
+            return;                                                 \
+        }                                                           \
+        if ((co).latency) {                                         \
+            (co).latency->record(micros() - (co).wakeAt);           \
+        }                                                           \
+    } while (0)
+
+// Return to the scheduler until cond is true; cond is re-evaluated on every
+// poll. Reuses wakeAt as the poll deadline, so periodic coroutines that also
+// wait on conditions must keep their period deadline elsewhere.
+#define CO_WAIT_UNTIL(co, cond)                                     \
+    do {                                                            \
+        (co).resumeLine = __LINE__;                                 \
+        case __LINE__:                                              \
+        if (!(cond)) {                                              \
+            (co).wakeAt = micros() + CO_POLL_INTERVAL_US;           \
+            return;                                                 \
+        }                                                           \
+    } while (0)
+
+#endif
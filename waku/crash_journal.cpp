@@ -0,0 +1,239 @@
+#include "crash_journal.h"
+#include <Arduino_FreeRTOS.h>
+#include "crc32.h"
+#include "data_flash.h"
+
+static const uint32_t CRASH_MAGIC = 0x43525348;    // "CRSH"
+static const uint32_t UPLOADED_MARK = 0;
+
+// SRAM bounds, for deciding whether a faulting stack pointer can be read
+static const uint32_t RAM_START = 0x20000000;
+static const uint32_t RAM_END = 0x20008000;
+
+static_assert(sizeof(CrashRecord) % DataFlash::WRITE_UNIT == 0, "Crash record must fill whole flash write units");
+
+// Left alone by the startup code, so it keeps its contents across a reset
+static CrashRecord retainedCrash __attribute__((section(".noinit")));
+
+static const char* const CRASH_TYPE_NAMES[] = {"?", "HARD_FAULT", "STACK_OVERFLOW", "SUPERVISOR_RESET"};
+
+int8_t CrashJournal::pendingSlot = -1;
+bool CrashJournal::uploadInFlight = false;
+
+static uint32_t recordCrc(const CrashRecord& record) {
+    return crc32Update(0, &record, offsetof(CrashRecord, crc));
+}
+
+// Common part of every capture; must not allocate, lock or print
+static void fillRecord(CrashType type, const char* taskName) {
+    memset(&retainedCrash, 0, sizeof(retainedCrash));
+    retainedCrash.magic = CRASH_MAGIC;
+    retainedCrash.type = static_cast<uint8_t>(type);
+    retainedCrash.uptimeMillis = millis();
+    if (taskName) {
+        strncpy(retainedCrash.taskName, taskName, sizeof(retainedCrash.taskName) - 1);
+    }
+    retainedCrash.cfsr = SCB->CFSR;
+    retainedCrash.hfsr = SCB->HFSR;
+    retainedCrash.mmfar = SCB->MMFAR;
+    retainedCrash.bfar = SCB->BFAR;
+    retainedCrash.logCount = Log::copyRecent(retainedCrash.log, CrashRecord::LOG_RECORDS);
+}
+
+static void sealRecord() {
+    retainedCrash.crc = recordCrc(retainedCrash);
+}
+
+static const char* currentTaskName() {
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        return "setup";
+    }
+    return pcTaskGetName(NULL);
+}
+
+// Called by HardFault_Handler with the stacked exception frame
+extern "C" void crashFromHardFault(uint32_t* frame, uint32_t excReturn) {
+    fillRecord(CrashType::HARD_FAULT, currentTaskName());
+    retainedCrash.excReturn = excReturn;
+
+    uint32_t sp = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(frame));
+    retainedCrash.sp = sp;
+
+    // A corrupt stack pointer would fault again in here; only read RAM
+    if (sp >= RAM_START && sp + sizeof(retainedCrash.frame) <= RAM_END) {
+        memcpy(retainedCrash.frame, frame, sizeof(retainedCrash.frame));
+
+        // The caller's stack starts after the basic frame, or after the
+        // extended one (plus FPU registers) if bit 4 of EXC_RETURN is clear
+        const uint32_t* callerStack = frame + ((excReturn & 0x10) ? 8 : 26);
+        for (uint8_t i = 0; i < CrashRecord::STACK_WORDS; i++) {
+            uint32_t address = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(callerStack + i));
+            if (address + sizeof(uint32_t) > RAM_END) {
+                break;
+            }
+            retainedCrash.stack[i] = callerStack[i];
+        }
+    }
+
+    sealRecord();
+    NVIC_SystemReset();
+}
+
+// Pick the stack the fault was taken on (MSP or the task's PSP) and hand the
+// frame to crashFromHardFault; replaces the core's default handler, which
+// spins forever
+extern "C" __attribute__((naked)) void HardFault_Handler(void) {
+    __asm volatile(
+        "tst lr, #4             \n"
+        "ite eq                 \n"
+        "mrseq r0, msp          \n"
+        "mrsne r0, psp          \n"
+        "mov r1, lr             \n"
+        "b crashFromHardFault   \n"
+    );
+}
+
+#if configCHECK_FOR_STACK_OVERFLOW
+extern "C" void vApplicationStackOverflowHook(TaskHandle_t task, char* taskName) {
+    // The task's stack is already trashed; record what we can and reset
+    __disable_irq();
+    fillRecord(CrashType::STACK_OVERFLOW, taskName);
+    retainedCrash.sp = __get_PSP();
+    sealRecord();
+    NVIC_SystemReset();
+}
+#endif
+
+void CrashJournal::capture(CrashType type, const char* taskName) {
+    fillRecord(type, taskName);
+    sealRecord();
+}
+
+uint32_t CrashJournal::slotOffset(uint8_t slot) {
+    return DataFlash::CRASH_JOURNAL_OFFSET + slot * SLOT_SIZE;
+}
+
+bool CrashJournal::readSlot(uint8_t slot, CrashRecord& record) {
+    if (DataFlash::isBlank(slotOffset(slot), sizeof(uint32_t))) {
+        return false;
+    }
+    return DataFlash::read(slotOffset(slot), &record, sizeof(record)) &&
+           record.magic == CRASH_MAGIC && record.crc == recordCrc(record);
+}
+
+bool CrashJournal::isUploaded(uint8_t slot) {
+    return !DataFlash::isBlank(slotOffset(slot) + SLOT_SIZE - sizeof(UPLOADED_MARK), sizeof(UPLOADED_MARK));
+}
+
+void CrashJournal::findPendingUpload() {
+    CrashRecord record;
+    pendingSlot = -1;
+    for (uint8_t slot = 0; slot < SLOT_COUNT; slot++) {
+        if (readSlot(slot, record) && !isUploaded(slot)) {
+            pendingSlot = slot;
+            return;
+        }
+    }
+}
+
+void CrashJournal::begin() {
+    static_assert(sizeof(CrashRecord) + sizeof(UPLOADED_MARK) <= SLOT_SIZE, "Crash record does not fit its slot");
+    static_assert(SLOT_SIZE * SLOT_COUNT <= DataFlash::BLOCK_SIZE, "Crash journal must fit one block");
+
+    if (!DataFlash::begin()) {
+        return;
+    }
+
+    if (retainedCrash.magic == CRASH_MAGIC && retainedCrash.crc == recordCrc(retainedCrash)) {
+        Serial.print("WARNING: Last reset: ");
+        Serial.print(CRASH_TYPE_NAMES[retainedCrash.type < 4 ? retainedCrash.type : 0]);
+        Serial.print(" in ");
+        Serial.print(retainedCrash.taskName);
+        Serial.print(", pc 0x");
+        Serial.println(retainedCrash.frame[6], HEX);
+
+        // Append to the journal; when it is full, start it over
+        uint8_t slot = 0;
+        while (slot < SLOT_COUNT && !DataFlash::isBlank(slotOffset(slot), SLOT_SIZE)) {
+            slot++;
+        }
+        if (slot == SLOT_COUNT) {
+            DataFlash::erase(DataFlash::CRASH_JOURNAL_OFFSET, 1);
+            slot = 0;
+        }
+        if (!DataFlash::write(slotOffset(slot), &retainedCrash, sizeof(retainedCrash))) {
+            Serial.println("ERROR: Failed to save crash record");
+        }
+    }
+    // Consumed (or garbage from power-up) either way
+    retainedCrash.magic = 0;
+
+    findPendingUpload();
+}
+
+const char* CrashJournal::toHex(const CrashRecord& record) {
+    // Lives until the update is serialised; network task only
+    static char hex[2 * sizeof(CrashRecord) + 1];
+    static const char DIGITS[] = "0123456789abcdef";
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+    for (size_t i = 0; i < sizeof(record); i++) {
+        hex[2 * i] = DIGITS[bytes[i] >> 4];
+        hex[2 * i + 1] = DIGITS[bytes[i] & 0x0F];
+    }
+    hex[2 * sizeof(record)] = '\0';
+    return hex;
+}
+
+const char* CrashJournal::pendingUpload() {
+    CrashRecord record;
+    if (pendingSlot < 0 || !readSlot(pendingSlot, record)) {
+        uploadInFlight = false;
+        return nullptr;
+    }
+    uploadInFlight = true;
+    return toHex(record);
+}
+
+void CrashJournal::confirmUpload() {
+    if (!uploadInFlight || pendingSlot < 0) {
+        return;
+    }
+    uploadInFlight = false;
+    DataFlash::write(slotOffset(pendingSlot) + SLOT_SIZE - sizeof(UPLOADED_MARK), &UPLOADED_MARK, sizeof(UPLOADED_MARK));
+    findPendingUpload();
+}
+
+void CrashJournal::printReport(const char* args) {
+    if (args && strcmp(args, "clear") == 0) {
+        DataFlash::erase(DataFlash::CRASH_JOURNAL_OFFSET, 1);
+        pendingSlot = -1;
+        uploadInFlight = false;
+        Serial.println("Crash journal cleared");
+        return;
+    }
+
+    // One "CRASH <slot> <uploaded> <hex>" line per record, for decode_crash.py
+    CrashRecord record;
+    uint8_t count = 0;
+    for (uint8_t slot = 0; slot < SLOT_COUNT; slot++) {
+        if (!readSlot(slot, record)) {
+            continue;
+        }
+        Serial.print("CRASH ");
+        Serial.print(slot);
+        Serial.print(isUploaded(slot) ? " uploaded " : " pending ");
+        // Byte by byte: the hex buffer belongs to the network task
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record);
+        for (size_t i = 0; i < sizeof(record); i++) {
+            if (bytes[i] < 0x10) {
+                Serial.print('0');
+            }
+            Serial.print(bytes[i], HEX);
+        }
+        Serial.println();
+        count++;
+    }
+    if (count == 0) {
+        Serial.println("No crash records");
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef CRASH_JOURNAL_H
+#define CRASH_JOURNAL_H
+
+#include <Arduino.h>
+#include "log.h"
+
+enum class CrashType : uint8_t {
+    HARD_FAULT = 1,
+    STACK_OVERFLOW = 2,
+    SUPERVISOR_RESET = 3
+};
+
+// Post-mortem of one reset. tools/decode_crash.py unpacks this layout, so
+// change both together.
+struct CrashRecord {
+    static const uint8_t STACK_WORDS = 16;
+    static const uint8_t LOG_RECORDS = 4;
+
+    uint32_t magic;
+    uint8_t type;                   // CrashType
+    uint8_t logCount;
+    uint16_t reserved;
+    uint32_t uptimeMillis;
+    char taskName[12];
+    uint32_t frame[8];              // Exception frame: r0-r3, r12, lr, pc, xPSR
+    uint32_t excReturn;
+    uint32_t sp;                    // Stack pointer at the fault
+    uint32_t cfsr;                  // Fault status registers
+    uint32_t hfsr;
+    uint32_t mmfar;
+    uint32_t bfar;
+    uint32_t stack[STACK_WORDS];    // Words above the exception frame
+    LogRecord log[LOG_RECORDS];     // Newest first
+    uint32_t crc;                   // CRC-32 of everything above
+};
+
+// Fault capture. The HardFault handler and the FreeRTOS stack overflow hook
+// fill a record in RAM that survives the reset they end with. On the next
+// boot the record is appended to a data flash journal, offered for upload
+// with the next device update, and can be dumped with the "crash" console
+// command for tools/decode_crash.py.
+class CrashJournal {
+private:
+    static const uint32_t SLOT_SIZE = 256;      // Record plus upload mark
+    static const uint8_t SLOT_COUNT = 4;        // One data flash block
+
+    static int8_t pendingSlot;      // Oldest record not yet uploaded, -1 if none
+    static bool uploadInFlight;
+
+    static uint32_t slotOffset(uint8_t slot);
+    static bool readSlot(uint8_t slot, CrashRecord& record);
+    static bool isUploaded(uint8_t slot);
+    static void findPendingUpload();
+    static const char* toHex(const CrashRecord& record);
+
+public:
+    // Commit a record left by the previous run to data flash and report it.
+    // Call once in setup(), before the scheduler starts.
+    static void begin();
+
+    // Fill the retained record without resetting; used by the supervisor
+    // right before it resets the board itself
+    static void capture(CrashType type, const char* taskName);
+
+    // A record is waiting for upload; reads nothing, unlike pendingUpload()
+    static bool hasPendingUpload() { return pendingSlot >= 0; }
+
+    // Hex of the oldest record not uploaded yet, or nullptr, for the update
+    // that carries it. The pointer is valid until the next call.
+    static const char* pendingUpload();
+
+    // The last update carrying pendingUpload() was accepted
+    static void confirmUpload();
+
+    // Console handler: dump the journal ("crash clear" erases it)
+    static void printReport(const char* args);
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include <Arduino.h>
+
+// Cortex-M4 DWT cycle counter. At 48 MHz it wraps every ~89 s, so it is only
+// meant for measuring short intervals.
+class CycleCounter {
+public:
+    static void begin() {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+
+    static uint32_t now() { return DWT->CYCCNT; }
+
+    static uint32_t cyclesPerMicro() { return SystemCoreClock / 1000000UL; }
+    static uint32_t toMicros(uint32_t cycles) { return cycles / cyclesPerMicro(); }
+};
+
+#endif
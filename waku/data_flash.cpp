@@ -0,0 +1,100 @@
+#include "data_flash.h"
+#include "r_flash_lp.h"
+#include "build_config.h"
+
+static flash_lp_instance_ctrl_t flashCtrl;
+static flash_cfg_t flashCfg;
+
+#if WAKU_STATIC_ALLOCATION
+static StaticSemaphore_t mutexStorage;
+#endif
+
+bool DataFlash::opened = false;
+SemaphoreHandle_t DataFlash::mutex = NULL;
+TaskHandle_t volatile DataFlash::owner = NULL;
+
+// Holds the driver for one operation; before the scheduler starts there is
+// nothing to wait for
+class FlashLock {
+public:
+    explicit FlashLock(SemaphoreHandle_t mutex) : mutex(mutex) {
+        if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+            xSemaphoreTake(mutex, portMAX_DELAY);
+            DataFlash::owner = xTaskGetCurrentTaskHandle();
+            taken = true;
+        }
+    }
+    ~FlashLock() {
+        if (taken) {
+            DataFlash::owner = NULL;
+            xSemaphoreGive(mutex);
+        }
+    }
+
+private:
+    SemaphoreHandle_t mutex;
+    bool taken = false;
+};
+
+bool DataFlash::begin() {
+    if (opened) {
+        return true;
+    }
+
+    // Blocking mode: no background operation, no interrupts
+    flashCfg.data_flash_bgo = false;
+    flashCfg.p_callback = nullptr;
+    flashCfg.p_context = nullptr;
+    flashCfg.irq = FSP_INVALID_VECTOR;
+    flashCfg.err_irq = FSP_INVALID_VECTOR;
+
+#if WAKU_STATIC_ALLOCATION
+    mutex = xSemaphoreCreateMutexStatic(&mutexStorage);
+#else
+    mutex = xSemaphoreCreateMutex();
+#endif
+    if (!mutex || R_FLASH_LP_Open(&flashCtrl, &flashCfg) != FSP_SUCCESS) {
+        Serial.println("ERROR: Failed to open data flash");
+        return false;
+    }
+    opened = true;
+    return true;
+}
+
+bool DataFlash::read(uint32_t offset, void* data, size_t length) {
+    if (!opened || !inRange(offset, length)) {
+        return false;
+    }
+    // Memory-mapped once the driver has enabled data flash reads
+    FlashLock lock(mutex);
+    memcpy(data, reinterpret_cast<const void*>(BASE + offset), length);
+    return true;
+}
+
+bool DataFlash::write(uint32_t offset, const void* data, size_t length) {
+    if (!opened || !inRange(offset, length) || offset % WRITE_UNIT || length % WRITE_UNIT) {
+        return false;
+    }
+    FlashLock lock(mutex);
+    return R_FLASH_LP_Write(&flashCtrl, static_cast<uint32_t>(reinterpret_cast<uintptr_t>(data)), BASE + offset, length) == FSP_SUCCESS;
+}
+
+bool DataFlash::erase(uint32_t offset, uint32_t blocks) {
+    if (!opened || offset % BLOCK_SIZE || !inRange(offset, blocks * BLOCK_SIZE)) {
+        return false;
+    }
+    FlashLock lock(mutex);
+    return R_FLASH_LP_Erase(&flashCtrl, BASE + offset, blocks) == FSP_SUCCESS;
+}
+
+bool DataFlash::isBlank(uint32_t offset, size_t length) {
+    if (!opened || !inRange(offset, length)) {
+        return false;
+    }
+    FlashLock lock(mutex);
+    flash_result_t result;
+    if (R_FLASH_LP_BlankCheck(&flashCtrl, BASE + offset, length, &result) != FSP_SUCCESS) {
+        return false;
+    }
+    return result == FLASH_RESULT_BLANK;
+}
@@ -0,0 +1,42 @@
+#ifndef DATA_FLASH_H
+#define DATA_FLASH_H
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+
+// The RA4M1's 8 KB data flash, through the FSP low-power flash driver (the
+// same one the core's EEPROM library uses). Offsets are relative to the start
+// of data flash. Erase works on 1 KB blocks; erased cells do not read back as
+// a defined value, so use isBlank() rather than comparing with 0xFF.
+// Blocking; operations from different tasks are serialised by a mutex.
+class DataFlash {
+public:
+    static const uint32_t BASE = 0x40100000;
+    static const uint32_t SIZE = 8192;
+    static const uint32_t BLOCK_SIZE = 1024;
+    static const uint32_t WRITE_UNIT = 4;   // Writes are padded out to this by callers
+
+    // Partition map, in blocks
+    static const uint32_t CRASH_JOURNAL_OFFSET = 0;             // 1 block
+    static const uint32_t CONFIG_STORE_OFFSET = 1 * BLOCK_SIZE; // CONFIG_STORE_BLOCKS blocks
+    static const uint32_t CONFIG_STORE_BLOCKS = 7;
+
+    static bool begin();
+    static bool read(uint32_t offset, void* data, size_t length);
+    static bool write(uint32_t offset, const void* data, size_t length);
+    static bool erase(uint32_t offset, uint32_t blocks);
+    static bool isBlank(uint32_t offset, size_t length);
+
+    // task is inside an operation, holding the lock
+    static bool heldBy(TaskHandle_t task) { return task && owner == task; }
+
+private:
+    static bool opened;
+    static SemaphoreHandle_t mutex;
+    static TaskHandle_t volatile owner;
+
+    friend class FlashLock;
+    static bool inRange(uint32_t offset, size_t length) { return offset <= SIZE && length <= SIZE - offset; }
+};
+
+#endif
@@ -1,4 +1,11 @@
 #include "display_manager.h"
+#include "profiler.h"
+
+// Push the frame buffer to the SSD1306 over I2C
+void DisplayManager::flushOled() {
+    PROFILE_SCOPE(ProbeId::OLED_DISPLAY);
+    oled.display();
+}
 
 // Display message on OLED
 void DisplayManager::displayMessage(const char* message) {
@@ -14,7 +21,7 @@ void DisplayManager::displayMessage(const char* message) {
         oled.setTextColor(SSD1306_WHITE);
         oled.setCursor(0,0);
         oled.println(message);
-        oled.display();
+        flushOled();
     }
 }
 
@@ -75,7 +82,7 @@ void DisplayManager::clearMessage() {
 
     if (oledInitialized) {
         oled.clearDisplay();
-        oled.display();
+        flushOled();
     }
 }
 
@@ -30,6 +30,8 @@ private:
     static const unsigned long ERROR_DISPLAY_TIME = 5000;    // 5 seconds
     static const unsigned long CO2_DISPLAY_TIME = 10000;    // 10 seconds
 
+    void flushOled();
+
 public:
     DisplayManager(ArduinoLEDMatrix& ledMatrix, int speed = 150) 
         : matrix(ledMatrix), 
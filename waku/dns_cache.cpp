@@ -0,0 +1,120 @@
+#include "dns_cache.h"
+#include "log.h"
+
+DnsCache::Entry DnsCache::entries[MAX_HOSTS];
+uint8_t DnsCache::entryCount = 0;
+uint32_t DnsCache::lookups = 0;
+uint32_t DnsCache::failures = 0;
+uint32_t DnsCache::fallbacks = 0;
+uint32_t DnsCache::lookupMillis = 0;
+
+DnsCache::Entry* DnsCache::find(const char* host) {
+    for (uint8_t i = 0; i < entryCount; i++) {
+        if (entries[i].host == host || strcmp(entries[i].host, host) == 0) {
+            return &entries[i];
+        }
+    }
+    if (entryCount == MAX_HOSTS) {
+        return nullptr;
+    }
+
+    Entry& entry = entries[entryCount++];
+    entry = Entry{host, IPAddress(), false, false, false, false, 0, 0};
+    entry.literal = entry.address.fromString(host);
+    entry.valid = entry.literal;
+    return &entry;
+}
+
+bool DnsCache::lookup(Entry& entry) {
+    IPAddress address;
+    uint32_t start = millis();
+    bool ok = WiFi.hostByName(entry.host, address) == 1 && static_cast<uint32_t>(address) != 0;
+    lookupMillis += millis() - start;
+    lookups++;
+    entry.checkedAt = millis();
+    entry.lastFailed = !ok;
+
+    if (!ok) {
+        failures++;
+        fallbacks += entry.valid;
+        LOG(DNS_LOOKUP_FAILED, entry.valid ? static_cast<int32_t>((millis() - entry.resolvedAt) / 1000) : -1);
+        return false;
+    }
+    entry.address = address;
+    entry.valid = true;
+    entry.suspect = false;
+    entry.resolvedAt = entry.checkedAt;
+    return true;
+}
+
+bool DnsCache::resolve(const char* host, IPAddress& address, uint32_t& lookupTime) {
+    lookupTime = 0;
+    Entry* entry = find(host);
+    if (!entry) {
+        // More hosts than slots: uncached
+        uint32_t start = millis();
+        bool ok = WiFi.hostByName(host, address) == 1;
+        lookupTime = millis() - start;
+        return ok;
+    }
+
+    if (!entry->literal && (!entry->valid || entry->suspect)) {
+        uint32_t start = millis();
+        lookup(*entry);
+        lookupTime = millis() - start;
+    }
+    address = entry->address;
+    return entry->valid;
+}
+
+void DnsCache::reportFailure(const char* host) {
+    Entry* entry = find(host);
+    if (entry && !entry->literal) {
+        entry->suspect = true;
+    }
+}
+
+void DnsCache::refresh() {
+    for (uint8_t i = 0; i < entryCount; i++) {
+        Entry& entry = entries[i];
+        if (entry.literal || !entry.valid) {
+            // Never resolved: resolve() looks it up when it is needed
+            continue;
+        }
+        uint32_t interval = entry.lastFailed ? RETRY_INTERVAL : TTL;
+        if (millis() - entry.checkedAt >= interval && WiFi.status() == WL_CONNECTED) {
+            lookup(entry);
+        }
+    }
+}
+
+void DnsCache::printReport(const char* args) {
+    for (uint8_t i = 0; i < entryCount; i++) {
+        const Entry& entry = entries[i];
+        Serial.print(entry.host);
+        Serial.print(": ");
+        if (!entry.valid) {
+            Serial.println("unresolved");
+            continue;
+        }
+        Serial.print(entry.address[0]);
+        for (uint8_t octet = 1; octet < 4; octet++) {
+            Serial.print('.');
+            Serial.print(entry.address[octet]);
+        }
+        if (entry.literal) {
+            Serial.println();
+            continue;
+        }
+        Serial.print(", ");
+        Serial.print((millis() - entry.resolvedAt) / 1000);
+        Serial.print(" s old");
+        Serial.println(entry.suspect ? ", connect failed" : entry.lastFailed ? ", last lookup failed" : "");
+    }
+
+    char line[88];      // 81 characters with 10-digit counters
+    snprintf(line, sizeof(line), "Lookups: %lu (%lu ms each), %lu failed, %lu fallbacks",
+             static_cast<unsigned long>(lookups), static_cast<unsigned long>(lookups ? lookupMillis / lookups : 0),
+             static_cast<unsigned long>(failures), static_cast<unsigned long>(fallbacks));
+    Serial.println(line);
+}
@@ -0,0 +1,70 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <Arduino.h>
+#include <WiFiS3.h>
+
+// Resolved addresses of the hosts the device talks to (the home server and
+// the SNTP server). A name is looked up through the WiFi module once; after
+// that requests connect to the cached address, and refresh() looks it up
+// again from the network task's housekeeping when its TTL runs out. A
+// failed lookup keeps the last good address, so a DNS hiccup on the router
+// no longer takes the server away. WiFiS3 does not report the record's TTL,
+// so a fixed one is used.
+//
+// Network task only.
+class DnsCache {
+public:
+    // Address for host. Cached if there is one and no connect to it has
+    // failed since; otherwise looked up now (lookupTime is the time that
+    // took, 0 from the cache). IP literals are parsed, never looked up.
+    // False only if there is no address at all.
+    static bool resolve(const char* host, IPAddress& address, uint32_t& lookupTime);
+
+    // A connect to the cached address failed: look it up again on the next
+    // resolve(), keeping the address in case the lookup fails too
+    static void reportFailure(const char* host);
+
+    // Network task housekeeping, holding wifiMutex: look up entries past
+    // their TTL while WiFi is connected
+    static void refresh();
+
+    // Console handler: cached addresses, their age and lookup counts
+    static void printReport(const char* args);
+
+    // Bytes of static storage, for ram_budget.h
+    static constexpr size_t staticBytes();
+
+private:
+    struct Entry {
+        const char* host;
+        IPAddress address;
+        bool valid;             // address holds a good lookup
+        bool literal;           // host is an IP address
+        bool suspect;           // A connect to address failed
+        bool lastFailed;        // The last lookup failed
+        uint32_t checkedAt;     // millis() of the last lookup
+        uint32_t resolvedAt;    // millis() of the last good one
+    };
+
+    static const uint8_t MAX_HOSTS = 2;
+    static const uint32_t TTL = 600000UL;           // ms
+    static const uint32_t RETRY_INTERVAL = 30000UL; // ms after a failed lookup
+
+    static Entry entries[MAX_HOSTS];
+    static uint8_t entryCount;
+    static uint32_t lookups;
+    static uint32_t failures;
+    static uint32_t fallbacks;      // Failed lookups that kept the last good address
+    static uint32_t lookupMillis;   // Total time in WiFi.hostByName()
+
+    static Entry* find(const char* host);
+    static bool lookup(Entry& entry);
+};
+
+constexpr size_t DnsCache::staticBytes() {
+    return sizeof(entries) + sizeof(entryCount) + sizeof(lookups) + sizeof(failures) + sizeof(fallbacks)
+         + sizeof(lookupMillis);
+}
+
+#endif
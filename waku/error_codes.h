@@ -16,7 +16,9 @@ enum class ErrorCode {
     JSON_PARSE_ERROR = 11,
     INVALID_TIME_FORMAT = 12,
     SENSOR_READ_ERROR = 13,
-    TASK_INIT_FAILED = 14
+    TASK_INIT_FAILED = 14,
+    INVALID_MELODY_FORMAT = 15,
+    INVALID_TIMEZONE = 16
 };
 
 // Convert enum to string for display and logging
@@ -37,6 +39,8 @@ inline const char* getErrorString(ErrorCode code) {
         case ErrorCode::INVALID_TIME_FORMAT: return "INVALID_TIME_FORMAT";
         case ErrorCode::SENSOR_READ_ERROR: return "SENSOR_READ_ERROR";
         case ErrorCode::TASK_INIT_FAILED: return "TASK_INIT_FAILED";
+        case ErrorCode::INVALID_MELODY_FORMAT: return "INVALID_MELODY_FORMAT";
+        case ErrorCode::INVALID_TIMEZONE: return "INVALID_TIMEZONE";
         default: return "UNKNOWN_ERROR";
     }
 }
@@ -1,7 +1,8 @@
 #include "global_variables.h"
+#include "build_config.h"
 
 // Recovery settings
-const unsigned long WATCHDOG_TIMEOUT = 8000;  // 8 seconds
+const unsigned long WATCHDOG_TIMEOUT = 5000;  // 5 seconds; the RA4M1 WDT tops out at ~5.6 s
 const int MAX_RECOVERY_ATTEMPTS = 3;
 const unsigned long RECOVERY_DELAY = 10000;   // 10 seconds between recovery attempts
 bool systemInitialized = false;
@@ -9,14 +10,35 @@ bool systemInitialized = false;
 // Server settings
 const char* server_host = SERVER_HOST;
 const int server_port = SERVER_PORT;
+#if WAKU_USE_TLS
+#ifndef SERVER_CA_CERT
+#error "WAKU_USE_TLS needs the server's certificate as SERVER_CA_CERT in arduino_secrets.h"
+#endif
+const char* server_ca_cert = SERVER_CA_CERT;
+#else
+const char* server_ca_cert = nullptr;
+#endif
+
+// SNTP: the home server unless arduino_secrets.h names another (e.g.
+// "pool.ntp.org"); tools/sntp_standin.py answers if it runs no NTP daemon
+#ifdef SNTP_HOST
+const char* sntp_host = SNTP_HOST;
+#else
+const char* sntp_host = SERVER_HOST;
+#endif
+const int sntp_port = 123;
 
 // Pin definitions
 const int BUZZER_PIN = 12;
 const int BUZZER_OVERDRIVE_PIN = 6; // For future applications. Not used for now.
-const int PIR_PIN = A2; // MH-Z19B CO2 sensor
+const int PIR_PIN = A2; // PIR motion sensor, used for missed-wake detection
 const int LED_PINS[] = {9, 10, 11};
 const int CO2_PWM_PIN = 2;
-const int MAX9814_PIN = A0; // Not used for now
+#if WAKU_SYNTH_ENABLED
+const int MAX9814_PIN = A1; // A0 carries the synthesizer DAC output
+#else
+const int MAX9814_PIN = A0; // Sound level and missed-wake detection
+#endif
 const int BUTTON_PIN = 3;
 
 const int LED_PIN_COUNT = sizeof(LED_PINS) / sizeof(LED_PINS[0]);
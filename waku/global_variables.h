@@ -6,7 +6,7 @@
 #include "arduino_secrets.h"
 
 // Recovery settings
-extern const unsigned long WATCHDOG_TIMEOUT;  // 8 seconds
+extern const unsigned long WATCHDOG_TIMEOUT;  // 5 seconds
 extern const int MAX_RECOVERY_ATTEMPTS;
 extern const unsigned long RECOVERY_DELAY;   // 10 seconds between recovery attempts
 extern bool systemInitialized;
@@ -14,6 +14,9 @@ extern bool systemInitialized;
 // Server settings
 extern const char* server_host;
 extern const int server_port;
+extern const char* server_ca_cert;
+extern const char* sntp_host;
+extern const int sntp_port;
 
 // Pin definitions
 extern const int BUZZER_PIN;
@@ -0,0 +1,96 @@
+#ifndef HEATSHRINK_DECODER_H
+#define HEATSHRINK_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Streaming decoder for heatshrink's LZSS format, as written by
+// `heatshrink -e -w 8 -l 4` (and tools/server_standin.py --firmware).
+// The stream is a sequence of MSB-first bit fields:
+//   1, 8-bit byte                     a literal
+//   0, index (W bits), count (L bits) copy count + 1 bytes from index + 1 back
+// The window is the last 2^W bytes of output, so decoding needs 256 bytes of
+// RAM whatever the image size. Padding bits after the last field are ignored
+// by stopping at the known output size.
+class HeatshrinkDecoder {
+public:
+    static const uint8_t WINDOW_BITS = 8;
+    static const uint8_t LOOKAHEAD_BITS = 4;
+    static const uint8_t MAX_OUTPUT = 1 << LOOKAHEAD_BITS;     // Per input byte
+
+    void reset() {
+        memset(window, 0, sizeof(window));
+        head = 0;
+        state = State::TAG;
+        bits = 0;
+        bitCount = 0;
+        index = 0;
+    }
+
+    // Decode one input byte into out (room for MAX_OUTPUT bytes): a field is
+    // at least 9 bits long, so one byte completes at most one of them.
+    // Returns the number of bytes written.
+    uint8_t feed(uint8_t input, uint8_t* out) {
+        uint8_t produced = 0;
+        for (uint8_t mask = 0x80; mask; mask >>= 1) {
+            bits = (bits << 1) | ((input & mask) ? 1 : 0);
+            bitCount++;
+            switch (state) {
+                case State::TAG:
+                    state = bits ? State::LITERAL : State::INDEX;
+                    startField();
+                    break;
+                case State::LITERAL:
+                    if (bitCount == 8) {
+                        out[produced++] = emit(static_cast<uint8_t>(bits));
+                        state = State::TAG;
+                        startField();
+                    }
+                    break;
+                case State::INDEX:
+                    if (bitCount == WINDOW_BITS) {
+                        index = bits + 1;
+                        state = State::COUNT;
+                        startField();
+                    }
+                    break;
+                case State::COUNT:
+                    if (bitCount == LOOKAHEAD_BITS) {
+                        for (uint16_t i = 0; i <= bits; i++) {
+                            out[produced++] = emit(window[(head - index) & WINDOW_MASK]);
+                        }
+                        state = State::TAG;
+                        startField();
+                    }
+                    break;
+            }
+        }
+        return produced;
+    }
+
+private:
+    enum class State : uint8_t { TAG, LITERAL, INDEX, COUNT };
+
+    static const uint16_t WINDOW_MASK = (1 << WINDOW_BITS) - 1;
+
+    uint8_t window[1 << WINDOW_BITS];
+    uint16_t head;          // Bytes output, modulo the window
+    State state;
+    uint16_t bits;          // Of the field being read
+    uint8_t bitCount;
+    uint16_t index;         // Distance back of the reference being read
+
+    void startField() {
+        bits = 0;
+        bitCount = 0;
+    }
+
+    uint8_t emit(uint8_t byte) {
+        window[head & WINDOW_MASK] = byte;
+        head++;
+        return byte;
+    }
+};
+
+#endif
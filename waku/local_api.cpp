@@ -0,0 +1,463 @@
+#include "local_api.h"
+#include <stdarg.h>
+#include "alarm.h"
+#include "co2_sensor.h"
+#include "clock_sync.h"
+#include "config_store.h"
+
+enum class AlarmPhase : uint8_t {
+    OFF,        // Disarmed
+    IDLE,       // Armed, outside the wake window
+    WAKING,     // Wake-up protocol or missed-wake escalation running
+    STOPPED,    // Stopped today
+    COUNT
+};
+
+static const char* const PHASE_NAMES[] = {"off", "idle", "waking", "stopped"};
+
+static_assert(sizeof(PHASE_NAMES) / sizeof(PHASE_NAMES[0]) == static_cast<uint8_t>(AlarmPhase::COUNT), "Name every alarm phase");
+
+// Families of /metrics, in output order
+enum class Metric : uint8_t {
+    CO2,
+    ALARM_PHASE,
+    WAKE_MINUTES,
+    CLOCK_SYNCED,
+    UPTIME,
+    TASK_JITTER_MEAN,
+    TASK_JITTER_MAX,
+    TASK_BUSY,
+    STACK_FREE,
+    HEAP_FREE,
+    HEAP_MIN_FREE,
+    HEAP_FRAGMENTATION,
+    NET_CONNECTS,
+    NET_REQUESTS,
+    NET_DEVICE_UPDATES,
+    NET_CONFIG_PUSHES,
+    NET_NOT_MODIFIED,
+    NET_SENT,
+    NET_RECEIVED,
+    API_REQUESTS,
+    COUNT
+};
+
+struct MetricInfo {
+    const char* name;
+    const char* type;
+    const char* label;      // Label of a family with several samples
+    const char* help;
+};
+
+static const MetricInfo METRICS[] = {
+    {"waku_co2_ppm", "gauge", nullptr, "CO2 concentration, calibrated"},
+    {"waku_alarm_phase", "gauge", "phase", "Alarm phase, 1 for the current one"},
+    {"waku_alarm_wake_minutes", "gauge", nullptr, "Wake-up time in minutes after midnight"},
+    {"waku_clock_synced", "gauge", nullptr, "Clock set from the network since boot"},
+    {"waku_uptime_seconds", "counter", nullptr, "Time since reset"},
+    {"waku_task_jitter_mean_microseconds", "gauge", "task", "Mean wake-up lateness since boot"},
+    {"waku_task_jitter_max_microseconds", "gauge", "task", "Worst wake-up lateness since boot"},
+    {"waku_task_busy_permille", "gauge", "task", "Share of the last 15 s window spent in the task body"},
+    {"waku_stack_free_words", "gauge", "task", "Lowest free stack seen since the task started"},
+    {"waku_heap_free_bytes", "gauge", nullptr, "Free heap, holes included"},
+    {"waku_heap_min_free_bytes", "gauge", nullptr, "Lowest free heap seen since boot"},
+    {"waku_heap_fragmentation_percent", "gauge", nullptr, "Share of free heap stuck in holes"},
+    {"waku_net_connects_total", "counter", nullptr, "Connects to the home server (TLS handshakes with TLS)"},
+    {"waku_net_requests_total", "counter", nullptr, "Requests sent to the home server"},
+    {"waku_net_device_updates_total", "counter", nullptr, "Device updates sent"},
+    {"waku_net_config_pushes_total", "counter", nullptr, "Config long-polls answered with a new configuration"},
+    {"waku_net_not_modified_total", "counter", nullptr, "Device update responses skipped as not modified"},
+    {"waku_net_sent_bytes_total", "counter", nullptr, "HTTP bytes sent to the home server"},
+    {"waku_net_received_bytes_total", "counter", nullptr, "HTTP bytes received from the home server"},
+    {"waku_api_requests_total", "counter", nullptr, "Requests answered by this endpoint"},
+};
+
+static_assert(sizeof(METRICS) / sizeof(METRICS[0]) == static_cast<uint8_t>(Metric::COUNT), "Describe every metric");
+
+WiFiServer LocalApi::server(WAKU_LOCAL_API_PORT);
+WiFiClient LocalApi::client;
+bool LocalApi::listening = false;
+LocalApi::Stage LocalApi::stage = LocalApi::Stage::IDLE;
+LocalApi::Route LocalApi::route = LocalApi::Route::NOT_FOUND;
+uint8_t LocalApi::item = 0;
+uint8_t LocalApi::sample = 0;
+uint32_t LocalApi::startedAt = 0;
+char LocalApi::request[REQUEST_LINE_SIZE];
+uint8_t LocalApi::requestLength = 0;
+char LocalApi::buffer[BUFFER_SIZE];
+LocalApi::Snapshot LocalApi::snapshot = {};
+uint32_t LocalApi::requests = 0;
+uint32_t LocalApi::dropped = 0;
+uint32_t LocalApi::longestMillis = 0;
+
+// vsnprintf onto what is already in out, counting on past the end the way
+// snprintf does, so the caller can tell the item did not fit
+static void append(char* out, size_t size, int& length, const char* format, ...) {
+    size_t used = static_cast<size_t>(length) < size ? length : size;
+    va_list args;
+    va_start(args, format);
+    length += vsnprintf(out + used, size - used, format, args);
+    va_end(args);
+}
+
+void LocalApi::begin() {
+    if (stage != Stage::IDLE) {
+        client.stop();
+        stage = Stage::IDLE;
+        dropped++;
+    }
+    server.begin();
+    listening = true;
+}
+
+void LocalApi::poll(Alarm* alarm, CO2Sensor* co2) {
+    if (!listening) {
+        return;
+    }
+    if (stage == Stage::IDLE) {
+        WiFiClient next = server.available();
+        if (!next) {
+            return;
+        }
+        client = next;
+        stage = Stage::READING;
+        requestLength = 0;
+        startedAt = millis();
+    }
+
+    if (stage == Stage::READING) {
+        if (!readRequestLine()) {
+            if (millis() - startedAt >= REQUEST_TIMEOUT || !client.connected()) {
+                finish(false);
+            }
+            return;
+        }
+        routeRequest();
+        if (route == Route::METRICS || route == Route::STATE) {
+            takeSnapshot(alarm, co2);
+        }
+        item = 0;
+        sample = 0;
+        stage = Stage::SENDING;
+    }
+
+    if (millis() - startedAt >= RESPONSE_TIMEOUT) {
+        finish(false);
+        return;
+    }
+    send();
+}
+
+// True once the whole first line is in. Headers and body are not needed:
+// whatever of them has arrived is read and dropped.
+bool LocalApi::readRequestLine() {
+    bool complete = false;
+    while (!complete && client.available()) {
+        int c = client.read();
+        if (c == '\n') {
+            complete = true;
+        } else if (c >= 0 && c != '\r' && requestLength < REQUEST_LINE_SIZE - 1) {
+            request[requestLength++] = static_cast<char>(c);
+        }
+    }
+    request[requestLength] = '\0';
+    if (complete) {
+        while (client.available()) {
+            client.read(reinterpret_cast<uint8_t*>(buffer), sizeof(buffer));
+        }
+    }
+    return complete;
+}
+
+void LocalApi::routeRequest() {
+    if (strncmp(request, "GET ", 4) != 0) {
+        route = Route::BAD_METHOD;
+        return;
+    }
+    const char* path = request + 4;
+    size_t length = strcspn(path, " ?");
+    if (length == 8 && strncmp(path, "/metrics", length) == 0) {
+        route = Route::METRICS;
+    } else if (length == 6 && strncmp(path, "/state", length) == 0) {
+        route = Route::STATE;
+    } else {
+        route = Route::NOT_FOUND;
+    }
+}
+
+void LocalApi::takeSnapshot(Alarm* alarm, CO2Sensor* co2) {
+    SensorCalibration calibration = {};
+    ConfigStore::get(ConfigKey::CALIBRATION, calibration);
+    int reading = co2 ? co2->readPWM() : -1;
+    snapshot.co2 = reading >= 0 ? reading + calibration.co2OffsetPpm : -1;
+
+    snapshot.uptimeSeconds = millis() / 1000;
+    snapshot.unixTime = static_cast<uint32_t>(ClockSync::nowMillis() / 1000);
+    snapshot.synced = ClockSync::isSynced();
+
+    snapshot.schedule = alarm ? alarm->getSchedule() : AlarmSchedule{};
+    snapshot.triggered = alarm && alarm->isTriggered();
+    AlarmPhase phase = AlarmPhase::OFF;
+    if (snapshot.triggered) {
+        phase = AlarmPhase::STOPPED;
+    } else if (alarm && alarm->isNearWakeWindow(0)) {
+        phase = AlarmPhase::WAKING;
+    } else if (snapshot.schedule.armed) {
+        phase = AlarmPhase::IDLE;
+    }
+    snapshot.phase = static_cast<uint8_t>(phase);
+
+    for (uint8_t i = 0; i < static_cast<uint8_t>(TaskId::COUNT); i++) {
+        TaskRunStats stats = TaskStats::get(static_cast<TaskId>(i));
+        snapshot.tasks[i].jitterMeanMicros = stats.jitter.meanMicros();
+        snapshot.tasks[i].jitterMaxMicros = stats.jitter.maxMicros;
+        snapshot.tasks[i].busyPermille = stats.busyPermille;
+    }
+    MemoryMonitor::sample();
+    snapshot.memory = MemoryMonitor::getLastStats();
+    snapshot.net = ServerClient::getUpkeep();
+    snapshot.requests = requests;
+}
+
+// Fill the buffer with as many items as fit, write it out, and go on until
+// the response is done or this poll's slice is used up
+void LocalApi::send() {
+    uint32_t start = millis();
+    size_t used = 0;
+    bool done = false;
+    for (;;) {
+        int length = renderItem(buffer + used, sizeof(buffer) - used);
+        if (length < 0) {
+            done = true;
+            break;
+        }
+        // snprintf needs room for the terminator as well
+        if (used + length < sizeof(buffer)) {
+            used += length;
+            advance();
+            continue;
+        }
+        if (used == 0) {
+            // Longer than the whole buffer: send what fitted
+            used = sizeof(buffer) - 1;
+            advance();
+        }
+        if (client.write(reinterpret_cast<const uint8_t*>(buffer), used) != used) {
+            finish(false);
+            return;
+        }
+        used = 0;
+        if (millis() - start >= SEND_SLICE) {
+            return;
+        }
+    }
+    if (used && client.write(reinterpret_cast<const uint8_t*>(buffer), used) != used) {
+        finish(false);
+        return;
+    }
+    if (done) {
+        finish(true);
+    }
+}
+
+void LocalApi::finish(bool complete) {
+    client.stop();
+    stage = Stage::IDLE;
+    if (!complete) {
+        dropped++;
+        return;
+    }
+    requests++;
+    uint32_t elapsed = millis() - startedAt;
+    if (elapsed > longestMillis) {
+        longestMillis = elapsed;
+    }
+}
+
+// Render the current item into out; its length (which may exceed size, as
+// with snprintf), or -1 past the last one
+int LocalApi::renderItem(char* out, size_t size) {
+    if (item == 0) {
+        return renderHeader(out, size);
+    }
+    switch (route) {
+        case Route::METRICS:
+            return renderMetric(out, size);
+        case Route::STATE:
+            return renderState(out, size);
+        case Route::NOT_FOUND:
+            return item == 1 ? snprintf(out, size, "Not found\n") : -1;
+        default:
+            return item == 1 ? snprintf(out, size, "Only GET\n") : -1;
+    }
+}
+
+int LocalApi::renderHeader(char* out, size_t size) {
+    const char* status = "200 OK";
+    const char* type = "text/plain; charset=utf-8";
+    if (route == Route::METRICS) {
+        type = "text/plain; version=0.0.4";
+    } else if (route == Route::STATE) {
+        type = "application/json";
+    } else if (route == Route::NOT_FOUND) {
+        status = "404 Not Found";
+    } else {
+        status = "405 Method Not Allowed";
+    }
+    // No Content-Length: the response is streamed and ends with the connection
+    return snprintf(out, size, "HTTP/1.1 %s\r\nContent-Type: %s\r\nConnection: close\r\n\r\n", status, type);
+}
+
+// One sample of family item - 1, led by the family's HELP and TYPE lines
+int LocalApi::renderMetric(char* out, size_t size) {
+    while (item - 1 < static_cast<uint8_t>(Metric::COUNT) &&
+           sampleCount(item - 1) == 0) {
+        item++;
+    }
+    if (item - 1 >= static_cast<uint8_t>(Metric::COUNT)) {
+        return -1;
+    }
+
+    const MetricInfo& info = METRICS[item - 1];
+    int length = 0;
+    if (sample == 0) {
+        append(out, size, length, "# HELP %s %s\n# TYPE %s %s\n", info.name, info.help, info.name, info.type);
+    }
+    const char* label = nullptr;
+    uint32_t value = sampleValue(item - 1, sample, label);
+    if (info.label) {
+        append(out, size, length, "%s{%s=\"%s\"} %lu\n", info.name, info.label, label, static_cast<unsigned long>(value));
+    } else {
+        append(out, size, length, "%s %lu\n", info.name, static_cast<unsigned long>(value));
+    }
+    return length;
+}
+
+// /state: one object, a group of fields per item
+int LocalApi::renderState(char* out, size_t size) {
+    const Snapshot& s = snapshot;
+    int length = 0;
+    switch (item) {
+        case 1:
+            append(out, size, length, "{\"time\":%lu,\"synced\":%s,\"uptime\":%lu,",
+                   static_cast<unsigned long>(s.unixTime), s.synced ? "true" : "false",
+                   static_cast<unsigned long>(s.uptimeSeconds));
+            if (s.co2 >= 0) {
+                append(out, size, length, "\"co2\":%ld,", static_cast<long>(s.co2));
+            } else {
+                append(out, size, length, "\"co2\":null,");
+            }
+            return length;
+        case 2:
+            return snprintf(out, size, "\"alarm\":{\"wake\":\"%02u:%02u\",\"armed\":%s,\"phase\":\"%s\",\"triggered\":%s},",
+                            s.schedule.wakeHour, s.schedule.wakeMinute, s.schedule.armed ? "true" : "false",
+                            PHASE_NAMES[s.phase], s.triggered ? "true" : "false");
+        case 3:
+            append(out, size, length, "\"tasks\":{");
+            for (uint8_t i = 0; i < static_cast<uint8_t>(TaskId::COUNT); i++) {
+                append(out, size, length, "%s\"%s\":[%lu,%lu,%u]", i ? "," : "", TaskStats::name(static_cast<TaskId>(i)),
+                       static_cast<unsigned long>(s.tasks[i].jitterMeanMicros),
+                       static_cast<unsigned long>(s.tasks[i].jitterMaxMicros), s.tasks[i].busyPermille);
+            }
+            append(out, size, length, "},");
+            return length;
+        case 4:
+            append(out, size, length, "\"stacks\":{");
+            for (uint8_t i = 0; s.memory.valid && i < s.memory.taskCount; i++) {
+                append(out, size, length, "%s\"%s\":%u", i ? "," : "", s.memory.stacks[i].name,
+                       s.memory.stacks[i].freeWords);
+            }
+            append(out, size, length, "},\"heap\":[%lu,%lu,%u],",
+                   static_cast<unsigned long>(s.memory.heapFree), static_cast<unsigned long>(s.memory.heapMinFree),
+                   s.memory.heapFragmentationPercent);
+            return length;
+        case 5:
+            return snprintf(out, size, "\"net\":{\"connects\":%lu,\"requests\":%lu,\"updates\":%lu,\"pushes\":%lu,"
+                            "\"not_modified\":%lu,\"tx\":%lu,\"rx\":%lu}}\n",
+                            static_cast<unsigned long>(s.net.connects), static_cast<unsigned long>(s.net.requests),
+                            static_cast<unsigned long>(s.net.deviceUpdates), static_cast<unsigned long>(s.net.configPushes),
+                            static_cast<unsigned long>(s.net.notModified), static_cast<unsigned long>(s.net.txBytes),
+                            static_cast<unsigned long>(s.net.rxBytes));
+        default:
+            return -1;
+    }
+}
+
+void LocalApi::advance() {
+    if (route == Route::METRICS && item > 0) {
+        sample++;
+        if (sample < sampleCount(item - 1)) {
+            return;
+        }
+        sample = 0;
+    }
+    item++;
+}
+
+uint8_t LocalApi::sampleCount(uint8_t family) {
+    switch (static_cast<Metric>(family)) {
+        case Metric::CO2:
+            return snapshot.co2 >= 0;
+        case Metric::ALARM_PHASE:
+            return static_cast<uint8_t>(AlarmPhase::COUNT);
+        case Metric::TASK_JITTER_MEAN:
+        case Metric::TASK_JITTER_MAX:
+        case Metric::TASK_BUSY:
+            return static_cast<uint8_t>(TaskId::COUNT);
+        case Metric::STACK_FREE:
+            return snapshot.memory.valid ? snapshot.memory.taskCount : 0;
+        case Metric::HEAP_FREE:
+        case Metric::HEAP_MIN_FREE:
+        case Metric::HEAP_FRAGMENTATION:
+            return snapshot.memory.valid;
+        default:
+            return 1;
+    }
+}
+
+uint32_t LocalApi::sampleValue(uint8_t family, uint8_t sample, const char*& label) {
+    const NetUpkeep& net = snapshot.net;
+    switch (static_cast<Metric>(family)) {
+        case Metric::CO2:                   return snapshot.co2;
+        case Metric::ALARM_PHASE:
+            label = PHASE_NAMES[sample];
+            return sample == snapshot.phase;
+        case Metric::WAKE_MINUTES:          return snapshot.schedule.wakeMinutes();
+        case Metric::CLOCK_SYNCED:          return snapshot.synced;
+        case Metric::UPTIME:                return snapshot.uptimeSeconds;
+        case Metric::TASK_JITTER_MEAN:
+            label = TaskStats::name(static_cast<TaskId>(sample));
+            return snapshot.tasks[sample].jitterMeanMicros;
+        case Metric::TASK_JITTER_MAX:
+            label = TaskStats::name(static_cast<TaskId>(sample));
+            return snapshot.tasks[sample].jitterMaxMicros;
+        case Metric::TASK_BUSY:
+            label = TaskStats::name(static_cast<TaskId>(sample));
+            return snapshot.tasks[sample].busyPermille;
+        case Metric::STACK_FREE:
+            label = snapshot.memory.stacks[sample].name;
+            return snapshot.memory.stacks[sample].freeWords;
+        case Metric::HEAP_FREE:             return snapshot.memory.heapFree;
+        case Metric::HEAP_MIN_FREE:         return snapshot.memory.heapMinFree;
+        case Metric::HEAP_FRAGMENTATION:    return snapshot.memory.heapFragmentationPercent;
+        case Metric::NET_CONNECTS:          return net.connects;
+        case Metric::NET_REQUESTS:          return net.requests;
+        case Metric::NET_DEVICE_UPDATES:    return net.deviceUpdates;
+        case Metric::NET_CONFIG_PUSHES:     return net.configPushes;
+        case Metric::NET_NOT_MODIFIED:      return net.notModified;
+        case Metric::NET_SENT:              return net.txBytes;
+        case Metric::NET_RECEIVED:          return net.rxBytes;
+        default:                            return snapshot.requests;
+    }
+}
+
+void LocalApi::printReport(const char* args) {
+    char line[80];
+    snprintf(line, sizeof(line), "Port %u: %s", WAKU_LOCAL_API_PORT,
+             !listening ? "not listening yet" : stage == Stage::IDLE ? "listening" : "serving a client");
+    Serial.println(line);
+    snprintf(line, sizeof(line), "Requests: %lu answered (longest %lu ms), %lu dropped",
+             static_cast<unsigned long>(requests), static_cast<unsigned long>(longestMillis),
+             static_cast<unsigned long>(dropped));
+    Serial.println(line);
+}
@@ -0,0 +1,113 @@
+#ifndef LOCAL_API_H
+#define LOCAL_API_H
+
+#include <Arduino.h>
+#include <WiFiS3.h>
+#include "build_config.h"
+#include "alarm_config.h"
+#include "memory_monitor.h"
+#include "server_client.h"
+#include "task_stats.h"
+
+class Alarm;
+class CO2Sensor;
+
+// Small HTTP endpoint on the device for the home network:
+//   GET /metrics  Prometheus text: CO2, alarm phase, task jitter, stack and
+//                 heap high-water marks, server connection counters
+//   GET /state    The same state as one JSON object
+//
+// One client at a time. poll() never waits on the socket: it reads what has
+// arrived of the request line, or sends the next part of the response, and
+// returns. A response is rendered item by item (one sample with its HELP and
+// TYPE lines, one group of JSON fields) into a fixed buffer that is written
+// out whenever the next item does not fit, so nothing is allocated and a
+// scrape of any size needs only the buffer. Values come from a snapshot
+// taken when the request line arrives, so a response sent over several
+// polls is consistent.
+//
+// Network task only, holding wifiMutex.
+class LocalApi {
+public:
+    // (Re)start listening; after every WiFi join, as WiFi.end() and a lost
+    // link take the listening socket with them
+    static void begin();
+
+    // Between network cycles: accept a client, read its request or send the
+    // next part of the response
+    static void poll(Alarm* alarm, CO2Sensor* co2);
+
+    // Console handler: port and requests served
+    static void printReport(const char* args);
+
+    // Bytes of static storage, for ram_budget.h. Buffers the WiFi library
+    // allocates for an open connection are not counted.
+    static constexpr size_t staticBytes();
+
+private:
+    enum class Stage : uint8_t { IDLE, READING, SENDING };
+    enum class Route : uint8_t { METRICS, STATE, NOT_FOUND, BAD_METHOD };
+
+    // What a response reports, copied when its request arrives
+    struct Snapshot {
+        int32_t co2;                // ppm, calibrated; -1 without a reading
+        uint32_t uptimeSeconds;
+        uint32_t unixTime;
+        bool synced;
+        uint8_t phase;              // AlarmPhase in local_api.cpp
+        AlarmSchedule schedule;
+        bool triggered;
+        struct {
+            uint32_t jitterMeanMicros;
+            uint32_t jitterMaxMicros;
+            uint16_t busyPermille;
+        } tasks[static_cast<uint8_t>(TaskId::COUNT)];
+        MemoryStats memory;
+        NetUpkeep net;
+        uint32_t requests;
+    };
+
+    static const size_t BUFFER_SIZE = 192;              // Longest item: a sample with its HELP and TYPE lines
+    static const size_t REQUEST_LINE_SIZE = 48;         // Kept of the request line; the rest is dropped
+    static const uint32_t REQUEST_TIMEOUT = 2000;       // ms for the request line to arrive
+    static const uint32_t RESPONSE_TIMEOUT = 20000;     // ms for the whole response to go out; spans a network cycle
+    static const uint32_t SEND_SLICE = 50;              // ms of writes per poll
+
+    static WiFiServer server;
+    static WiFiClient client;
+    static bool listening;
+    static Stage stage;
+    static Route route;
+    static uint8_t item;            // Next item of the response; 0 is the header
+    static uint8_t sample;          // Next sample of a /metrics family
+    static uint32_t startedAt;      // millis() the client was accepted
+    static char request[REQUEST_LINE_SIZE];
+    static uint8_t requestLength;
+    static char buffer[BUFFER_SIZE];
+    static Snapshot snapshot;
+
+    static uint32_t requests;       // Responses sent in full
+    static uint32_t dropped;        // Clients given up on: timeout, closed, failed write
+    static uint32_t longestMillis;  // Accept to close, for a full response
+
+    static bool readRequestLine();
+    static void routeRequest();
+    static void takeSnapshot(Alarm* alarm, CO2Sensor* co2);
+    static void send();
+    static void finish(bool complete);
+    static int renderItem(char* out, size_t size);
+    static int renderHeader(char* out, size_t size);
+    static int renderMetric(char* out, size_t size);
+    static int renderState(char* out, size_t size);
+    static uint8_t sampleCount(uint8_t family);
+    static uint32_t sampleValue(uint8_t family, uint8_t sample, const char*& label);
+    static void advance();
+};
+
+constexpr size_t LocalApi::staticBytes() {
+    return sizeof(server) + sizeof(client) + sizeof(listening) + sizeof(stage) + sizeof(route) + sizeof(item)
+         + sizeof(sample) + sizeof(startedAt) + sizeof(request) + sizeof(requestLength) + sizeof(buffer)
+         + sizeof(snapshot) + sizeof(requests) + sizeof(dropped) + sizeof(longestMillis);
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include "log.h"
+#include <Arduino_FreeRTOS.h>
+#include "error_codes.h"
+
+static const char* const MESSAGE_FORMATS[] = {
+#define LOG_MESSAGE(id, level, format) format,
+#include "log_messages.h"
+#undef LOG_MESSAGE
+};
+
+static const char LEVEL_LETTERS[] = {'?', 'E', 'W', 'I', 'D'};
+
+// Start of every binary frame, so the decoder can resynchronise after noise
+static const uint8_t FRAME_SYNC[2] = {0xA5, 0x5A};
+
+Log::Slot Log::slots[Log::RING_SIZE];
+std::atomic<uint32_t> Log::head(0);
+uint32_t Log::tail = 0;
+std::atomic<uint32_t> Log::dropped(0);
+uint32_t Log::droppedReported = 0;
+std::atomic<uint8_t> Log::writers(0);
+
+void Log::begin() {
+    for (uint16_t i = 0; i < RING_SIZE; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    head.store(0, std::memory_order_relaxed);
+    tail = 0;
+}
+
+bool Log::writeRecord(LogMsg id, uint8_t argCount, int32_t a, int32_t b, int32_t c) {
+    writers.fetch_add(1);
+    uint32_t pos = head.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &slots[pos & (RING_SIZE - 1)];
+        uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int32_t diff = static_cast<int32_t>(sequence - pos);
+        if (diff == 0) {
+            // Slot is free for this lap; claim it
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Ring full: drop rather than wait, this may be an interrupt
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            writers.fetch_sub(1);
+            return false;
+        } else {
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+
+    LogRecord& record = slot->record;
+    record.timestamp = millis();
+    record.id = static_cast<uint16_t>(id);
+    record.argCount = argCount;
+    record.args[0] = a;
+    record.args[1] = b;
+    record.args[2] = c;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    writers.fetch_sub(1);
+    return true;
+}
+
+bool Log::read(LogRecord& record) {
+    Slot& slot = slots[tail & (RING_SIZE - 1)];
+    uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (static_cast<int32_t>(sequence - (tail + 1)) < 0) {
+        return false;   // Empty, or the producer has not finished writing
+    }
+
+    record = slot.record;
+    slot.sequence.store(tail + RING_SIZE, std::memory_order_release);
+    tail++;
+    return true;
+}
+
+uint8_t Log::copyRecent(LogRecord* out, uint8_t max) {
+    uint32_t pos = head.load(std::memory_order_relaxed);
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < max && i < RING_SIZE && i < pos; i++) {
+        uint32_t index = pos - 1 - i;
+        const Slot& slot = slots[index & (RING_SIZE - 1)];
+        // Published (index + 1) or already drained (index + RING_SIZE);
+        // anything else is a claim that never finished
+        uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        if (sequence != index + 1 && sequence != index + RING_SIZE) {
+            continue;
+        }
+        out[count++] = slot.record;
+    }
+    return count;
+}
+
+void Log::printText(const LogRecord& record) {
+    uint8_t level = record.id < static_cast<uint16_t>(LogMsg::COUNT) ? LOG_MESSAGE_LEVELS[record.id] : 0;
+    Serial.print('[');
+    Serial.print(record.timestamp);
+    Serial.print("] ");
+    Serial.print(LEVEL_LETTERS[level]);
+    Serial.print(' ');
+
+    if (record.id >= static_cast<uint16_t>(LogMsg::COUNT)) {
+        Serial.print("Unknown log message ");
+        Serial.println(record.id);
+        return;
+    }
+
+    uint8_t arg = 0;
+    for (const char* p = MESSAGE_FORMATS[record.id]; *p; p++) {
+        if (*p != '%' || p[1] == '\0') {
+            Serial.print(*p);
+            continue;
+        }
+
+        char conversion = *++p;
+        if (conversion == '%') {
+            Serial.print('%');
+            continue;
+        }
+        int32_t value = arg < record.argCount ? record.args[arg] : 0;
+        arg++;
+
+        switch (conversion) {
+            case 'd': Serial.print(value); break;
+            case 'u': Serial.print(static_cast<uint32_t>(value)); break;
+            case 's': Serial.print(value ? reinterpret_cast<const char*>(static_cast<intptr_t>(value)) : "(null)"); break;
+            case 'E': Serial.print(getErrorString(static_cast<ErrorCode>(value))); break;
+            default: Serial.print('?'); break;
+        }
+    }
+    Serial.println();
+}
+
+void Log::printBinary(const LogRecord& record) {
+    // Little-endian: sync, timestamp u32, id u16, arg count u8, args i32 x count
+    Serial.write(FRAME_SYNC, sizeof(FRAME_SYNC));
+    Serial.write(reinterpret_cast<const uint8_t*>(&record.timestamp), sizeof(record.timestamp));
+    Serial.write(reinterpret_cast<const uint8_t*>(&record.id), sizeof(record.id));
+    Serial.write(&record.argCount, sizeof(record.argCount));
+    Serial.write(reinterpret_cast<const uint8_t*>(record.args), record.argCount * sizeof(int32_t));
+}
+
+uint16_t Log::drain() {
+    uint32_t droppedNow = droppedCount();
+    // Reported through the ring itself so it keeps its place in the stream;
+    // if the ring is still full, the count waits for the next drain
+    if (droppedNow != droppedReported &&
+        write(LogMsg::LOG_DROPPED, static_cast<int32_t>(droppedNow - droppedReported))) {
+        droppedReported = droppedNow;
+    }
+
+    uint16_t count = 0;
+    LogRecord record;
+    while (read(record)) {
+#if WAKU_LOG_BINARY
+        printBinary(record);
+#else
+        printText(record);
+#endif
+        count++;
+    }
+    return count;
+}
+
+void vLogTask(void *pvParameters) {
+    const TickType_t idleDelay = pdMS_TO_TICKS(20);
+
+    for(;;) {
+        Log::drain();
+        vTaskDelay(idleDelay);
+    }
+}
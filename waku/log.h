@@ -0,0 +1,109 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "build_config.h"
+
+// Deferred logging. LOG() stores a compact binary record (message ID plus
+// arguments) in a lock-free ring and returns; it is safe from any task or
+// interrupt and never touches Serial or the heap. A low-priority task drains
+// the ring and does the formatting, as text or as binary frames for
+// tools/decode_log.py. Messages below WAKU_LOG_LEVEL are compiled out.
+//
+//   LOG(BUTTON_RELEASED, lastPressDuration);
+//   LOG(SERVER_ERROR, static_cast<int32_t>(error), LOG_STR(message));
+
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+enum class LogMsg : uint16_t {
+#define LOG_MESSAGE(id, level, format) id,
+#include "log_messages.h"
+#undef LOG_MESSAGE
+    COUNT
+};
+
+constexpr uint8_t LOG_MESSAGE_LEVELS[] = {
+#define LOG_MESSAGE(id, level, format) LOG_LEVEL_##level,
+#include "log_messages.h"
+#undef LOG_MESSAGE
+};
+
+constexpr uint8_t logLevelOf(LogMsg id) { return LOG_MESSAGE_LEVELS[static_cast<uint16_t>(id)]; }
+
+struct LogRecord {
+    static const uint8_t MAX_ARGS = 3;
+
+    uint32_t timestamp;     // millis()
+    uint16_t id;
+    uint8_t argCount;
+    int32_t args[MAX_ARGS];
+};
+
+class Log {
+public:
+    static const uint16_t RING_SIZE = 32;   // Power of two
+
+private:
+    // Bounded MPSC queue: producers claim a slot with a CAS on head and
+    // publish it through the slot sequence; the drain task owns tail
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        LogRecord record;
+    };
+
+    static Slot slots[RING_SIZE];
+    static std::atomic<uint32_t> head;
+    static uint32_t tail;
+    static std::atomic<uint32_t> dropped;
+    static uint32_t droppedReported;
+    static std::atomic<uint8_t> writers;    // Inside writeRecord, from claim to publish
+
+    static bool writeRecord(LogMsg id, uint8_t argCount, int32_t a, int32_t b, int32_t c);
+    static void printText(const LogRecord& record);
+    static void printBinary(const LogRecord& record);
+
+public:
+    // Call once before the scheduler starts
+    static void begin();
+
+    // False if the ring was full and the record was dropped
+    static bool write(LogMsg id) { return writeRecord(id, 0, 0, 0, 0); }
+    static bool write(LogMsg id, int32_t a) { return writeRecord(id, 1, a, 0, 0); }
+    static bool write(LogMsg id, int32_t a, int32_t b) { return writeRecord(id, 2, a, b, 0); }
+    static bool write(LogMsg id, int32_t a, int32_t b, int32_t c) { return writeRecord(id, 3, a, b, c); }
+
+    // Take the oldest published record; drain task only
+    static bool read(LogRecord& record);
+
+    // Format and print everything pending; returns the number of records
+    static uint16_t drain();
+
+    static uint32_t droppedCount() { return dropped.load(std::memory_order_relaxed); }
+
+    // Some task is inside writeRecord, maybe holding a claimed slot that the
+    // drain waits for. Claims do not record the writer, so this is any task.
+    static bool writing() { return writers.load() != 0; }
+
+    // Copy up to max of the most recently written records, newest first,
+    // whether drained or not. Unsynchronised; for crash capture, when
+    // nothing else runs any more.
+    static uint8_t copyRecent(LogRecord* out, uint8_t max);
+};
+
+// Pass a string with static lifetime as a %s argument
+#define LOG_STR(s) static_cast<int32_t>(reinterpret_cast<intptr_t>(static_cast<const char*>(s)))
+
+#define LOG(id, ...)                                                    \
+    do {                                                                \
+        if (logLevelOf(LogMsg::id) <= WAKU_LOG_LEVEL) {                 \
+            Log::write(LogMsg::id, ##__VA_ARGS__);                      \
+        }                                                               \
+    } while (0)
+
+void vLogTask(void *pvParameters);
+
+#endif
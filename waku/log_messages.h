@@ -0,0 +1,47 @@
+// Log message table: LOG_MESSAGE(id, level, format)
+//
+// A record carries only the message ID (its position in this list) and up to
+// three 32-bit arguments; the format is applied when the record is drained.
+// tools/decode_log.py parses this file to decode binary logs, so only append
+// new entries at the end and keep each entry on one line.
+//
+// Conversions: %d signed, %u unsigned, %s pointer to a string that lives for
+// the whole program (literal or flash), %E ErrorCode name.
+
+LOG_MESSAGE(LOG_DROPPED, WARN, "%u log records dropped")
+LOG_MESSAGE(BUTTON_INIT, INFO, "Button handler initialized on pin %d with debouncing")
+LOG_MESSAGE(BUTTON_PRESSED, DEBUG, "Button pressed (FALLING edge)")
+LOG_MESSAGE(BUTTON_RELEASED, DEBUG, "Button released (RISING edge), duration: %u ms")
+LOG_MESSAGE(BUTTON_SHORT_PRESS, INFO, "Short press")
+LOG_MESSAGE(BUTTON_LONG_PRESS, INFO, "Long press - not implemented yet")
+LOG_MESSAGE(ALARM_TIME_SHOWN, INFO, "Displaying alarm time %d:%d")
+LOG_MESSAGE(ALARM_STOPPED, INFO, "ALARM STOPPED!")
+LOG_MESSAGE(ALARM_MIDNIGHT_RESET, INFO, "Midnight reached - Reset alarm trigger status for new day")
+LOG_MESSAGE(WAKE_CONFIRMED, INFO, "Wake-up confirmed by activity")
+LOG_MESSAGE(WAKE_MISSED, WARN, "No activity after alarm - re-triggering wake-up")
+LOG_MESSAGE(SERVER_ERROR, ERROR, "Error: %E - %s")
+LOG_MESSAGE(NETWORK_UPDATE_FAILED, WARN, "Network update failed. Total fails: %u")
+LOG_MESSAGE(WIFI_MUTEX_BUSY, WARN, "Failed to acquire WiFi mutex for network update")
+LOG_MESSAGE(MELODY_JITTER, INFO, "Melody onset jitter (us) - max: %u, mean: %u, notes: %u")
+LOG_MESSAGE(SUPERVISOR_TASK_STALLED, WARN, "Task %s silent for %u ms - recovery stage %u")
+LOG_MESSAGE(SUPERVISOR_TASK_RECOVERED, INFO, "Task %s healthy again")
+LOG_MESSAGE(WIFI_REINIT, WARN, "Re-initialising WiFi, connected: %d")
+LOG_MESSAGE(CONFIG_COMPACTED, INFO, "Config store moved to block %u, generation %u")
+LOG_MESSAGE(CONFIG_WRITE_FAILED, ERROR, "Failed to save config key %u")
+LOG_MESSAGE(BOOT_EVENT, INFO, "Boot: %s ready after %u ms")
+LOG_MESSAGE(RTC_SET_FAILED, ERROR, "Failed to set the RTC from the server time")
+LOG_MESSAGE(CLOCK_OFFSET_CHANGED, INFO, "UTC offset changed from %d to %d s - RTC adjusted")
+LOG_MESSAGE(CLOCK_SYNCED, DEBUG, "SNTP: offset %d ms, delay %u ms, drift %d ppb")
+LOG_MESSAGE(SNTP_FAILED, WARN, "SNTP exchange failed (%u in a row)")
+LOG_MESSAGE(RTC_CORRECTED, DEBUG, "RTC off by %d ms - rewritten, %d s left to slew")
+LOG_MESSAGE(CONFIG_POLL_FAILED, DEBUG, "Config long-poll failed, HTTP status %d")
+LOG_MESSAGE(CONFIG_PUSH_UNSUPPORTED, WARN, "Server has no config long-poll (HTTP %d) - polling instead")
+LOG_MESSAGE(CONFIG_PUSHED, INFO, "Config pushed by the server: alarm %d:%d")
+LOG_MESSAGE(DNS_LOOKUP_FAILED, WARN, "DNS lookup failed - keeping the address from %d s ago (-1: none)")
+LOG_MESSAGE(RADIO_NOT_READY, WARN, "Wake window started before the server and clock were synced")
+LOG_MESSAGE(RADIO_NIGHT, INFO, "Radio last night: %u s on, %u joins, ~%u/10 mAh")
+LOG_MESSAGE(OTA_STAGED, INFO, "Firmware %u staged: %u s download, %d bytes saved by compression")
+LOG_MESSAGE(OTA_FAILED, WARN, "Firmware download failed: %s after %u bytes")
+LOG_MESSAGE(OTA_APPLIED, INFO, "Running firmware %u from the server")
+LOG_MESSAGE(OTA_REFUSED, WARN, "Firmware %u was applied but %u is running - not fetching it again")
+LOG_MESSAGE(OTA_COPY_TOO_SLOW, WARN, "Firmware %u not applied: staging took %u ms of flash time, the copy has %u ms")
@@ -0,0 +1,418 @@
+#include "melody.h"
+#include "cycle_counter.h"
+#include "log.h"
+
+// Velvet Horizon Theme - Approximation
+static const PackedNote VELVET_HORIZON_NOTES[] = {
+    // Opening sequence (ethereal and dreamy)
+    PACK_NOTE(67, 600), PACK_NOTE(0, 200), PACK_NOTE(69, 600), PACK_NOTE(72, 600),   // G4, rest, A4, C5
+    PACK_NOTE(69, 600), PACK_NOTE(0, 200), PACK_NOTE(67, 600), PACK_NOTE(65, 600),   // A4, rest, G4, F4
+    PACK_NOTE(67, 400), PACK_NOTE(69, 400), PACK_NOTE(72, 600), PACK_NOTE(74, 600),  // G4, A4, C5, D5
+    PACK_NOTE(72, 600), PACK_NOTE(0, 200), PACK_NOTE(69, 600), PACK_NOTE(0, 800),    // C5, rest, A4, rest
+
+    // Main melody (flowing)
+    PACK_NOTE(72, 400), PACK_NOTE(74, 400), PACK_NOTE(76, 600), PACK_NOTE(72, 600),  // C5, D5, E5, C5
+    PACK_NOTE(74, 600), PACK_NOTE(0, 200), PACK_NOTE(72, 400), PACK_NOTE(69, 400),   // D5, rest, C5, A4
+    PACK_NOTE(67, 400), PACK_NOTE(69, 400), PACK_NOTE(72, 600), PACK_NOTE(0, 800),   // G4, A4, C5, rest
+    PACK_NOTE(69, 400), PACK_NOTE(67, 400), PACK_NOTE(65, 600), PACK_NOTE(0, 800),   // A4, G4, F4, rest
+
+    // Bridge section (mystical)
+    PACK_NOTE(69, 600), PACK_NOTE(0, 200), PACK_NOTE(72, 600), PACK_NOTE(74, 600),   // A4, rest, C5, D5
+    PACK_NOTE(76, 600), PACK_NOTE(0, 200), PACK_NOTE(74, 400), PACK_NOTE(72, 400),   // E5, rest, D5, C5
+    PACK_NOTE(69, 400), PACK_NOTE(67, 400), PACK_NOTE(69, 600), PACK_NOTE(0, 800),   // A4, G4, A4, rest
+    PACK_NOTE(72, 400), PACK_NOTE(74, 400), PACK_NOTE(76, 600), PACK_NOTE(0, 800),   // C5, D5, E5, rest
+
+    // Final sequence (ethereal return)
+    PACK_NOTE(72, 600), PACK_NOTE(0, 200), PACK_NOTE(69, 600), PACK_NOTE(67, 600),   // C5, rest, A4, G4
+    PACK_NOTE(69, 600), PACK_NOTE(0, 200), PACK_NOTE(72, 600), PACK_NOTE(74, 600),   // A4, rest, C5, D5
+    PACK_NOTE(72, 600), PACK_NOTE(0, 200), PACK_NOTE(69, 600), PACK_NOTE(0, 800),    // C5, rest, A4, rest
+    PACK_NOTE(67, 400), PACK_NOTE(65, 400), PACK_NOTE(67, 600), PACK_NOTE(0, 800)    // G4, F4, G4, rest
+};
+
+const MelodyTrack Melody::VELVET_HORIZON = {
+    VELVET_HORIZON_NOTES,
+    sizeof(VELVET_HORIZON_NOTES) / sizeof(VELVET_HORIZON_NOTES[0])
+};
+
+// Frequencies of the eighth octave (C8 = MIDI 108); lower octaves are right shifts
+static const uint16_t OCTAVE_8_FREQUENCIES[12] = {
+    4186, 4435, 4699, 4978, 5274, 5588, 5920, 6272, 6645, 7040, 7459, 7902
+};
+
+uint16_t Melody::frequency(uint8_t midiNote) {
+    if (midiNote == REST) {
+        return 0;
+    }
+    int octave = midiNote / 12;
+    if (octave > 9) {
+        octave = 9;
+    }
+    return OCTAVE_8_FREQUENCIES[midiNote % 12] >> (9 - octave);
+}
+
+static int parseNumber(const char*& p) {
+    int value = 0;
+    while (isdigit(*p)) {
+        value = value * 10 + (*p++ - '0');
+    }
+    return value;
+}
+
+static PackedNote makeNote(int midiNote, unsigned long durationMs) {
+    if (midiNote < 0) midiNote = Melody::REST;
+    if (midiNote > 127) midiNote = 127;
+    if (durationMs > Melody::MAX_DURATION_MS) durationMs = Melody::MAX_DURATION_MS;
+    return PACK_NOTE(midiNote, durationMs);
+}
+
+bool Melody::parseRtttl(const char* text, PackedNote* out, uint16_t capacity, uint16_t& length) {
+    length = 0;
+    if (!text) {
+        return false;
+    }
+
+    // Skip the name section
+    const char* p = strchr(text, ':');
+    if (!p) {
+        return false;
+    }
+    p++;
+
+    // Defaults section, e.g. "d=4,o=5,b=120"
+    int defaultDuration = 4;
+    int defaultOctave = 6;
+    int bpm = 63;
+    while (*p && *p != ':') {
+        while (*p == ' ' || *p == ',') p++;
+        if (*p == ':') break;
+
+        char key = tolower(*p);
+        if (p[1] != '=') {
+            return false;
+        }
+        p += 2;
+        int value = parseNumber(p);
+        switch (key) {
+            case 'd': defaultDuration = value; break;
+            case 'o': defaultOctave = value; break;
+            case 'b': bpm = value; break;
+            default: return false;
+        }
+    }
+    if (*p != ':' || defaultDuration <= 0 || bpm <= 0) {
+        return false;
+    }
+    p++;
+
+    // Semitone offsets from C for the letters a..g
+    static const int8_t SEMITONES[7] = {9, 11, 0, 2, 4, 5, 7};
+    const unsigned long wholeNoteMs = 240000UL / bpm;
+
+    while (*p) {
+        while (*p == ' ' || *p == ',') p++;
+        if (!*p) break;
+
+        int duration = parseNumber(p);
+        if (duration <= 0) {
+            duration = defaultDuration;
+        }
+
+        char letter = tolower(*p++);
+        int semitone;
+        if (letter == 'p') {
+            semitone = -1;
+        } else if (letter >= 'a' && letter <= 'g') {
+            semitone = SEMITONES[letter - 'a'];
+        } else {
+            return false;
+        }
+        if (*p == '#') {
+            semitone++;
+            p++;
+        }
+
+        unsigned long noteMs = wholeNoteMs / duration;
+        if (*p == '.') {
+            noteMs += noteMs / 2;
+            p++;
+        }
+        int octave = defaultOctave;
+        if (isdigit(*p)) {
+            octave = *p++ - '0';
+        }
+        if (*p == '.') {
+            noteMs += noteMs / 2;
+            p++;
+        }
+
+        if (length >= capacity) {
+            return false;
+        }
+        out[length++] = makeNote(semitone < 0 ? REST : 12 * (octave + 1) + semitone, noteMs);
+    }
+
+    return length > 0;
+}
+
+bool Melody::parseMidiLite(const char* text, PackedNote* out, uint16_t capacity, uint16_t& length) {
+    length = 0;
+    if (!text || strncmp(text, "midi:", 5) != 0) {
+        return false;
+    }
+    const char* p = text + 5;
+
+    while (*p) {
+        while (*p == ' ' || *p == ',') p++;
+        if (!*p) break;
+
+        if (!isdigit(*p)) {
+            return false;
+        }
+        int midiNote = parseNumber(p);
+        if (*p++ != '/' || !isdigit(*p)) {
+            return false;
+        }
+        unsigned long durationMs = parseNumber(p);
+
+        if (length >= capacity) {
+            return false;
+        }
+        out[length++] = makeNote(midiNote, durationMs);
+    }
+
+    return length > 0;
+}
+
+// Melody store
+PackedNote MelodyStore::slots[2][MelodyStore::MAX_LOADED_NOTES];
+MelodyTrack MelodyStore::loadedTracks[2];
+const MelodyTrack* volatile MelodyStore::activeTrack = &Melody::VELVET_HORIZON;
+uint32_t MelodyStore::loadedHash = 0;
+uint32_t MelodyStore::rejectedHash = 0;
+
+static uint32_t hashText(const char* text) {
+    // FNV-1a
+    uint32_t hash = 2166136261UL;
+    while (*text) {
+        hash ^= static_cast<uint8_t>(*text++);
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+MelodyStore::LoadResult MelodyStore::load(const char* text) {
+    if (!text) {
+        return LoadResult::INVALID;
+    }
+
+    uint32_t hash = hashText(text);
+    if (hash == loadedHash) {
+        return LoadResult::UNCHANGED;
+    }
+    if (hash == rejectedHash) {
+        return LoadResult::STILL_INVALID;
+    }
+
+    int slot = (activeTrack == &loadedTracks[0]) ? 1 : 0;
+    uint16_t length = 0;
+    bool parsed = strncmp(text, "midi:", 5) == 0
+        ? Melody::parseMidiLite(text, slots[slot], MAX_LOADED_NOTES, length)
+        : Melody::parseRtttl(text, slots[slot], MAX_LOADED_NOTES, length);
+    if (!parsed) {
+        rejectedHash = hash;
+        return LoadResult::INVALID;
+    }
+
+    loadedTracks[slot].notes = slots[slot];
+    loadedTracks[slot].length = length;
+    activeTrack = &loadedTracks[slot];
+    loadedHash = hash;
+    return LoadResult::LOADED;
+}
+
+void MelodyStore::reset() {
+    activeTrack = &Melody::VELVET_HORIZON;
+    loadedHash = 0;
+    rejectedHash = 0;
+}
+
+// Melody sequencer
+bool MelodySequencer::begin() {
+    uint8_t noteTimerType = AGT_TIMER;
+    int8_t noteChannel = FspTimer::get_available_timer(noteTimerType);
+    uint8_t toneTimerType = GPT_TIMER;
+    int8_t toneChannel = FspTimer::get_available_timer(toneTimerType);
+    if (noteChannel < 0 || toneChannel < 0) {
+        Serial.println("WARNING: No free timer for melody, using polled playback");
+        return false;
+    }
+
+    // The tone timer overflows twice per period, once per pin edge
+    timersReady =
+        noteTimer.begin(TIMER_MODE_PERIODIC, noteTimerType, noteChannel, TICK_HZ, 0.0f, noteTimerCallback, this) &&
+        noteTimer.setup_overflow_irq() &&
+        noteTimer.open() &&
+        toneTimer.begin(TIMER_MODE_PERIODIC, toneTimerType, toneChannel, 880.0f, 0.0f, toneTimerCallback, this) &&
+        toneTimer.setup_overflow_irq() &&
+        toneTimer.open();
+
+    if (!timersReady) {
+        Serial.println("WARNING: Melody timer setup failed, using polled playback");
+    }
+    return timersReady;
+}
+
+uint16_t MelodySequencer::noteTicks(PackedNote note) {
+    uint16_t ticks = note & 0x1FF;  // Durations are already in 10 ms ticks
+    return ticks > 0 ? ticks : 1;
+}
+
+PackedNote MelodySequencer::nextNote() {
+    const MelodyTrack* track = MelodyStore::current();
+    uint16_t index = noteIndex;
+    if (index >= track->length) {
+        index = 0;  // Loop back to start
+    }
+    noteIndex = index + 1;
+    return track->notes[index];
+}
+
+void MelodySequencer::playNote(PackedNote note) {
+    uint16_t freq = Melody::frequency(Melody::noteNumber(note));
+
+    if (synth) {
+        synth->noteOn(freq, Melody::durationMs(note));
+        return;
+    }
+
+    if (!timersReady) {
+        if (freq == 0) {
+            noTone(buzzerPin);
+        } else {
+            tone(buzzerPin, freq, Melody::durationMs(note));
+        }
+        return;
+    }
+
+    // Runs in interrupt context: only timer register updates, no allocation
+    if (freq == 0) {
+        toneTimer.stop();
+        pinLevel = false;
+        digitalWrite(buzzerPin, LOW);
+    } else {
+        toneTimer.set_frequency(2.0f * freq);
+        toneTimer.start();
+    }
+}
+
+void MelodySequencer::recordOnset(PackedNote note) {
+    uint32_t now = CycleCounter::now();
+    if (onsetValid) {
+        uint32_t interval = now - lastOnsetCycles;
+        uint32_t error = interval > lastNoteCycles ? interval - lastNoteCycles : lastNoteCycles - interval;
+        uint32_t errorMicros = CycleCounter::toMicros(error);
+        jitter.onsets++;
+        jitter.totalMicros += errorMicros;
+        if (errorMicros > jitter.maxMicros) {
+            jitter.maxMicros = errorMicros;
+        }
+    }
+    onsetValid = true;
+    lastOnsetCycles = now;
+    lastNoteCycles = noteTicks(note) * (1000000UL / TICK_HZ) * CycleCounter::cyclesPerMicro();
+}
+
+void MelodySequencer::noteTimerCallback(timer_callback_args_t* args) {
+    MelodySequencer* self = static_cast<MelodySequencer*>(const_cast<void*>(args->p_context));
+    if (!self->running || --self->ticksRemaining > 0) {
+        return;
+    }
+
+    PackedNote note = self->nextNote();
+    self->recordOnset(note);
+    self->playNote(note);
+    self->ticksRemaining = noteTicks(note);
+}
+
+void MelodySequencer::toneTimerCallback(timer_callback_args_t* args) {
+    MelodySequencer* self = static_cast<MelodySequencer*>(const_cast<void*>(args->p_context));
+    self->pinLevel = !self->pinLevel;
+    digitalWrite(self->buzzerPin, self->pinLevel ? HIGH : LOW);
+}
+
+void MelodySequencer::start(unsigned long now) {
+    noteIndex = 0;
+
+    // Jitter is reported per play
+    noInterrupts();
+    onsetValid = false;
+    jitter = JitterStats{0, 0, 0};
+    interrupts();
+
+    if (!timersReady) {
+        nextDeadline = now;
+        running = true;
+        service(now);
+        return;
+    }
+
+    // Play the first note from here; the timer takes over from the next boundary
+    PackedNote note = nextNote();
+    recordOnset(note);
+    playNote(note);
+    ticksRemaining = noteTicks(note);
+    running = true;
+    noteTimer.reset();
+    noteTimer.start();
+}
+
+void MelodySequencer::stop() {
+    if (!running) {
+        return;
+    }
+    running = false;
+
+    if (synth) {
+        synth->allNotesOff();
+    }
+    if (timersReady) {
+        noteTimer.stop();
+        toneTimer.stop();
+        pinLevel = false;
+        digitalWrite(buzzerPin, LOW);
+    } else {
+        noTone(buzzerPin);
+    }
+    noteIndex = 0;
+
+    JitterStats stats = getJitterStats();
+    if (stats.onsets > 0) {
+        LOG(MELODY_JITTER, stats.maxMicros, stats.totalMicros / stats.onsets, stats.onsets);
+    }
+}
+
+void MelodySequencer::service(unsigned long now) {
+    if (timersReady || !running || (long)(now - nextDeadline) < 0) {
+        return;
+    }
+
+    PackedNote note = nextNote();
+    recordOnset(note);
+    playNote(note);
+
+    // Schedule the next onset from this note's deadline, not from now. If the
+    // caller was starved for longer than a whole note, restart from now instead
+    // of bursting through the missed notes.
+    unsigned long duration = Melody::durationMs(note);
+    if (now - nextDeadline > duration) {
+        nextDeadline = now;
+    }
+    nextDeadline += duration;
+}
+
+MelodySequencer::JitterStats MelodySequencer::getJitterStats() {
+    noInterrupts();
+    JitterStats stats = jitter;
+    interrupts();
+    return stats;
+}
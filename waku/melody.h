@@ -0,0 +1,135 @@
+#ifndef MELODY_H
+#define MELODY_H
+
+#include <Arduino.h>
+#include <FspTimer.h>
+#include "wavetable_synth.h"
+
+// A note packed into 16 bits so whole tracks can stay in flash:
+// bits 15..9 hold the MIDI note number (0 = rest), bits 8..0 the duration in 10 ms units.
+typedef uint16_t PackedNote;
+
+#define PACK_NOTE(midiNote, durationMs) \
+    static_cast<PackedNote>(((midiNote) << 9) | (((durationMs) / 10) & 0x1FF))
+
+struct MelodyTrack {
+    const PackedNote* notes;
+    uint16_t length;
+};
+
+class Melody {
+public:
+    static const uint8_t REST = 0;
+    static const uint16_t MAX_DURATION_MS = 0x1FF * 10;
+
+    static uint8_t noteNumber(PackedNote note) { return note >> 9; }
+    static uint16_t durationMs(PackedNote note) { return (note & 0x1FF) * 10; }
+
+    // Equal-tempered frequency (Hz) of a MIDI note number, 0 for rests
+    static uint16_t frequency(uint8_t midiNote);
+
+    // Parse "name:d=4,o=5,b=120:8c6,p,4e." (RTTTL) into packed notes
+    static bool parseRtttl(const char* text, PackedNote* out, uint16_t capacity, uint16_t& length);
+
+    // Parse "midi:67/600,0/200,69/600" (MIDI note number / milliseconds pairs)
+    static bool parseMidiLite(const char* text, PackedNote* out, uint16_t capacity, uint16_t& length);
+
+    // Built-in wake-up theme, resident in flash
+    static const MelodyTrack VELVET_HORIZON;
+};
+
+// Holds the track the alarm plays. Tracks pushed at runtime are parsed into
+// the inactive one of two RAM slots and then published with a single pointer
+// write, so the sequencer never sees a half-parsed melody.
+class MelodyStore {
+private:
+    static const uint16_t MAX_LOADED_NOTES = 64;
+
+    static PackedNote slots[2][MAX_LOADED_NOTES];
+    static MelodyTrack loadedTracks[2];
+    static const MelodyTrack* volatile activeTrack;
+    static uint32_t loadedHash;
+    static uint32_t rejectedHash;   // Last text that did not parse
+
+public:
+    enum class LoadResult : uint8_t {
+        LOADED,         // Parsed and now current
+        UNCHANGED,      // Same text as the current track
+        INVALID,        // Did not parse; the current track stays
+        STILL_INVALID   // Same text as the last one that did not parse
+    };
+
+    // Accepts RTTTL or "midi:" text. Neither unchanged text nor the text that
+    // last failed is parsed again, so a bad melody in every server response
+    // is reported once.
+    static LoadResult load(const char* text);
+    static void reset();
+    static const MelodyTrack* current() { return activeTrack; }
+};
+
+// Plays a track on the buzzer. A 100 Hz hardware timer (the resolution of
+// PackedNote durations) counts each note down and switches to the next one
+// from its interrupt, so note boundaries no longer depend on when the alarm
+// task gets to run. The square wave comes from a second timer toggling the pin.
+// If no hardware timer is free, service() falls back to polled deadlines and tone().
+class MelodySequencer {
+public:
+    struct JitterStats {
+        uint32_t onsets;
+        uint32_t maxMicros;     // Worst onset error against the nominal note length
+        uint32_t totalMicros;
+    };
+
+private:
+    static const uint32_t TICK_HZ = 100;
+
+    const int buzzerPin;
+    WavetableSynth* synth;       // Plays notes instead of the buzzer when set
+    FspTimer noteTimer;
+    FspTimer toneTimer;
+    bool timersReady;
+
+    volatile bool running;
+    volatile uint16_t noteIndex;
+    volatile uint16_t ticksRemaining;
+    volatile bool pinLevel;
+    unsigned long nextDeadline;  // Polled fallback only
+
+    // Onset jitter, measured on the cycle counter
+    volatile bool onsetValid;
+    volatile uint32_t lastOnsetCycles;
+    volatile uint32_t lastNoteCycles;
+    JitterStats jitter;
+
+    static void noteTimerCallback(timer_callback_args_t* args);
+    static void toneTimerCallback(timer_callback_args_t* args);
+    static uint16_t noteTicks(PackedNote note);
+
+    PackedNote nextNote();
+    void playNote(PackedNote note);
+    void recordOnset(PackedNote note);
+
+public:
+    explicit MelodySequencer(int pin)
+        : buzzerPin(pin), synth(nullptr), timersReady(false), running(false), noteIndex(0),
+          ticksRemaining(0), pinLevel(false), nextDeadline(0),
+          onsetValid(false), lastOnsetCycles(0), lastNoteCycles(0), jitter{0, 0, 0} {}
+
+    // Claims the hardware timers; returns false if it has to fall back to polling
+    bool begin();
+
+    // Route notes to a synthesizer instead of the buzzer pin
+    void setSynth(WavetableSynth* target) { synth = target; }
+
+    void start(unsigned long now);
+    void stop();
+    bool isRunning() const { return running; }
+
+    // Polled fallback: advance the track if the next note deadline has passed
+    void service(unsigned long now);
+
+    // Since the last start(); stop() logs it
+    JitterStats getJitterStats();
+};
+
+#endif
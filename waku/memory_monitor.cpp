@@ -0,0 +1,84 @@
+#include "memory_monitor.h"
+#include <malloc.h>
+#include "task_manager.h"
+
+extern "C" char* sbrk(int incr);
+extern "C" char __HeapLimit;    // End of the heap region, from the linker script
+
+MemoryStats MemoryMonitor::lastStats = {};
+uint32_t MemoryMonitor::heapMinFree = UINT32_MAX;
+
+void MemoryMonitor::addTask(MemoryStats& stats, TaskHandle_t handle, const char* name, uint16_t sizeWords) {
+    if (!handle || stats.taskCount >= MemoryStats::MAX_TASKS) {
+        return;
+    }
+    TaskStackStats& task = stats.stacks[stats.taskCount++];
+    task.name = name;
+    task.sizeWords = sizeWords;
+    task.freeWords = uxTaskGetStackHighWaterMark(handle);
+}
+
+void MemoryMonitor::sample() {
+    MemoryStats stats = {};
+
+#if WAKU_COOPERATIVE_TASKS
+    addTask(stats, cooperativeTaskHandle, "coop", COOPERATIVE_STACK_SIZE);
+    addTask(stats, networkTaskHandle, "network", NETWORK_STACK_SIZE);
+#else
+    addTask(stats, alarmTaskHandle, "alarm", ALARM_STACK_SIZE);
+    addTask(stats, networkTaskHandle, "network", NETWORK_STACK_SIZE);
+    addTask(stats, displayTaskHandle, "display", DISPLAY_STACK_SIZE);
+#endif
+    addTask(stats, logTaskHandle, "log", LOG_STACK_SIZE);
+    addTask(stats, supervisorTaskHandle, "supervisor", SUPERVISOR_STACK_SIZE);
+
+    // Free heap is the free chunks inside the arena plus what sbrk has not
+    // handed out yet. Only the top chunk and the unclaimed tail are contiguous;
+    // the rest is holes left between live allocations.
+    struct mallinfo info = mallinfo();
+    uint32_t unclaimed = static_cast<uint32_t>(&__HeapLimit - sbrk(0));
+    uint32_t heapFree = unclaimed + info.fordblks;
+    uint32_t contiguous = unclaimed + info.keepcost;
+
+    if (heapFree < heapMinFree) {
+        heapMinFree = heapFree;
+    }
+
+    stats.heapFree = heapFree;
+    stats.heapMinFree = heapMinFree;
+    stats.heapFragmentationPercent = heapFree > 0 ? 100 - (contiguous * 100) / heapFree : 0;
+    stats.valid = true;
+
+    noInterrupts();
+    lastStats = stats;
+    interrupts();
+}
+
+MemoryStats MemoryMonitor::getLastStats() {
+    noInterrupts();
+    MemoryStats stats = lastStats;
+    interrupts();
+    return stats;
+}
+
+void MemoryMonitor::printReport(const char* args) {
+    sample();
+    MemoryStats stats = getLastStats();
+
+    Serial.println("Stack free (words, lowest since start):");
+    for (uint8_t i = 0; i < stats.taskCount; i++) {
+        Serial.print("  ");
+        Serial.print(stats.stacks[i].name);
+        Serial.print(": ");
+        Serial.print(stats.stacks[i].freeWords);
+        Serial.print(" of ");
+        Serial.println(stats.stacks[i].sizeWords);
+    }
+    Serial.print("Heap free: ");
+    Serial.print(stats.heapFree);
+    Serial.print(" bytes, min ever: ");
+    Serial.print(stats.heapMinFree);
+    Serial.print(", fragmentation: ");
+    Serial.print(stats.heapFragmentationPercent);
+    Serial.println("%");
+}
@@ -0,0 +1,42 @@
+#ifndef MEMORY_MONITOR_H
+#define MEMORY_MONITOR_H
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+
+struct TaskStackStats {
+    const char* name;
+    uint16_t sizeWords;
+    uint16_t freeWords;     // Lowest free stack seen since the task started
+};
+
+struct MemoryStats {
+    static const uint8_t MAX_TASKS = 5;
+
+    TaskStackStats stacks[MAX_TASKS];
+    uint8_t taskCount;
+    uint32_t heapFree;              // Bytes, free chunks plus unclaimed heap
+    uint32_t heapMinFree;           // Lowest heapFree seen since boot
+    uint8_t heapFragmentationPercent; // Share of free heap stuck in holes
+    bool valid;
+};
+
+// Samples stack high-water marks of the application tasks and the newlib
+// heap state. sample() is cheap enough to run every network cycle; the result
+// goes into telemetry and the "mem" console command.
+class MemoryMonitor {
+private:
+    static MemoryStats lastStats;
+    static uint32_t heapMinFree;
+
+    static void addTask(MemoryStats& stats, TaskHandle_t handle, const char* name, uint16_t sizeWords);
+
+public:
+    static void sample();
+    static MemoryStats getLastStats();
+
+    // Console handler: sample and print
+    static void printReport(const char* args);
+};
+
+#endif
@@ -0,0 +1,391 @@
+#include "ota_updater.h"
+#include <WDT.h>
+#include "alarm.h"
+#include "config_store.h"
+#include "crc32.h"
+#include "dns_cache.h"
+#include "radio_manager.h"
+#include "supervisor.h"
+#include "log.h"
+
+static const char* const FAILURE_NAMES[] = {
+    "connect", "bad response", "too large", "storage", "timeout", "closed", "truncated", "CRC mismatch", "wake window",
+    "copy too slow"
+};
+
+static_assert(sizeof(FAILURE_NAMES) / sizeof(FAILURE_NAMES[0]) == static_cast<uint8_t>(OtaFailure::COUNT), "Name every OTA failure");
+
+const char* OtaUpdater::host = nullptr;
+int OtaUpdater::port = 0;
+const char* OtaUpdater::caCert = nullptr;
+OTAStorage* OtaUpdater::storage = nullptr;
+void (*OtaUpdater::pushPoll)() = nullptr;
+#if WAKU_USE_TLS
+WiFiSSLClient OtaUpdater::client;
+#else
+WiFiClient OtaUpdater::client;
+#endif
+HeatshrinkDecoder OtaUpdater::decoder;
+
+OtaUpdater::State OtaUpdater::state = OtaUpdater::State::IDLE;
+char OtaUpdater::line[LINE_SIZE];
+uint8_t OtaUpdater::lineLength = 0;
+int OtaUpdater::httpStatus = 0;
+uint32_t OtaUpdater::offeredVersion = 0;
+uint32_t OtaUpdater::imageSize = 0;
+uint32_t OtaUpdater::imageCrc = 0;
+uint32_t OtaUpdater::bodyLength = 0;
+uint32_t OtaUpdater::received = 0;
+uint32_t OtaUpdater::written = 0;
+uint32_t OtaUpdater::crc = 0;
+uint32_t OtaUpdater::flashMicros = 0;
+uint32_t OtaUpdater::startedAt = 0;
+uint32_t OtaUpdater::lastDataAt = 0;
+uint32_t OtaUpdater::lastCheck = 0;
+bool OtaUpdater::checkedOnce = false;
+uint32_t OtaUpdater::refusedVersion = 0;
+uint32_t OtaUpdater::slowVersion = 0;
+
+uint32_t OtaUpdater::checks = 0;
+uint32_t OtaUpdater::downloads = 0;
+uint32_t OtaUpdater::failures = 0;
+OtaFailure OtaUpdater::lastFailure = OtaFailure::COUNT;
+uint32_t OtaUpdater::lastTransferMillis = 0;
+uint32_t OtaUpdater::lastCompressedBytes = 0;
+uint32_t OtaUpdater::lastImageBytes = 0;
+uint32_t OtaUpdater::lastFlashMillis = 0;
+
+// Value of header name in line, or nullptr if line is another header
+static const char* headerValue(const char* line, const char* name) {
+    size_t length = strlen(name);
+    if (strncasecmp(line, name, length) != 0 || line[length] != ':') {
+        return nullptr;
+    }
+    const char* value = line + length + 1;
+    while (*value == ' ') {
+        value++;
+    }
+    return value;
+}
+
+void OtaUpdater::begin(const char* serverHost, int serverPort, const char* ca, OTAStorage& staging, void (*poll)()) {
+    host = serverHost;
+    port = serverPort;
+    caCert = ca;
+    storage = &staging;
+    pushPoll = poll;
+
+    uint32_t applied;
+    if (ConfigStore::get(ConfigKey::FIRMWARE_APPLIED, applied)) {
+        if (applied == WAKU_FIRMWARE_VERSION) {
+            LOG(OTA_APPLIED, applied);
+        } else {
+            refusedVersion = applied;
+            LOG(OTA_REFUSED, applied, WAKU_FIRMWARE_VERSION);
+        }
+    }
+}
+
+bool OtaUpdater::nearWakeWindow(Alarm* alarm) {
+    return alarm && alarm->isNearWakeWindow(APPLY_MARGIN);
+}
+
+void OtaUpdater::cycle(Alarm* alarm) {
+#if WAKU_OTA_PULL
+    if (!storage || nearWakeWindow(alarm)) {
+        return;
+    }
+    if (state == State::STAGED) {
+        apply();
+    }
+    if (state != State::IDLE || millis() - lastCheck < (checkedOnce ? CHECK_INTERVAL : FIRST_CHECK_DELAY) ||
+        WiFi.status() != WL_CONNECTED) {
+        return;
+    }
+    lastCheck = millis();
+    checkedOnce = true;
+    checks++;
+    if (!startCheck()) {
+        fail(OtaFailure::CONNECT);
+    }
+#endif
+}
+
+bool OtaUpdater::startCheck() {
+#if WAKU_USE_TLS
+    client.setCACert(caCert);
+    if (!client.connect(host, port)) {
+        return false;
+    }
+#else
+    IPAddress address;
+    uint32_t lookupTime;
+    if (!DnsCache::resolve(host, address, lookupTime)) {
+        return false;
+    }
+    if (!client.connect(address, port)) {
+        DnsCache::reportFailure(host);
+        return false;
+    }
+#endif
+    char request[128];
+    int length = snprintf(request, sizeof(request),
+                          "GET /api/device/firmware HTTP/1.1\r\nHost: %s\r\nIf-None-Match: \"%lu\"\r\nConnection: close\r\n\r\n",
+                          host, static_cast<unsigned long>(WAKU_FIRMWARE_VERSION));
+    if (length <= 0 || static_cast<size_t>(length) >= sizeof(request) ||
+        client.write(reinterpret_cast<const uint8_t*>(request), length) != static_cast<size_t>(length)) {
+        client.stop();
+        return false;
+    }
+
+    state = State::HEADERS;
+    lineLength = 0;
+    httpStatus = 0;
+    offeredVersion = 0;
+    imageSize = 0;
+    imageCrc = 0;
+    bodyLength = 0;
+    received = 0;
+    written = 0;
+    startedAt = millis();
+    lastDataAt = startedAt;
+    // Keep the radio up past the batch until the download is over
+    RadioManager::hold(true);
+    return true;
+}
+
+void OtaUpdater::poll(Alarm* alarm) {
+    bool nearWindow = nearWakeWindow(alarm);
+    // A push stages into the same storage and would rewind it under a
+    // download, or overwrite a staged image that was checked before writing
+    if (pushPoll && state == State::IDLE && !nearWindow) {
+        // An upload is received and applied inside the call
+        Supervisor::setPaused(true);
+        pushPoll();
+        Supervisor::setPaused(false);
+    }
+
+    if (state != State::HEADERS && state != State::BODY) {
+        return;
+    }
+    if (nearWindow) {
+        fail(OtaFailure::WAKE_WINDOW);
+        return;
+    }
+    uint32_t start = millis();
+    do {
+        if (!client.available()) {
+            if (!client.connected()) {
+                fail(state == State::BODY ? OtaFailure::TRUNCATED : OtaFailure::CLOSED);
+            } else if (millis() - lastDataAt >= DATA_TIMEOUT) {
+                fail(OtaFailure::TIMEOUT);
+            }
+            return;
+        }
+        lastDataAt = millis();
+        if (state == State::HEADERS) {
+            readHeaders();
+        } else {
+            readBody();
+        }
+    } while ((state == State::HEADERS || state == State::BODY) && millis() - start < SLICE);
+}
+
+// Header lines, as far as they have arrived
+void OtaUpdater::readHeaders() {
+    while (state == State::HEADERS && client.available()) {
+        int c = client.read();
+        if (c == '\n') {
+            line[lineLength] = '\0';
+            handleHeaderLine();
+            lineLength = 0;
+        } else if (c >= 0 && c != '\r' && lineLength < LINE_SIZE - 1) {
+            line[lineLength++] = static_cast<char>(c);
+        }
+    }
+}
+
+void OtaUpdater::handleHeaderLine() {
+    if (httpStatus == 0) {
+        const char* space = strchr(line, ' ');
+        httpStatus = space ? atoi(space + 1) : -1;
+        return;
+    }
+    if (lineLength == 0) {
+        headersDone();
+        return;
+    }
+
+    const char* value;
+    if ((value = headerValue(line, "Content-Length"))) {
+        bodyLength = strtoul(value, nullptr, 10);
+    } else if ((value = headerValue(line, "ETag"))) {
+        offeredVersion = strtoul(value + (*value == '"'), nullptr, 10);
+    } else if ((value = headerValue(line, "X-Firmware-Size"))) {
+        imageSize = strtoul(value, nullptr, 10);
+    } else if ((value = headerValue(line, "X-Firmware-CRC32"))) {
+        imageCrc = strtoul(value, nullptr, 16);
+    }
+}
+
+void OtaUpdater::headersDone() {
+    if (httpStatus == 304 || httpStatus == 404 ||
+        (httpStatus == 200 && (offeredVersion == WAKU_FIRMWARE_VERSION ||
+                               (refusedVersion && offeredVersion == refusedVersion) ||
+                               (slowVersion && offeredVersion == slowVersion)))) {
+        // Up to date, no firmware on the server, or a version not to apply
+        close();
+        return;
+    }
+    if (httpStatus != 200 || !imageSize || !bodyLength || !offeredVersion) {
+        fail(OtaFailure::BAD_RESPONSE);
+        return;
+    }
+    if (static_cast<long>(imageSize) > storage->maxSize()) {
+        fail(OtaFailure::TOO_LARGE);
+        return;
+    }
+    uint32_t start = micros();
+    bool opened = storage->open(imageSize);
+    flashMicros = micros() - start;
+    if (!opened) {
+        fail(OtaFailure::STORAGE);
+        return;
+    }
+    decoder.reset();
+    crc = 0;
+    state = State::BODY;
+}
+
+// One chunk of the body: decoded, checksummed and staged
+void OtaUpdater::readBody() {
+    uint8_t chunk[CHUNK_SIZE];
+    uint8_t output[HeatshrinkDecoder::MAX_OUTPUT];
+    int length = client.read(chunk, sizeof(chunk));
+    if (length <= 0) {
+        return;
+    }
+    received += length;
+    for (int i = 0; i < length && written < imageSize; i++) {
+        uint8_t produced = decoder.feed(chunk[i], output);
+        if (produced > imageSize - written) {
+            // Padding bits of the last byte read as a reference
+            produced = imageSize - written;
+        }
+        crc = crc32Update(crc, output, produced);
+        uint32_t start = micros();
+        for (uint8_t j = 0; j < produced; j++) {
+            if (storage->write(output[j]) != 1) {
+                fail(OtaFailure::STORAGE);
+                return;
+            }
+        }
+        flashMicros += micros() - start;
+        written += produced;
+    }
+
+    if (written == imageSize) {
+        complete();
+    } else if (received >= bodyLength) {
+        fail(OtaFailure::TRUNCATED);
+    }
+}
+
+void OtaUpdater::complete() {
+    if (crc != imageCrc) {
+        fail(OtaFailure::CRC);
+        return;
+    }
+    uint32_t start = micros();
+    storage->close();
+    flashMicros += micros() - start;
+    if (flashMicros / 1000 > MAX_COPY_MILLIS) {
+        LOG(OTA_COPY_TOO_SLOW, offeredVersion, flashMicros / 1000, MAX_COPY_MILLIS);
+        slowVersion = offeredVersion;
+        storage->clear();
+        failures++;
+        lastFailure = OtaFailure::COPY_TIME;
+        close();
+        return;
+    }
+    downloads++;
+    lastTransferMillis = millis() - startedAt;
+    lastCompressedBytes = received;
+    lastImageBytes = imageSize;
+    lastFlashMillis = flashMicros / 1000;
+    // Signed: a body that does not compress is larger than the image
+    LOG(OTA_STAGED, offeredVersion, lastTransferMillis / 1000,
+        static_cast<int32_t>(imageSize) - static_cast<int32_t>(received));
+    close();
+    state = State::STAGED;
+}
+
+void OtaUpdater::fail(OtaFailure failure) {
+    if (state == State::BODY) {
+        storage->close();
+        storage->clear();
+    }
+    failures++;
+    lastFailure = failure;
+    LOG(OTA_FAILED, LOG_STR(FAILURE_NAMES[static_cast<uint8_t>(failure)]), received);
+    close();
+}
+
+void OtaUpdater::close() {
+    client.stop();
+    state = State::IDLE;
+    RadioManager::hold(false);
+}
+
+// Copy the staged image over the sketch and reset. Does not return.
+void OtaUpdater::apply() {
+    ConfigStore::set(ConfigKey::FIRMWARE_APPLIED, offeredVersion);
+    // The copy runs with interrupts off and cannot feed the watchdog; give it
+    // the whole period. Staging the image took lastFlashMillis of flash work.
+    WDT.refresh();
+    storage->apply();
+}
+
+void OtaUpdater::printReport(const char* args) {
+    char text[112];     // The Checks line with every count at its widest
+    snprintf(text, sizeof(text), "Firmware %lu%s", static_cast<unsigned long>(WAKU_FIRMWARE_VERSION),
+             state == State::STAGED ? ", update staged" : state == State::IDLE ? "" : ", downloading");
+    Serial.println(text);
+    if (state == State::HEADERS || state == State::BODY) {
+        snprintf(text, sizeof(text), "Download: %lu of %lu bytes, %lu staged, %lu s",
+                 static_cast<unsigned long>(received), static_cast<unsigned long>(bodyLength),
+                 static_cast<unsigned long>(written), static_cast<unsigned long>((millis() - startedAt) / 1000));
+        Serial.println(text);
+    }
+    if (!WAKU_OTA_PULL) {
+        Serial.println("Pull updates off (WAKU_OTA_PULL)");
+        return;
+    }
+    snprintf(text, sizeof(text), "Checks: %lu, last %lu s ago, %lu downloads, %lu failed%s%s",
+             static_cast<unsigned long>(checks), static_cast<unsigned long>(checkedOnce ? (millis() - lastCheck) / 1000 : 0),
+             static_cast<unsigned long>(downloads), static_cast<unsigned long>(failures),
+             lastFailure == OtaFailure::COUNT ? "" : ", last: ",
+             lastFailure == OtaFailure::COUNT ? "" : FAILURE_NAMES[static_cast<uint8_t>(lastFailure)]);
+    Serial.println(text);
+    if (downloads) {
+        // What the compression saved on the air; negative if the body was the larger
+        int32_t savedPercent = lastImageBytes ? 100 - static_cast<int32_t>(lastCompressedBytes * 100 / lastImageBytes) : 0;
+        snprintf(text, sizeof(text), "Last download: %lu bytes for a %lu byte image (%ld%% saved) in %lu s",
+                 static_cast<unsigned long>(lastCompressedBytes), static_cast<unsigned long>(lastImageBytes),
+                 static_cast<long>(savedPercent), static_cast<unsigned long>(lastTransferMillis / 1000));
+        Serial.println(text);
+        snprintf(text, sizeof(text), "Staging flash time: %lu ms (the copy has %lu ms)",
+                 static_cast<unsigned long>(lastFlashMillis), static_cast<unsigned long>(MAX_COPY_MILLIS));
+        Serial.println(text);
+    }
+    if (slowVersion) {
+        snprintf(text, sizeof(text), "Not fetching %lu again: too slow to copy under the watchdog",
+                 static_cast<unsigned long>(slowVersion));
+        Serial.println(text);
+    }
+    if (refusedVersion) {
+        snprintf(text, sizeof(text), "Not fetching %lu again: it came up as another version",
+                 static_cast<unsigned long>(refusedVersion));
+        Serial.println(text);
+    }
+}
@@ -0,0 +1,158 @@
+#ifndef OTA_UPDATER_H
+#define OTA_UPDATER_H
+
+#include <Arduino.h>
+#include <WiFiS3.h>
+#include <OTAStorage.h>
+#include "build_config.h"
+#include "heatshrink_decoder.h"
+
+class Alarm;
+
+// Why a firmware check or download was dropped
+enum class OtaFailure : uint8_t {
+    CONNECT,
+    BAD_RESPONSE,       // Not 200/304, or a header missing
+    TOO_LARGE,          // For the staging area
+    STORAGE,            // Staging area would not open or take a byte
+    TIMEOUT,
+    CLOSED,             // Before the body
+    TRUNCATED,
+    CRC,
+    WAKE_WINDOW,        // Cut short by the run-up to the window
+    COPY_TIME,          // Staging took longer than the copy may, see MAX_COPY_MILLIS
+    COUNT
+};
+
+// Firmware updates, both ways, from the network task:
+//
+// Push: ArduinoOTA.poll(), for uploads from the Arduino IDE, between network
+// cycles. The upload is received and applied inside that call, so it is only
+// made outside the wake window.
+//
+// Pull (WAKU_OTA_PULL): once an hour the home server is asked for
+// GET /api/device/firmware with If-None-Match: "WAKU_FIRMWARE_VERSION". A
+// 304 means up to date. A 200 carries the image compressed in heatshrink's
+// format (HeatshrinkDecoder), with its size and CRC-32 in X-Firmware-Size and
+// X-Firmware-CRC32 and its version as the ETag. The body is read a slice at a
+// time between network cycles, decoded through the 256-byte window and
+// written to the staging area (InternalStorage) as it arrives; nothing close
+// to the image size is ever held in RAM. The image is kept only if its size
+// and CRC-32 match. It replaces the running sketch (and the device resets)
+// at the next network cycle outside the wake window and APPLY_MARGIN before
+// it.
+//
+// The copy over the sketch (InternalStorage.apply()) runs from RAM with
+// interrupts off, inside the library, so the watchdog cannot be fed during
+// it: it has WATCHDOG_TIMEOUT (5 s) from the refresh before it. It erases and
+// programs as many blocks as staging the image did, so the time spent in the
+// staging area's open() and write() is measured on the device as an estimate
+// of the copy. An image whose staging took over MAX_COPY_MILLIS is dropped
+// instead of applied, and that version is not fetched again. IDE uploads
+// (push) are applied inside ArduinoOTA without this check, and are only taken
+// while no download or staged image is using the storage.
+//
+// The version being applied is saved first. If the device comes back up
+// running another one, the image did not carry the version it was offered
+// as, and that version is not fetched again, so a forgotten version bump
+// cannot turn into an update loop.
+class OtaUpdater {
+public:
+    // host, port and ca as for ServerClient; storage is the staging area;
+    // pushPoll runs ArduinoOTA.poll(), whose globals live in waku.ino
+    static void begin(const char* host, int port, const char* ca, OTAStorage& storage, void (*pushPoll)());
+
+    // Network cycle, holding wifiMutex: apply a staged image, or start a
+    // check when one is due and WiFi is joined
+    static void cycle(Alarm* alarm);
+
+    // Between cycles, holding wifiMutex: push uploads, then the next slice
+    // of a download
+    static void poll(Alarm* alarm);
+
+    // Console handler: version, last check and the last download's time
+    // and compression saving
+    static void printReport(const char* args);
+
+    // Bytes of static storage, for ram_budget.h. Buffers the WiFi library
+    // allocates for an open connection are not counted.
+    static constexpr size_t staticBytes();
+
+private:
+    enum class State : uint8_t { IDLE, HEADERS, BODY, STAGED };
+
+    static const uint32_t FIRST_CHECK_DELAY = 120000UL;     // ms after boot
+    static const uint32_t CHECK_INTERVAL = 3600000UL;       // ms
+    static const uint32_t DATA_TIMEOUT = 15000UL;           // ms without a byte before a download is dropped
+    static const int APPLY_MARGIN = 20;                     // min before the wake window with no downloads or swaps
+    static const uint32_t SLICE = 200;                      // ms of reading per look between cycles
+    static const size_t CHUNK_SIZE = 64;
+    static const size_t LINE_SIZE = 64;     // Header lines are cut here
+    // Staging flash time allowed for an image, against the 5 s watchdog. The
+    // copy programs in larger units than staging, so it should be faster.
+    static const uint32_t MAX_COPY_MILLIS = 3500;
+
+    static const char* host;
+    static int port;
+    static const char* caCert;
+    static OTAStorage* storage;
+    static void (*pushPoll)();
+#if WAKU_USE_TLS
+    static WiFiSSLClient client;
+#else
+    static WiFiClient client;
+#endif
+    static HeatshrinkDecoder decoder;
+
+    static State state;
+    static char line[LINE_SIZE];
+    static uint8_t lineLength;
+    static int httpStatus;              // 0 until the status line is in
+    static uint32_t offeredVersion;     // ETag of the response
+    static uint32_t imageSize;          // X-Firmware-Size
+    static uint32_t imageCrc;           // X-Firmware-CRC32
+    static uint32_t bodyLength;         // Content-Length: compressed size
+    static uint32_t received;           // Compressed bytes read
+    static uint32_t written;            // Image bytes staged
+    static uint32_t crc;
+    static uint32_t flashMicros;        // In storage->open() and write(): the flash work the copy repeats
+    static uint32_t startedAt;          // millis() of the check
+    static uint32_t lastDataAt;         // millis()
+    static uint32_t lastCheck;          // millis()
+    static bool checkedOnce;
+    static uint32_t refusedVersion;     // Applied once and did not come up; 0 if none
+    static uint32_t slowVersion;        // Staged too slowly to copy under the watchdog; 0 if none
+
+    // Since boot
+    static uint32_t checks;
+    static uint32_t downloads;
+    static uint32_t failures;
+    static OtaFailure lastFailure;
+    static uint32_t lastTransferMillis;
+    static uint32_t lastCompressedBytes;
+    static uint32_t lastImageBytes;
+    static uint32_t lastFlashMillis;    // Staging flash time of the last image staged
+
+    static bool nearWakeWindow(Alarm* alarm);
+    static bool startCheck();
+    static void readHeaders();
+    static void handleHeaderLine();
+    static void headersDone();
+    static void readBody();
+    static void complete();
+    static void fail(OtaFailure failure);
+    static void close();
+    static void apply();
+};
+
+constexpr size_t OtaUpdater::staticBytes() {
+    return sizeof(host) + sizeof(port) + sizeof(caCert) + sizeof(storage) + sizeof(pushPoll) + sizeof(client)
+         + sizeof(decoder) + sizeof(state) + sizeof(line) + sizeof(lineLength) + sizeof(httpStatus)
+         + sizeof(offeredVersion) + sizeof(imageSize) + sizeof(imageCrc) + sizeof(bodyLength) + sizeof(received)
+         + sizeof(written) + sizeof(crc) + sizeof(flashMicros) + sizeof(startedAt) + sizeof(lastDataAt)
+         + sizeof(lastCheck) + sizeof(checkedOnce) + sizeof(refusedVersion) + sizeof(slowVersion) + sizeof(checks)
+         + sizeof(downloads) + sizeof(failures) + sizeof(lastFailure) + sizeof(lastTransferMillis)
+         + sizeof(lastCompressedBytes) + sizeof(lastImageBytes) + sizeof(lastFlashMillis);
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include "profiler.h"
+
+#if WAKU_PROFILING
+
+#if !defined(ARDUINO)
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#endif
+
+ProbeStats Profiler::probes[static_cast<uint8_t>(ProbeId::COUNT)];
+
+const char* const Profiler::PROBE_NAMES[static_cast<uint8_t>(ProbeId::COUNT)] = {
+    "alarm_task",
+    "pulse_isr",
+    "button_isr",
+    "oled_display",
+    "http_send",
+    "http_request"
+};
+
+#if defined(ARDUINO)
+// Probes run in interrupts too, so the update masks interrupts and restores
+// the previous state instead of unconditionally re-enabling them
+#define PROFILER_LOCK() uint32_t primask = __get_PRIMASK(); __disable_irq()
+#define PROFILER_UNLOCK() __set_PRIMASK(primask)
+#else
+static std::mutex profilerMutex;
+#define PROFILER_LOCK() std::lock_guard<std::mutex> lock(profilerMutex)
+#define PROFILER_UNLOCK() do {} while (0)
+#endif
+
+static uint8_t log2Bucket(uint32_t ticks) {
+    return ticks ? static_cast<uint8_t>(31 - __builtin_clz(ticks)) : 0;
+}
+
+void Profiler::record(ProbeId id, uint32_t ticks) {
+    uint8_t bucket = log2Bucket(ticks);
+
+    PROFILER_LOCK();
+    ProbeStats& probe = probes[static_cast<uint8_t>(id)];
+    if (probe.count == 0 || ticks < probe.minTicks) {
+        probe.minTicks = ticks;
+    }
+    if (ticks > probe.maxTicks) {
+        probe.maxTicks = ticks;
+    }
+    probe.count++;
+    probe.totalTicks += ticks;
+    if (probe.histogram[bucket] < UINT16_MAX) {
+        probe.histogram[bucket]++;
+    }
+    PROFILER_UNLOCK();
+}
+
+void Profiler::reset() {
+    PROFILER_LOCK();
+    memset(probes, 0, sizeof(probes));
+    PROFILER_UNLOCK();
+}
+
+ProbeStats Profiler::get(ProbeId id) {
+    PROFILER_LOCK();
+    ProbeStats stats = probes[static_cast<uint8_t>(id)];
+    PROFILER_UNLOCK();
+    return stats;
+}
+
+#if defined(ARDUINO)
+
+void Profiler::printReport(const char* args) {
+    if (args && strcmp(args, "reset") == 0) {
+        reset();
+        Serial.println("Profiler reset");
+        return;
+    }
+
+    uint32_t perMicro = ticksPerMicro();
+    Serial.println("Probe            count     min_us    mean_us     max_us");
+    for (uint8_t i = 0; i < static_cast<uint8_t>(ProbeId::COUNT); i++) {
+        ProbeStats stats = get(static_cast<ProbeId>(i));
+        char row[64];
+        snprintf(row, sizeof(row), "%-14s %7lu %10lu %10lu %10lu",
+                 PROBE_NAMES[i],
+                 static_cast<unsigned long>(stats.count),
+                 static_cast<unsigned long>(stats.minTicks / perMicro),
+                 static_cast<unsigned long>(stats.meanTicks() / perMicro),
+                 static_cast<unsigned long>(stats.maxTicks / perMicro));
+        Serial.println(row);
+
+        if (stats.count == 0) {
+            continue;
+        }
+        // Non-empty histogram buckets as "2^n:count", n = log2 of the cycle count
+        Serial.print("    ");
+        for (uint8_t b = 0; b < ProbeStats::HISTOGRAM_BUCKETS; b++) {
+            if (stats.histogram[b]) {
+                Serial.print("2^");
+                Serial.print(b);
+                Serial.print(":");
+                Serial.print(stats.histogram[b]);
+                Serial.print(" ");
+            }
+        }
+        Serial.println();
+    }
+}
+
+#else
+
+void Profiler::printReport(const char* /*args*/) {
+    for (uint8_t i = 0; i < static_cast<uint8_t>(ProbeId::COUNT); i++) {
+        ProbeStats stats = get(static_cast<ProbeId>(i));
+        printf("%-14s %7u %10u %10u %10u\n", PROBE_NAMES[i], stats.count,
+               stats.minTicks / 1000, stats.meanTicks() / 1000, stats.maxTicks / 1000);
+    }
+}
+
+#endif
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include "build_config.h"
+
+// Scoped timing probes for hot paths. Each probe has a fixed slot with
+// count, min/max/mean and a log2 histogram; nothing is allocated and a probe
+// costs two counter reads plus a short critical section.
+//
+//   void DisplayManager::flushOled() {
+//       PROFILE_SCOPE(ProbeId::OLED_DISPLAY);
+//       oled.display();
+//   }
+//
+// On the device the clock is the DWT cycle counter; in a host build it is
+// std::chrono::steady_clock in nanoseconds. With WAKU_PROFILING 0 the macros
+// expand to nothing.
+
+enum class ProbeId : uint8_t {
+    ALARM_TASK,     // One vAlarmTask cycle
+    PULSE_ISR,      // CO2 PWM edge interrupt
+    BUTTON_ISR,
+    OLED_DISPLAY,   // SSD1306 frame transfer
+    HTTP_SEND,      // Connect and send the device update
+    HTTP_REQUEST,   // Device update, connect to response handled
+    COUNT
+};
+
+#if WAKU_PROFILING
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#include "cycle_counter.h"
+#else
+#include <chrono>
+#endif
+
+struct ProbeStats {
+    static const uint8_t HISTOGRAM_BUCKETS = 32;
+
+    uint32_t count;
+    uint32_t minTicks;
+    uint32_t maxTicks;
+    uint64_t totalTicks;
+    uint16_t histogram[HISTOGRAM_BUCKETS];  // Bucket n: 2^n <= ticks < 2^(n+1), saturating
+
+    uint32_t meanTicks() const { return count ? static_cast<uint32_t>(totalTicks / count) : 0; }
+};
+
+class Profiler {
+private:
+    static ProbeStats probes[static_cast<uint8_t>(ProbeId::COUNT)];
+    static const char* const PROBE_NAMES[static_cast<uint8_t>(ProbeId::COUNT)];
+
+public:
+    static uint32_t now() {
+#if defined(ARDUINO)
+        return CycleCounter::now();
+#else
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    static uint32_t ticksPerMicro() {
+#if defined(ARDUINO)
+        return CycleCounter::cyclesPerMicro();
+#else
+        return 1000;
+#endif
+    }
+
+    // Safe from interrupts and tasks
+    static void record(ProbeId id, uint32_t ticks);
+    static void reset();
+
+    static ProbeStats get(ProbeId id);
+    static const char* name(ProbeId id) { return PROBE_NAMES[static_cast<uint8_t>(id)]; }
+
+    // Console handler: "prof" prints the table, "prof reset" clears it
+    static void printReport(const char* args);
+};
+
+class ProfileScope {
+private:
+    const ProbeId id;
+    const uint32_t start;
+
+public:
+    explicit ProfileScope(ProbeId probe) : id(probe), start(Profiler::now()) {}
+    ~ProfileScope() { Profiler::record(id, Profiler::now() - start); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+// Time the rest of the enclosing scope
+#define PROFILE_SCOPE(id) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(id)
+
+// For spans that do not fit one scope: take a timestamp, record later
+#define PROFILE_TIMESTAMP() Profiler::now()
+#define PROFILE_RECORD_SINCE(id, start) Profiler::record((id), Profiler::now() - (start))
+
+#else
+
+#define PROFILE_SCOPE(id) do {} while (0)
+#define PROFILE_TIMESTAMP() 0U
+#define PROFILE_RECORD_SINCE(id, start) do { (void)(start); } while (0)
+
+#endif
+
+#endif
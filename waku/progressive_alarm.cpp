@@ -37,18 +37,6 @@ void ProgressiveAlarm::calculateLEDIntensities(float progress, int& red, int& gr
     blue = constrain((progress - 0.6) / 0.4 * 120, 0, 120);
 }
 
-void ProgressiveAlarm::playNextNote() {
-    if (currentNoteIndex >= THEME_LENGTH) {
-        currentNoteIndex = 0;  // Loop back to start
-    }
-    
-    // Play the current note
-    tone(BUZZER_PIN, THEME_NOTES[currentNoteIndex], NOTE_DURATIONS[currentNoteIndex]);
-    lastBuzzerTime = millis();
-    isBuzzerActive = true;
-    currentNoteIndex++;
-}
-
 void ProgressiveAlarm::update(float progress) {
     unsigned long currentMillis = millis();
     
@@ -67,33 +55,43 @@ void ProgressiveAlarm::update(float progress) {
     analogWrite(GREEN_PIN, green);
     analogWrite(BLUE_PIN, blue);
     
-    // Buzzer control
-    if (progress >= BUZZER_START) {
-        if (!isBuzzerActive) {
-            // Start next note
-            playNextNote();
-        } else if (currentMillis - lastBuzzerTime >= NOTE_DURATIONS[currentNoteIndex > 0 ? currentNoteIndex - 1 : THEME_LENGTH - 1]) {
-            // Previous note finished, turn off buzzer and prepare for next note
-            noTone(BUZZER_PIN);
-            noTone(BUZZER_OVERDRIVE_PIN);
-            isBuzzerActive = false;
+    // Melody control
+#if WAKU_SYNTH_ENABLED
+    const float soundStart = SYNTH_START;
+#else
+    const float soundStart = BUZZER_START;
+#endif
+    if (progress >= soundStart) {
+#if WAKU_SYNTH_ENABLED
+        // Volume follows dawn progress, squared so the start is gentle
+        float level = (progress - SYNTH_START) / (1.0 - SYNTH_START);
+        synth.setVolume(level * level);
+        synth.start();
+#endif
+        if (!melody.isRunning()) {
+            melody.start(currentMillis);
+        } else {
+            melody.service(currentMillis);
         }
     } else {
-        noTone(BUZZER_PIN);
+        melody.stop();  // Resets to start of theme
         noTone(BUZZER_OVERDRIVE_PIN);
-        isBuzzerActive = false;
-        currentNoteIndex = 0;  // Reset to start of theme
-    }   
+#if WAKU_SYNTH_ENABLED
+        synth.stop();
+#endif
+    }
 }
 
 void ProgressiveAlarm::stop() {
     analogWrite(RED_PIN, 0);
     analogWrite(GREEN_PIN, 0);
     analogWrite(BLUE_PIN, 0);
+    melody.stop();  // Reset theme position
+#if WAKU_SYNTH_ENABLED
+    synth.stop();
+#endif
     noTone(BUZZER_PIN);
     noTone(BUZZER_OVERDRIVE_PIN);
     flashState = false;
-    isBuzzerActive = false;
-    currentNoteIndex = 0;  // Reset theme position
     rampStartTime = millis(); // Reset ramp start time when stopping
 } 
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include "radio_manager.h"
+#include "alarm.h"
+#include "clock_sync.h"
+#include "log.h"
+
+static const char* const MODE_NAMES[] = {"active", "power save", "off"};
+
+static_assert(sizeof(MODE_NAMES) / sizeof(MODE_NAMES[0]) == static_cast<uint8_t>(RadioMode::COUNT), "Name every radio mode");
+
+// The module comes up associated-capable with power save off
+RadioMode RadioManager::mode = RadioMode::ACTIVE;
+uint32_t RadioManager::modeSince = 0;
+bool RadioManager::inRunUp = false;
+bool RadioManager::ready = false;
+bool RadioManager::notReadyLogged = false;
+bool RadioManager::batch = false;
+bool RadioManager::held = false;
+bool RadioManager::lastBatchFailed = false;
+uint32_t RadioManager::lastBatch = 0;
+uint32_t RadioManager::batchStart = 0;
+uint32_t RadioManager::runUpStart = 0;
+uint32_t RadioManager::lastUpdate = 0;
+bool RadioManager::updatedOnce = false;
+RadioManager::NightStats RadioManager::night = {};
+RadioManager::NightStats RadioManager::lastNight = {};
+bool RadioManager::lastNightValid = false;
+
+void RadioManager::account() {
+    uint32_t now = millis();
+    night.modeMillis[static_cast<uint8_t>(mode)] += now - modeSince;
+    modeSince = now;
+}
+
+void RadioManager::switchTo(RadioMode next) {
+    if (next == mode) {
+        return;
+    }
+    account();
+    switch (next) {
+        case RadioMode::OFF:
+            WiFi.disconnect();
+            WiFi.end();
+            break;
+        case RadioMode::POWER_SAVE:
+            WiFi.lowPowerMode();
+            break;
+        default:
+            WiFi.noLowPowerMode();
+            break;
+    }
+    mode = next;
+}
+
+bool RadioManager::beginCycle(Alarm* alarm, bool urgent) {
+    bool runUp = alarm && alarm->isNearWakeWindow(READY_MARGIN);
+    if (runUp && !inRunUp) {
+        // The night is over; make sure the window starts on a fresh
+        // schedule and a freshly checked clock
+        closeNight();
+        ready = false;
+        notReadyLogged = false;
+        runUpStart = millis();
+        ClockSync::requestSync();
+    }
+    inRunUp = runUp;
+
+    if (runUp) {
+        if (!ready && !notReadyLogged && alarm->isNearWakeWindow(0)) {
+            LOG(RADIO_NOT_READY);
+            notReadyLogged = true;
+        }
+        batch = false;
+        switchTo(RadioMode::ACTIVE);
+        return true;
+    }
+
+#if WAKU_RADIO_DUTY_CYCLE
+    if (held) {
+        // The batch that started the transfer stays up until it is done
+        batch = false;
+        switchTo(RadioMode::POWER_SAVE);
+        return true;
+    }
+    // Stay up until the server has been reached once after boot. Urgent
+    // telemetry cuts the wait short, unless the server was just unreachable:
+    // it would only be again, at a join every cycle.
+    if (mode == RadioMode::OFF && updatedOnce && (!urgent || lastBatchFailed) && millis() - lastBatch < BATCH_INTERVAL) {
+        return false;
+    }
+    if (!batch) {
+        batchStart = millis();
+    }
+    batch = true;
+#endif
+    switchTo(RadioMode::POWER_SAVE);
+    return true;
+}
+
+void RadioManager::joined(uint32_t joinMillis) {
+    night.joins++;
+    night.joinMillis += joinMillis;
+    if (mode == RadioMode::POWER_SAVE) {
+        WiFi.lowPowerMode();
+    } else {
+        WiFi.noLowPowerMode();
+    }
+}
+
+void RadioManager::recordUpdate(bool success) {
+    if (success) {
+        lastUpdate = millis();
+        updatedOnce = true;
+    }
+}
+
+bool RadioManager::exchangeWanted() {
+    return batch || (inRunUp && !ready);
+}
+
+void RadioManager::endCycle() {
+    if (inRunUp && !ready && updatedOnce && static_cast<int32_t>(lastUpdate - runUpStart) >= 0 && ClockSync::isSynced()) {
+        ready = true;
+    }
+#if WAKU_RADIO_DUTY_CYCLE
+    // A failed batch is retried at the next one, not every cycle
+    if (batch && updatedOnce && !held) {
+        batch = false;
+        lastBatch = millis();
+        lastBatchFailed = static_cast<int32_t>(lastUpdate - batchStart) < 0;
+        switchTo(RadioMode::OFF);
+    }
+#endif
+}
+
+void RadioManager::closeNight() {
+    account();
+    lastNight = night;
+    lastNightValid = true;
+    uint32_t onSeconds = (night.modeMillis[static_cast<uint8_t>(RadioMode::ACTIVE)] +
+                          night.modeMillis[static_cast<uint8_t>(RadioMode::POWER_SAVE)]) / 1000;
+    LOG(RADIO_NIGHT, onSeconds, night.joins, chargeTenthsMah(night));
+    night = NightStats{};
+}
+
+// Joins are counted at JOIN_MA instead of the power save current they
+// otherwise fall under
+uint32_t RadioManager::chargeTenthsMah(const NightStats& stats) {
+    uint32_t powerSave = stats.modeMillis[static_cast<uint8_t>(RadioMode::POWER_SAVE)];
+    powerSave = powerSave > stats.joinMillis ? powerSave - stats.joinMillis : 0;
+    uint64_t milliAmpMillis = static_cast<uint64_t>(stats.modeMillis[static_cast<uint8_t>(RadioMode::ACTIVE)]) * ACTIVE_MA +
+                              static_cast<uint64_t>(powerSave) * POWER_SAVE_MA +
+                              static_cast<uint64_t>(stats.joinMillis) * JOIN_MA;
+    return static_cast<uint32_t>(milliAmpMillis / 360000ULL);
+}
+
+void RadioManager::printNight(const char* label, const NightStats& stats) {
+    uint32_t charge = chargeTenthsMah(stats);
+    char line[96];
+    snprintf(line, sizeof(line), "%s: %lu s active, %lu s power save, %lu s off, %u joins (%lu s), ~%lu.%lu mAh",
+             label,
+             static_cast<unsigned long>(stats.modeMillis[static_cast<uint8_t>(RadioMode::ACTIVE)] / 1000),
+             static_cast<unsigned long>(stats.modeMillis[static_cast<uint8_t>(RadioMode::POWER_SAVE)] / 1000),
+             static_cast<unsigned long>(stats.modeMillis[static_cast<uint8_t>(RadioMode::OFF)] / 1000),
+             stats.joins, static_cast<unsigned long>(stats.joinMillis / 1000),
+             static_cast<unsigned long>(charge / 10), static_cast<unsigned long>(charge % 10));
+    Serial.println(line);
+}
+
+void RadioManager::printReport(const char* args) {
+    Serial.print("Mode: ");
+    Serial.print(MODE_NAMES[static_cast<uint8_t>(mode)]);
+    if (inRunUp) {
+        Serial.println(ready ? " (wake window, ready)" : " (wake window, not synced yet)");
+    } else {
+        Serial.println(WAKU_RADIO_DUTY_CYCLE ? " (duty cycling: no config push, local API or IDE upload until the run-up)" : "");
+    }
+
+    // Counted up to now without touching the network task's figures
+    NightStats current = night;
+    current.modeMillis[static_cast<uint8_t>(mode)] += millis() - modeSince;
+    printNight("Since last wake", current);
+    if (lastNightValid) {
+        printNight("Last night", lastNight);
+    }
+}
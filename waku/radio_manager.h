@@ -0,0 +1,103 @@
+#ifndef RADIO_MANAGER_H
+#define RADIO_MANAGER_H
+
+#include <Arduino.h>
+#include <WiFiS3.h>
+#include "build_config.h"
+
+class Alarm;
+
+enum class RadioMode : uint8_t {
+    ACTIVE,         // Associated, modem power save off: lowest latency
+    POWER_SAVE,     // Associated, modem sleeps between beacons (WiFi.lowPowerMode)
+    OFF,            // WiFi stopped (WiFi.end)
+    COUNT
+};
+
+// When the WiFi radio is up. From READY_MARGIN minutes before the wake
+// window (T-40) until the window ends the link is ACTIVE, and the first
+// network cycles in there bring the configuration and the clock up to date,
+// so the window never starts on a stale schedule. Outside it, with
+// WAKU_RADIO_DUTY_CYCLE, the radio is OFF between batches: every
+// BATCH_INTERVAL (or right away for urgent telemetry, such as the alarm
+// being stopped) it joins, exchanges what is pending and stops again. A
+// batch that could not reach the server is retried at the next interval,
+// urgent or not. Without duty cycling (the default while config push or
+// the local API need the link) it stays associated in POWER_SAVE.
+//
+// Time in each mode and the joins are counted per night (from the end of
+// one wake window to the run-up to the next) and turned into a rough energy
+// estimate for the WiFi module.
+//
+// Network task only.
+class RadioManager {
+public:
+    // Start of a network cycle: pick the mode. False while the radio is
+    // meant to stay off this cycle (no WiFi calls at all then).
+    static bool beginCycle(Alarm* alarm, bool urgent);
+
+    // The module joined the network (joinMillis spent on it): re-apply the
+    // modem power save setting, which does not survive WiFi.end()
+    static void joined(uint32_t joinMillis);
+
+    // Result of a device update
+    static void recordUpdate(bool success);
+
+    // A batch or the run-up to the wake window wants a device update now,
+    // whatever the telemetry interval says
+    static bool exchangeWanted();
+
+    // End of the cycle's exchanges: a batch ends by stopping the radio
+    static void endCycle();
+
+    // Keep the radio up past the end of a batch, with no new batches, while
+    // a transfer that spans cycles (a firmware download) runs
+    static void hold(bool on) { held = on; }
+    static bool isHeld() { return held; }
+
+    // Associated or about to be; false while OFF
+    static bool isUp() { return mode != RadioMode::OFF; }
+
+    // Console handler: mode, readiness and this and last night's radio time
+    static void printReport(const char* args);
+
+private:
+    struct NightStats {
+        uint32_t modeMillis[static_cast<uint8_t>(RadioMode::COUNT)];
+        uint32_t joinMillis;
+        uint16_t joins;
+    };
+
+    static const int READY_MARGIN = 15;                 // min before T-40 that the radio is brought up
+    static const uint32_t BATCH_INTERVAL = 600000UL;    // ms between batches with the radio off
+
+    // Rough WiFi module currents (mA), for the estimate only
+    static const uint16_t ACTIVE_MA = 95;
+    static const uint16_t POWER_SAVE_MA = 25;
+    static const uint16_t JOIN_MA = 130;
+
+    static RadioMode mode;
+    static uint32_t modeSince;          // millis()
+    static bool inRunUp;                // Within READY_MARGIN of the window, or in it
+    static bool ready;                  // Server exchange done and clock synced in the run-up
+    static bool notReadyLogged;
+    static bool batch;                  // Up for a batch, off again at endCycle()
+    static bool held;                   // See hold()
+    static bool lastBatchFailed;        // No successful update in the last batch
+    static uint32_t lastBatch;          // millis() at the end of the last batch
+    static uint32_t batchStart;         // millis()
+    static uint32_t runUpStart;         // millis()
+    static uint32_t lastUpdate;         // millis() of the last successful device update
+    static bool updatedOnce;
+    static NightStats night;
+    static NightStats lastNight;
+    static bool lastNightValid;
+
+    static void switchTo(RadioMode next);
+    static void account();
+    static void closeNight();
+    static uint32_t chargeTenthsMah(const NightStats& stats);
+    static void printNight(const char* label, const NightStats& stats);
+};
+
+#endif
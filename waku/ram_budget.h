@@ -0,0 +1,92 @@
+#ifndef RAM_BUDGET_H
+#define RAM_BUDGET_H
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include "build_config.h"
+#include "task_manager.h"
+#include "activity_detector.h"
+
+// RAM taken by each subsystem's long-lived objects, computed at compile time.
+// A subsystem that grows past its budget fails the build instead of failing
+// an allocation at boot. With WAKU_STATIC_ALLOCATION these bytes are all in
+// .bss; otherwise the same amounts come from the heap at startup.
+namespace RamBudget {
+#if WAKU_COOPERATIVE_TASKS
+    constexpr size_t TASKS = (COOPERATIVE_STACK_SIZE + NETWORK_STACK_SIZE + LOG_STACK_SIZE
+                              + SUPERVISOR_STACK_SIZE) * sizeof(StackType_t)
+                           + 4 * sizeof(StaticTask_t);
+#else
+    constexpr size_t TASKS = (ALARM_STACK_SIZE + NETWORK_STACK_SIZE + DISPLAY_STACK_SIZE + LOG_STACK_SIZE
+                              + SUPERVISOR_STACK_SIZE) * sizeof(StackType_t)
+                           + 5 * sizeof(StaticTask_t);
+#endif
+    constexpr size_t KERNEL_OBJECTS = 3 * sizeof(StaticSemaphore_t) + sizeof(StaticQueue_t)
+                                    + ALARM_STATE_QUEUE_LENGTH * sizeof(AlarmState)
+                                    + sizeof(StaticEventGroup_t);
+    constexpr size_t ALARM = sizeof(Alarm) + sizeof(ActivityDetector) + sizeof(ButtonHandler);
+    constexpr size_t AUDIO = sizeof(SoundMeter);
+    constexpr size_t NETWORK = sizeof(ServerClient) + sizeof(CO2Sensor);
+    constexpr size_t CLOCK = sizeof(SntpClient);
+    constexpr size_t DNS = DnsCache::staticBytes();
+    constexpr size_t LOCAL_API = LocalApi::staticBytes();
+    constexpr size_t OTA = OtaUpdater::staticBytes();
+    constexpr size_t LOGGING = sizeof(LogRecord) * Log::RING_SIZE + Log::RING_SIZE * sizeof(uint32_t);
+    constexpr size_t DISPLAY_MANAGER = sizeof(DisplayManager);
+    constexpr size_t TOTAL = TASKS + KERNEL_OBJECTS + ALARM + AUDIO + NETWORK + CLOCK + DNS + LOCAL_API + OTA
+                         + LOGGING + DISPLAY_MANAGER;
+
+    // Budgets (bytes). The rest of the 32 KB goes to the WiFi driver, the
+    // FreeRTOS idle/timer tasks, the interrupt stack and String temporaries.
+    constexpr size_t TASKS_BUDGET = 6400;
+    constexpr size_t KERNEL_OBJECTS_BUDGET = 512;
+    constexpr size_t ALARM_BUDGET = 1536;   // Includes the synth buffers when enabled
+    constexpr size_t AUDIO_BUDGET = 1024;
+    constexpr size_t NETWORK_BUDGET = 512;
+    constexpr size_t CLOCK_BUDGET = 1152;   // Mostly the UDP socket's receive FIFO
+    constexpr size_t DNS_BUDGET = 128;
+    constexpr size_t LOCAL_API_BUDGET = 576;    // Mostly the response buffer and the snapshot
+    constexpr size_t OTA_BUDGET = 512;          // Mostly the decoder's 256-byte window
+    constexpr size_t LOGGING_BUDGET = 768;
+    constexpr size_t DISPLAY_MANAGER_BUDGET = 256;
+    constexpr size_t TOTAL_BUDGET = 12352;
+
+    static_assert(TASKS <= TASKS_BUDGET, "Task stacks exceed their RAM budget");
+    static_assert(KERNEL_OBJECTS <= KERNEL_OBJECTS_BUDGET, "Kernel objects exceed their RAM budget");
+    static_assert(ALARM <= ALARM_BUDGET, "Alarm subsystem exceeds its RAM budget");
+    static_assert(AUDIO <= AUDIO_BUDGET, "Sound meter exceeds its RAM budget");
+    static_assert(NETWORK <= NETWORK_BUDGET, "Network subsystem exceeds its RAM budget");
+    static_assert(CLOCK <= CLOCK_BUDGET, "SNTP client exceeds its RAM budget");
+    static_assert(DNS <= DNS_BUDGET, "DNS cache exceeds its RAM budget");
+    static_assert(LOCAL_API <= LOCAL_API_BUDGET, "Local API exceeds its RAM budget");
+    static_assert(OTA <= OTA_BUDGET, "OTA updater exceeds its RAM budget");
+    static_assert(LOGGING <= LOGGING_BUDGET, "Log ring exceeds its RAM budget");
+    static_assert(DISPLAY_MANAGER <= DISPLAY_MANAGER_BUDGET, "Display subsystem exceeds its RAM budget");
+    static_assert(TOTAL <= TOTAL_BUDGET, "Long-lived objects exceed the total RAM budget");
+}
+
+inline void printRamBudgetLine(const char* name, size_t used, size_t budget) {
+    Serial.print(name);
+    Serial.print(": ");
+    Serial.print(used);
+    Serial.print(" / ");
+    Serial.println(budget);
+}
+
+inline void printRamBudget() {
+    Serial.println(WAKU_STATIC_ALLOCATION ? "RAM budget (bytes, static):" : "RAM budget (bytes, heap):");
+    printRamBudgetLine("Tasks", RamBudget::TASKS, RamBudget::TASKS_BUDGET);
+    printRamBudgetLine("Kernel objects", RamBudget::KERNEL_OBJECTS, RamBudget::KERNEL_OBJECTS_BUDGET);
+    printRamBudgetLine("Alarm", RamBudget::ALARM, RamBudget::ALARM_BUDGET);
+    printRamBudgetLine("Audio", RamBudget::AUDIO, RamBudget::AUDIO_BUDGET);
+    printRamBudgetLine("Network", RamBudget::NETWORK, RamBudget::NETWORK_BUDGET);
+    printRamBudgetLine("Clock", RamBudget::CLOCK, RamBudget::CLOCK_BUDGET);
+    printRamBudgetLine("DNS cache", RamBudget::DNS, RamBudget::DNS_BUDGET);
+    printRamBudgetLine("Local API", RamBudget::LOCAL_API, RamBudget::LOCAL_API_BUDGET);
+    printRamBudgetLine("OTA", RamBudget::OTA, RamBudget::OTA_BUDGET);
+    printRamBudgetLine("Logging", RamBudget::LOGGING, RamBudget::LOGGING_BUDGET);
+    printRamBudgetLine("Display", RamBudget::DISPLAY_MANAGER, RamBudget::DISPLAY_MANAGER_BUDGET);
+    printRamBudgetLine("Total", RamBudget::TOTAL, RamBudget::TOTAL_BUDGET);
+}
+
+#endif
@@ -0,0 +1,74 @@
+#include "serial_console.h"
+
+SerialConsole::Command SerialConsole::commands[SerialConsole::MAX_COMMANDS];
+uint8_t SerialConsole::commandCount = 0;
+char SerialConsole::line[SerialConsole::LINE_LENGTH];
+uint8_t SerialConsole::lineLength = 0;
+
+bool SerialConsole::registerCommand(const char* name, const char* help, Handler handler) {
+    if (commandCount >= MAX_COMMANDS) {
+        Serial.println("ERROR: Console command table full");
+        return false;
+    }
+    commands[commandCount++] = {name, help, handler};
+    return true;
+}
+
+void SerialConsole::poll() {
+    while (Serial.available() > 0) {
+        int c = Serial.read();
+        if (c < 0) {
+            break;
+        }
+
+        if (c == '\r' || c == '\n') {
+            if (lineLength > 0) {
+                line[lineLength] = '\0';
+                execute();
+                lineLength = 0;
+            }
+        } else if (lineLength < LINE_LENGTH - 1) {
+            line[lineLength++] = static_cast<char>(c);
+        }
+        // Overlong lines are truncated; the command still runs on newline
+    }
+}
+
+void SerialConsole::execute() {
+    // Split "name args" in place
+    char* args = strchr(line, ' ');
+    if (args) {
+        *args++ = '\0';
+        while (*args == ' ') {
+            args++;
+        }
+    } else {
+        args = line + lineLength;
+    }
+
+    if (strcmp(line, "help") == 0) {
+        printHelp(args);
+        return;
+    }
+
+    for (uint8_t i = 0; i < commandCount; i++) {
+        if (strcmp(line, commands[i].name) == 0) {
+            commands[i].handler(args);
+            return;
+        }
+    }
+
+    Serial.print("Unknown command: ");
+    Serial.println(line);
+    printHelp(args);
+}
+
+void SerialConsole::printHelp(const char* args) {
+    Serial.println("Commands:");
+    for (uint8_t i = 0; i < commandCount; i++) {
+        Serial.print("  ");
+        Serial.print(commands[i].name);
+        Serial.print(" - ");
+        Serial.println(commands[i].help);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef SERIAL_CONSOLE_H
+#define SERIAL_CONSOLE_H
+
+#include <Arduino.h>
+
+// Line-based diagnostics console on the USB serial port. Modules register a
+// command name and a handler; poll() is called periodically from a task, reads
+// whatever bytes have arrived without blocking and runs complete lines.
+class SerialConsole {
+public:
+    // Receives the rest of the line after the command name (may be empty)
+    typedef void (*Handler)(const char* args);
+
+    struct Command {
+        const char* name;
+        const char* help;
+        Handler handler;
+    };
+
+    // Room for every command of a build with all the optional ones enabled
+    static const uint8_t MAX_COMMANDS = 16;
+
+private:
+    static const uint8_t LINE_LENGTH = 48;
+
+    static Command commands[MAX_COMMANDS];
+    static uint8_t commandCount;
+    static char line[LINE_LENGTH];
+    static uint8_t lineLength;
+
+    static void execute();
+    static void printHelp(const char* args);
+
+public:
+    // Returns false if the table is full
+    static bool registerCommand(const char* name, const char* help, Handler handler);
+
+    static void poll();
+};
+
+#endif
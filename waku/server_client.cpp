@@ -1,50 +1,243 @@
 #include "server_client.h"
+#include <Arduino_FreeRTOS.h>
+#include "config_store.h"
+#include "civil_time.h"
+#include "dns_cache.h"
+
+NetUpkeep ServerClient::upkeep = {};
+
+// IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT") to Unix time; 0 if malformed
+static uint32_t parseHttpDate(const char* value) {
+    static const char MONTHS[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char month[4];
+    int day, year, hour, minute, second;
+    if (sscanf(value, " %*3s, %2d %3s %4d %2d:%2d:%2d GMT", &day, month, &year, &hour, &minute, &second) != 6) {
+        return 0;
+    }
+    const char* found = strstr(MONTHS, month);
+    if (!found || strlen(month) != 3 || (found - MONTHS) % 3 != 0 || year < 1970 ||
+        day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return 0;
+    }
+    int32_t days = daysFromCivil(year, static_cast<uint8_t>((found - MONTHS) / 3 + 1), static_cast<uint8_t>(day));
+    return static_cast<uint32_t>(days) * SECONDS_PER_DAY + hour * 3600UL + minute * 60UL + second;
+}
 
 void ServerClient::logError(ErrorCode error, const char* message) {
-    Serial.print("Error: ");
-    Serial.print(getErrorString(error));
-    Serial.print(" - ");
-    Serial.println(message);
+    // message must be a literal or otherwise static; it is printed later
+    LOG(SERVER_ERROR, static_cast<int32_t>(error), LOG_STR(message));
     displayManager.displayError(static_cast<int>(error));
 }
 
 bool ServerClient::sendDeviceUpdateAndGetTime(const DeviceUpdate& update, int& hour, int& minute, unsigned long& currentTime) {
+    if (!beginDeviceUpdate(update)) {
+        return false;
+    }
+    
+    // A tick at a time, so tasks at the same or lower priority run while
+    // the server answers
+    RequestStatus status;
+    while ((status = pollDeviceUpdate(hour, minute, currentTime)) == RequestStatus::PENDING) {
+        vTaskDelay(1);
+    }
+    return status == RequestStatus::SUCCEEDED;
+}
+
+bool ServerClient::beginDeviceUpdate(const DeviceUpdate& update) {
+    // One socket: a long-poll waiting for configuration makes way
+    abortRequest();
+    
     // Create JSON document
-    StaticJsonDocument<512> doc;
+    StaticJsonDocument<UPDATE_JSON_CAPACITY> doc;
     doc["error_code"] = getErrorString(update.error);
     doc["co2_level"] = update.CO2Level;
-    doc["sound_level"] = 0; // for legacy reasons now.
+    doc["sound_level"] = update.SoundLevel;
+    doc["sound_peak"] = update.SoundPeakLevel;
+    doc["sound_weighted"] = update.SoundWeightedLevel;
+    doc["sound_cpu_permille"] = update.SoundCpuPermille;
     doc["alarm_active"] = update.AlarmActive;
     doc["alarm_active_time"] = update.AlarmActiveTime;
     
+    if (update.Memory.valid) {
+        doc["heap_free"] = update.Memory.heapFree;
+        doc["heap_min_free"] = update.Memory.heapMinFree;
+        doc["heap_frag_pct"] = update.Memory.heapFragmentationPercent;
+        JsonObject stacks = doc.createNestedObject("stack_free_words");
+        for (uint8_t i = 0; i < update.Memory.taskCount; i++) {
+            stacks[update.Memory.stacks[i].name] = update.Memory.stacks[i].freeWords;
+        }
+    }
+    
+    if (update.CrashRecordHex) {
+        doc["crash"] = update.CrashRecordHex;
+    }
+    
+    // Connection upkeep since boot:
+    // [connects, tx_bytes, rx_bytes, connected_ms, parsed, not_modified,
+    //  connect_ms, requests, dns_ms]
+    JsonArray net = doc.createNestedArray("net");
+    net.add(upkeep.connects);
+    net.add(upkeep.txBytes);
+    net.add(upkeep.rxBytes);
+    net.add(upkeep.connectedMillis);
+    net.add(upkeep.responsesParsed);
+    net.add(upkeep.notModified);
+    net.add(upkeep.connectMillis);
+    net.add(upkeep.requests);
+    net.add(upkeep.dnsMillis);
+    
+    // ms from reset to each boot milestone, 0 while pending
+    JsonArray boot = doc.createNestedArray("boot_ms");
+    for (uint8_t i = 0; i < static_cast<uint8_t>(BootEvent::COUNT); i++) {
+        boot.add(BootEvents::millisAt(static_cast<BootEvent>(i)));
+    }
+    
+    // Per task: [busy_permille, late_mean_us, late_max_us]
+    JsonObject sched = doc.createNestedObject("sched");
+    for (uint8_t i = 0; i < static_cast<uint8_t>(TaskId::COUNT); i++) {
+        TaskId id = static_cast<TaskId>(i);
+        TaskRunStats stats = TaskStats::get(id);
+        JsonArray values = sched.createNestedArray(TaskStats::name(id));
+        values.add(stats.busyPermille);
+        values.add(stats.jitter.meanMicros());
+        values.add(stats.jitter.maxMicros);
+    }
+    
+#if WAKU_PROFILING
+    // Per probe: [mean_us, max_us]
+    JsonObject profile = doc.createNestedObject("profile");
+    for (uint8_t i = 0; i < static_cast<uint8_t>(ProbeId::COUNT); i++) {
+        ProbeId id = static_cast<ProbeId>(i);
+        ProbeStats stats = Profiler::get(id);
+        JsonArray values = profile.createNestedArray(Profiler::name(id));
+        values.add(stats.meanTicks() / Profiler::ticksPerMicro());
+        values.add(stats.maxTicks / Profiler::ticksPerMicro());
+    }
+#endif
+    
     String jsonString;
     serializeJson(doc, jsonString);
     
-    String response = makeHttpRequest("/api/device/update", jsonString);
-    if (response.length() == 0) {
+    if (!sendHttpRequest("POST", "/api/device/update", jsonString)) {
         logError(ErrorCode::SERVER_CONNECTION_FAILED, "Failed to send device update");
         return false;
     }
+    requestKind = RequestKind::DEVICE_UPDATE;
+    requestTimeout = RESPONSE_TIMEOUT;
+    upkeep.deviceUpdates++;
+    return true;
+}
+
+ServerClient::RequestStatus ServerClient::pollDeviceUpdate(int& hour, int& minute, unsigned long& currentTime) {
+    if (!requestInFlight) {
+        return RequestStatus::FAILED;
+    }
     
-    ServerResponse serverResponse;
-    if (!parseServerResponse(response, serverResponse)) {
+    if (!client.available()) {
+        if (millis() - requestStartMillis > requestTimeout) {
+            requestInFlight = false;
+            logError(ErrorCode::SERVER_CONNECTION_FAILED, "Request timeout");
+            closeConnection();
+            return RequestStatus::FAILED;
+        }
+        return RequestStatus::PENDING;
+    }
+    
+    String response = readHttpResponse();
+    if (httpStatus == 304) {
+        // Configuration unchanged: nothing to parse or apply
+        upkeep.notModified++;
+        currentTime = responseDate;
+        return RequestStatus::SUCCEEDED;
+    }
+    if (response.length() == 0) {
+        logError(ErrorCode::SERVER_CONNECTION_FAILED, "Failed to send device update");
+        return RequestStatus::FAILED;
+    }
+    
+    return handleDeviceUpdateResponse(response, hour, minute, currentTime) ? RequestStatus::SUCCEEDED : RequestStatus::FAILED;
+}
+
+bool ServerClient::beginConfigPoll(uint16_t waitSeconds) {
+    abortRequest();
+    
+    char endpoint[64];
+    snprintf(endpoint, sizeof(endpoint), "/api/device/config?wait=%u", waitSeconds);
+    if (!sendHttpRequest("GET", endpoint, String())) {
+        // Not worth an error on the display: the device update reports the server
+        LOG(CONFIG_POLL_FAILED, 0);
         return false;
     }
+    requestKind = RequestKind::CONFIG_POLL;
+    requestTimeout = waitSeconds * 1000UL + RESPONSE_TIMEOUT;
+    upkeep.configPolls++;
+    return true;
+}
+
+ServerClient::RequestStatus ServerClient::pollConfig(int& hour, int& minute, unsigned long& currentTime) {
+    if (!configPollInFlight()) {
+        return RequestStatus::FAILED;
+    }
     
-    currentTime = serverResponse.currentTime + 3600; // Add one hour (3600 seconds) to UTC time
+    if (!client.available()) {
+        if (millis() - requestStartMillis > requestTimeout) {
+            requestInFlight = false;
+            closeConnection();
+            LOG(CONFIG_POLL_FAILED, 0);
+            return RequestStatus::FAILED;
+        }
+        return RequestStatus::PENDING;
+    }
     
-    if (parseTimeString(serverResponse.alarmTime.c_str(), hour, minute)) {
-        // Update the alarm time if we have a valid alarm object (first time we don't have it.)
-        if (alarm && alarm->updateTime(hour, minute)) {
-            return true;
-        } else if (alarm == nullptr) {
-            // No alarm object yet, but time parsing succeeded
-            return true;
+    String response = readHttpResponse();
+    currentTime = 0;
+    switch (httpStatus) {
+        case 200:
+            if (!handleDeviceUpdateResponse(response, hour, minute, currentTime)) {
+                return RequestStatus::FAILED;
+            }
+            upkeep.configPushes++;
+            LOG(CONFIG_PUSHED, hour, minute);
+            return RequestStatus::SUCCEEDED;
+        case 304:
+            // Held for the whole wait without a change
+            currentTime = responseDate;
+            return RequestStatus::SUCCEEDED;
+        case 404:
+        case 405:
+        case 501:
+            // Older server: stay with device update polling
+            pushSupported = false;
+            LOG(CONFIG_PUSH_UNSUPPORTED, httpStatus);
+            return RequestStatus::FAILED;
+        default:
+            LOG(CONFIG_POLL_FAILED, httpStatus);
+            return RequestStatus::FAILED;
+    }
+}
+
+bool ServerClient::handleDeviceUpdateResponse(const String& response, int& hour, int& minute, unsigned long& currentTime) {
+    uint32_t start = micros();
+    ServerResponse serverResponse;
+    bool parsed = parseServerResponse(response, serverResponse);
+    // No alarm object the first time; the time still has to parse
+    bool applied = parsed && parseTimeString(serverResponse.alarmTime.c_str(), hour, minute) &&
+                   (alarm == nullptr || alarm->updateTime(hour, minute, serverResponse.alarmArmed));
+    upkeep.responsesParsed++;
+    upkeep.parseMicros += micros() - start;
+    
+    if (!applied) {
+        if (parsed) {
+            logError(ErrorCode::INVALID_TIME_FORMAT, "Invalid time format");
         }
+        return false;
     }
     
-    logError(ErrorCode::INVALID_TIME_FORMAT, "Invalid time format");
-    return false;
+    // UTC; ClockSync applies the time zone
+    currentTime = serverResponse.currentTime ? serverResponse.currentTime : responseDate;
+    // Only an applied configuration may be answered with 304 from now on
+    configVersion = serverResponse.version;
+    return true;
 }
 
 bool ServerClient::parseServerResponse(const String& response, ServerResponse& serverResponse) {
@@ -58,6 +251,32 @@ bool ServerClient::parseServerResponse(const String& response, ServerResponse& s
     serverResponse.alarmTime = doc["time"].as<const char*>();
     serverResponse.alarmArmed = doc["armed"] | true;
     serverResponse.currentTime = doc["current_time"] | 0;
+    serverResponse.version = doc["version"] | responseVersion;
+    
+    // Optional wake-up melody (RTTTL or "midi:" text); unchanged melodies are not re-parsed
+    const char* melody = doc["melody"].as<const char*>();
+    if (melody && MelodyStore::load(melody) == MelodyStore::LoadResult::INVALID) {
+        logError(ErrorCode::INVALID_MELODY_FORMAT, "Invalid melody");
+    }
+    
+    // Optional persistent settings; resending the same values writes nothing
+    if (doc.containsKey("utc_offset")) {
+        int32_t utcOffset = doc["utc_offset"] | 0;
+        ConfigStore::set(ConfigKey::UTC_OFFSET, utcOffset);
+        TimeZone::reload();
+    }
+    const char* tz = doc["tz"].as<const char*>();
+    if (tz && !TimeZone::set(tz)) {
+        logError(ErrorCode::INVALID_TIMEZONE, "Invalid TZ string");
+    }
+    if (doc.containsKey("co2_offset") || doc.containsKey("sound_offset_db")) {
+        SensorCalibration calibration = {};
+        ConfigStore::get(ConfigKey::CALIBRATION, calibration);
+        calibration.co2OffsetPpm = doc["co2_offset"] | calibration.co2OffsetPpm;
+        float soundOffset = doc["sound_offset_db"] | calibration.soundOffsetCentiDb / 100.0f;
+        calibration.soundOffsetCentiDb = static_cast<int16_t>(lroundf(soundOffset * 100.0f));
+        ConfigStore::set(ConfigKey::CALIBRATION, calibration);
+    }
     
     return true;
 }
@@ -102,64 +321,268 @@ bool ServerClient::parseTimeString(const char* timeStr, int& hour, int& minute)
     return true;
 }
 
-String ServerClient::makeHttpRequest(const char* endpoint, const String& jsonBody) {
+// An idle connection the server may have dropped by now is not worth the
+// risk of a request that is never answered
+bool ServerClient::connectionReusable() {
+    return WAKU_HTTP_KEEP_ALIVE && connectionOpen && millis() - lastUsedMillis < KEEP_ALIVE_IDLE && client.connected();
+}
+
+bool ServerClient::openConnection() {
+    closeConnection();
+#if WAKU_USE_TLS
+    // Pinned: the home server's own certificate is the only trust anchor.
+    // Connect by name: the certificate is checked against it, so the module
+    // resolves it and the DNS time is part of the handshake.
+    client.setCACert(caCert);
+    unsigned long start = millis();
     if (!client.connect(serverHost, serverPort)) {
+        return false;
+    }
+#else
+    IPAddress address;
+    uint32_t lookupTime;
+    bool resolved = DnsCache::resolve(serverHost, address, lookupTime);
+    upkeep.dnsMillis += lookupTime;
+    unsigned long start = millis();
+    if (!resolved) {
+        return false;
+    }
+    if (!client.connect(address, serverPort)) {
+        DnsCache::reportFailure(serverHost);
+        return false;
+    }
+#endif
+    connectedAtMillis = millis();
+    connectionOpen = true;
+    upkeep.connects++;
+    upkeep.connectMillis += connectedAtMillis - start;
+    return true;
+}
+
+bool ServerClient::sendHttpRequest(const char* method, const char* endpoint, const String& jsonBody) {
+    PROFILE_SCOPE(ProbeId::HTTP_SEND);
+    requestStartTicks = PROFILE_TIMESTAMP();
+    
+    bool reused = connectionReusable();
+    if (!reused && !openConnection()) {
         logError(ErrorCode::SERVER_CONNECTION_FAILED, "Failed to connect to server");
-        return "";
+        return false;
     }
     /* Debugging
     Serial.print("Making request to: ");
     Serial.println(endpoint);
     */
     
-    // Make HTTP request
-    client.print("POST ");
-    client.print(endpoint);
-    client.println(" HTTP/1.1");
-    client.print("Host: ");
-    client.println(serverHost);
-    client.println("Content-Type: application/json");
-    client.print("Content-Length: ");
-    client.println(jsonBody.length());
-    client.println("Connection: close");
-    client.println();
-    client.println(jsonBody);
+    size_t sent = writeHttpRequest(method, endpoint, jsonBody);
+    if (sent == 0 && reused) {
+        // The server closed the kept connection after all
+        if (!openConnection()) {
+            logError(ErrorCode::SERVER_CONNECTION_FAILED, "Failed to connect to server");
+            return false;
+        }
+        sent = writeHttpRequest(method, endpoint, jsonBody);
+    }
+    upkeep.txBytes += sent;
+    upkeep.requests++;
     
     /* Debugging
     Serial.print("Request body: ");
     Serial.println(jsonBody);
     */
     
-    // Wait for response
-    unsigned long timeout = millis();
-    while (!client.available()) {
-        if (millis() - timeout > 5000) {
-            logError(ErrorCode::SERVER_CONNECTION_FAILED, "Request timeout");
-            client.stop();
-            return "";
-        }
+    requestStartMillis = millis();
+    requestInFlight = true;
+    return true;
+}
+
+size_t ServerClient::writeHttpRequest(const char* method, const char* endpoint, const String& jsonBody) {
+    size_t sent = client.print(method);
+    sent += client.print(" ");
+    sent += client.print(endpoint);
+    sent += client.println(" HTTP/1.1");
+    sent += client.print("Host: ");
+    sent += client.println(serverHost);
+    if (configVersion != 0) {
+        sent += client.print("If-None-Match: \"");
+        sent += client.print(configVersion);
+        sent += client.println("\"");
+    }
+    if (jsonBody.length() > 0) {
+        sent += client.println("Content-Type: application/json");
+        sent += client.print("Content-Length: ");
+        sent += client.println(jsonBody.length());
     }
+    sent += client.println(WAKU_HTTP_KEEP_ALIVE ? "Connection: keep-alive" : "Connection: close");
+    sent += client.println();
+    // Exactly Content-Length bytes: anything after it would be read as the
+    // next request on a kept connection
+    sent += client.print(jsonBody);
+    return sent;
+}
+
+String ServerClient::readHttpResponse() {
+    requestInFlight = false;
+    
+    // Status line ("HTTP/1.1 200 OK"), then the headers: ETag and Date for
+    // the configuration and the clock, the rest to find the end of the body
+    String statusLine = client.readStringUntil('\n');
+    int space = statusLine.indexOf(' ');
+    httpStatus = space > 0 ? statusLine.substring(space + 1).toInt() : 0;
+    upkeep.rxBytes += statusLine.length() + 1;
+    responseVersion = 0;
+    responseDate = 0;
+    long contentLength = -1;
+    bool chunked = false;
+    bool serverCloses = !WAKU_HTTP_KEEP_ALIVE;
     
-    // Skip headers
     bool headersParsed = false;
     while (client.available() && !headersParsed) {
         String line = client.readStringUntil('\n');
+        upkeep.rxBytes += line.length() + 1;
+        const char* header = line.c_str();
         if (line == "\r") {
             headersParsed = true;
+        } else if (strncasecmp(header, "ETag:", 5) == 0) {
+            // "42" or W/"42": the configuration version
+            const char* quote = strchr(header, '"');
+            responseVersion = quote ? strtoul(quote + 1, nullptr, 10) : 0;
+        } else if (strncasecmp(header, "Date:", 5) == 0) {
+            responseDate = parseHttpDate(header + 5);
+        } else if (strncasecmp(header, "Content-Length:", 15) == 0) {
+            contentLength = strtol(header + 15, nullptr, 10);
+        } else if (strncasecmp(header, "Transfer-Encoding:", 18) == 0) {
+            chunked = strstr(header, "chunked") != nullptr;
+        } else if (strncasecmp(header, "Connection:", 11) == 0) {
+            serverCloses = serverCloses || strstr(header, "close") != nullptr;
         }
     }
     
     if (!headersParsed) {
         logError(ErrorCode::SERVER_CONNECTION_FAILED, "Failed to parse headers");
+        httpStatus = 0;
+        closeConnection();
         return "";
     }
     
     // Read response body
-    String response = client.readString();
-    client.stop();
+    String response;
+    if (chunked) {
+        response = readChunkedBody();
+    } else if (contentLength >= 0) {
+        response = readBody(contentLength);
+    } else if (httpStatus != 304 && httpStatus != 204) {
+        // No length: the body ends when the server closes
+        response = client.readString();
+        serverCloses = true;
+    }
+    upkeep.rxBytes += response.length();
+    lastUsedMillis = millis();
+    if (serverCloses) {
+        closeConnection();
+    }
+    PROFILE_RECORD_SINCE(ProbeId::HTTP_REQUEST, requestStartTicks);
     /* Debugging
     Serial.print("Response: ");
     Serial.println(response);
     */
     return response;
-} 
\ No newline at end of file
+}
+
+// Exactly length bytes, so a kept connection stays in step; a body over
+// MAX_RESPONSE_SIZE is cut short (and will not parse)
+String ServerClient::readBody(size_t length) {
+    String body;
+    body.reserve(length < MAX_RESPONSE_SIZE ? length : MAX_RESPONSE_SIZE);
+    char chunk[64];
+    while (length > 0) {
+        size_t count = client.readBytes(chunk, length < sizeof(chunk) ? length : sizeof(chunk));
+        if (count == 0) {
+            // Timed out partway; the connection is no good for another request
+            closeConnection();
+            break;
+        }
+        length -= count;
+        for (size_t i = 0; i < count && body.length() < MAX_RESPONSE_SIZE; i++) {
+            body += chunk[i];
+        }
+    }
+    return body;
+}
+
+// Chunk size lines in hex, each chunk followed by CRLF, a zero-size chunk
+// last (trailers are not expected)
+String ServerClient::readChunkedBody() {
+    String body;
+    for (;;) {
+        String sizeLine = client.readStringUntil('\n');
+        upkeep.rxBytes += sizeLine.length() + 1;
+        if (sizeLine.length() == 0) {
+            // Timed out
+            closeConnection();
+            break;
+        }
+        size_t size = strtoul(sizeLine.c_str(), nullptr, 16);
+        body += readBody(size);
+        if (!connectionOpen) {
+            break;
+        }
+        // CRLF after every chunk, the last (empty) one included
+        upkeep.rxBytes += client.readStringUntil('\n').length() + 1;
+        if (size == 0) {
+            break;
+        }
+    }
+    return body;
+}
+
+void ServerClient::closeConnection() {
+    if (!connectionOpen) {
+        return;
+    }
+    client.stop();
+    connectionOpen = false;
+    upkeep.connectedMillis += millis() - connectedAtMillis;
+}
+
+void ServerClient::printUpkeep(const char* args) {
+    NetUpkeep snapshot = upkeep;
+    uint32_t hours = millis() / 3600000UL;
+    char line[80];      // Longest with 10-digit counters: the "Requests" and "Responses" lines, 74 characters
+    snprintf(line, sizeof(line), "%s: %lu (%lu/h), %lu ms each", WAKU_USE_TLS ? "TLS handshakes" : "Connects",
+             static_cast<unsigned long>(snapshot.connects),
+             static_cast<unsigned long>(hours ? snapshot.connects / hours : snapshot.connects),
+             static_cast<unsigned long>(snapshot.connects ? snapshot.connectMillis / snapshot.connects : 0));
+    Serial.println(line);
+#if !WAKU_USE_TLS
+    // DNS lookups on the way to a connect (see DnsCache), against the TCP connects
+    snprintf(line, sizeof(line), "Connect phases: %lu ms DNS, %lu ms TCP in total",
+             static_cast<unsigned long>(snapshot.dnsMillis), static_cast<unsigned long>(snapshot.connectMillis));
+    Serial.println(line);
+#endif
+    // Connection setup spread over the requests that shared it
+    snprintf(line, sizeof(line), "Requests: %lu, %lu ms connecting per request%s",
+             static_cast<unsigned long>(snapshot.requests),
+             static_cast<unsigned long>(snapshot.requests ? snapshot.connectMillis / snapshot.requests : 0),
+             WAKU_HTTP_KEEP_ALIVE ? "" : " (no keep-alive)");
+    Serial.println(line);
+    snprintf(line, sizeof(line), "Device updates: %lu", static_cast<unsigned long>(snapshot.deviceUpdates));
+    Serial.println(line);
+    snprintf(line, sizeof(line), "Config polls: %lu, pushed: %lu%s", static_cast<unsigned long>(snapshot.configPolls),
+             static_cast<unsigned long>(snapshot.configPushes), WAKU_CONFIG_PUSH ? "" : " (push off)");
+    Serial.println(line);
+    snprintf(line, sizeof(line), "Bytes: %lu sent, %lu received", static_cast<unsigned long>(snapshot.txBytes),
+             static_cast<unsigned long>(snapshot.rxBytes));
+    Serial.println(line);
+    snprintf(line, sizeof(line), "Socket open: %lu ms", static_cast<unsigned long>(snapshot.connectedMillis));
+    Serial.println(line);
+    
+    // What the 304s saved, at the mean cost of a parsed response
+    uint32_t meanParse = snapshot.responsesParsed ? snapshot.parseMicros / snapshot.responsesParsed : 0;
+    snprintf(line, sizeof(line), "Responses: %lu parsed (%lu us each), %lu not modified",
+             static_cast<unsigned long>(snapshot.responsesParsed), static_cast<unsigned long>(meanParse),
+             static_cast<unsigned long>(snapshot.notModified));
+    Serial.println(line);
+    uint32_t avoided = (hours ? snapshot.notModified / hours : snapshot.notModified) * meanParse;
+    snprintf(line, sizeof(line), "Parse work avoided: %lu us/h", static_cast<unsigned long>(avoided));
+    Serial.println(line);
+}
@@ -8,11 +8,23 @@
 #include "error_codes.h"
 #include "co2_sensor.h"
 #include "alarm.h"
+#include "melody.h"
+#include "memory_monitor.h"
+#include "profiler.h"
+#include "task_stats.h"
+#include "boot_events.h"
+#include "timezone.h"
+#include "log.h"
 
 struct DeviceUpdate {
     ErrorCode error = ErrorCode::NO_ERROR;
     float CO2Level = 0;
-    float SoundLevel = 0;
+    float SoundLevel = 0;          // dBFS, RMS over the last second
+    float SoundPeakLevel = 0;      // dBFS
+    float SoundWeightedLevel = 0;  // dBFS, rough A-weighting
+    uint16_t SoundCpuPermille = 0; // Sampling + analysis cost per second of audio
+    MemoryStats Memory = {};       // Stack high-water marks and heap state
+    const char* CrashRecordHex = nullptr;  // Crash record not uploaded yet, see CrashJournal
     bool AlarmActive = false;
     long AlarmActiveTime = 0;
 };
@@ -20,30 +32,130 @@ struct DeviceUpdate {
 struct ServerResponse {
     String alarmTime;
     bool alarmArmed;
-    unsigned long currentTime;  // Unix timestamp from server
+    unsigned long currentTime;  // Unix timestamp from server (UTC)
+    uint32_t version;           // Configuration version, from the body or the ETag
+};
+
+// What keeping in touch with the server costs, since boot. Compare a
+// WAKU_CONFIG_PUSH build with a polling one over the same night.
+struct NetUpkeep {
+    uint32_t connects;          // With TLS, full handshakes
+    uint32_t connectMillis;     // Spent in connect(), handshakes included
+    uint32_t dnsMillis;         // Spent resolving the server's name before connect()
+    uint32_t requests;          // Sent, on new or reused connections
+    uint32_t deviceUpdates;
+    uint32_t configPolls;       // Long-poll requests sent
+    uint32_t configPushes;      // Of those, answered with a new configuration
+    uint32_t txBytes;           // HTTP requests, headers included
+    uint32_t rxBytes;           // HTTP responses, headers included
+    uint32_t connectedMillis;   // Socket open time
+    uint32_t responsesParsed;   // Device update responses parsed and applied
+    uint32_t parseMicros;       // Time spent on those
+    uint32_t notModified;       // Device update responses skipped (304)
 };
 
 class ServerClient {
+public:
+    enum class RequestStatus { PENDING, SUCCEEDED, FAILED };
+
 private:
+    static const unsigned long RESPONSE_TIMEOUT = 5000;  // ms
+    static const unsigned long KEEP_ALIVE_IDLE = 50000;  // ms; servers drop idle connections after a minute or more
+    static const size_t MAX_RESPONSE_SIZE = 1024;        // Body bytes kept; the rest is read and dropped
+    
+    enum class RequestKind : uint8_t { DEVICE_UPDATE, CONFIG_POLL };
+    
+    // Device update document; profiling adds a probe summary
+    static const size_t UPDATE_JSON_CAPACITY = WAKU_PROFILING ? 1088 : 832;
+    
+
     const char* serverHost;
     const int serverPort;
+    const char* caCert;             // PEM, the only certificate trusted with TLS
+#if WAKU_USE_TLS
+    WiFiSSLClient client;
+#else
     WiFiClient client;
+#endif
     DisplayManager& displayManager;
     CO2Sensor* co2Sensor;
     Alarm* alarm;
     
+    // Request sent and waiting for the response
+    bool requestInFlight;
+    RequestKind requestKind;
+    unsigned long requestStartMillis;
+    unsigned long requestTimeout;   // ms
+    uint32_t requestStartTicks;     // Profiler timestamp
+    unsigned long connectedAtMillis;
+    bool connectionOpen;
+    unsigned long lastUsedMillis;   // Last response on the open connection
+    int httpStatus;                 // Of the last response
+    uint32_t responseVersion;       // ETag of the last response, 0 if none
+    uint32_t responseDate;          // Date header of the last response, 0 if none
+    
+    // Configuration version the server last sent (0: none yet). Sent as
+    // If-None-Match: an unchanged configuration comes back as a bodyless 304,
+    // and a long-poll returns as soon as the server's differs.
+    uint32_t configVersion;
+    bool pushSupported;
+    
+    static NetUpkeep upkeep;
+    
     bool parseTimeString(const char* timeStr, int& hour, int& minute);
-    String makeHttpRequest(const char* endpoint, const String& jsonBody);
+    bool sendHttpRequest(const char* method, const char* endpoint, const String& jsonBody);
+    size_t writeHttpRequest(const char* method, const char* endpoint, const String& jsonBody);
+    String readHttpResponse();
+    String readBody(size_t length);
+    String readChunkedBody();
+    bool openConnection();
+    bool connectionReusable();
+    void closeConnection();
+    bool handleDeviceUpdateResponse(const String& response, int& hour, int& minute, unsigned long& currentTime);
     void logError(ErrorCode error, const char* message);
     bool parseServerResponse(const String& response, ServerResponse& serverResponse);
     
 public:
-    ServerClient(const char* host, int port, DisplayManager& display, 
+    // caCert is only used with WAKU_USE_TLS
+    ServerClient(const char* host, int port, const char* ca, DisplayManager& display, 
                 CO2Sensor* co2, Alarm* alm) 
-        : serverHost(host), serverPort(port), displayManager(display),
-          co2Sensor(co2), alarm(alm) {}
+        : serverHost(host), serverPort(port), caCert(ca), displayManager(display),
+          co2Sensor(co2), alarm(alm), requestInFlight(false), requestKind(RequestKind::DEVICE_UPDATE),
+          requestStartMillis(0), requestTimeout(RESPONSE_TIMEOUT), requestStartTicks(0), connectedAtMillis(0),
+          connectionOpen(false), lastUsedMillis(0), httpStatus(0), responseVersion(0), responseDate(0), configVersion(0), pushSupported(true) {}
     
+    // Blocking: send the update and wait for the response
     bool sendDeviceUpdateAndGetTime(const DeviceUpdate& update, int& hour, int& minute, unsigned long& currentTime);
+    
+    // Split form for callers that must not block while the server answers:
+    // send the request, then poll until the response is handled or fails
+    bool beginDeviceUpdate(const DeviceUpdate& update);
+    RequestStatus pollDeviceUpdate(int& hour, int& minute, unsigned long& currentTime);
+    
+    // Long-poll for configuration changes: the server holds the request
+    // until the configuration differs from the version we have or
+    // waitSeconds pass (304). SUCCEEDED covers both; a change is applied like
+    // a device update response. A server without the endpoint (404) turns
+    // push off for this boot, see supportsPush().
+    bool beginConfigPoll(uint16_t waitSeconds);
+    RequestStatus pollConfig(int& hour, int& minute, unsigned long& currentTime);
+    bool configPollInFlight() const { return requestInFlight && requestKind == RequestKind::CONFIG_POLL; }
+    bool supportsPush() const { return pushSupported; }
+    
+    // Drop a request left open by a network task that was restarted, or a
+    // long-poll that has to make way for a device update. The connection
+    // goes with it: the response would still arrive on it.
+    void abortRequest() {
+        if (requestInFlight) {
+            closeConnection();
+        }
+        requestInFlight = false;
+    }
+    
+    static NetUpkeep getUpkeep() { return upkeep; }
+    
+    // Console handler: connection upkeep counters and parse work saved by 304s
+    static void printUpkeep(const char* args);
 };
 
 #endif 
\ No newline at end of file
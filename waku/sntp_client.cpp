@@ -0,0 +1,81 @@
+#include "sntp_client.h"
+#include "clock_sync.h"
+#include "dns_cache.h"
+
+// Seconds from the NTP era (1900) to the Unix epoch
+static const uint32_t NTP_UNIX_OFFSET = 2208988800UL;
+
+static uint32_t readBigEndian(const uint8_t* bytes) {
+    return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | bytes[3];
+}
+
+// NTP timestamp (seconds and 2^-32 fractions since 1900) to Unix ms
+static int64_t ntpToUnixMillis(const uint8_t* bytes) {
+    uint32_t seconds = readBigEndian(bytes);
+    uint32_t fraction = readBigEndian(bytes + 4);
+    return (static_cast<int64_t>(seconds) - NTP_UNIX_OFFSET) * 1000 + ((static_cast<uint64_t>(fraction) * 1000) >> 32);
+}
+
+bool SntpClient::begin() {
+    if (inFlight) {
+        udp.stop();
+    }
+    inFlight = false;
+
+    uint8_t packet[PACKET_SIZE] = {};
+    packet[0] = 0x23;   // LI 0, version 4, mode 3 (client)
+
+    // Resolved before T1, so a lookup does not count as round-trip delay
+    IPAddress address;
+    uint32_t lookupTime;
+    if (!DnsCache::resolve(host, address, lookupTime) || !udp.begin(LOCAL_PORT) || !udp.beginPacket(address, port)) {
+        udp.stop();
+        return false;
+    }
+    udp.write(packet, sizeof(packet));
+    sentMillis = millis();
+    sentUtcMillis = ClockSync::nowMillis();
+    if (!udp.endPacket()) {
+        udp.stop();
+        return false;
+    }
+    inFlight = true;
+    return true;
+}
+
+SntpClient::Status SntpClient::poll(Sample& sample) {
+    if (!inFlight) {
+        return Status::FAILED;
+    }
+
+    if (udp.parsePacket() < PACKET_SIZE) {
+        if (millis() - sentMillis > RESPONSE_TIMEOUT) {
+            inFlight = false;
+            udp.stop();
+            // The server may have moved; check the name before the next try
+            DnsCache::reportFailure(host);
+            return Status::FAILED;
+        }
+        return Status::PENDING;
+    }
+
+    int64_t receivedUtcMillis = ClockSync::nowMillis();    // T4
+    uint8_t packet[PACKET_SIZE];
+    int length = udp.read(packet, sizeof(packet));
+    inFlight = false;
+    udp.stop();
+
+    // Server mode, a stratum it admits to and a transmit time
+    uint8_t mode = packet[0] & 0x07;
+    uint8_t stratum = packet[1];
+    if (length < PACKET_SIZE || mode != 4 || stratum == 0 || stratum > 15 || readBigEndian(packet + 40) == 0) {
+        return Status::FAILED;
+    }
+
+    int64_t serverReceived = ntpToUnixMillis(packet + 32);     // T2
+    int64_t serverSent = ntpToUnixMillis(packet + 40);         // T3
+    int64_t delay = (receivedUtcMillis - sentUtcMillis) - (serverSent - serverReceived);
+    sample.offsetMillis = ((serverReceived - sentUtcMillis) + (serverSent - receivedUtcMillis)) / 2;
+    sample.delayMillis = delay > 0 ? static_cast<uint32_t>(delay) : 0;
+    return Status::SUCCEEDED;
+}
@@ -0,0 +1,38 @@
+#ifndef SNTP_CLIENT_H
+#define SNTP_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFiS3.h>
+
+// One SNTP (RFC 4330) exchange at a time over UDP. Split into send and poll
+// like ServerClient, so the caller decides how to wait.
+// Client timestamps come from ClockSync's own clock, so the result is that
+// clock's error.
+class SntpClient {
+public:
+    enum class Status { PENDING, SUCCEEDED, FAILED };
+
+    struct Sample {
+        int64_t offsetMillis;   // Server time minus our clock at the midpoint; since 1970 if the clock never was set
+        uint32_t delayMillis;   // Round trip, less the server's processing time
+    };
+
+    SntpClient(const char* host, int port) : host(host), port(port), inFlight(false), sentMillis(0), sentUtcMillis(0) {}
+
+    bool begin();
+    Status poll(Sample& sample);
+
+private:
+    static const uint16_t LOCAL_PORT = 8123;
+    static const unsigned long RESPONSE_TIMEOUT = 2000;    // ms
+    static const uint8_t PACKET_SIZE = 48;
+
+    const char* host;
+    const int port;
+    WiFiUDP udp;
+    bool inFlight;
+    uint32_t sentMillis;        // millis() at send, for the timeout
+    int64_t sentUtcMillis;      // T1
+};
+
+#endif
@@ -0,0 +1,237 @@
+#include "sound_meter.h"
+#include "cycle_counter.h"
+
+// ADC input channels of A0-A5 on the UNO R4; the RA4M1 has one ADC unit
+static const uint8_t ANALOG_CHANNELS[] = {9, 0, 1, 2, 21, 22};
+
+// Overflow event of each GPT channel, for the ELC link to the ADC
+static const elc_event_t GPT_OVERFLOW_EVENTS[] = {
+    ELC_EVENT_GPT0_COUNTER_OVERFLOW, ELC_EVENT_GPT1_COUNTER_OVERFLOW,
+    ELC_EVENT_GPT2_COUNTER_OVERFLOW, ELC_EVENT_GPT3_COUNTER_OVERFLOW,
+    ELC_EVENT_GPT4_COUNTER_OVERFLOW, ELC_EVENT_GPT5_COUNTER_OVERFLOW,
+    ELC_EVENT_GPT6_COUNTER_OVERFLOW, ELC_EVENT_GPT7_COUNTER_OVERFLOW
+};
+
+// ADSTRGR.TRSA: start the scan on the ELC's ADC event
+static const uint8_t ADC_TRIGGER_ELC = 0x09;
+
+// Polls of ADST before a late conversion is given up on; a scan takes ~1 us
+static const uint8_t CONVERSION_SPINS = 64;
+
+SoundMeter::SoundMeter(int pin)
+    : micPin(pin), adcChannel(0), timerReady(false), writePos(0), writeHalf(0), readyHalf(-1),
+      overruns(0), isrCycles(0), processCycles(0),
+      secondSquareSum(0), secondWeightedSum(0), secondPeak(0), secondBlocks(0),
+      lastSecond{0.0f, 0.0f, 0.0f, 0, false},
+      listener(nullptr), listenerContext(nullptr) {
+}
+
+bool SoundMeter::begin() {
+    uint8_t pinIndex = static_cast<uint8_t>(micPin - A0);
+    if (pinIndex >= sizeof(ANALOG_CHANNELS)) {
+        Serial.println("ERROR: Sound sensor is not on an analog pin");
+        return false;
+    }
+    adcChannel = ANALOG_CHANNELS[pinIndex];
+
+    // One conversion through the core powers the ADC up at 12 bits and puts
+    // the pin in analog mode
+    pinMode(micPin, INPUT);
+    analogReadResolution(12);
+    analogRead(micPin);
+
+    uint8_t timerType = GPT_TIMER;
+    int8_t channel = FspTimer::get_available_timer(timerType);
+    if (channel < 0 || channel >= static_cast<int8_t>(sizeof(GPT_OVERFLOW_EVENTS) / sizeof(GPT_OVERFLOW_EVENTS[0]))) {
+        Serial.println("ERROR: No free timer for sound sampling");
+        return false;
+    }
+
+    timerReady =
+        sampleTimer.begin(TIMER_MODE_PERIODIC, timerType, channel, SAMPLE_RATE, 0.0f, sampleTimerCallback, this) &&
+        sampleTimer.setup_overflow_irq() &&
+        sampleTimer.open();
+    if (!timerReady) {
+        Serial.println("ERROR: Sound sampling timer setup failed");
+        return false;
+    }
+
+    // Each timer overflow starts a single scan of the microphone channel
+    // through the ELC, so conversions keep the timer's period exactly and
+    // the CPU only collects the results
+    R_BSP_MODULE_START(FSP_IP_ELC, 0);
+    R_ELC->ELSR[ELC_PERIPHERAL_ADC0].HA = GPT_OVERFLOW_EVENTS[channel];
+    R_ELC->ELCR_b.ELCON = 1;
+
+    R_ADC0->ADCSR_b.ADST = 0;
+    R_ADC0->ADANSA[0] = adcChannel < 16 ? static_cast<uint16_t>(1U << adcChannel) : 0;
+    R_ADC0->ADANSA[1] = adcChannel < 16 ? 0 : static_cast<uint16_t>(1U << (adcChannel - 16));
+    R_ADC0->ADSTRGR_b.TRSA = ADC_TRIGGER_ELC;
+    R_ADC0->ADCSR_b.ADCS = 0;      // Single scan
+    R_ADC0->ADCSR_b.TRGE = 1;
+
+    timerReady = sampleTimer.start();
+    return timerReady;
+}
+
+void SoundMeter::sampleTimerCallback(timer_callback_args_t* args) {
+    SoundMeter* self = static_cast<SoundMeter*>(const_cast<void*>(args->p_context));
+    uint32_t startCycles = CycleCounter::now();
+
+    // The overflow that got us here also started the conversion. It is
+    // normally done by now, as the FSP interrupt entry takes longer.
+    for (uint8_t spins = 0; R_ADC0->ADCSR_b.ADST && spins < CONVERSION_SPINS; spins++) {
+    }
+
+    uint8_t half = self->writeHalf;
+    uint16_t pos = self->writePos;
+    self->buffer[half][pos] = static_cast<int16_t>(R_ADC0->ADDR[self->adcChannel] - ADC_MIDSCALE);
+
+    if (++pos == BLOCK_SIZE) {
+        pos = 0;
+        if (self->readyHalf >= 0) {
+            self->overruns++;   // Previous block was never processed
+        }
+        self->readyHalf = half;
+        self->writeHalf = half ^ 1;
+    }
+    self->writePos = pos;
+
+    self->isrCycles += CycleCounter::now() - startCycles;
+}
+
+// Block energy, cross-correlation at lag 1 and sum, two samples per
+// instruction. The first-difference energy follows from them:
+// sum((x[n] - x[n-1])^2) = 2*E - x[N-1]^2 + x[0]^2 - 2*C, taking x[-1] = x[0].
+SoundMeter::BlockResult SoundMeter::analyzeBlock(const int16_t* samples, uint16_t count) {
+    int32_t sum = 0;
+    int64_t energy = 0;
+    int64_t cross = 0;
+    uint16_t peak = 0;
+
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(samples);
+    uint32_t previousHigh = words[0] & 0xFFFF;     // x[-1] = x[0]
+
+    for (uint16_t k = 0; k < count / 2; k++) {
+        uint32_t pair = words[k];                          // x[2k+1] : x[2k]
+        uint32_t shifted = previousHigh | (pair << 16);    // x[2k]   : x[2k-1]
+
+        sum = static_cast<int32_t>(__SMLAD(pair, 0x00010001, static_cast<uint32_t>(sum)));
+        energy = static_cast<int64_t>(__SMLALD(pair, pair, static_cast<uint64_t>(energy)));
+        cross = static_cast<int64_t>(__SMLALD(pair, shifted, static_cast<uint64_t>(cross)));
+        previousHigh = pair >> 16;
+
+        int16_t a = static_cast<int16_t>(pair);
+        int16_t b = static_cast<int16_t>(pair >> 16);
+        uint16_t magnitude = max(abs(a), abs(b));
+        if (magnitude > peak) {
+            peak = magnitude;
+        }
+    }
+
+    return blockResult(samples, count, sum, energy, cross, peak);
+}
+
+SoundMeter::BlockResult SoundMeter::analyzeBlockScalar(const int16_t* samples, uint16_t count) {
+    int32_t sum = 0;
+    int64_t energy = 0;
+    int64_t cross = 0;
+    uint16_t peak = 0;
+
+    int32_t previous = samples[0];
+    for (uint16_t n = 0; n < count; n++) {
+        int32_t x = samples[n];
+        sum += x;
+        energy += x * x;
+        cross += x * previous;
+        previous = x;
+        uint16_t magnitude = abs(x);
+        if (magnitude > peak) {
+            peak = magnitude;
+        }
+    }
+
+    return blockResult(samples, count, sum, energy, cross, peak);
+}
+
+SoundMeter::BlockResult SoundMeter::blockResult(const int16_t* samples, uint16_t count, int32_t sum,
+                                                int64_t energy, int64_t cross, uint16_t peak) {
+    int64_t first = samples[0];
+    int64_t last = samples[count - 1];
+    int64_t diffEnergy = 2 * energy - last * last + first * first - 2 * cross;
+
+    // Variance, so the microphone's DC offset drops out
+    int64_t meanSquare = (energy * count - static_cast<int64_t>(sum) * sum) / (static_cast<int64_t>(count) * count);
+
+    BlockResult result;
+    result.meanSquare = meanSquare > 0 ? static_cast<uint32_t>(meanSquare) : 0;
+    result.weightedSquare = diffEnergy > 0 ? static_cast<uint32_t>(diffEnergy / count) : 0;
+    result.peak = peak;
+    return result;
+}
+
+void SoundMeter::process() {
+    int8_t half = readyHalf;
+    if (half < 0) {
+        return;
+    }
+
+    uint32_t startCycles = CycleCounter::now();
+    BlockResult block = analyzeBlock(buffer[half], BLOCK_SIZE);
+    readyHalf = -1;
+
+    secondSquareSum += block.meanSquare;
+    secondWeightedSum += block.weightedSquare;
+    if (block.peak > secondPeak) {
+        secondPeak = block.peak;
+    }
+    processCycles += CycleCounter::now() - startCycles;
+
+    if (listener) {
+        listener(block, listenerContext);
+    }
+
+    if (++secondBlocks >= BLOCKS_PER_SECOND) {
+        closeSecond();
+    }
+}
+
+static float toDbfs(float meanSquare, float fullScaleSquare) {
+    if (meanSquare < 1.0f) {
+        meanSquare = 1.0f;  // Floor at one ADC count
+    }
+    return 10.0f * log10f(meanSquare / fullScaleSquare);
+}
+
+void SoundMeter::closeSecond() {
+    const float fullScaleSquare = static_cast<float>(ADC_MIDSCALE) * ADC_MIDSCALE;
+
+    noInterrupts();
+    uint32_t cycles = isrCycles + processCycles;
+    isrCycles = 0;
+    interrupts();
+    processCycles = 0;
+
+    SoundLevelStats stats;
+    stats.rmsDbfs = toDbfs(static_cast<float>(secondSquareSum) / secondBlocks, fullScaleSquare);
+    stats.peakDbfs = toDbfs(static_cast<float>(secondPeak) * secondPeak, fullScaleSquare);
+    stats.weightedDbfs = toDbfs(static_cast<float>(secondWeightedSum) / secondBlocks, fullScaleSquare);
+    stats.cpuLoadPermille = static_cast<uint16_t>(static_cast<uint64_t>(cycles) * 1000 / SystemCoreClock);
+    stats.valid = true;
+
+    noInterrupts();
+    lastSecond = stats;
+    interrupts();
+
+    secondSquareSum = 0;
+    secondWeightedSum = 0;
+    secondPeak = 0;
+    secondBlocks = 0;
+}
+
+SoundLevelStats SoundMeter::getLastSecond() {
+    noInterrupts();
+    SoundLevelStats stats = lastSecond;
+    interrupts();
+    return stats;
+}
@@ -0,0 +1,94 @@
+#ifndef SOUND_METER_H
+#define SOUND_METER_H
+
+#include <Arduino.h>
+#include <FspTimer.h>
+
+// Per-second sound level summary, in dB relative to ADC full scale
+struct SoundLevelStats {
+    float rmsDbfs;
+    float peakDbfs;
+    float weightedDbfs;     // Rough A-weighting: first-difference (high-pass) energy
+    uint16_t cpuLoadPermille;
+    bool valid;
+};
+
+// Samples the MAX9814 at a fixed rate into a double buffer and reduces each
+// block to energy, peak and weighted energy with the Cortex-M4 dual 16-bit
+// MAC instructions. A GPT timer starts each conversion through the ELC, and
+// its overflow interrupt only collects the result, so sampling costs no
+// blocking reads. The meter then owns the ADC: analogRead() elsewhere would
+// change its channel selection. process() does the block work and is called
+// from a task; it also rolls block results into per-second aggregates.
+class SoundMeter {
+public:
+    static const uint32_t SAMPLE_RATE = 8000;
+    static const uint16_t BLOCK_SIZE = 200;     // 25 ms, 40 blocks per second
+    static const uint16_t BLOCKS_PER_SECOND = SAMPLE_RATE / BLOCK_SIZE;
+
+    // Result of one block, also handed to listeners such as activity detection
+    struct BlockResult {
+        uint32_t meanSquare;        // DC removed, in ADC counts squared
+        uint32_t weightedSquare;
+        uint16_t peak;
+    };
+
+    typedef void (*BlockListener)(const BlockResult& block, void* context);
+
+private:
+    static const int16_t ADC_MIDSCALE = 2048;  // 12-bit ADC
+
+    const int micPin;
+    uint8_t adcChannel;
+    FspTimer sampleTimer;
+    bool timerReady;
+
+    alignas(4) int16_t buffer[2][BLOCK_SIZE];
+    volatile uint16_t writePos;
+    volatile uint8_t writeHalf;
+    volatile int8_t readyHalf;      // -1 when no block is waiting
+    volatile uint32_t overruns;
+
+    // Cycles spent in the sample interrupt and in block processing
+    volatile uint32_t isrCycles;
+    uint32_t processCycles;
+
+    // Current second
+    uint64_t secondSquareSum;
+    uint64_t secondWeightedSum;
+    uint16_t secondPeak;
+    uint16_t secondBlocks;
+
+    SoundLevelStats lastSecond;
+
+    BlockListener listener;
+    void* listenerContext;
+
+    static void sampleTimerCallback(timer_callback_args_t* args);
+    static BlockResult blockResult(const int16_t* samples, uint16_t count, int32_t sum,
+                                   int64_t energy, int64_t cross, uint16_t peak);
+    void closeSecond();
+
+public:
+    explicit SoundMeter(int pin);
+
+    bool begin();
+
+    // Process a completed block, if any. Call at least every BLOCK_SIZE samples.
+    void process();
+
+    void setBlockListener(BlockListener callback, void* context) {
+        listener = callback;
+        listenerContext = context;
+    }
+
+    // The block kernel (count even, samples word-aligned) and the scalar
+    // reference it is checked and benchmarked against in tests/
+    static BlockResult analyzeBlock(const int16_t* samples, uint16_t count);
+    static BlockResult analyzeBlockScalar(const int16_t* samples, uint16_t count);
+
+    SoundLevelStats getLastSecond();
+    uint32_t getOverruns() const { return overruns; }
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef STATIC_STORAGE_H
+#define STATIC_STORAGE_H
+
+#include <Arduino.h>
+#include <new>
+#include <utility>
+#include "build_config.h"
+
+// Home for one long-lived object. With WAKU_STATIC_ALLOCATION the object is
+// placement-constructed into storage reserved at link time, so running out of
+// RAM is a link error instead of a failed `new` at boot. Otherwise it falls
+// back to the heap. Call sites are the same in both builds.
+#if WAKU_STATIC_ALLOCATION
+
+template <typename T>
+class ObjectSlot {
+private:
+    alignas(T) unsigned char storage[sizeof(T)];
+    T* object;
+
+public:
+    static const size_t STATIC_BYTES = sizeof(T);
+
+    ObjectSlot() : object(nullptr) {}
+
+    // Returns nullptr if the slot is already in use
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (object) {
+            return nullptr;
+        }
+        object = new (storage) T(std::forward<Args>(args)...);
+        return object;
+    }
+
+    void destroy() {
+        if (object) {
+            object->~T();
+            object = nullptr;
+        }
+    }
+
+    T* get() const { return object; }
+};
+
+#else
+
+template <typename T>
+class ObjectSlot {
+private:
+    T* object;
+
+public:
+    static const size_t STATIC_BYTES = 0;
+
+    ObjectSlot() : object(nullptr) {}
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (object) {
+            return nullptr;
+        }
+        object = new T(std::forward<Args>(args)...);
+        return object;
+    }
+
+    void destroy() {
+        delete object;
+        object = nullptr;
+    }
+
+    T* get() const { return object; }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,230 @@
+#include "supervisor.h"
+#include <Arduino_FreeRTOS.h>
+#include <WDT.h>
+#include "alarm.h"
+#include "crash_journal.h"
+#include "display_manager.h"
+#include "global_variables.h"
+#include "task_manager.h"
+
+static const uint32_t RETAINED_MAGIC = 0x57414B55;    // "WAKU"
+
+// Left alone by the startup code, so it keeps its contents across a reset
+static RetainedState retainedState __attribute__((section(".noinit")));
+
+// The same in the cooperative build, where the alarm and display share a task
+// but the network has its own
+const unsigned long Supervisor::HEARTBEAT_DEADLINES[TASK_COUNT] = {
+    1000,   // Alarm: 10 ms period
+    2000,   // Display: 50 ms period plus up to 100 ms waiting for the mutex
+    60000   // Network: 15 s period plus connect and response timeouts
+};
+
+std::atomic<uint32_t> Supervisor::lastBeat[TASK_COUNT];
+uint8_t Supervisor::stage[TASK_COUNT];
+unsigned long Supervisor::nextAction[TASK_COUNT];
+std::atomic<bool> Supervisor::paused(false);
+std::atomic<uint32_t> Supervisor::pausedAt(0);
+std::atomic<bool> Supervisor::wifiReinitRequested(false);
+Alarm* Supervisor::alarm = nullptr;
+
+static uint32_t retainedChecksum(const RetainedState& state) {
+    // FNV-1a over everything before the checksum
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&state);
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < offsetof(RetainedState, checksum); i++) {
+        hash = (hash ^ bytes[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+void Supervisor::saveRetained() {
+    if (alarm) {
+        retainedState.alarmSaved = true;
+        retainedState.schedule = alarm->getSchedule();
+        retainedState.alarmTriggeredToday = alarm->isTriggered();
+    }
+    retainedState.magic = RETAINED_MAGIC;
+    retainedState.checksum = retainedChecksum(retainedState);
+}
+
+void Supervisor::begin() {
+    bool valid = retainedState.magic == RETAINED_MAGIC &&
+                 retainedState.checksum == retainedChecksum(retainedState);
+
+    if (!valid) {
+        // Power-up: start from a clean record with no alarm state
+        memset(&retainedState, 0, sizeof(retainedState));
+        saveRetained();
+        return;
+    }
+
+    switch (retainedState.resetCause) {
+        case RetainedState::SUPERVISOR:
+            Serial.print("WARNING: Restarted by the supervisor, stalled task: ");
+            Serial.print(TaskStats::name(static_cast<TaskId>(retainedState.stalledTask)));
+            Serial.print(", forced resets since power-up: ");
+            Serial.println(retainedState.supervisorResets);
+            break;
+        case RetainedState::BOOT_FAILURE:
+            Serial.print("WARNING: Retrying after a failed boot, attempt ");
+            Serial.println(retainedState.bootFailures + 1);
+            break;
+        default:
+            Serial.println("WARNING: Restarted by the watchdog or the reset button");
+            break;
+    }
+    retainedState.resetCause = RetainedState::NONE;
+    saveRetained();
+}
+
+void Supervisor::attachAlarm(Alarm* alarmToKeep) {
+    if (alarmToKeep && retainedState.alarmSaved) {
+        // Progress is derived from the RTC, which kept running, so a dawn in
+        // progress picks up where it was once the schedule is back
+        alarmToKeep->restoreState(retainedState.schedule, retainedState.alarmTriggeredToday);
+    }
+    alarm = alarmToKeep;
+}
+
+bool Supervisor::startWatchdog() {
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < TASK_COUNT; i++) {
+        lastBeat[i].store(now);
+    }
+
+    if (!WDT.begin(WATCHDOG_TIMEOUT)) {
+        Serial.println("ERROR: Failed to start the watchdog");
+        return false;
+    }
+    return true;
+}
+
+void Supervisor::escalate(TaskId task, uint32_t silentMillis) {
+    uint8_t i = static_cast<uint8_t>(task);
+    stage[i]++;
+    LOG(SUPERVISOR_TASK_STALLED, LOG_STR(TaskStats::name(task)), silentMillis, stage[i]);
+
+    if (stage[i] >= MAX_RECOVERY_ATTEMPTS) {
+        resetSystem(RetainedState::SUPERVISOR, i);
+    }
+
+    if (stage[i] == 1) {
+        TaskManager::requestRestart(task);
+    } else {
+        if (task == TaskId::NETWORK) {
+            wifiReinitRequested.store(true);
+        }
+        // Refused if the task may hold a lock: deleting it would leave
+        // that lock held for good
+        if (!TaskManager::restartTask(task)) {
+            resetSystem(RetainedState::SUPERVISOR, i);
+        }
+    }
+    lastBeat[i].store(millis());
+    nextAction[i] = millis() + RECOVERY_DELAY;
+}
+
+void Supervisor::check() {
+    static unsigned long healthySince = 0;
+    bool healthy = true;
+    bool withinBudget = true;   // Every silent task has its next stage ahead
+
+    if (!paused.load()) {
+        for (uint8_t i = 0; i < TASK_COUNT; i++) {
+            uint32_t silent = millis() - lastBeat[i].load(std::memory_order_relaxed);
+            if (silent <= HEARTBEAT_DEADLINES[i]) {
+                if (stage[i] > 0 && static_cast<long>(millis() - nextAction[i]) >= 0) {
+                    // Stayed healthy for a full recovery delay
+                    LOG(SUPERVISOR_TASK_RECOVERED, LOG_STR(TaskStats::name(static_cast<TaskId>(i))));
+                    stage[i] = 0;
+                }
+                continue;
+            }
+
+            healthy = false;
+            if (stage[i] == 0 || static_cast<long>(millis() - nextAction[i]) >= 0) {
+                escalate(static_cast<TaskId>(i), silent);
+            }
+            withinBudget = withinBudget && static_cast<long>(millis() - nextAction[i]) < 0;
+        }
+    }
+
+    if (!healthy) {
+        healthySince = millis();
+    } else if (retainedState.bootFailures && millis() - healthySince >= HEALTHY_BOOT_TIME) {
+        retainedState.bootFailures = 0;
+    }
+
+    saveRetained();
+    bool pausedTooLong = paused.load() && millis() - pausedAt.load() > MAX_PAUSE;
+    if ((healthy || withinBudget) && !pausedTooLong) {
+        WDT.refresh();
+    }
+}
+
+void Supervisor::resetSystem(RetainedState::ResetCause cause, uint8_t stalledTask) {
+    retainedState.resetCause = cause;
+    retainedState.stalledTask = stalledTask;
+    if (cause == RetainedState::SUPERVISOR) {
+        retainedState.supervisorResets++;
+        CrashJournal::capture(CrashType::SUPERVISOR_RESET, TaskStats::name(static_cast<TaskId>(stalledTask)));
+    }
+    saveRetained();
+
+    // The log task may be the one that is stuck; print directly
+    Serial.println("ERROR: Supervisor recovery failed - resetting");
+    Serial.flush();
+    NVIC_SystemReset();
+    for (;;) {
+    }
+}
+
+void Supervisor::recoverFromBootFailure(ErrorCode error, DisplayManager* display) {
+    if (retainedState.bootFailures < MAX_RECOVERY_ATTEMPTS) {
+        retainedState.bootFailures++;
+        retainedState.resetCause = RetainedState::BOOT_FAILURE;
+        saveRetained();
+
+        Serial.print("ERROR: ");
+        Serial.print(getErrorString(error));
+        Serial.println(" - resetting");
+        Serial.flush();
+        delay(RECOVERY_DELAY);
+        NVIC_SystemReset();
+    }
+
+    // Resetting again would only flash the outputs every few seconds; stay
+    // put with the error on the display until someone power-cycles
+    Serial.println("ERROR: System recovery failed - halting");
+    if (display) {
+        display->displayError(static_cast<int>(ErrorCode::SYSTEM_RECOVERY_FAILED));
+    }
+    for (;;) {
+        delay(1000);
+    }
+}
+
+void Supervisor::printReport(const char* args) {
+    Serial.println("Task      silent_ms  deadline_ms  stage");
+    for (uint8_t i = 0; i < TASK_COUNT; i++) {
+        char row[48];
+        snprintf(row, sizeof(row), "%-9s %9lu  %11lu  %5u",
+                 TaskStats::name(static_cast<TaskId>(i)),
+                 static_cast<unsigned long>(millis() - lastBeat[i].load(std::memory_order_relaxed)),
+                 HEARTBEAT_DEADLINES[i],
+                 stage[i]);
+        Serial.println(row);
+    }
+    Serial.print("Forced resets since power-up: ");
+    Serial.println(retainedState.supervisorResets);
+}
+
+void vSupervisorTask(void *pvParameters) {
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+
+    for(;;) {
+        Supervisor::check();
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(1000)); // Well inside the watchdog timeout
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "alarm_config.h"
+#include "error_codes.h"
+#include "task_stats.h"
+
+class Alarm;
+class DisplayManager;
+
+// RAM that survives a software or watchdog reset (not a power cycle). After
+// power-up the section holds whatever the SRAM came up with, so it is only
+// trusted when the magic number and checksum match.
+struct RetainedState {
+    enum ResetCause : uint8_t { NONE, SUPERVISOR, BOOT_FAILURE };
+
+    uint32_t magic;
+    uint16_t supervisorResets;      // Resets forced by the supervisor since power-up
+    uint8_t bootFailures;           // Consecutive boots that failed in setup()
+    uint8_t resetCause;             // Why the last reset was requested
+    uint8_t stalledTask;            // TaskId behind a SUPERVISOR reset
+    bool alarmSaved;                // The two fields below hold real alarm state
+    AlarmSchedule schedule;
+    bool alarmTriggeredToday;
+    uint32_t checksum;
+};
+
+// Task health. Each periodic body reports a heartbeat (one relaxed store);
+// the supervisor task checks them every second and feeds the hardware
+// watchdog. A task that stays silent past its deadline is recovered in
+// stages, RECOVERY_DELAY apart:
+//   1. ask the task to start over from its entry point, which it does at
+//      the top of its next cycle with no lock held
+//   2. delete and recreate it, and the network task re-initialises WiFi
+//      first; only if it provably holds no lock (TaskManager::restartTask),
+//      otherwise reset as in stage 3
+//   3. save the alarm state and reset the MCU
+// The watchdog is fed only while every task is healthy or each silent one is
+// within its recovery budget, with its next stage still ahead, and while
+// paused for at most MAX_PAUSE. A stall that outlasts that, or a supervisor
+// that stops, lets the watchdog reset the board.
+class Supervisor {
+private:
+    static const uint8_t TASK_COUNT = static_cast<uint8_t>(TaskId::COUNT);
+    static const unsigned long HEALTHY_BOOT_TIME = 60000;  // ms of health that clears boot failures
+    static const unsigned long MAX_PAUSE = 120000;          // ms; a pushed upload takes well under this
+    static const unsigned long HEARTBEAT_DEADLINES[TASK_COUNT];
+
+    static std::atomic<uint32_t> lastBeat[TASK_COUNT];
+    static uint8_t stage[TASK_COUNT];
+    static unsigned long nextAction[TASK_COUNT];
+    static std::atomic<bool> paused;
+    static std::atomic<uint32_t> pausedAt;
+    static std::atomic<bool> wifiReinitRequested;
+    static Alarm* alarm;
+
+    static void escalate(TaskId task, uint32_t silentMillis);
+    static void saveRetained();
+
+public:
+    // Read the retained state left by the previous run and report why it
+    // ended. Call early in setup(), before the alarm exists.
+    static void begin();
+
+    // Alarm whose schedule and trigger flag are kept across resets; restores
+    // them into it when the retained state is valid
+    static void attachAlarm(Alarm* alarmToKeep);
+
+    // Start the hardware watchdog; call right before the scheduler starts
+    static bool startWatchdog();
+
+    static void heartbeat(TaskId task) { lastBeat[static_cast<uint8_t>(task)].store(millis(), std::memory_order_relaxed); }
+
+    // Ignore heartbeats (but keep the watchdog fed, up to MAX_PAUSE) while
+    // tasks are suspended
+    static void setPaused(bool isPaused) {
+        pausedAt.store(millis());
+        paused.store(isPaused);
+    }
+
+    // Set by stage 2; the network task takes it when it starts
+    static bool takeWifiReinitRequest() { return wifiReinitRequested.exchange(false); }
+
+    // One supervision pass; called by vSupervisorTask
+    static void check();
+
+    // Save state and reset the MCU
+    [[noreturn]] static void resetSystem(RetainedState::ResetCause cause, uint8_t stalledTask = 0);
+
+    // setup() could not bring the system up: reset after RECOVERY_DELAY, up
+    // to MAX_RECOVERY_ATTEMPTS boots in a row, then stop with the error shown
+    [[noreturn]] static void recoverFromBootFailure(ErrorCode error, DisplayManager* display);
+
+    // Console handler: heartbeat ages and recovery stages
+    static void printReport(const char* args);
+};
+
+void vSupervisorTask(void *pvParameters);
+
+#endif
@@ -1,6 +1,7 @@
 #include "task_manager.h"
 #include <Arduino.h>
 #include <Arduino_FreeRTOS.h>
+#include "data_flash.h"
 
 // Function to check available RAM
 extern "C" char *sbrk(int i);
@@ -13,6 +14,8 @@ int freeMemory() {
 TaskHandle_t alarmTaskHandle = NULL;
 TaskHandle_t networkTaskHandle = NULL;
 TaskHandle_t displayTaskHandle = NULL;
+TaskHandle_t logTaskHandle = NULL;
+TaskHandle_t supervisorTaskHandle = NULL;
 
 // Semaphores and mutexes initialization
 SemaphoreHandle_t wifiMutex = NULL;
@@ -23,6 +26,51 @@ QueueHandle_t alarmStateQueue = NULL;
 
 // Static member initialization
 bool TaskManager::tasksInitialized = false;
+std::atomic<bool> TaskManager::restartRequested[static_cast<uint8_t>(TaskId::COUNT)];
+
+#if WAKU_STATIC_ALLOCATION
+#if !configSUPPORT_STATIC_ALLOCATION
+#error "WAKU_STATIC_ALLOCATION needs configSUPPORT_STATIC_ALLOCATION in FreeRTOSConfig.h"
+#endif
+
+// Kernel objects in static storage; the FreeRTOS heap is not touched
+static StaticSemaphore_t wifiMutexStorage;
+static StaticSemaphore_t displayMutexStorage;
+static StaticQueue_t alarmStateQueueStorage;
+static uint8_t alarmStateQueueItems[ALARM_STATE_QUEUE_LENGTH * sizeof(AlarmState)];
+
+#if WAKU_COOPERATIVE_TASKS
+static StackType_t cooperativeStack[COOPERATIVE_STACK_SIZE];
+static StaticTask_t cooperativeTcb;
+#else
+static StackType_t alarmStack[ALARM_STACK_SIZE];
+static StaticTask_t alarmTcb;
+static StackType_t displayStack[DISPLAY_STACK_SIZE];
+static StaticTask_t displayTcb;
+#endif
+static StackType_t networkStack[NETWORK_STACK_SIZE];
+static StaticTask_t networkTcb;
+static StackType_t logStack[LOG_STACK_SIZE];
+static StaticTask_t logTcb;
+static StackType_t supervisorStack[SUPERVISOR_STACK_SIZE];
+static StaticTask_t supervisorTcb;
+
+#define TASK_STORAGE(name) name##Stack, &name##Tcb
+#else
+#define TASK_STORAGE(name) nullptr, nullptr
+#endif
+
+// xTaskCreate, or xTaskCreateStatic on the given stack and TCB
+static BaseType_t createTask(TaskFunction_t function, const char* name, uint32_t stackWords,
+                             void* params, UBaseType_t priority, TaskHandle_t* handle,
+                             StackType_t* stack, StaticTask_t* tcb) {
+#if WAKU_STATIC_ALLOCATION
+    *handle = xTaskCreateStatic(function, name, stackWords, params, priority, stack, tcb);
+    return *handle ? pdPASS : pdFAIL;
+#else
+    return xTaskCreate(function, name, stackWords, params, priority, handle);
+#endif
+}
 
 // Struct for display task parameters
 struct DisplayTaskParams {
@@ -32,124 +80,526 @@ struct DisplayTaskParams {
 
 struct NetworkTaskParams {
     ServerClient* server;
+    SntpClient* sntp;
     CO2Sensor* co2Sensor;
+    SoundMeter* soundMeter;
+    DisplayManager* display;    // For WiFi status during recovery
+    Alarm* alarm;               // State to persist
 };
 
+static ObjectSlot<AlarmTaskParams> alarmParamsSlot;
+static ObjectSlot<NetworkTaskParams> networkParamsSlot;
+static ObjectSlot<DisplayTaskParams> displayParamsSlot;
+
+// Per-cycle work of each task, shared by the threaded and the cooperative build
+
+static void alarmStep(AlarmTaskParams* params) {
+    PROFILE_SCOPE(ProbeId::ALARM_TASK);
+    Alarm* alarm = params->alarm;
+
+    // Keep the RTC on the disciplined clock before anything reads it
+    ClockSync::tick(alarm);
+    
+    // After a power cut the RTC is meaningless until the first network sync
+    if (alarm && BootEvents::isSet(BootEvent::CLOCK_VALID)) {
+        // Check and update alarm state
+        bool isWakeTime = alarm->isWakeUpTime();
+        bool isTriggered = alarm->isTriggered();
+        
+        // Update alarm
+        alarm->update();
+        
+        // Send alarm state to queue
+        AlarmState state = {isTriggered, isWakeTime};
+        xQueueOverwrite(alarmStateQueue, &state);
+        
+        // Check for midnight reset
+        alarm->checkAndResetAtMidnight();
+        BootEvents::publish(BootEvent::ALARM_READY);
+    }
+
+    // Update button state
+    if (params->button) {
+        params->button->update();
+    }
+
+    // Reduce completed microphone blocks (one every 25 ms)
+    if (params->soundMeter) {
+        params->soundMeter->process();
+    }
+}
+
+static void displayStep(DisplayTaskParams* params, TickType_t mutexWait) {
+    DisplayManager* display = params->display;
+    
+    if (display && xSemaphoreTake(displayMutex, mutexWait) == pdTRUE) {
+        RTCTime currentTime;
+        RTC.getTime(currentTime);
+        int currentHour = currentTime.getHour();
+
+        /*
+        Not needed now.
+        if (currentHour >= 11 && currentHour <= 22 && co2Sensor) {
+            int co2Level = co2Sensor->readPWM();
+            display->displayCO2Level(co2Level);
+        }
+        */
+
+        // Update the display state
+        display->update();
+        
+        xSemaphoreGive(displayMutex);
+        BootEvents::publish(BootEvent::FIRST_FRAME);
+    }
+    
+    // Diagnostics commands typed on the serial port
+    SerialConsole::poll();
+}
+
+// Runs when the network body (re)starts: close whatever a killed predecessor
+// left open, and re-initialise WiFi if the supervisor asked for it
+static void recoverNetwork(NetworkTaskParams* params) {
+    if (params->server) {
+        params->server->abortRequest();
+    }
+    if (Supervisor::takeWifiReinitRequest() && xSemaphoreTake(wifiMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        bool connected = reconnectWiFi(params->display);
+        LOG(WIFI_REINIT, connected);
+        xSemaphoreGive(wifiMutex);
+    }
+}
+
+static DeviceUpdate collectDeviceUpdate(NetworkTaskParams* params) {
+    SensorCalibration calibration = {};
+    ConfigStore::get(ConfigKey::CALIBRATION, calibration);
+    float soundOffset = calibration.soundOffsetCentiDb / 100.0f;
+
+    DeviceUpdate update;
+    update.CO2Level = params->co2Sensor->readPWM() + calibration.co2OffsetPpm;
+
+    if (params->soundMeter) {
+        SoundLevelStats sound = params->soundMeter->getLastSecond();
+        if (sound.valid) {
+            update.SoundLevel = sound.rmsDbfs + soundOffset;
+            update.SoundPeakLevel = sound.peakDbfs + soundOffset;
+            update.SoundWeightedLevel = sound.weightedDbfs + soundOffset;
+            update.SoundCpuPermille = sound.cpuLoadPermille;
+        }
+    }
+        
+    AlarmState alarmState;
+    if (xQueuePeek(alarmStateQueue, &alarmState, 0) == pdTRUE) {
+        update.AlarmActive = !alarmState.isTriggered;
+    }
+    
+    MemoryMonitor::sample();
+    update.Memory = MemoryMonitor::getLastStats();
+    update.CrashRecordHex = CrashJournal::pendingUpload();
+    return update;
+}
+
+// Join the network if not connected (any more). One attempt per cycle, so
+// a missing access point costs one WiFi.begin every 15 s and nothing else.
+static bool joinWiFi(NetworkTaskParams* params) {
+    if (WiFi.status() == WL_CONNECTED) {
+        return true;
+    }
+    uint32_t start = millis();
+    if (!connectToWiFi(params->display, 1)) {
+        return false;
+    }
+    RadioManager::joined(millis() - start);
+    BootEvents::publish(BootEvent::WIFI_CONNECTED);
+    return true;
+}
+
+// After a power cut the RTC only knows the date again once it is set, so
+// check for a stop earlier today once the network (server or SNTP) has set
+// the clock
+static void restoreTriggeredDay(Alarm* alarm) {
+    static bool restored = false;
+    if (restored || !ClockSync::isSynced()) {
+        return;
+    }
+    restored = true;
+
+    uint32_t triggeredDay;
+    if (alarm && !alarm->isTriggered() && ConfigStore::get(ConfigKey::TRIGGERED_DAY, triggeredDay) &&
+        triggeredDay == Alarm::currentDate()) {
+        alarm->restoreState(alarm->getSchedule(), true);
+    }
+}
+
+// Last device update the server took, for deciding when the next is due
+static bool serverUpdated = false;
+static uint32_t lastUpdateMillis = 0;
+static bool reportedTriggered = false;
+
+static void recordUpdateResult(NetworkTaskParams* params, bool success, unsigned long currentTime) {
+    static uint32_t updateFailCount = 0;
+    RadioManager::recordUpdate(success);
+    
+    if (!success) {
+        updateFailCount++;
+        LOG(NETWORK_UPDATE_FAILED, updateFailCount);
+    } else {
+        //Serial.println("Network update successful");
+        updateFailCount = 0;
+        CrashJournal::confirmUpload();
+        serverUpdated = true;
+        lastUpdateMillis = millis();
+        reportedTriggered = params->alarm && params->alarm->isTriggered();
+        
+        // Sets the clock if SNTP has not, and stands in for it while it
+        // does not answer
+        bool clockSet = currentTime && ClockSync::setFromServer(currentTime);
+        if (!BootEvents::isSet(BootEvent::SERVER_SYNCED)) {
+            if (!clockSet) {
+                LOG(RTC_SET_FAILED);
+            }
+            BootEvents::publish(BootEvent::SERVER_SYNCED);
+        }
+    }
+}
+
+// Mirror the alarm into the config store, so a cold boot without the server
+// starts from the last schedule; only changes reach the flash
+static void saveAlarmState(NetworkTaskParams* params) {
+    if (!params->alarm) {
+        return;
+    }
+    ConfigStore::set(ConfigKey::WAKE_SCHEDULE, params->alarm->getSchedule());
+    if (params->alarm->isTriggered()) {
+        ConfigStore::set(ConfigKey::TRIGGERED_DAY, Alarm::currentDate());
+    }
+}
+
+#if WAKU_CONFIG_PUSH
+static const uint32_t TELEMETRY_INTERVAL = 300000UL;    // ms between device updates while the server pushes
+static const uint16_t CONFIG_POLL_WAIT = 60;            // s the server may hold a config long-poll
+static bool configPollPaused = false;                   // After a failure, until the next cycle
+#endif
+static const uint32_t SERVICE_INTERVAL = 250;           // ms between looks at the long-poll, local API and OTA sockets
+
+// Telemetry that should not wait: the alarm was stopped or started, or a
+// crash record is waiting
+static bool telemetryUrgent(NetworkTaskParams* params) {
+    bool triggered = params->alarm && params->alarm->isTriggered();
+    return (serverUpdated && triggered != reportedTriggered) || CrashJournal::hasPendingUpload();
+}
+
+// Device updates carry the telemetry and, without push, the configuration:
+// one every cycle while polling. With push they go out every
+// TELEMETRY_INTERVAL, right away when the alarm was stopped or started, and
+// every cycle until the server has taken one.
+static bool deviceUpdateDue(NetworkTaskParams* params) {
+#if WAKU_CONFIG_PUSH
+    if (!serverUpdated || !params->server->supportsPush() || RadioManager::exchangeWanted()) {
+        return true;
+    }
+    return telemetryUrgent(params) || millis() - lastUpdateMillis >= TELEMETRY_INTERVAL;
+#else
+    return true;
+#endif
+}
+
+#if WAKU_CONFIG_PUSH
+// One look at the config long-poll between cycles: open one if none is
+// waiting, otherwise check for the server's answer. Never blocks on the
+// response; a failed poll is not retried before the next cycle.
+static void serviceConfigPoll(NetworkTaskParams* params) {
+    ServerClient* server = params->server;
+    if (!server || !serverUpdated || !server->supportsPush() || configPollPaused) {
+        return;
+    }
+    if (!server->configPollInFlight()) {
+        configPollPaused = !server->beginConfigPoll(CONFIG_POLL_WAIT);
+    } else {
+        int hour, minute;
+        unsigned long currentTime = 0;
+        ServerClient::RequestStatus status = server->pollConfig(hour, minute, currentTime);
+        if (status == ServerClient::RequestStatus::FAILED) {
+            configPollPaused = true;
+        } else if (status == ServerClient::RequestStatus::SUCCEEDED && currentTime) {
+            ClockSync::setFromServer(currentTime);
+        }
+    }
+}
+#endif
+
+// Between cycles, every SERVICE_INTERVAL: the config long-poll, the local
+// API and firmware updates. Skipped while anything else holds the module or
+// the radio is off.
+static void serviceBetweenCycles(NetworkTaskParams* params) {
+    if (!RadioManager::isUp() || xSemaphoreTake(wifiMutex, 0) != pdTRUE) {
+        return;
+    }
+#if WAKU_CONFIG_PUSH
+    serviceConfigPoll(params);
+#endif
+#if WAKU_LOCAL_API
+    LocalApi::poll(params->alarm, params->co2Sensor);
+#endif
+    OtaUpdater::poll(params->alarm);
+    xSemaphoreGive(wifiMutex);
+}
+
+// Start of a network cycle
+static void beginNetworkCycle() {
+    // One task-stats window per network cycle (15 s)
+    TaskStats::closeWindow();
+#if WAKU_CONFIG_PUSH
+    configPollPaused = false;
+#endif
+}
+
+#if WAKU_COOPERATIVE_TASKS
+
+// The alarm and display bodies run as stackless coroutines on one task. Each
+// one returns to vCooperativeTask whenever it waits. The network body keeps
+// its own task: joining, connecting and the TLS handshake block inside the
+// WiFiS3 driver for seconds, and on a shared task the alarm would wait with
+// them.
+
+TaskHandle_t cooperativeTaskHandle = NULL;
+
+struct CooperativeTaskParams {
+    AlarmTaskParams* alarm;
+    DisplayTaskParams* display;
+};
+
+static ObjectSlot<CooperativeTaskParams> cooperativeParamsSlot;
+
+static const uint32_t ALARM_PERIOD_US = 10000UL;
+static const uint32_t DISPLAY_PERIOD_US = 50000UL;
+
+static Coroutine alarmCoroutine = {0, 0, TaskStats::jitter(TaskId::ALARM)};
+static Coroutine displayCoroutine = {0, 0, TaskStats::jitter(TaskId::DISPLAY_UPDATE)};
+
+static void runAlarmCoroutine(AlarmTaskParams* params) {
+    Coroutine& co = alarmCoroutine;
+    CO_BEGIN(co);
+    co.wakeAt = micros();
+    for (;;) {
+        alarmStep(params);
+        CO_SLEEP_UNTIL(co, co.wakeAt + ALARM_PERIOD_US);
+    }
+    CO_END(co);
+}
+
+static void runDisplayCoroutine(DisplayTaskParams* params) {
+    Coroutine& co = displayCoroutine;
+    CO_BEGIN(co);
+    co.wakeAt = micros();
+    for (;;) {
+        // Nothing else holds the mutex in this build; never wait for it
+        displayStep(params, 0);
+        CO_SLEEP_UNTIL(co, co.wakeAt + DISPLAY_PERIOD_US);
+    }
+    CO_END(co);
+}
+
+// Back to the start of both bodies, for a restarted task
+static void resetCoroutines() {
+    alarmCoroutine.resumeLine = 0;
+    displayCoroutine.resumeLine = 0;
+    alarmCoroutine.wakeAt = displayCoroutine.wakeAt = micros();
+}
+
+void vCooperativeTask(void *pvParameters) {
+    CooperativeTaskParams* params = (CooperativeTaskParams*)pvParameters;
+    
+    resetCoroutines();
+    
+    for(;;) {
+        // Between resumes neither body holds a lock; a restart of either
+        // starts both over
+        bool restartAlarm = TaskManager::takeRestartRequest(TaskId::ALARM);
+        bool restartDisplay = TaskManager::takeRestartRequest(TaskId::DISPLAY_UPDATE);
+        if (restartAlarm || restartDisplay) {
+            resetCoroutines();
+        }
+        
+        // Highest priority first, as in the threaded build. Each resume is
+        // one run in the task stats, so the longest run is the longest time
+        // a coroutine kept the other waiting.
+        uint32_t start;
+        if (alarmCoroutine.due(micros())) {
+            start = CycleCounter::now();
+            runAlarmCoroutine(params->alarm);
+            TaskStats::recordRun(TaskId::ALARM, CycleCounter::now() - start);
+            Supervisor::heartbeat(TaskId::ALARM);
+        }
+        if (displayCoroutine.due(micros())) {
+            start = CycleCounter::now();
+            runDisplayCoroutine(params->display);
+            TaskStats::recordRun(TaskId::DISPLAY_UPDATE, CycleCounter::now() - start);
+            Supervisor::heartbeat(TaskId::DISPLAY_UPDATE);
+        }
+        
+        // Sleep until the earlier deadline
+        uint32_t now = micros();
+        int32_t wait = static_cast<int32_t>(alarmCoroutine.wakeAt - now);
+        int32_t displayWait = static_cast<int32_t>(displayCoroutine.wakeAt - now);
+        if (displayWait < wait) wait = displayWait;
+        
+        if (wait > 0) {
+            TickType_t ticks = pdMS_TO_TICKS(wait / 1000);
+            vTaskDelay(ticks > 0 ? ticks : 1);
+        }
+    }
+}
+
+#endif
+
+// vTaskDelayUntil plus the lateness of the wake-up against the ideal period
+static void delayUntilNextCycle(TickType_t* lastWakeTime, TickType_t period,
+                                uint32_t* expectedMicros, TaskId task) {
+    vTaskDelayUntil(lastWakeTime, period);
+    *expectedMicros += period * portTICK_PERIOD_MS * 1000UL;
+    int32_t late = static_cast<int32_t>(micros() - *expectedMicros);
+    TaskStats::recordWake(task, late > 0 ? late : 0);
+}
+
+// One SNTP exchange, waiting for the reply a tick at a time; the timestamps
+// are taken when the reply is noticed, so a coarser wait would show up as
+// round-trip delay
+static void syncClockBlocking(NetworkTaskParams* params) {
+    SntpClient::Sample sample = {};
+    SntpClient::Status result = SntpClient::Status::FAILED;
+    if (WiFi.status() == WL_CONNECTED && params->sntp->begin()) {
+        while ((result = params->sntp->poll(sample)) == SntpClient::Status::PENDING) {
+            vTaskDelay(1);
+        }
+    }
+    ClockSync::recordSntp(result == SntpClient::Status::SUCCEEDED, sample);
+}
+
+#if !WAKU_COOPERATIVE_TASKS
 void vAlarmTask(void *pvParameters) {
     AlarmTaskParams* params = (AlarmTaskParams*)pvParameters;
-    Alarm* alarm = params->alarm;
-    ButtonHandler* button = params->button;
     
     TickType_t xLastWakeTime = xTaskGetTickCount();
+    uint32_t expectedMicros = micros();
     const TickType_t xFrequency = pdMS_TO_TICKS(10); // 10ms period as per README
     
     for(;;) {
-        if (alarm) {
-            // Check and update alarm state
-            bool isWakeTime = alarm->isWakeUpTime();
-            bool isTriggered = alarm->isTriggered();
-            
-            // Update alarm
-            alarm->update();
-            
-            // Send alarm state to queue
-            AlarmState state = {isTriggered, isWakeTime};
-            xQueueOverwrite(alarmStateQueue, &state);
-            
-            // Check for midnight reset
-            alarm->checkAndResetAtMidnight();
-        }
-
-        // Update button state
-        if (button) {
-            button->update();
+        if (TaskManager::takeRestartRequest(TaskId::ALARM)) {
+            // Back to the entry point's state
+            xLastWakeTime = xTaskGetTickCount();
+            expectedMicros = micros();
         }
         
+        uint32_t start = CycleCounter::now();
+        alarmStep(params);
+        TaskStats::recordRun(TaskId::ALARM, CycleCounter::now() - start);
+        Supervisor::heartbeat(TaskId::ALARM);
+        
         // Wait for the next cycle
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        delayUntilNextCycle(&xLastWakeTime, xFrequency, &expectedMicros, TaskId::ALARM);
     }
 }
-
+#endif
 
 void vNetworkTask(void *pvParameters) {
     NetworkTaskParams* params = (NetworkTaskParams*)pvParameters;
     ServerClient* server = params->server;
-    CO2Sensor* co2Sensor = params->co2Sensor;
-
-    static uint32_t updateFailCount = 0;
     
     TickType_t xLastWakeTime = xTaskGetTickCount();
+    uint32_t expectedMicros = micros();
     const TickType_t xFrequency = pdMS_TO_TICKS(15000); // 15 seconds as per README
     
+    recoverNetwork(params);
+    
     for(;;) {
+        if (TaskManager::takeRestartRequest(TaskId::NETWORK)) {
+            // Back to the entry point's state; wifiMutex is not held here
+            xLastWakeTime = xTaskGetTickCount();
+            expectedMicros = micros();
+            recoverNetwork(params);
+        }
+        
+        uint32_t start = CycleCounter::now();
+        beginNetworkCycle();
         if (server && xSemaphoreTake(wifiMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-
-            DeviceUpdate update;
-            update.CO2Level = co2Sensor->readPWM();
-                
-            AlarmState alarmState;
-            if (xQueuePeek(alarmStateQueue, &alarmState, 0) == pdTRUE) {
-                update.AlarmActive = !alarmState.isTriggered;
-            }
-                
-            int newHour, newMinute;
-            unsigned long currentTime;
-            if (!server->sendDeviceUpdateAndGetTime(update, newHour, newMinute, currentTime)) {
-                updateFailCount++;
-                Serial.print("Network update failed. Total fails: ");
-                Serial.println(updateFailCount);
-            } else {
-                //Serial.println("Network update successful");
-                updateFailCount = 0;
+            if (RadioManager::beginCycle(params->alarm, telemetryUrgent(params))) {
+                int newHour, newMinute;
+                unsigned long currentTime = 0;
+                if (!joinWiFi(params)) {
+                    recordUpdateResult(params, false, 0);
+                } else if (deviceUpdateDue(params)) {
+                    DeviceUpdate update = collectDeviceUpdate(params);
+                    bool success = server->sendDeviceUpdateAndGetTime(update, newHour, newMinute, currentTime);
+                    recordUpdateResult(params, success, currentTime);
+                }
+                if (params->sntp && ClockSync::syncDue()) {
+                    syncClockBlocking(params);
+                }
+                // Names past their TTL, looked up off the request path
+                DnsCache::refresh();
+                // Firmware check, or the swap to a downloaded image
+                OtaUpdater::cycle(params->alarm);
             }
+            RadioManager::endCycle();
             xSemaphoreGive(wifiMutex);
         } else {
-            Serial.println("Failed to acquire WiFi mutex for network update");
+            LOG(WIFI_MUTEX_BUSY);
+        }
+        restoreTriggeredDay(params->alarm);
+        saveAlarmState(params);
+        ClockSync::followTimeZone();
+        TaskStats::recordRun(TaskId::NETWORK, CycleCounter::now() - start);
+        Supervisor::heartbeat(TaskId::NETWORK);
+        
+        // Rest of the cycle: keep an eye on the config long-poll, the local API and OTA
+        const TickType_t checkInterval = pdMS_TO_TICKS(SERVICE_INTERVAL);
+        while (xTaskGetTickCount() - xLastWakeTime + checkInterval < xFrequency) {
+            start = CycleCounter::now();
+            serviceBetweenCycles(params);
+            TaskStats::recordRun(TaskId::NETWORK, CycleCounter::now() - start);
+            Supervisor::heartbeat(TaskId::NETWORK);
+            vTaskDelay(checkInterval);
         }
         
         // Wait for the next cycle
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        delayUntilNextCycle(&xLastWakeTime, xFrequency, &expectedMicros, TaskId::NETWORK);
     }
 }
 
+#if !WAKU_COOPERATIVE_TASKS
 void vDisplayTask(void *pvParameters) {
     DisplayTaskParams* params = (DisplayTaskParams*)pvParameters;
-    DisplayManager* display = params->display;
-    CO2Sensor* co2Sensor = params->co2Sensor;
     
     TickType_t xLastWakeTime = xTaskGetTickCount();
+    uint32_t expectedMicros = micros();
     const TickType_t xFrequency = pdMS_TO_TICKS(50); // 50ms as per README
     
     for(;;) {
-        if (display && xSemaphoreTake(displayMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            RTCTime currentTime;
-            RTC.getTime(currentTime);
-            int currentHour = currentTime.getHour();
-
-            /*
-            Not needed now.
-            if (currentHour >= 11 && currentHour <= 22 && co2Sensor) {
-                int co2Level = co2Sensor->readPWM();
-                display->displayCO2Level(co2Level);
-            }
-            */
-
-            // Update the display state
-            display->update();
-            
-            xSemaphoreGive(displayMutex);
+        if (TaskManager::takeRestartRequest(TaskId::DISPLAY_UPDATE)) {
+            // Back to the entry point's state
+            xLastWakeTime = xTaskGetTickCount();
+            expectedMicros = micros();
         }
         
+        uint32_t start = CycleCounter::now();
+        displayStep(params, pdMS_TO_TICKS(100));
+        TaskStats::recordRun(TaskId::DISPLAY_UPDATE, CycleCounter::now() - start);
+        Supervisor::heartbeat(TaskId::DISPLAY_UPDATE);
+        
         // Wait for the next cycle
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        delayUntilNextCycle(&xLastWakeTime, xFrequency, &expectedMicros, TaskId::DISPLAY_UPDATE);
     }
 }
 
+#endif
+
 bool TaskManager::initializeTasks(
     Alarm* alarm,
     ServerClient* serverClient,
+    SntpClient* sntpClient,
     DisplayManager* displayManager,
     CO2Sensor* co2Sensor,
+    SoundMeter* soundMeter,
     ButtonHandler* buttonHandler
 ) {
     if (tasksInitialized) {
@@ -163,8 +613,13 @@ bool TaskManager::initializeTasks(
     Serial.println(freeMemory());
     
     // Create binary semaphores
+#if WAKU_STATIC_ALLOCATION
+    wifiMutex = xSemaphoreCreateBinaryStatic(&wifiMutexStorage);
+    displayMutex = xSemaphoreCreateBinaryStatic(&displayMutexStorage);
+#else
     wifiMutex = xSemaphoreCreateBinary();
     displayMutex = xSemaphoreCreateBinary();
+#endif
     
     if (!wifiMutex || !displayMutex) {
         Serial.println("ERROR: Failed to create semaphores");
@@ -176,7 +631,12 @@ bool TaskManager::initializeTasks(
     xSemaphoreGive(displayMutex);
     
     // Create queues
-    alarmStateQueue = xQueueCreate(1, sizeof(AlarmState));
+#if WAKU_STATIC_ALLOCATION
+    alarmStateQueue = xQueueCreateStatic(ALARM_STATE_QUEUE_LENGTH, sizeof(AlarmState),
+                                         alarmStateQueueItems, &alarmStateQueueStorage);
+#else
+    alarmStateQueue = xQueueCreate(ALARM_STATE_QUEUE_LENGTH, sizeof(AlarmState));
+#endif
     
     if (!alarmStateQueue) {
         Serial.println("ERROR: Failed to create queues");
@@ -186,87 +646,158 @@ bool TaskManager::initializeTasks(
     Serial.print("Free RAM after queues: ");
     Serial.println(freeMemory());
     
-    // Create task parameters on heap to ensure they remain valid
-    // These will not be freed as they need to persist for the lifetime of the tasks
-    NetworkTaskParams* networkParams = new NetworkTaskParams();
+    // Task parameters must stay valid for the lifetime of the tasks, so they
+    // live in slots (static storage or heap, see static_storage.h)
+    NetworkTaskParams* networkParams = networkParamsSlot.create();
     if (!networkParams) {
         Serial.println("ERROR: Failed to allocate network parameters");
         return false;
     }
     networkParams->server = serverClient;
+    networkParams->sntp = sntpClient;
     networkParams->co2Sensor = co2Sensor;
+    networkParams->soundMeter = soundMeter;
+    networkParams->display = displayManager;
+    networkParams->alarm = alarm;
     
-    AlarmTaskParams* alarmParams = new AlarmTaskParams();
+    AlarmTaskParams* alarmParams = alarmParamsSlot.create();
     if (!alarmParams) {
         Serial.println("ERROR: Failed to allocate alarm parameters");
-        delete networkParams;
+        networkParamsSlot.destroy();
         return false;
     }
     alarmParams->alarm = alarm;
     alarmParams->button = buttonHandler;
+    alarmParams->soundMeter = soundMeter;
     
-    DisplayTaskParams* displayParams = new DisplayTaskParams();
+    DisplayTaskParams* displayParams = displayParamsSlot.create();
     if (!displayParams) {
         Serial.println("ERROR: Failed to allocate display parameters");
-        delete networkParams;
-        delete alarmParams;
+        networkParamsSlot.destroy();
+        alarmParamsSlot.destroy();
         return false;
     }
     displayParams->display = displayManager;
     displayParams->co2Sensor = co2Sensor;
     
+#if WAKU_COOPERATIVE_TASKS
+    CooperativeTaskParams* cooperativeParams = cooperativeParamsSlot.create();
+    if (!cooperativeParams) {
+        Serial.println("ERROR: Failed to allocate cooperative parameters");
+        networkParamsSlot.destroy();
+        alarmParamsSlot.destroy();
+        displayParamsSlot.destroy();
+        return false;
+    }
+    cooperativeParams->alarm = alarmParams;
+    cooperativeParams->display = displayParams;
+    
+    BaseType_t status = createTask(
+        vCooperativeTask,
+        "CoopTask",
+        COOPERATIVE_STACK_SIZE,
+        (void*)cooperativeParams,
+        COOPERATIVE_TASK_PRIORITY,
+        &cooperativeTaskHandle,
+        TASK_STORAGE(cooperative)
+    );
+    if (status != pdPASS) {
+        Serial.println("ERROR: Failed to create Cooperative Task");
+        Serial.print("Free RAM: ");
+        Serial.println(freeMemory());
+        networkParamsSlot.destroy();
+        alarmParamsSlot.destroy();
+        displayParamsSlot.destroy();
+        cooperativeParamsSlot.destroy();
+        return false;
+    }
+    
+    Serial.print("Free RAM after Cooperative Task: ");
+    Serial.println(freeMemory());
+    
+    status = createTask(
+        vNetworkTask,
+        "NetworkTask",
+        NETWORK_STACK_SIZE,
+        (void*)networkParams,
+        NETWORK_TASK_PRIORITY,
+        &networkTaskHandle,
+        TASK_STORAGE(network)
+    );
+    if (status != pdPASS) {
+        Serial.println("ERROR: Failed to create Network Task");
+        networkParamsSlot.destroy();
+        alarmParamsSlot.destroy();
+        displayParamsSlot.destroy();
+        vTaskDelete(cooperativeTaskHandle);
+        cooperativeParamsSlot.destroy();
+        return false;
+    }
+    
+    Serial.println("Cooperative and network tasks created successfully");
+    Serial.println("Stack sizes (words):");
+    Serial.print("Cooperative: "); Serial.println(COOPERATIVE_STACK_SIZE);
+    Serial.print("Network: "); Serial.println(NETWORK_STACK_SIZE);
+    Serial.print("Saved vs separate alarm and display tasks: ");
+    Serial.println(ALARM_STACK_SIZE + DISPLAY_STACK_SIZE - COOPERATIVE_STACK_SIZE);
+#else
     // Create tasks
     BaseType_t status = pdPASS;
     
-    status = xTaskCreate(
+    status = createTask(
         vAlarmTask,
         "AlarmTask",
         ALARM_STACK_SIZE,
         (void*)alarmParams,
         ALARM_TASK_PRIORITY,
-        &alarmTaskHandle
+        &alarmTaskHandle,
+        TASK_STORAGE(alarm)
     );
     if (status != pdPASS) {
         Serial.println("ERROR: Failed to create Alarm Task");
         Serial.print("Free RAM: ");
         Serial.println(freeMemory());
-        delete networkParams;
-        delete alarmParams;
-        delete displayParams;
+        networkParamsSlot.destroy();
+        alarmParamsSlot.destroy();
+        displayParamsSlot.destroy();
         return false;
     }
     
     Serial.print("Free RAM after Alarm Task: ");
     Serial.println(freeMemory());
     
-    status = xTaskCreate(
+    status = createTask(
         vNetworkTask,
         "NetworkTask",
         NETWORK_STACK_SIZE,
         (void*)networkParams,
         NETWORK_TASK_PRIORITY,
-        &networkTaskHandle
+        &networkTaskHandle,
+        TASK_STORAGE(network)
     );
     if (status != pdPASS) {
         Serial.println("ERROR: Failed to create Network Task");
-        delete networkParams;
-        delete displayParams;
+        networkParamsSlot.destroy();
+        alarmParamsSlot.destroy();
+        displayParamsSlot.destroy();
         vTaskDelete(alarmTaskHandle);
         return false;
     }
     
-    status = xTaskCreate(
+    status = createTask(
         vDisplayTask,
         "DisplayTask",
         DISPLAY_STACK_SIZE,
         (void*)displayParams,
         DISPLAY_TASK_PRIORITY,
-        &displayTaskHandle
+        &displayTaskHandle,
+        TASK_STORAGE(display)
     );
     if (status != pdPASS) {
         Serial.println("ERROR: Failed to create Display Task");
-        delete networkParams;
-        delete displayParams;
+        networkParamsSlot.destroy();
+        alarmParamsSlot.destroy();
+        displayParamsSlot.destroy();
         vTaskDelete(alarmTaskHandle);
         vTaskDelete(networkTaskHandle);
         return false;
@@ -278,18 +809,126 @@ bool TaskManager::initializeTasks(
     Serial.print("Network: "); Serial.println(NETWORK_STACK_SIZE);
     Serial.print("Display: "); Serial.println(DISPLAY_STACK_SIZE);
     
+#endif
+    
+    // Log drain, lowest application priority in both builds
+    status = createTask(
+        vLogTask,
+        "LogTask",
+        LOG_STACK_SIZE,
+        NULL,
+        LOG_TASK_PRIORITY,
+        &logTaskHandle,
+        TASK_STORAGE(log)
+    );
+    if (status != pdPASS) {
+        // Not fatal: records stay in the ring and new ones are dropped
+        Serial.println("ERROR: Failed to create Log Task");
+    } else {
+        Serial.print("Log: "); Serial.println(LOG_STACK_SIZE);
+    }
+    
+    // Watches the others' heartbeats and feeds the hardware watchdog
+    status = createTask(
+        vSupervisorTask,
+        "Supervisor",
+        SUPERVISOR_STACK_SIZE,
+        NULL,
+        SUPERVISOR_TASK_PRIORITY,
+        &supervisorTaskHandle,
+        TASK_STORAGE(supervisor)
+    );
+    if (status != pdPASS) {
+        Serial.println("ERROR: Failed to create Supervisor Task");
+        return false;
+    }
+    Serial.print("Supervisor: "); Serial.println(SUPERVISOR_STACK_SIZE);
+    
     tasksInitialized = true;
     return true;
 }
 
 void TaskManager::suspendAllTasks() {
+    // The supervisor keeps running so the watchdog stays fed
+    Supervisor::setPaused(true);
+#if WAKU_COOPERATIVE_TASKS
+    if (cooperativeTaskHandle) vTaskSuspend(cooperativeTaskHandle);
+#endif
     if (alarmTaskHandle) vTaskSuspend(alarmTaskHandle);
     if (networkTaskHandle) vTaskSuspend(networkTaskHandle);
     if (displayTaskHandle) vTaskSuspend(displayTaskHandle);
+    if (logTaskHandle) vTaskSuspend(logTaskHandle);
 }
 
 void TaskManager::resumeAllTasks() {
+#if WAKU_COOPERATIVE_TASKS
+    if (cooperativeTaskHandle) vTaskResume(cooperativeTaskHandle);
+#endif
     if (alarmTaskHandle) vTaskResume(alarmTaskHandle);
     if (networkTaskHandle) vTaskResume(networkTaskHandle);
     if (displayTaskHandle) vTaskResume(displayTaskHandle);
-} 
\ No newline at end of file
+    if (logTaskHandle) vTaskResume(logTaskHandle);
+    Supervisor::setPaused(false);
+}
+
+// Whether deleting the task now could leave another waiting for good: it
+// holds the data flash lock, some task is between claiming and publishing a
+// log slot, or the semaphore only this task's body takes is taken. The
+// supervisor runs above every task it restarts, so nothing changes between
+// this check and the delete.
+static bool mayHoldLock(TaskHandle_t handle, SemaphoreHandle_t semaphore) {
+    return DataFlash::heldBy(handle) || Log::writing() || (semaphore && uxSemaphoreGetCount(semaphore) == 0);
+}
+
+bool TaskManager::restartTask(TaskId task) {
+    BaseType_t status;
+    
+    switch (task) {
+#if WAKU_COOPERATIVE_TASKS
+        case TaskId::ALARM:
+        case TaskId::DISPLAY_UPDATE:
+            // One task runs both bodies, so both start over
+            if (mayHoldLock(cooperativeTaskHandle, displayMutex)) {
+                return false;
+            }
+            if (cooperativeTaskHandle) vTaskDelete(cooperativeTaskHandle);
+            restartRequested[static_cast<uint8_t>(TaskId::ALARM)].store(false);
+            restartRequested[static_cast<uint8_t>(TaskId::DISPLAY_UPDATE)].store(false);
+            status = createTask(vCooperativeTask, "CoopTask", COOPERATIVE_STACK_SIZE, (void*)cooperativeParamsSlot.get(),
+                                COOPERATIVE_TASK_PRIORITY, &cooperativeTaskHandle, TASK_STORAGE(cooperative));
+            break;
+#else
+        case TaskId::ALARM:
+            if (mayHoldLock(alarmTaskHandle, nullptr)) {
+                return false;
+            }
+            if (alarmTaskHandle) vTaskDelete(alarmTaskHandle);
+            restartRequested[static_cast<uint8_t>(task)].store(false);
+            status = createTask(vAlarmTask, "AlarmTask", ALARM_STACK_SIZE, (void*)alarmParamsSlot.get(),
+                                ALARM_TASK_PRIORITY, &alarmTaskHandle, TASK_STORAGE(alarm));
+            break;
+        case TaskId::DISPLAY_UPDATE:
+            if (mayHoldLock(displayTaskHandle, displayMutex)) {
+                return false;
+            }
+            if (displayTaskHandle) vTaskDelete(displayTaskHandle);
+            restartRequested[static_cast<uint8_t>(task)].store(false);
+            status = createTask(vDisplayTask, "DisplayTask", DISPLAY_STACK_SIZE, (void*)displayParamsSlot.get(),
+                                DISPLAY_TASK_PRIORITY, &displayTaskHandle, TASK_STORAGE(display));
+            break;
+#endif
+        case TaskId::NETWORK:
+            if (mayHoldLock(networkTaskHandle, wifiMutex)) {
+                return false;
+            }
+            if (networkTaskHandle) vTaskDelete(networkTaskHandle);
+            restartRequested[static_cast<uint8_t>(task)].store(false);
+            status = createTask(vNetworkTask, "NetworkTask", NETWORK_STACK_SIZE, (void*)networkParamsSlot.get(),
+                                NETWORK_TASK_PRIORITY, &networkTaskHandle, TASK_STORAGE(network));
+            break;
+        default:
+            return false;
+    }
+    
+    return status == pdPASS;
+}
@@ -3,17 +3,44 @@
 
 #include <Arduino.h>
 #include <Arduino_FreeRTOS.h>
+#include <atomic>
 
+#include "build_config.h"
+#include "coroutine.h"
+#include "cycle_counter.h"
+#include "task_stats.h"
+#include "static_storage.h"
 #include "alarm.h"
 #include "server_client.h"
 #include "display_manager.h"
 #include "co2_sensor.h"
+#include "sound_meter.h"
 #include "button_handler.h"
+#include "memory_monitor.h"
+#include "serial_console.h"
+#include "profiler.h"
+#include "log.h"
+#include "supervisor.h"
+#include "crash_journal.h"
+#include "wifi_connection.h"
+#include "config_store.h"
+#include "boot_events.h"
+#include "clock_sync.h"
+#include "sntp_client.h"
+#include "dns_cache.h"
+#include "radio_manager.h"
+#include "local_api.h"
+#include "ota_updater.h"
 
 // Task handles
 extern TaskHandle_t alarmTaskHandle;
 extern TaskHandle_t networkTaskHandle;
 extern TaskHandle_t displayTaskHandle;
+extern TaskHandle_t logTaskHandle;
+extern TaskHandle_t supervisorTaskHandle;
+#if WAKU_COOPERATIVE_TASKS
+extern TaskHandle_t cooperativeTaskHandle;
+#endif
 
 // Semaphores and mutexes
 extern SemaphoreHandle_t wifiMutex;
@@ -34,43 +61,72 @@ struct AlarmState {
 extern QueueHandle_t sensorDataQueue;
 extern QueueHandle_t alarmStateQueue;
 
+#define ALARM_STATE_QUEUE_LENGTH 1  // Overwritten, latest state only
+
 // Task priorities (1-24, where 24 is highest)
 #define ALARM_TASK_PRIORITY    3
 #define NETWORK_TASK_PRIORITY  1
 #define DISPLAY_TASK_PRIORITY  2
+#define COOPERATIVE_TASK_PRIORITY ALARM_TASK_PRIORITY
+#define LOG_TASK_PRIORITY      1  // Formats and prints the log ring when nothing else runs
+#define SUPERVISOR_TASK_PRIORITY 4  // Above everything it watches
 
 // Task stack sizes (in words)
 #define ALARM_STACK_SIZE      256
 #define NETWORK_STACK_SIZE    512
 #define DISPLAY_STACK_SIZE    256
+#define COOPERATIVE_STACK_SIZE 288  // Alarm and display take turns: the deeper of the two plus the scheduler
+#define LOG_STACK_SIZE        192
+#define SUPERVISOR_STACK_SIZE 160
 
 // Function declarations for tasks
 void vAlarmTask(void *pvParameters);
 void vNetworkTask(void *pvParameters);
 void vDisplayTask(void *pvParameters);
+#if WAKU_COOPERATIVE_TASKS
+void vCooperativeTask(void *pvParameters);
+#endif
 
 // Structure for alarm task parameters
 struct AlarmTaskParams {
     Alarm* alarm;
     ButtonHandler* button;
+    SoundMeter* soundMeter;
 };
 
 // Task manager class
 class TaskManager {
 private:
     static bool tasksInitialized;
+    static std::atomic<bool> restartRequested[static_cast<uint8_t>(TaskId::COUNT)];
 
 public:
     static bool initializeTasks(
         Alarm* alarm,
         ServerClient* serverClient,
+        SntpClient* sntpClient,
         DisplayManager* displayManager,
         CO2Sensor* co2Sensor,
+        SoundMeter* soundMeter,
         ButtonHandler* buttonHandler
     );
     
     static void suspendAllTasks();
     static void resumeAllTasks();
+
+    // Ask a task to start over from its entry point. It does so at the top
+    // of its next cycle, where it holds no lock.
+    static void requestRestart(TaskId task) { restartRequested[static_cast<uint8_t>(task)].store(true); }
+
+    // For the task's loop: true once per request
+    static bool takeRestartRequest(TaskId task) { return restartRequested[static_cast<uint8_t>(task)].exchange(false); }
+
+    // Delete a task that did not come back and start it again on the same
+    // parameters (and storage). Refuses, returning false, unless the task
+    // provably holds nothing another task would wait on for good: the data
+    // flash lock, a claimed log slot, or its body's semaphore. In the
+    // cooperative build the alarm and display restart together.
+    static bool restartTask(TaskId task);
 };
 
 #endif 
\ No newline at end of file
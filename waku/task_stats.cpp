@@ -0,0 +1,117 @@
+#include "task_stats.h"
+#include <Arduino_FreeRTOS.h>
+#include "cycle_counter.h"
+
+TaskRunStats TaskStats::tasks[static_cast<uint8_t>(TaskId::COUNT)];
+uint64_t TaskStats::windowStartBusy[static_cast<uint8_t>(TaskId::COUNT)];
+unsigned long TaskStats::windowStartMillis = 0;
+
+const char* const TaskStats::TASK_NAMES[static_cast<uint8_t>(TaskId::COUNT)] = {
+    "alarm",
+    "display",
+    "network"
+};
+
+#if configGENERATE_RUN_TIME_STATS
+// Kernel run-time counter on the DWT cycle counter. Divided down to 750 kHz
+// so the 32-bit counter wraps every ~95 minutes instead of every 89 s;
+// FreeRTOSConfig.h maps portCONFIGURE_TIMER_FOR_RUN_TIME_STATS and
+// portGET_RUN_TIME_COUNTER_VALUE to these.
+extern "C" void vConfigureTimerForRunTimeStats(void) {
+    CycleCounter::begin();
+}
+
+extern "C" unsigned long ulGetRunTimeCounterValue(void) {
+    return CycleCounter::now() >> 6;
+}
+#endif
+
+void TaskStats::recordWake(TaskId id, uint32_t lateMicros) {
+    noInterrupts();
+    tasks[static_cast<uint8_t>(id)].jitter.record(lateMicros);
+    interrupts();
+}
+
+void TaskStats::recordRun(TaskId id, uint32_t cycles) {
+    uint32_t busyMicros = CycleCounter::toMicros(cycles);
+
+    noInterrupts();
+    TaskRunStats& task = tasks[static_cast<uint8_t>(id)];
+    task.runs++;
+    task.busyCycles += cycles;
+    if (busyMicros > task.maxBusyMicros) {
+        task.maxBusyMicros = busyMicros;
+    }
+    interrupts();
+}
+
+void TaskStats::closeWindow() {
+    unsigned long now = millis();
+    uint64_t windowCycles = static_cast<uint64_t>(now - windowStartMillis) * (SystemCoreClock / 1000);
+    windowStartMillis = now;
+
+    for (uint8_t i = 0; i < static_cast<uint8_t>(TaskId::COUNT); i++) {
+        noInterrupts();
+        uint64_t busy = tasks[i].busyCycles;
+        interrupts();
+
+        uint64_t delta = busy - windowStartBusy[i];
+        windowStartBusy[i] = busy;
+        uint16_t permille = windowCycles ? static_cast<uint16_t>(delta * 1000 / windowCycles) : 0;
+
+        noInterrupts();
+        tasks[i].busyPermille = permille;
+        interrupts();
+    }
+}
+
+TaskRunStats TaskStats::get(TaskId id) {
+    noInterrupts();
+    TaskRunStats stats = tasks[static_cast<uint8_t>(id)];
+    interrupts();
+    return stats;
+}
+
+void TaskStats::printReport(const char* args) {
+    Serial.println("Task      busy_pm runs      max_run_us  late_mean_us  late_max_us");
+    for (uint8_t i = 0; i < static_cast<uint8_t>(TaskId::COUNT); i++) {
+        TaskRunStats stats = get(static_cast<TaskId>(i));
+        char row[80];
+        snprintf(row, sizeof(row), "%-9s %7u %-9lu %10lu  %12lu  %11lu",
+                 TASK_NAMES[i],
+                 stats.busyPermille,
+                 static_cast<unsigned long>(stats.runs),
+                 static_cast<unsigned long>(stats.maxBusyMicros),
+                 static_cast<unsigned long>(stats.jitter.meanMicros()),
+                 static_cast<unsigned long>(stats.jitter.maxMicros));
+        Serial.println(row);
+
+        // Lateness distribution as "<upper bound us>:count"
+        Serial.print("    ");
+        for (uint8_t b = 0; b < LatencyStats::HISTOGRAM_BUCKETS; b++) {
+            if (stats.jitter.histogram[b]) {
+                Serial.print(b + 1 < LatencyStats::HISTOGRAM_BUCKETS ? "<" : ">=");
+                Serial.print(b + 1 < LatencyStats::HISTOGRAM_BUCKETS ? (1UL << (b + 1)) : (1UL << b));
+                Serial.print(":");
+                Serial.print(stats.jitter.histogram[b]);
+                Serial.print(" ");
+            }
+        }
+        Serial.println();
+    }
+
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+    // Kernel view, including the idle task and anything outside our tasks
+    static TaskStatus_t status[8];
+    unsigned long totalRunTime = 0;
+    UBaseType_t count = uxTaskGetSystemState(status, 8, &totalRunTime);
+    totalRunTime /= 1000;   // For permille
+    Serial.println("Kernel run time (permille):");
+    for (UBaseType_t i = 0; i < count; i++) {
+        Serial.print("    ");
+        Serial.print(status[i].pcTaskName);
+        Serial.print(": ");
+        Serial.println(totalRunTime ? status[i].ulRunTimeCounter / totalRunTime : 0);
+    }
+#endif
+}
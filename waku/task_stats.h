@@ -0,0 +1,80 @@
+#ifndef TASK_STATS_H
+#define TASK_STATS_H
+
+#include <Arduino.h>
+
+// Wake-up lateness of a periodic body: how long after its ideal release time
+// it actually started, as a log2 histogram in microseconds
+struct LatencyStats {
+    static const uint8_t HISTOGRAM_BUCKETS = 16;    // Last bucket: >= 32 ms
+
+    uint32_t wakeups;
+    uint32_t maxMicros;
+    uint64_t totalMicros;
+    uint16_t histogram[HISTOGRAM_BUCKETS];  // Bucket n: 2^n <= us < 2^(n+1); bucket 0 also holds 0
+
+    void record(uint32_t lateMicros) {
+        wakeups++;
+        totalMicros += lateMicros;
+        if (lateMicros > maxMicros) {
+            maxMicros = lateMicros;
+        }
+        uint8_t bucket = lateMicros ? 31 - __builtin_clz(lateMicros) : 0;
+        if (bucket >= HISTOGRAM_BUCKETS) {
+            bucket = HISTOGRAM_BUCKETS - 1;
+        }
+        if (histogram[bucket] < UINT16_MAX) {
+            histogram[bucket]++;
+        }
+    }
+
+    uint32_t meanMicros() const { return wakeups ? static_cast<uint32_t>(totalMicros / wakeups) : 0; }
+};
+
+enum class TaskId : uint8_t {
+    ALARM,
+    DISPLAY_UPDATE,
+    NETWORK,
+    COUNT
+};
+
+struct TaskRunStats {
+    LatencyStats jitter;
+    uint32_t runs;
+    uint32_t maxBusyMicros;         // Longest single run
+    uint64_t busyCycles;            // Since boot
+    uint16_t busyPermille;          // Share of the last closed window
+};
+
+// Per-task run-time accounting for the application tasks: cycles spent in
+// each body (DWT), its share of each window, and wake-up jitter. Busy time is
+// wall time from the start to the end of a body, so it includes time the body
+// was preempted or blocked; the kernel run-time stats give exact CPU time.
+// The tasks record into their own slot; readers take copies.
+class TaskStats {
+private:
+    static TaskRunStats tasks[static_cast<uint8_t>(TaskId::COUNT)];
+    static const char* const TASK_NAMES[static_cast<uint8_t>(TaskId::COUNT)];
+
+    // CPU window bookkeeping
+    static uint64_t windowStartBusy[static_cast<uint8_t>(TaskId::COUNT)];
+    static unsigned long windowStartMillis;
+
+public:
+    static LatencyStats* jitter(TaskId id) { return &tasks[static_cast<uint8_t>(id)].jitter; }
+
+    static void recordWake(TaskId id, uint32_t lateMicros);
+    static void recordRun(TaskId id, uint32_t cycles);
+
+    // Compute busy shares since the previous call; called once per network cycle
+    static void closeWindow();
+
+    static TaskRunStats get(TaskId id);
+    static const char* name(TaskId id) { return TASK_NAMES[static_cast<uint8_t>(id)]; }
+
+    // Console handler: per-task busy time and jitter, plus FreeRTOS run-time stats
+    // when the kernel is built with them
+    static void printReport(const char* args);
+};
+
+#endif
@@ -0,0 +1,276 @@
+#include "timezone.h"
+#include "civil_time.h"
+#include "config_store.h"
+
+static const int32_t DEFAULT_UTC_OFFSET = 3600;     // s, until the server says otherwise
+
+TimeZone::Rules TimeZone::rules = {DEFAULT_UTC_OFFSET, DEFAULT_UTC_OFFSET, false, {}, {}};
+char TimeZone::tzString[MAX_TZ_LENGTH + 1];
+int64_t TimeZone::validFrom = 0;
+int64_t TimeZone::validUntil = 0;
+int32_t TimeZone::cachedOffset = DEFAULT_UTC_OFFSET;
+bool TimeZone::cachedDst = false;
+
+// Parsing helpers; each advances p past what it consumed and fails on
+// anything it does not recognise
+
+static bool parseNumber(const char*& p, int32_t maxValue, int32_t& value) {
+    if (!isdigit(*p)) {
+        return false;
+    }
+    value = 0;
+    while (isdigit(*p)) {
+        value = value * 10 + (*p++ - '0');
+        if (value > maxValue) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Zone abbreviation: three or more letters, or anything in <> ("<+03>")
+static bool parseName(const char*& p) {
+    const char* start = p;
+    if (*p == '<') {
+        while (*p && *p != '>') {
+            p++;
+        }
+        if (*p != '>' || p - start < 4) {
+            return false;
+        }
+        p++;
+        return true;
+    }
+    while (isalpha(*p)) {
+        p++;
+    }
+    return p - start >= 3;
+}
+
+// [+|-]hh[:mm[:ss]]; hours up to 167 as in the extended rule times
+static bool parseTime(const char*& p, int32_t& seconds) {
+    int32_t sign = 1;
+    if (*p == '+' || *p == '-') {
+        sign = *p++ == '-' ? -1 : 1;
+    }
+    int32_t hours, minutes = 0, secs = 0;
+    if (!parseNumber(p, 167, hours)) {
+        return false;
+    }
+    if (*p == ':') {
+        p++;
+        if (!parseNumber(p, 59, minutes)) {
+            return false;
+        }
+        if (*p == ':') {
+            p++;
+            if (!parseNumber(p, 59, secs)) {
+                return false;
+            }
+        }
+    }
+    seconds = sign * (hours * 3600 + minutes * 60 + secs);
+    return true;
+}
+
+// Jn, n or Mm.w.d, then an optional /time (default 02:00)
+static bool parseRule(const char*& p, TzRule& rule) {
+    int32_t value;
+    if (*p == 'M') {
+        p++;
+        int32_t week, weekday;
+        if (!parseNumber(p, 12, value) || value < 1 || *p++ != '.' ||
+            !parseNumber(p, 5, week) || week < 1 || *p++ != '.' ||
+            !parseNumber(p, 6, weekday)) {
+            return false;
+        }
+        rule.form = TzRule::MONTH_WEEK_DAY;
+        rule.month = value;
+        rule.week = week;
+        rule.weekday = weekday;
+    } else if (*p == 'J') {
+        p++;
+        if (!parseNumber(p, 365, value) || value < 1) {
+            return false;
+        }
+        rule.form = TzRule::JULIAN_NO_LEAP;
+        rule.day = value;
+    } else {
+        if (!parseNumber(p, 365, value)) {
+            return false;
+        }
+        rule.form = TzRule::ZERO_BASED;
+        rule.day = value;
+    }
+
+    rule.time = 2 * 3600;
+    if (*p == '/') {
+        p++;
+        return parseTime(p, rule.time);
+    }
+    return true;
+}
+
+bool TimeZone::parse(const char* tz, Rules& parsed) {
+    const char* p = tz;
+    int32_t offset;
+    if (!parseName(p) || !parseTime(p, offset)) {
+        return false;
+    }
+    // POSIX offsets count west of Greenwich
+    parsed.stdOffset = -offset;
+    parsed.hasDst = false;
+
+    if (*p == '\0') {
+        parsed.dstOffset = parsed.stdOffset;
+        return true;
+    }
+
+    if (!parseName(p)) {
+        return false;
+    }
+    parsed.hasDst = true;
+    parsed.dstOffset = parsed.stdOffset + 3600;
+    if (*p && *p != ',') {
+        if (!parseTime(p, offset)) {
+            return false;
+        }
+        parsed.dstOffset = -offset;
+    }
+
+    if (*p == '\0') {
+        // No rules given; POSIX leaves them to the implementation, take the current US ones
+        const char* usRules = "M3.2.0,M11.1.0";
+        return parseRule(usRules, parsed.start) && *usRules++ == ',' && parseRule(usRules, parsed.end);
+    }
+    return *p++ == ',' && parseRule(p, parsed.start) && *p++ == ',' && parseRule(p, parsed.end) && *p == '\0';
+}
+
+// UTC time at which a rule fires in the given year; rule times are local
+// time under the offset in force just before the transition
+int64_t TimeZone::transitionUtc(const TzRule& rule, int32_t year, int32_t offsetBefore) {
+    int32_t days;
+    switch (rule.form) {
+        case TzRule::JULIAN_NO_LEAP:
+            // Day 60 is always 1 March
+            days = daysFromCivil(year, 1, 1) + rule.day - 1 + (isLeapYear(year) && rule.day >= 60);
+            break;
+        case TzRule::ZERO_BASED:
+            days = daysFromCivil(year, 1, 1) + rule.day;
+            break;
+        default: {
+            int32_t first = daysFromCivil(year, rule.month, 1);
+            days = first + (rule.weekday + 7 - weekdayFromDays(first)) % 7 + (rule.week - 1) * 7;
+            // Week 5 means the last one, which may be the fourth
+            int32_t nextMonth = rule.month == 12 ? daysFromCivil(year + 1, 1, 1) : daysFromCivil(year, rule.month + 1, 1);
+            while (days >= nextMonth) {
+                days -= 7;
+            }
+            break;
+        }
+    }
+    return static_cast<int64_t>(days) * SECONDS_PER_DAY + rule.time - offsetBefore;
+}
+
+void TimeZone::invalidate() {
+    validFrom = 0;
+    validUntil = 0;
+}
+
+void TimeZone::recompute(int64_t utc) {
+    if (!rules.hasDst) {
+        validFrom = INT64_MIN;
+        validUntil = INT64_MAX;
+        cachedOffset = rules.stdOffset;
+        cachedDst = false;
+        return;
+    }
+
+    // Transitions of the neighbouring years cover an interval that starts in
+    // one year and ends in the next, and southern-hemisphere rules where DST
+    // spans New Year
+    int32_t year = civilFromDays(daysFromSeconds(utc + rules.stdOffset)).year;
+    validFrom = INT64_MIN;
+    validUntil = INT64_MAX;
+    cachedDst = false;
+    for (int32_t y = year - 1; y <= year + 1; y++) {
+        int64_t start = transitionUtc(rules.start, y, rules.stdOffset);
+        int64_t end = transitionUtc(rules.end, y, rules.dstOffset);
+        if (start <= utc && start > validFrom) {
+            validFrom = start;
+            cachedDst = true;
+        }
+        if (end <= utc && end > validFrom) {
+            validFrom = end;
+            cachedDst = false;
+        }
+        if (start > utc && start < validUntil) {
+            validUntil = start;
+        }
+        if (end > utc && end < validUntil) {
+            validUntil = end;
+        }
+    }
+    cachedOffset = cachedDst ? rules.dstOffset : rules.stdOffset;
+}
+
+int32_t TimeZone::offsetAt(int64_t utc) {
+    if (utc < validFrom || utc >= validUntil) {
+        recompute(utc);
+    }
+    return cachedOffset;
+}
+
+bool TimeZone::isDst(int64_t utc) {
+    offsetAt(utc);
+    return cachedDst;
+}
+
+int32_t TimeZone::offsetForLocal(int64_t local) {
+    int32_t offset = offsetAt(local - rules.stdOffset);
+    return offsetAt(local - offset) == offset ? offset : rules.stdOffset;
+}
+
+int64_t TimeZone::nextTransition(int64_t utc) {
+    offsetAt(utc);
+    return validUntil;
+}
+
+void TimeZone::begin() {
+    Rules parsed;
+    if (ConfigStore::getString(ConfigKey::TIMEZONE, tzString, sizeof(tzString)) && parse(tzString, parsed)) {
+        rules = parsed;
+    } else {
+        int32_t utcOffset = DEFAULT_UTC_OFFSET;
+        ConfigStore::get(ConfigKey::UTC_OFFSET, utcOffset);
+        tzString[0] = '\0';
+        rules = Rules{utcOffset, utcOffset, false, {}, {}};
+    }
+    invalidate();
+}
+
+bool TimeZone::set(const char* tz) {
+    Rules parsed;
+    if (strlen(tz) > MAX_TZ_LENGTH || !parse(tz, parsed)) {
+        return false;
+    }
+    if (strcmp(tz, tzString) == 0) {
+        return true;
+    }
+    strcpy(tzString, tz);
+    rules = parsed;
+    invalidate();
+    return ConfigStore::setString(ConfigKey::TIMEZONE, tz);
+}
+
+void TimeZone::printReport() {
+    Serial.print("Zone: ");
+    Serial.println(tzString[0] ? tzString : "fixed offset");
+    Serial.print("Offset: ");
+    Serial.print(cachedOffset);
+    Serial.println(cachedDst ? " s (DST)" : " s");
+    if (rules.hasDst && validUntil != INT64_MAX) {
+        Serial.print("Next transition (UTC): ");
+        Serial.println(static_cast<unsigned long>(validUntil));
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef TIMEZONE_H
+#define TIMEZONE_H
+
+#include <Arduino.h>
+
+// One end of the daylight saving period in a POSIX TZ string
+struct TzRule {
+    enum Form : uint8_t { JULIAN_NO_LEAP, ZERO_BASED, MONTH_WEEK_DAY };
+
+    Form form;
+    uint8_t month;      // MONTH_WEEK_DAY: 1-12
+    uint8_t week;       // MONTH_WEEK_DAY: 1-5, 5 = last
+    uint8_t weekday;    // MONTH_WEEK_DAY: 0 = Sunday
+    uint16_t day;       // JULIAN_NO_LEAP: 1-365, ZERO_BASED: 0-365
+    int32_t time;       // Seconds after local midnight, may be negative or past 24 h
+};
+
+// Local time from UTC with the rules of a POSIX TZ string, e.g.
+// "CET-1CEST,M3.5.0,M10.5.0/3". The string comes from the server ("tz") and
+// is kept in the config store; without one, the fixed "utc_offset" applies.
+//
+// The offset in force and the UTC interval it holds for are cached, so
+// converting a time inside that interval is a compare and an add. Crossing
+// a transition recomputes the neighbouring transitions once.
+//
+// Network task only (server sync and the clock's DST check).
+class TimeZone {
+public:
+    static const uint8_t MAX_TZ_LENGTH = 47;
+
+    // Load the rules from the config store; call after ConfigStore::begin()
+    static void begin();
+
+    // Validate, apply and store a POSIX TZ string; false leaves the current
+    // rules in place
+    static bool set(const char* tz);
+
+    // Re-read the fixed offset after the server changed it
+    static void reload() { begin(); }
+
+    // Seconds to add to UTC at the given UTC time
+    static int32_t offsetAt(int64_t utc);
+    static bool isDst(int64_t utc);
+
+    // Offset for a local time, for a clock that only keeps local time. In
+    // the hour repeated at the end of DST this picks standard time.
+    static int32_t offsetForLocal(int64_t local);
+
+    // First transition after the given UTC time, or INT64_MAX without DST
+    static int64_t nextTransition(int64_t utc);
+
+    // Console output: rules and the cached interval
+    static void printReport();
+
+private:
+    struct Rules {
+        int32_t stdOffset;      // Seconds east of UTC
+        int32_t dstOffset;
+        bool hasDst;
+        TzRule start;
+        TzRule end;
+    };
+
+    static Rules rules;
+    static char tzString[MAX_TZ_LENGTH + 1];
+
+    // Cache: offset between two transitions
+    static int64_t validFrom;
+    static int64_t validUntil;
+    static int32_t cachedOffset;
+    static bool cachedDst;
+
+    static bool parse(const char* tz, Rules& parsed);
+    static int64_t transitionUtc(const TzRule& rule, int32_t year, int32_t offsetBefore);
+    static void recompute(int64_t utc);
+    static void invalidate();
+};
+
+#endif
@@ -15,155 +15,157 @@
 #include "display_manager.h"
 #include "arduino_secrets.h"
 #include "co2_sensor.h"
+#include "sound_meter.h"
+#include "activity_detector.h"
 #include "error_codes.h"
 #include "task_manager.h"
 #include "button_handler.h"
+#include "cycle_counter.h"
+#include "static_storage.h"
+#include "ram_budget.h"
+#include "memory_monitor.h"
+#include "task_stats.h"
+#include "serial_console.h"
+#include "profiler.h"
+#include "log.h"
+#include "wifi_connection.h"
+#include "supervisor.h"
+#include "crash_journal.h"
+#include "config_store.h"
+#include "boot_events.h"
+#include "clock_sync.h"
+#include "timezone.h"
+#include "sntp_client.h"
+#include "dns_cache.h"
+#include "radio_manager.h"
+#include "local_api.h"
+#include "ota_updater.h"
 
 // Objects
 ArduinoLEDMatrix matrix;
 Alarm* alarm = nullptr;
 DisplayManager* displayManager = nullptr;
 ServerClient* serverClient = nullptr;
+SntpClient* sntpClient = nullptr;
 CO2Sensor* co2Sensor = nullptr;
+SoundMeter* soundMeter = nullptr;
+ActivityDetector* activityDetector = nullptr;
 ButtonHandler* buttonHandler = nullptr;
 
-// Time conversion helper
-RTCTime unixTimeToRTCTime(unsigned long unixTime) {
-    // Convert Unix timestamp to date/time components
-    unsigned long seconds = unixTime % 60;
-    unsigned long minutes = (unixTime / 60) % 60;
-    unsigned long hours = (unixTime / 3600) % 24;
-    unsigned long days = (unixTime / 86400) + 1; // +1 because RTCTime expects day 1-31
-    
-    // Simple calculation for month/year (approximate)
-    unsigned long year = 1970 + (days / 365);
-    unsigned long month = ((days % 365) / 30) + 1; // +1 because Month enum starts at 1
-    days = (days % 365 % 30) + 1; // +1 because RTCTime expects day 1-31
-    
-    // Calculate day of week (0 = Sunday)
-    unsigned long dayOfWeek = (days + 4) % 7; // Jan 1, 1970 was Thursday (4)
-    
-    return RTCTime(
-        days, static_cast<Month>(month), year,
-        hours, minutes, seconds,
-        static_cast<DayOfWeek>((dayOfWeek % 7) + 1), // Convert to 1-7 range
-        SaveLight::SAVING_TIME_ACTIVE
-    );
-}
+// Storage for the objects above (static with WAKU_STATIC_ALLOCATION)
+ObjectSlot<Alarm> alarmSlot;
+ObjectSlot<DisplayManager> displayManagerSlot;
+ObjectSlot<ServerClient> serverClientSlot;
+ObjectSlot<SntpClient> sntpClientSlot;
+ObjectSlot<CO2Sensor> co2SensorSlot;
+ObjectSlot<SoundMeter> soundMeterSlot;
+ObjectSlot<ActivityDetector> activityDetectorSlot;
+ObjectSlot<ButtonHandler> buttonHandlerSlot;
 
-bool connectToWiFi() {
-    int attempts = 0;
-    const int maxAttempts = 5;
-    
-    while (status != WL_CONNECTED && attempts < maxAttempts) {
-        /* Debugging
-        Serial.print("Attempt ");
-        Serial.print(attempts + 1);
-        Serial.print(" of ");
-        Serial.print(maxAttempts);
-        Serial.print(" - Connecting to SSID: ");
-        Serial.println(ssid);
-        */
-
-        status = WiFi.begin(ssid, pass);
-        if (status != WL_CONNECTED) {
-            attempts++;
-            if (displayManager) {
-                displayManager->displayError(static_cast<int>(ErrorCode::WIFI_CONNECTION_FAILED));
-            }
-            
-            if (attempts < maxAttempts) {
-                vTaskDelay(pdMS_TO_TICKS(5000));  // Use vTaskDelay instead of Thread::sleep
-            }
-        }
-    }
-    
-    if (status == WL_CONNECTED) {
-        Serial.println("Connected to WiFi");
-        if (displayManager) {
-            displayManager->displayMessage("WAKU");
-        }
-        ArduinoOTA.begin(WiFi.localIP(), "Arduino", "password", InternalStorage);
-        return true;
-    } else {
-        Serial.println("Failed to connect to WiFi");
-        if (displayManager) {
-            displayManager->displayError(static_cast<int>(ErrorCode::WIFI_CONNECTION_FAILED));
-        }
-        return false;
+// Create the alarm with the schedule it last had: the one kept in RAM
+// across a reset, else the one in the config store, else the defaults
+Alarm* createAlarm() {
+    Alarm* created = alarmSlot.create(WAKE_HOUR, WAKE_MINUTE, WAKE_DURATION,
+                                      LED_PINS, LED_PIN_COUNT,
+                                      BUZZER_PIN, BUZZER_OVERDRIVE_PIN);
+    AlarmSchedule stored;
+    if (ConfigStore::get(ConfigKey::WAKE_SCHEDULE, stored)) {
+        created->restoreState(stored, false);
     }
+    Supervisor::attachAlarm(created);
+    return created;
+}
+
+// Start the OTA listener and the local API; runs after every WiFi (re)connect
+void onWiFiConnected() {
+    ArduinoOTA.begin(WiFi.localIP(), "Arduino", "password", InternalStorage);
+#if WAKU_LOCAL_API
+    LocalApi::begin();
+#endif
+}
+
+// Receive (and apply) an upload from the IDE; the network task calls it
+// outside the wake window
+void pollOta() {
+    ArduinoOTA.poll();
 }
 
 bool initializeSystem() {
     bool fullInit = true;
 
-    displayManager = new DisplayManager(matrix);
+    displayManager = displayManagerSlot.create(matrix);
     
-    co2Sensor = new CO2Sensor(CO2_PWM_PIN);
+    co2Sensor = co2SensorSlot.create(CO2_PWM_PIN);
     if (!co2Sensor->begin()) {
         Serial.println("ERROR: Failed to initialize CO2 sensor");
         displayManager->displayError(static_cast<int>(ErrorCode::CO2_SENSOR_INIT_FAILED));
         fullInit = false;
     }
 
-    if (!connectToWiFi()) {
-        Serial.println("WARNING: Operating without WiFi connection");
+    soundMeter = soundMeterSlot.create(MAX9814_PIN);
+    if (!soundMeter->begin()) {
+        Serial.println("ERROR: Failed to initialize sound sensor");
+        displayManager->displayError(static_cast<int>(ErrorCode::SOUND_SENSOR_INIT_FAILED));
         fullInit = false;
     }
-    
-    // Initialize server client if WiFi is available
-    if (WiFi.status() == WL_CONNECTED) {
-        alarm = new Alarm(1, 1, WAKE_DURATION,
-                        LED_PINS, LED_PIN_COUNT,
-                        BUZZER_PIN, BUZZER_OVERDRIVE_PIN);
-        
-        serverClient = new ServerClient(server_host, server_port, *displayManager, co2Sensor, alarm);
-        
-        if (!RTC.begin()) {
-            Serial.println("ERROR: RTC initialization failed");
-            displayManager->displayError(static_cast<int>(ErrorCode::RTC_INIT_FAILED));
-            fullInit = false;
-        } else {
-            int initialHour = WAKE_HOUR;
-            int initialMinute = WAKE_MINUTE;
-            unsigned long currentTime;
-            
-            DeviceUpdate initialUpdate;
-            if (serverClient->sendDeviceUpdateAndGetTime(initialUpdate, initialHour, initialMinute, currentTime)) {
-                RTCTime timeToSet = unixTimeToRTCTime(currentTime);
-                if (RTC.setTime(timeToSet)) {
-                    Serial.println("RTC updated successfully");
-                } else {
-                    Serial.println("ERROR: Failed to update RTC time");
-                    fullInit = false;
-                }
-            } else {
-                Serial.println("ERROR: Failed to get time from server");
-                Serial.println("WARNING: Using default alarm time");
-                fullInit = false;
-            }
-        }
-    } else {
-        Serial.println("WARNING: Operating without server connection");
+
+    // A clock that kept running across the reset is good as it is; after
+    // a power cut the alarm waits for the first server sync
+    if (!ClockSync::begin()) {
+        Serial.println("ERROR: RTC initialization failed");
+        displayManager->displayError(static_cast<int>(ErrorCode::RTC_INIT_FAILED));
         fullInit = false;
-        
-        // Try to initialize RTC anyway
-        if (!RTC.begin()) {
-            Serial.println("ERROR: RTC initialization failed");
-            displayManager->displayError(static_cast<int>(ErrorCode::RTC_INIT_FAILED));
-        }
-        
-        // Create alarm with default values
-        alarm = new Alarm(WAKE_HOUR, WAKE_MINUTE, WAKE_DURATION,
-                         LED_PINS, LED_PIN_COUNT,
-                         BUZZER_PIN, BUZZER_OVERDRIVE_PIN);
     }
+
+    // Before any network access, so the alarm works offline from the start
+    alarm = createAlarm();
+
+    // WiFi, OTA and the first sync happen in the network task
+    setWiFiConnectedListener(onWiFiConnected);
+    serverClient = serverClientSlot.create(server_host, server_port, server_ca_cert, *displayManager, co2Sensor, alarm);
+    sntpClient = sntpClientSlot.create(sntp_host, sntp_port);
+    // Firmware from the IDE and from the server, staged in the upper half of flash
+    OtaUpdater::begin(server_host, server_port, server_ca_cert, InternalStorage, pollOta);
     
+    // Missed-wake detection from PIR edges and microphone activity
+    activityDetector = activityDetectorSlot.create();
+    activityDetector->begin(PIR_PIN);
+    if (soundMeter) {
+        soundMeter->setBlockListener(ActivityDetector::soundBlockListener, activityDetector);
+    }
+    alarm->setActivityDetector(activityDetector);
+
     // Initialize button with proper pin mode
     pinMode(BUTTON_PIN, INPUT_PULLUP);
-    buttonHandler = new ButtonHandler(BUTTON_PIN, alarm, displayManager, co2Sensor);
+    buttonHandler = buttonHandlerSlot.create(BUTTON_PIN, alarm, displayManager, co2Sensor);
     buttonHandler->begin();
 
+    // Diagnostics on the serial port ("help" lists commands)
+    static const SerialConsole::Command COMMANDS[] = {
+        {"mem", "Stack and heap usage", MemoryMonitor::printReport},
+        {"sched", "Per-task busy time and wake-up jitter", TaskStats::printReport},
+        {"health", "Task heartbeats and recovery stages", Supervisor::printReport},
+        {"crash", "Dump crash records (\"crash clear\" erases)", CrashJournal::printReport},
+        {"boot", "Time from reset to each boot milestone", BootEvents::printReport},
+        {"time", "Local time, clock sync, time zone and next DST transition", ClockSync::printReport},
+        {"config", "Persistent settings in data flash", ConfigStore::printReport},
+        {"net", "Server connection upkeep: connects, config polls, bytes, socket time", ServerClient::printUpkeep},
+        {"dns", "Cached server addresses and DNS lookups", DnsCache::printReport},
+        {"radio", "WiFi radio mode and radio-on time per night", RadioManager::printReport},
+        {"ota", "Firmware version, update checks and the last download", OtaUpdater::printReport},
+#if WAKU_LOCAL_API
+        {"api", "Local /metrics and /state endpoint: port and requests served", LocalApi::printReport},
+#endif
+#if WAKU_PROFILING
+        {"prof", "Probe timings (\"prof reset\" clears)", Profiler::printReport},
+#endif
+    };
+    static_assert(sizeof(COMMANDS) / sizeof(COMMANDS[0]) <= SerialConsole::MAX_COMMANDS,
+                  "Raise SerialConsole::MAX_COMMANDS");
+    for (const SerialConsole::Command& command : COMMANDS) {
+        SerialConsole::registerCommand(command.name, command.help, command.handler);
+    }
+
     Serial.println("\n=== Initialization Complete ===");
     Serial.print("Status: ");
     Serial.println(fullInit ? "FULL" : "DEGRADED");
@@ -175,24 +177,20 @@ bool initializeSystem() {
     return fullInit;
 }
 
-// Add cleanup function after object declarations
-void cleanupResources() {
-    if (alarm) { delete alarm; alarm = nullptr; }
-    if (displayManager) { delete displayManager; displayManager = nullptr; }
-    if (serverClient) { delete serverClient; serverClient = nullptr; }
-    if (co2Sensor) { delete co2Sensor; co2Sensor = nullptr; }
-    if (buttonHandler) { delete buttonHandler; buttonHandler = nullptr; }
-}
-
 void setup() {
+    CycleCounter::begin();
+    Log::begin();
     Wire.begin();
+    // No waiting for a serial monitor: headless boots must not stall here.
+    // Missed output can be recalled with "boot" and the other commands.
     Serial.begin(9600);
-    while (!Serial) {
-        ; // Wait for serial port to connect
-    }
-
-    delay(2000);
     Serial.println("\n\nSerial initialized. Waku waking up...");
+    BootEvents::begin();
+    Supervisor::begin();
+    CrashJournal::begin();
+    ConfigStore::begin();
+    TimeZone::begin();
+    printRamBudget();
 
     // Initialize the system
     systemInitialized = initializeSystem();
@@ -201,16 +199,20 @@ void setup() {
     if (!TaskManager::initializeTasks(
         alarm,
         serverClient,
+        sntpClient,
         displayManager,
         co2Sensor,
+        soundMeter,
         buttonHandler
     )) {
         Serial.println("ERROR: Failed to initialize tasks");
         displayManager->displayError(static_cast<int>(ErrorCode::TASK_INIT_FAILED));
-        cleanupResources();  // Clean up before halting
-        while(1); // Critical error - halt system
+        Supervisor::recoverFromBootFailure(ErrorCode::TASK_INIT_FAILED, displayManager);
     }
     
+    // From here on the supervisor task has to feed it
+    Supervisor::startWatchdog();
+    
     // Start the FreeRTOS scheduler
     vTaskStartScheduler();
     Serial.println("Scheduler started. All systems operational.");
@@ -218,7 +220,7 @@ void setup() {
     // If we get here, something went wrong with the scheduler
     Serial.println("ERROR: Scheduler failed to start!");
     displayManager->displayError(static_cast<int>(ErrorCode::TASK_INIT_FAILED));
-    while(1); // Critical error - halt system
+    Supervisor::recoverFromBootFailure(ErrorCode::TASK_INIT_FAILED, displayManager);
 }
 
 void loop() {
@@ -0,0 +1,292 @@
+#include "wavetable_synth.h"
+#include "cycle_counter.h"
+
+// One cycle of a soft bell-like tone (fundamental with weak 2nd and 3rd
+// harmonics), Q15, resident in flash
+static const int16_t WAVETABLE[256] = {
+         0,   1392,   2781,   4164,   5539,   6903,   8253,   9586,
+     10900,  12191,  13459,  14700,  15911,  17092,  18239,  19351,
+     20426,  21462,  22457,  23411,  24321,  25187,  26008,  26782,
+     27510,  28190,  28822,  29406,  29942,  30430,  30870,  31262,
+     31606,  31905,  32157,  32365,  32528,  32649,  32728,  32767,
+     32767,  32729,  32655,  32547,  32407,  32235,  32034,  31806,
+     31552,  31275,  30976,  30657,  30319,  29965,  29597,  29216,
+     28824,  28422,  28012,  27596,  27176,  26751,  26325,  25898,
+     25471,  25046,  24623,  24203,  23788,  23377,  22971,  22571,
+     22178,  21791,  21410,  21037,  20671,  20311,  19958,  19612,
+     19272,  18938,  18609,  18286,  17967,  17651,  17339,  17030,
+     16722,  16415,  16109,  15803,  15495,  15186,  14874,  14559,
+     14240,  13916,  13586,  13251,  12909,  12560,  12203,  11838,
+     11465,  11083,  10692,  10291,   9881,   9462,   9032,   8594,
+      8146,   7688,   7222,   6747,   6263,   5771,   5272,   4766,
+      4254,   3735,   3211,   2683,   2151,   1616,   1079,    540,
+         0,   -540,  -1079,  -1616,  -2151,  -2683,  -3211,  -3735,
+     -4254,  -4766,  -5272,  -5771,  -6263,  -6747,  -7222,  -7688,
+     -8146,  -8594,  -9032,  -9462,  -9881, -10291, -10692, -11083,
+    -11465, -11838, -12203, -12560, -12909, -13251, -13586, -13916,
+    -14240, -14559, -14874, -15186, -15495, -15803, -16109, -16415,
+    -16722, -17030, -17339, -17651, -17967, -18286, -18609, -18938,
+    -19272, -19612, -19958, -20311, -20671, -21037, -21410, -21791,
+    -22178, -22571, -22971, -23377, -23788, -24203, -24623, -25046,
+    -25471, -25898, -26325, -26751, -27176, -27596, -28012, -28422,
+    -28824, -29216, -29597, -29965, -30319, -30657, -30976, -31275,
+    -31552, -31806, -32034, -32235, -32407, -32547, -32655, -32729,
+    -32767, -32767, -32728, -32649, -32528, -32365, -32157, -31905,
+    -31606, -31262, -30870, -30430, -29942, -29406, -28822, -28190,
+    -27510, -26782, -26008, -25187, -24321, -23411, -22457, -21462,
+    -20426, -19351, -18239, -17092, -15911, -14700, -13459, -12191,
+    -10900,  -9586,  -8253,  -6903,  -5539,  -4164,  -2781,  -1392,
+};
+
+// The sample interrupt must preempt rendering; both stay above the RTOS
+static const uint8_t SAMPLE_IRQ_PRIORITY = 8;
+static const uint8_t RENDER_IRQ_PRIORITY = 14;
+
+static const uint16_t DAC_MIDSCALE = 2048;
+
+WavetableSynth::WavetableSynth()
+    : nextVoice(0), voiceLimit(NUM_VOICES), targetVolume(0), volume(0),
+      readPos(0), pendingHalf(NO_PENDING_HALF), timersReady(false), outputActive(false),
+      blocksRendered(0), maxBlockCycles(0), totalBlockCycles(0), underBudgetBlocks(0) {
+    memset(voices, 0, sizeof(voices));
+    for (uint16_t i = 0; i < 2 * BLOCK_SIZE; i++) {
+        buffer[i] = DAC_MIDSCALE;
+    }
+}
+
+bool WavetableSynth::begin() {
+    // The core sets up the pin and the DAC module on the first analogWrite().
+    // Samples then go straight to DADR0, so the global write resolution stays
+    // at the 8 bits the dawn LEDs are written in.
+    analogWrite(DAC, 128);
+    R_DAC->DADR[0] = DAC_MIDSCALE;
+
+    uint8_t sampleTimerType = GPT_TIMER;
+    int8_t sampleChannel = FspTimer::get_available_timer(sampleTimerType);
+    uint8_t renderTimerType = GPT_TIMER;
+    int8_t renderChannel = sampleChannel < 0 ? -1 : FspTimer::get_available_timer(renderTimerType);
+    if (sampleChannel < 0 || renderChannel < 0) {
+        Serial.println("WARNING: No free timer for synthesizer");
+        return false;
+    }
+
+    // Rendering runs at twice the block rate so a finished half is refilled
+    // well before the sample interrupt wraps around to it
+    timersReady =
+        sampleTimer.begin(TIMER_MODE_PERIODIC, sampleTimerType, sampleChannel, SAMPLE_RATE, 0.0f, sampleTimerCallback, this) &&
+        sampleTimer.setup_overflow_irq(SAMPLE_IRQ_PRIORITY) &&
+        sampleTimer.open() &&
+        renderTimer.begin(TIMER_MODE_PERIODIC, renderTimerType, renderChannel, 2.0f * SAMPLE_RATE / BLOCK_SIZE, 0.0f, renderTimerCallback, this) &&
+        renderTimer.setup_overflow_irq(RENDER_IRQ_PRIORITY) &&
+        renderTimer.open();
+
+    if (!timersReady) {
+        Serial.println("WARNING: Synthesizer timer setup failed");
+    }
+    return timersReady;
+}
+
+void WavetableSynth::start() {
+    if (!timersReady || outputActive) {
+        return;
+    }
+    readPos = 0;
+    renderHalf(0);
+    renderHalf(1);
+    pendingHalf = NO_PENDING_HALF;
+    outputActive = true;
+    renderTimer.start();
+    sampleTimer.start();
+}
+
+void WavetableSynth::stop() {
+    if (!outputActive) {
+        return;
+    }
+    outputActive = false;
+    sampleTimer.stop();
+    renderTimer.stop();
+    allNotesOff();
+    volume = 0;
+    R_DAC->DADR[0] = DAC_MIDSCALE;
+}
+
+void WavetableSynth::sampleTimerCallback(timer_callback_args_t* args) {
+    WavetableSynth* self = static_cast<WavetableSynth*>(const_cast<void*>(args->p_context));
+
+    uint16_t pos = self->readPos;
+    R_DAC->DADR[0] = self->buffer[pos];
+
+    if (++pos == 2 * BLOCK_SIZE) {
+        pos = 0;
+        self->pendingHalf = 1;
+    } else if (pos == BLOCK_SIZE) {
+        self->pendingHalf = 0;
+    }
+    self->readPos = pos;
+}
+
+void WavetableSynth::renderTimerCallback(timer_callback_args_t* args) {
+    WavetableSynth* self = static_cast<WavetableSynth*>(const_cast<void*>(args->p_context));
+
+    uint8_t half = self->pendingHalf;
+    if (half == NO_PENDING_HALF) {
+        return;
+    }
+    self->pendingHalf = NO_PENDING_HALF;
+    self->renderHalf(half);
+}
+
+void WavetableSynth::renderHalf(uint8_t half) {
+    int16_t samples[BLOCK_SIZE];
+
+    uint32_t startCycles = CycleCounter::now();
+    renderBlock(samples, BLOCK_SIZE);
+    uint32_t blockCycles = CycleCounter::now() - startCycles;
+
+    // Signed 16-bit to unsigned 12-bit DAC codes
+    uint16_t* out = &buffer[half * BLOCK_SIZE];
+    for (uint16_t i = 0; i < BLOCK_SIZE; i++) {
+        out[i] = static_cast<uint16_t>((samples[i] >> 4) + DAC_MIDSCALE);
+    }
+
+    enforceBudget(blockCycles);
+}
+
+void WavetableSynth::enforceBudget(uint32_t blockCycles) {
+    blocksRendered++;
+    totalBlockCycles += blockCycles;
+    if (blockCycles > maxBlockCycles) {
+        maxBlockCycles = blockCycles;
+    }
+
+    // Shed a voice whenever a block goes over budget; dropped notes are
+    // preferable to starving the tasks
+    uint32_t budgetCycles = (SystemCoreClock / SAMPLE_RATE) * BLOCK_SIZE * CPU_BUDGET_PERCENT / 100;
+    uint8_t limit = voiceLimit;
+    if (blockCycles > budgetCycles) {
+        underBudgetBlocks = 0;
+        if (limit > 1) {
+            voiceLimit = limit - 1;
+            voices[limit - 1].stage = EnvelopeStage::OFF;
+            voices[limit - 1].level = 0;
+        }
+        return;
+    }
+
+    // Give a voice back after a second of blocks that would have stayed
+    // under budget with it; the cost grows about linearly with voices
+    if (limit < NUM_VOICES && blockCycles * (limit + 1) / limit <= budgetCycles) {
+        if (++underBudgetBlocks >= RESTORE_BLOCKS) {
+            voiceLimit = limit + 1;
+            underBudgetBlocks = 0;
+        }
+    } else {
+        underBudgetBlocks = 0;
+    }
+}
+
+void WavetableSynth::noteOn(uint16_t frequency, uint16_t durationMs) {
+    if (frequency == 0) {
+        return;  // Rests let the previous notes ring out
+    }
+
+    uint8_t limit = voiceLimit;
+    if (nextVoice >= limit) {
+        nextVoice = 0;
+    }
+    Voice& voice = voices[nextVoice];
+    nextVoice = (nextVoice + 1) % limit;
+
+    // The attack starts from the current level, so stealing a voice does not click
+    voice.stage = EnvelopeStage::OFF;
+    voice.phaseIncrement = static_cast<uint32_t>((static_cast<uint64_t>(frequency) << 32) / SAMPLE_RATE);
+    voice.gateSamples = static_cast<uint32_t>(durationMs) * SAMPLE_RATE / 1000;
+    if (voice.gateSamples == 0) {
+        voice.gateSamples = 1;
+    }
+    voice.stage = EnvelopeStage::ATTACK;
+}
+
+void WavetableSynth::allNotesOff() {
+    for (uint8_t i = 0; i < NUM_VOICES; i++) {
+        voices[i].stage = EnvelopeStage::OFF;
+        voices[i].level = 0;
+    }
+}
+
+void WavetableSynth::setVolume(float level) {
+    if (level < 0.0f) level = 0.0f;
+    if (level > 1.0f) level = 1.0f;
+    targetVolume = static_cast<int32_t>(level * ENVELOPE_MAX);
+}
+
+void WavetableSynth::renderBlock(int16_t* out, uint16_t count) {
+    // Glide towards the target volume once per block
+    int32_t target = targetVolume;
+    int32_t step = (target - volume) / 8;
+    volume = step != 0 ? volume + step : target;
+
+    // Mix headroom: each voice may use 1/NUM_VOICES of full scale
+    const int32_t gain = volume / NUM_VOICES;
+    const uint8_t limit = voiceLimit;
+
+    for (uint16_t i = 0; i < count; i++) {
+        int32_t mix = 0;
+
+        for (uint8_t v = 0; v < limit; v++) {
+            Voice& voice = voices[v];
+            if (voice.stage == EnvelopeStage::OFF) {
+                continue;
+            }
+
+            // ADSR envelope, linear segments
+            if (voice.gateSamples > 0 && --voice.gateSamples == 0) {
+                voice.stage = EnvelopeStage::RELEASE;
+            }
+            switch (voice.stage) {
+                case EnvelopeStage::ATTACK:
+                    voice.level += ATTACK_STEP;
+                    if (voice.level >= ENVELOPE_MAX) {
+                        voice.level = ENVELOPE_MAX;
+                        voice.stage = EnvelopeStage::DECAY;
+                    }
+                    break;
+                case EnvelopeStage::DECAY:
+                    voice.level -= DECAY_STEP;
+                    if (voice.level <= SUSTAIN_LEVEL) {
+                        voice.level = SUSTAIN_LEVEL;
+                        voice.stage = EnvelopeStage::SUSTAIN;
+                    }
+                    break;
+                case EnvelopeStage::RELEASE:
+                    voice.level -= RELEASE_STEP;
+                    if (voice.level <= 0) {
+                        voice.level = 0;
+                        voice.stage = EnvelopeStage::OFF;
+                    }
+                    break;
+                default:
+                    break;
+            }
+
+            mix += (WAVETABLE[voice.phase >> 24] * voice.level) >> 15;
+            voice.phase += voice.phaseIncrement;
+        }
+
+        out[i] = static_cast<int16_t>((mix * gain) >> 15);
+    }
+}
+
+WavetableSynth::LoadStats WavetableSynth::getLoadStats() {
+    noInterrupts();
+    LoadStats stats;
+    stats.blocks = blocksRendered;
+    stats.maxCyclesPerSample = maxBlockCycles / BLOCK_SIZE;
+    stats.meanCyclesPerSample = blocksRendered > 0
+        ? static_cast<uint32_t>(totalBlockCycles / blocksRendered / BLOCK_SIZE)
+        : 0;
+    stats.voiceLimit = voiceLimit;
+    interrupts();
+    return stats;
+}
@@ -0,0 +1,102 @@
+#ifndef WAVETABLE_SYNTH_H
+#define WAVETABLE_SYNTH_H
+
+#include <Arduino.h>
+#include <FspTimer.h>
+
+// Small polyphonic wavetable synthesizer in fixed point. A high-priority timer
+// interrupt writes one sample per period to the 12-bit DAC from a double
+// buffer; a second, lower-priority timer interrupt renders each half in a
+// block once it has been played. renderBlock() does not touch any hardware
+// and can be built on its own to render to a file.
+class WavetableSynth {
+public:
+    static const uint32_t SAMPLE_RATE = 16000;
+    static const uint8_t NUM_VOICES = 3;
+    static const uint16_t BLOCK_SIZE = 64;
+
+    // Share of the CPU the renderer may use before voices are shed. A shed
+    // voice comes back after RESTORE_BLOCKS blocks that would have fit with it.
+    static const uint8_t CPU_BUDGET_PERCENT = 15;
+    static const uint16_t RESTORE_BLOCKS = SAMPLE_RATE / BLOCK_SIZE;     // 1 s
+
+    struct LoadStats {
+        uint32_t blocks;
+        uint32_t maxCyclesPerSample;
+        uint32_t meanCyclesPerSample;
+        uint8_t voiceLimit;
+    };
+
+private:
+    enum class EnvelopeStage : uint8_t { OFF, ATTACK, DECAY, SUSTAIN, RELEASE };
+
+    struct Voice {
+        uint32_t phase;
+        uint32_t phaseIncrement;
+        int32_t level;              // Envelope level, Q15
+        uint32_t gateSamples;       // Samples left before release
+        EnvelopeStage stage;
+    };
+
+    // Envelope shape, as per-sample steps in Q15
+    static const int32_t ENVELOPE_MAX = 32767;
+    static const int32_t SUSTAIN_LEVEL = 20000;
+    static const int32_t ATTACK_STEP = ENVELOPE_MAX / (SAMPLE_RATE * 30 / 1000);       // 30 ms
+    static const int32_t DECAY_STEP = (ENVELOPE_MAX - SUSTAIN_LEVEL) / (SAMPLE_RATE * 150 / 1000);  // 150 ms
+    static const int32_t RELEASE_STEP = SUSTAIN_LEVEL / (SAMPLE_RATE * 250 / 1000);     // 250 ms
+
+    Voice voices[NUM_VOICES];
+    uint8_t nextVoice;
+    volatile uint8_t voiceLimit;
+
+    // Master volume, Q15. The target follows dawn progress; the applied value
+    // slides towards it once per block so changes do not click.
+    volatile int32_t targetVolume;
+    int32_t volume;
+
+    // Output double buffer of DAC codes
+    static const uint8_t NO_PENDING_HALF = 0xFF;
+    uint16_t buffer[2 * BLOCK_SIZE];
+    volatile uint16_t readPos;
+    volatile uint8_t pendingHalf;   // Half that has been played and needs rendering
+
+    FspTimer sampleTimer;
+    FspTimer renderTimer;
+    bool timersReady;
+    volatile bool outputActive;
+
+    // Render cost, measured on the cycle counter
+    uint32_t blocksRendered;
+    uint32_t maxBlockCycles;
+    uint64_t totalBlockCycles;
+    uint16_t underBudgetBlocks;     // In a row, towards restoring a voice
+
+    static void sampleTimerCallback(timer_callback_args_t* args);
+    static void renderTimerCallback(timer_callback_args_t* args);
+    void renderHalf(uint8_t half);
+    void enforceBudget(uint32_t blockCycles);
+
+public:
+    WavetableSynth();
+
+    // Configures the DAC and claims a sample timer
+    bool begin();
+
+    void start();
+    void stop();
+    bool isActive() const { return outputActive; }
+
+    // Start a note; it is released after durationMs. Safe to call from an ISR.
+    void noteOn(uint16_t frequency, uint16_t durationMs);
+    void allNotesOff();
+
+    // 0.0 (silent) to 1.0 (full scale)
+    void setVolume(float level);
+
+    // Render signed 16-bit samples at SAMPLE_RATE, independent of the hardware
+    void renderBlock(int16_t* out, uint16_t count);
+
+    LoadStats getLoadStats();
+};
+
+#endif
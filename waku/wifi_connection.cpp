@@ -0,0 +1,62 @@
+#include "wifi_connection.h"
+#include <Arduino_FreeRTOS.h>
+#include "global_variables.h"
+#include "error_codes.h"
+
+static WiFiConnectedListener connectedListener = nullptr;
+
+void setWiFiConnectedListener(WiFiConnectedListener listener) {
+    connectedListener = listener;
+}
+
+bool connectToWiFi(DisplayManager* display, int maxAttempts) {
+    int attempts = 0;
+    status = WiFi.status();  // The link may have dropped since the last call
+    
+    while (status != WL_CONNECTED && attempts < maxAttempts) {
+        /* Debugging
+        Serial.print("Attempt ");
+        Serial.print(attempts + 1);
+        Serial.print(" of ");
+        Serial.print(maxAttempts);
+        Serial.print(" - Connecting to SSID: ");
+        Serial.println(ssid);
+        */
+
+        status = WiFi.begin(ssid, pass);
+        if (status != WL_CONNECTED) {
+            attempts++;
+            if (display) {
+                display->displayError(static_cast<int>(ErrorCode::WIFI_CONNECTION_FAILED));
+            }
+            
+            if (attempts < maxAttempts) {
+                vTaskDelay(pdMS_TO_TICKS(5000));  // Use vTaskDelay instead of Thread::sleep
+            }
+        }
+    }
+    
+    if (status == WL_CONNECTED) {
+        Serial.println("Connected to WiFi");
+        if (display) {
+            display->displayMessage("WAKU");
+        }
+        if (connectedListener) {
+            connectedListener();
+        }
+        return true;
+    } else {
+        Serial.println("Failed to connect to WiFi");
+        if (display) {
+            display->displayError(static_cast<int>(ErrorCode::WIFI_CONNECTION_FAILED));
+        }
+        return false;
+    }
+}
+
+bool reconnectWiFi(DisplayManager* display, int maxAttempts) {
+    WiFi.disconnect();
+    WiFi.end();
+    status = WL_IDLE_STATUS;
+    return connectToWiFi(display, maxAttempts);
+}
@@ -0,0 +1,21 @@
+#ifndef WIFI_CONNECTION_H
+#define WIFI_CONNECTION_H
+
+#include <Arduino.h>
+#include <WiFiS3.h>
+#include "display_manager.h"
+
+// Called after every successful connect, e.g. to (re)start the OTA listener.
+// ArduinoOTA defines its globals in its header, so it stays in waku.ino.
+typedef void (*WiFiConnectedListener)();
+void setWiFiConnectedListener(WiFiConnectedListener listener);
+
+// Join the configured network, retrying up to maxAttempts times 5 s apart.
+// Progress and failures are shown on display when it is set.
+bool connectToWiFi(DisplayManager* display, int maxAttempts = 5);
+
+// Recovery path: drop the association and shut the radio down, then join
+// again. Clears whatever state a task killed mid-transfer left in the module.
+bool reconnectWiFi(DisplayManager* display, int maxAttempts = 1);
+
+#endif